@@ -0,0 +1,598 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "autosave.h"
+
+#include "documentmanager.h"
+#include "mainwindow.h"
+#include "settings.h"
+#include "textcodec.h"
+#include "textdocument.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QMessageBox>
+#include <QStandardPaths>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTimerEvent>
+
+Autosave *Autosave::s_instance = NULL;
+
+AutosaveWriter::AutosaveWriter(QObject *parent) :
+    QThread(parent)
+{
+}
+
+AutosaveWriter::~AutosaveWriter()
+{
+    enqueue(AutosaveJob(AutosaveJob::Stop));
+    wait();
+}
+
+void AutosaveWriter::enqueue(const AutosaveJob &job)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_jobs.append(job);
+    m_jobsAvailable.wakeOne();
+}
+
+// static
+bool AutosaveWriter::replay(const QString &path, QString *location, qint64 *codecNumber, QString *text)
+{
+    Q_ASSERT(location != NULL);
+    Q_ASSERT(codecNumber != NULL);
+    Q_ASSERT(text != NULL);
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint8 formatVersion;
+
+    stream >> formatVersion;
+
+    if (stream.status() != QDataStream::Ok || formatVersion != FormatVersion) {
+        qDebug() << "AutosaveWriter: Ignoring journal with unknown format version" << path;
+
+        return false;
+    }
+
+    bool checkpointed = false;
+
+    while (!stream.atEnd()) {
+        QByteArray record;
+        quint16 checksum;
+
+        stream >> record;
+        stream >> checksum;
+
+        // The rest was cut off or garbled by the crash
+        if (stream.status() != QDataStream::Ok || checksum != qChecksum(record.constData(), (uint)record.length())) {
+            break;
+        }
+
+        QDataStream recordStream(record);
+        quint8 kind;
+
+        recordStream >> kind;
+
+        if (kind == AutosaveJob::Checkpoint) {
+            QByteArray recordLocation;
+            QByteArray recordText;
+
+            recordStream >> recordLocation;
+            recordStream >> *codecNumber;
+            recordStream >> recordText;
+
+            *location = QString::fromUtf8(recordLocation);
+            *text = QString::fromUtf8(qUncompress(recordText));
+            checkpointed = true;
+        } else if (kind == AutosaveJob::Change && checkpointed) {
+            qint32 position;
+            qint32 charsRemoved;
+            QByteArray inserted;
+
+            recordStream >> position;
+            recordStream >> charsRemoved;
+            recordStream >> inserted;
+
+            // QTextDocument counts the final paragraph separator in some changes, that isn't part of the plain text
+            position = qBound(0, position, text->length());
+            charsRemoved = qBound(0, charsRemoved, text->length() - position);
+
+            text->replace(position, charsRemoved, QString::fromUtf8(inserted));
+        }
+    }
+
+    return checkpointed;
+}
+
+// protected
+void AutosaveWriter::run()
+{
+    forever {
+        QList<AutosaveJob> jobs;
+
+        m_mutex.lock();
+
+        while (m_jobs.isEmpty()) {
+            m_jobsAvailable.wait(&m_mutex);
+        }
+
+        jobs.swap(m_jobs);
+
+        m_mutex.unlock();
+
+        // Flush once per batch, typing fast queues several changes at once
+        bool stop = false;
+
+        foreach (const AutosaveJob &job, jobs) {
+            if (job.kind == AutosaveJob::Stop) {
+                stop = true;
+
+                break;
+            }
+
+            process(job);
+        }
+
+        foreach (QFile *file, m_files) {
+            file->flush();
+        }
+
+        if (stop) {
+            break;
+        }
+    }
+
+    qDeleteAll(m_files);
+
+    m_files.clear();
+}
+
+// private
+void AutosaveWriter::process(const AutosaveJob &job)
+{
+    QByteArray record;
+    QDataStream recordStream(&record, QIODevice::WriteOnly);
+
+    recordStream << (quint8)job.kind;
+
+    if (job.kind == AutosaveJob::Checkpoint) {
+        QFile *file = new QFile(job.path);
+
+        if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qDebug() << "AutosaveWriter: Could not open" << job.path << "for writing:" << file->errorString();
+
+            delete file;
+
+            return;
+        }
+
+        QDataStream stream(file);
+
+        stream << (quint8)FormatVersion;
+
+        recordStream << job.location.toUtf8();
+        recordStream << job.codecNumber;
+        recordStream << qCompress(job.text.toUtf8());
+
+        writeRecord(file, record);
+
+        // The previous file is only removed once the new one is complete, one of them survives a crash in between
+        file->flush();
+
+        m_files.insert(job.path, file);
+
+        if (!job.previousPath.isEmpty()) {
+            delete m_files.take(job.previousPath);
+
+            QFile::remove(job.previousPath);
+        }
+    } else if (job.kind == AutosaveJob::Change) {
+        QFile *file = m_files.value(job.path, NULL);
+
+        if (file == NULL) {
+            return;
+        }
+
+        recordStream << (qint32)job.position;
+        recordStream << (qint32)job.charsRemoved;
+        recordStream << job.text.toUtf8();
+
+        writeRecord(file, record);
+    } else if (job.kind == AutosaveJob::Discard) {
+        delete m_files.take(job.path);
+
+        QFile::remove(job.path);
+    }
+}
+
+// private
+void AutosaveWriter::writeRecord(QFile *file, const QByteArray &record)
+{
+    QDataStream stream(file);
+
+    stream << record;
+    stream << qChecksum(record.constData(), (uint)record.length());
+}
+
+Autosave::Autosave(QObject *parent) :
+    QObject(parent),
+    m_enabled(Settings::settings()->value("Autosave/Enabled", true).toBool()),
+    m_lockFile(NULL),
+    m_writer(new AutosaveWriter(this)),
+    m_nextJournalNumber(0)
+{
+    s_instance = this;
+
+    int checkpointInterval = Settings::settings()->value("Autosave/CheckpointInterval",
+                                                         (int)DefaultCheckpointInterval).toInt();
+
+    if (m_enabled && checkpointInterval > 0) {
+        m_checkpointTimer.start(checkpointInterval * 1000, this);
+    }
+
+    m_writer->start(QThread::LowPriority);
+
+    connect(DocumentManager::instance(), &DocumentManager::opened, this, &Autosave::addDocument);
+    connect(DocumentManager::instance(), &DocumentManager::aboutToBeClosed, this, &Autosave::removeDocument);
+}
+
+Autosave::~Autosave()
+{
+    // Writes the remaining jobs. The journals of documents that are still modified are kept for the next start.
+    delete m_writer;
+    delete m_lockFile;
+
+    if (!m_directory.isEmpty() && m_journals.isEmpty()) {
+        QDir(m_directory).removeRecursively();
+    }
+
+    s_instance = NULL;
+}
+
+// static
+void Autosave::recover()
+{
+    QDir base(baseDirectory());
+    QList<QLockFile *> lockFiles;
+    QStringList directories;
+    QMap<QString, QMap<int, QString> > journalPaths; // by journal name and sequence
+
+    foreach (const QString &name, base.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QString &directory = base.filePath(name);
+
+        if (directory == s_instance->m_directory) {
+            continue;
+        }
+
+        // Hold the lock until the recovery is done, so that another instance starting at the same time skips it
+        QLockFile *lockFile = new QLockFile(QDir(directory).filePath("lock"));
+
+        if (!lockFile->tryLock(0)) {
+            delete lockFile; // the instance is still running
+
+            continue;
+        }
+
+        lockFiles.append(lockFile);
+        directories.append(directory);
+
+        foreach (const QFileInfo &fileInfo, QDir(directory).entryInfoList(QStringList("*.journal"), QDir::Files)) {
+            const QString &baseName = fileInfo.completeBaseName();
+            const QString &journalName = QDir(directory).filePath(baseName.section('-', 0, 0));
+
+            journalPaths[journalName].insert(baseName.section('-', 1, 1).toInt(), fileInfo.filePath());
+        }
+    }
+
+    if (!journalPaths.isEmpty()) {
+        QString message = QString("Unsaved changes of %1 document(s) were left over from an earlier session. "
+                                  "Recover them?").arg(journalPaths.size());
+
+        if (QMessageBox::question(MainWindow::instance(), "Recover Unsaved Changes", message, "Recover",
+                                  "Discard") == 0) {
+            foreach (const QMap<int, QString> &paths, journalPaths) {
+                recoverJournal(paths);
+            }
+        }
+    }
+
+    // Unlock first, a lock file can't be removed while it's held on every platform
+    for (int i = 0; i < directories.length(); ++i) {
+        delete lockFiles.at(i);
+
+        QDir(directories.at(i)).removeRecursively();
+    }
+}
+
+// private static
+void Autosave::recoverJournal(const QMap<int, QString> &paths)
+{
+    QMapIterator<int, QString> it(paths);
+    QString locationPath;
+    qint64 codecNumber = -1;
+    QString text;
+    bool replayed = false;
+
+    // A crash during a checkpoint leaves the previous file behind, that is used if the newest one is incomplete
+    it.toBack();
+
+    while (it.hasPrevious() && !replayed) {
+        replayed = AutosaveWriter::replay(it.previous().value(), &locationPath, &codecNumber, &text);
+    }
+
+    if (!replayed) {
+        return;
+    }
+
+    Location location(locationPath);
+
+    if (!location.isEmpty()) {
+        Document *document = DocumentManager::find(location);
+
+        // The restored document only knows the saved file
+        if (document != NULL) {
+            DocumentManager::close(document);
+        }
+    }
+
+    TextCodec *codec = TextCodec::fromNumber(codecNumber);
+
+    if (codec == NULL) {
+        codec = TextCodec::fromName("UTF-8");
+    }
+
+    TextCodecState state;
+    QByteArray data = codec->encode(text.constData(), text.length(), &state);
+
+    // The text might contain chars that were typed but can't be saved with the codec, don't lose them here
+    if (state.hasError()) {
+        TextCodecState utf8State;
+
+        codec = TextCodec::fromName("UTF-8");
+        data = codec->encode(text.constData(), text.length(), &utf8State);
+    }
+
+    QString error;
+    Document *document = DocumentManager::load(location, Document::Text, data, codec, &error);
+
+    if (document == NULL) {
+        if (error.isEmpty()) {
+            error = QString("Could not recover \"%1\": Unknown error.").arg(location.path("unnamed"));
+        }
+
+        QMessageBox::critical(MainWindow::instance(), "Recover File Error", error);
+
+        return;
+    }
+
+    document->setModified(true);
+}
+
+// protected
+void Autosave::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_checkpointTimer.timerId()) {
+        QObject::timerEvent(event);
+
+        return;
+    }
+
+    QMutableHashIterator<TextDocument *, Journal> it(m_journals);
+
+    while (it.hasNext()) {
+        it.next();
+
+        if (it.value().changeCount > 0) {
+            checkpoint(it.key(), &it.value());
+        }
+    }
+}
+
+// private slot
+void Autosave::addDocument(Document *document)
+{
+    TextDocument *textDocument = qobject_cast<TextDocument *>(document);
+
+    if (textDocument == NULL) {
+        return;
+    }
+
+    m_documents.insert(textDocument->internalDocument(), textDocument);
+
+    connect(textDocument, &Document::modificationChanged, this, &Autosave::updateModificationOfSender);
+    connect(textDocument->internalDocument(), &QTextDocument::contentsChange, this, &Autosave::recordContentsChange);
+}
+
+// private slot
+void Autosave::removeDocument(Document *document)
+{
+    TextDocument *textDocument = qobject_cast<TextDocument *>(document);
+
+    if (textDocument == NULL) {
+        return;
+    }
+
+    discard(textDocument);
+
+    m_documents.remove(textDocument->internalDocument());
+
+    disconnect(textDocument, &Document::modificationChanged, this, &Autosave::updateModificationOfSender);
+    disconnect(textDocument->internalDocument(), &QTextDocument::contentsChange, this, &Autosave::recordContentsChange);
+}
+
+// private slot
+void Autosave::updateModificationOfSender(bool modified)
+{
+    TextDocument *document = qobject_cast<TextDocument *>(sender());
+
+    Q_ASSERT(document != NULL);
+
+    if (!modified) {
+        discard(document);
+    } else if (m_enabled && !m_journals.contains(document)) {
+        start(document);
+    }
+}
+
+// private slot
+void Autosave::recordContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    QTextDocument *internalDocument = qobject_cast<QTextDocument *>(sender());
+    TextDocument *document = m_documents.value(internalDocument, NULL);
+
+    // QTextDocument emits contentsChange before modificationChanged, so the first change to an unmodified document
+    // isn't recorded here. It's part of the checkpoint that starts the journal.
+    if (document == NULL || !m_journals.contains(document)) {
+        return;
+    }
+
+    Journal &journal = m_journals[document];
+    QTextCursor cursor(internalDocument);
+    int end = qMin(position + charsAdded, internalDocument->characterCount() - 1);
+
+    cursor.setPosition(qMin(position, end));
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+
+    // Use the same line breaks as QTextDocument::toPlainText does for the checkpoints
+    QString text = cursor.selectedText();
+
+    text.replace(QChar::ParagraphSeparator, '\n');
+    text.replace(QChar::LineSeparator, '\n');
+    text.replace(QChar::Nbsp, ' ');
+
+    AutosaveJob job(AutosaveJob::Change);
+
+    job.path = journalPath(journal);
+    job.position = position;
+    job.charsRemoved = charsRemoved;
+    job.text = text;
+
+    m_writer->enqueue(job);
+
+    ++journal.changeCount;
+}
+
+// private static
+QString Autosave::baseDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)).filePath("ZeroEditor/Autosave");
+}
+
+// private
+bool Autosave::createDirectory()
+{
+    if (m_lockFile != NULL) {
+        return true;
+    }
+
+    const QString &directory = QDir(baseDirectory()).filePath(QString("%1-%2").arg(QCoreApplication::applicationPid())
+                                                                  .arg(QDateTime::currentMSecsSinceEpoch()));
+
+    if (!QDir().mkpath(directory)) {
+        qDebug() << "Autosave: Could not create" << directory;
+
+        return false;
+    }
+
+    m_lockFile = new QLockFile(QDir(directory).filePath("lock"));
+
+    if (!m_lockFile->tryLock(0)) {
+        qDebug() << "Autosave: Could not lock" << directory;
+
+        delete m_lockFile;
+
+        m_lockFile = NULL;
+
+        return false;
+    }
+
+    m_directory = directory;
+
+    return true;
+}
+
+// private
+QString Autosave::journalPath(const Journal &journal) const
+{
+    return QDir(m_directory).filePath(QString("%1-%2.journal").arg(journal.name).arg(journal.sequence));
+}
+
+// private
+void Autosave::start(TextDocument *document)
+{
+    if (document->isMapped() || !createDirectory()) {
+        return;
+    }
+
+    Journal journal;
+
+    journal.name = QString::number(m_nextJournalNumber++);
+
+    checkpoint(document, &m_journals.insert(document, journal).value());
+}
+
+// private
+void Autosave::checkpoint(TextDocument *document, Journal *journal)
+{
+    AutosaveJob job(AutosaveJob::Checkpoint);
+
+    if (journal->sequence > 0) {
+        job.previousPath = journalPath(*journal);
+    }
+
+    ++journal->sequence;
+
+    job.path = journalPath(*journal);
+    job.location = document->location().path();
+    job.codecNumber = document->codec() != NULL ? document->codec()->number() : -1;
+    job.text = document->internalDocument()->toPlainText();
+
+    m_writer->enqueue(job);
+
+    journal->changeCount = 0;
+}
+
+// private
+void Autosave::discard(TextDocument *document)
+{
+    if (!m_journals.contains(document)) {
+        return;
+    }
+
+    const Journal &journal = m_journals.take(document);
+    AutosaveJob job(AutosaveJob::Discard);
+
+    job.path = journalPath(journal);
+
+    m_writer->enqueue(job);
+}
@@ -0,0 +1,154 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QBasicTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+class Document;
+class QFile;
+class QLockFile;
+class QTextDocument;
+class TextDocument;
+
+// Work for the AutosaveWriter, filled in on the UI thread. Encoding the text and writing it is left to the writer.
+struct AutosaveJob
+{
+    enum Kind {
+        Checkpoint, // starts a new journal file with the whole text, then removes the previous one
+        Change,
+        Discard, // removes the journal file
+        Stop
+    };
+
+    explicit AutosaveJob(Kind kind_) : kind(kind_), codecNumber(-1), position(0), charsRemoved(0) { }
+
+    Kind kind;
+    QString path;
+    QString previousPath; // empty for the first checkpoint of a journal
+    QString location;
+    qint64 codecNumber;
+    int position;
+    int charsRemoved;
+    QString text; // the whole text for a checkpoint, the inserted text for a change
+};
+
+// Appends the journal records on a worker thread. Every record is framed with its length and a checksum, so that a
+// record that was only partly written when the editor crashed is detected on replay and everything before it is kept.
+class AutosaveWriter : public QThread
+{
+    Q_DISABLE_COPY(AutosaveWriter)
+
+public:
+    enum {
+        FormatVersion = 1
+    };
+
+    explicit AutosaveWriter(QObject *parent = NULL);
+    ~AutosaveWriter();
+
+    void enqueue(const AutosaveJob &job);
+
+    // Returns false if not even the first checkpoint of the journal is intact
+    static bool replay(const QString &path, QString *location, qint64 *codecNumber, QString *text);
+
+protected:
+    void run();
+
+private:
+    void process(const AutosaveJob &job);
+    void writeRecord(QFile *file, const QByteArray &record);
+
+    QMutex m_mutex;
+    QWaitCondition m_jobsAvailable;
+    QList<AutosaveJob> m_jobs;
+    QHash<QString, QFile *> m_files; // only used on the worker thread
+};
+
+// Keeps an append-only journal of the changes to every modified TextDocument, so that unsaved work survives a crash.
+// A journal starts with a checkpoint of the whole text, every QTextDocument::contentsChange after that is recorded as
+// position, removed char count and inserted text. Journals are checkpointed again periodically to keep them short and
+// are removed once their document is saved, reverted or closed. The journals of documents that are still modified on
+// exit are kept and offered for recovery on the next start, the same as after a crash.
+class Autosave : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(Autosave)
+
+public:
+    explicit Autosave(QObject *parent = NULL);
+    ~Autosave();
+
+    static Autosave *instance() { return s_instance; }
+
+    // Offers to reopen the unsaved changes left in the journals of an earlier instance
+    static void recover();
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void addDocument(Document *document);
+    void removeDocument(Document *document);
+    void updateModificationOfSender(bool modified);
+    void recordContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    enum {
+        DefaultCheckpointInterval = 60 // seconds
+    };
+
+    struct Journal {
+        Journal() : sequence(0), changeCount(0) { }
+
+        QString name;
+        int sequence; // of the current file, incremented for each checkpoint
+        int changeCount; // since the last checkpoint
+    };
+
+    static QString baseDirectory();
+    static void recoverJournal(const QMap<int, QString> &paths);
+
+    bool createDirectory();
+    QString journalPath(const Journal &journal) const;
+    void start(TextDocument *document);
+    void checkpoint(TextDocument *document, Journal *journal);
+    void discard(TextDocument *document);
+
+    static Autosave *s_instance;
+
+    bool m_enabled;
+    QString m_directory; // of this instance, created for the first journal
+    QLockFile *m_lockFile; // held while this instance runs, journals in unlocked directories are left over
+    AutosaveWriter *m_writer;
+    QBasicTimer m_checkpointTimer;
+    int m_nextJournalNumber;
+    QHash<QTextDocument *, TextDocument *> m_documents;
+    QHash<TextDocument *, Journal> m_journals;
+};
+
+#endif // AUTOSAVE_H
@@ -0,0 +1,332 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "binarydecoder.h"
+
+#include <QtEndian>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <string.h>
+
+#include <algorithm>
+
+static const char *s_typeNames[BinaryDecoder::TypeCount] = {
+    "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64", "uleb128", "sleb128", "time32", "time64",
+    "filetime"
+};
+
+static const char *s_typeDisplayNames[BinaryDecoder::TypeCount] = {
+    "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64", "float", "double", "ULEB128", "SLEB128",
+    "time_t (32-bit)", "time_t (64-bit)", "FILETIME"
+};
+
+static const int s_fixedSizes[BinaryDecoder::TypeCount] = {
+    1, 1, 2, 2, 4, 4, 8, 8, 4, 8, -1, -1, 4, 8, 8
+};
+
+template<typename T>
+static T readValue(const char *data, bool bigEndian)
+{
+    if (bigEndian) {
+        return qFromBigEndian<T>((const uchar *)data);
+    } else {
+        return qFromLittleEndian<T>((const uchar *)data);
+    }
+}
+
+static QString formatTime(qint64 msecsSinceEpoch)
+{
+    // QDateTime covers roughly +/- 292 million years, but formatting years beyond 9999 as ISO date is not possible
+    const qint64 minimum = Q_INT64_C(-62135596800000); // 0001-01-01T00:00:00
+    const qint64 maximum = Q_INT64_C(253402300799999); // 9999-12-31T23:59:59
+
+    if (msecsSinceEpoch < minimum || msecsSinceEpoch > maximum) {
+        return "Out of range";
+    }
+
+    return QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch, Qt::UTC).toString("yyyy-MM-dd hh:mm:ss.zzz") + " UTC";
+}
+
+// static
+QString BinaryDecoder::typeName(Type type)
+{
+    return s_typeNames[type];
+}
+
+// static
+QString BinaryDecoder::typeDisplayName(Type type)
+{
+    return s_typeDisplayNames[type];
+}
+
+// static
+bool BinaryDecoder::typeFromName(const QString &name, Type *type)
+{
+    Q_ASSERT(type != NULL);
+
+    for (int i = 0; i < TypeCount; ++i) {
+        if (name.compare(s_typeNames[i], Qt::CaseInsensitive) == 0) {
+            *type = (Type)i;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// static
+int BinaryDecoder::fixedSize(Type type)
+{
+    return s_fixedSizes[type];
+}
+
+// static
+bool BinaryDecoder::hasEndianness(Type type)
+{
+    return s_fixedSizes[type] > 1;
+}
+
+// static
+int BinaryDecoder::decode(const char *data, int length, Type type, bool bigEndian, QString *value)
+{
+    Q_ASSERT(value != NULL);
+
+    int size = s_fixedSizes[type];
+
+    if (size > length) {
+        return -1;
+    }
+
+    switch (type) {
+    case Int8:
+        *value = QString::number((qint8)data[0]);
+        break;
+
+    case UInt8:
+        *value = QString::number((quint8)data[0]);
+        break;
+
+    case Int16:
+        *value = QString::number(readValue<qint16>(data, bigEndian));
+        break;
+
+    case UInt16:
+        *value = QString::number(readValue<quint16>(data, bigEndian));
+        break;
+
+    case Int32:
+        *value = QString::number(readValue<qint32>(data, bigEndian));
+        break;
+
+    case UInt32:
+        *value = QString::number(readValue<quint32>(data, bigEndian));
+        break;
+
+    case Int64:
+        *value = QString::number(readValue<qint64>(data, bigEndian));
+        break;
+
+    case UInt64:
+        *value = QString::number(readValue<quint64>(data, bigEndian));
+        break;
+
+    case Float: {
+        quint32 bits = readValue<quint32>(data, bigEndian);
+        float number;
+
+        memcpy(&number, &bits, sizeof(number));
+
+        *value = QString::number(number, 'g', 9);
+
+        break;
+    }
+
+    case Double: {
+        quint64 bits = readValue<quint64>(data, bigEndian);
+        double number;
+
+        memcpy(&number, &bits, sizeof(number));
+
+        *value = QString::number(number, 'g', 17);
+
+        break;
+    }
+
+    case ULeb128:
+    case SLeb128: {
+        // Every byte contributes its low 7 bits, the high bit marks that another byte follows
+        quint64 result = 0;
+        int shift = 0;
+        int i = 0;
+
+        for (; i < qMin(length, (int)MaximumSize); ++i) {
+            quint8 byte = data[i];
+
+            result |= (quint64)(byte & 0x7F) << shift;
+            shift += 7;
+
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        // Ten bytes without a terminator are too long for 64 bits, no matter how many more bytes are available
+        if (i == MaximumSize) {
+            *value = "Overflow";
+
+            return MaximumSize;
+        } else if (i == length) {
+            return -1;
+        }
+
+        size = i + 1;
+
+        if (type == SLeb128 && shift < 64 && (data[i] & 0x40) != 0) {
+            result |= ~Q_UINT64_C(0) << shift; // Sign extend
+        }
+
+        if (type == ULeb128) {
+            *value = QString::number(result);
+        } else {
+            *value = QString::number((qint64)result);
+        }
+
+        break;
+    }
+
+    case UnixTime32:
+        *value = formatTime((qint64)readValue<qint32>(data, bigEndian) * 1000);
+        break;
+
+    case UnixTime64: {
+        qint64 seconds = readValue<qint64>(data, bigEndian);
+
+        // Avoid overflowing the multiplication below, the result is out of range anyway
+        if (seconds < Q_INT64_C(-100000000000000) || seconds > Q_INT64_C(100000000000000)) {
+            *value = "Out of range";
+        } else {
+            *value = formatTime(seconds * 1000);
+        }
+
+        break;
+    }
+
+    case FileTime:
+        // 100 nanosecond intervals since 1601-01-01
+        *value = formatTime((qint64)(readValue<quint64>(data, bigEndian) / 10000) - Q_INT64_C(11644473600000));
+        break;
+
+    case TypeCount:
+        Q_ASSERT(false);
+        break;
+    }
+
+    return size;
+}
+
+bool BinaryStructLayout::parse(const QString &text, QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    QRegularExpression fieldRegularExpression("^(?:(le|be)\\s+)?([a-z0-9]+)\\s*(?:\\[\\s*([0-9]+)\\s*\\])?"
+                                              "(?:\\s+([A-Za-z_][A-Za-z0-9_]*))?$",
+                                              QRegularExpression::CaseInsensitiveOption);
+    QVector<Field> fields;
+    QVector<int> firstElements;
+    qint64 elementCount = 0;
+
+    foreach (const QString &part, text.split(QRegularExpression("[;\\n]"))) {
+        const QString &definition = part.trimmed();
+
+        if (definition.isEmpty()) {
+            continue;
+        }
+
+        QRegularExpressionMatch match = fieldRegularExpression.match(definition);
+
+        if (!match.hasMatch()) {
+            *error = QString("Invalid field definition \"%1\".").arg(definition);
+
+            return false;
+        }
+
+        Field field;
+
+        if (!BinaryDecoder::typeFromName(match.captured(2), &field.type)) {
+            *error = QString("Unknown type \"%1\".").arg(match.captured(2));
+
+            return false;
+        }
+
+        field.bigEndian = match.captured(1).compare("be", Qt::CaseInsensitive) == 0;
+        field.count = 1;
+        field.name = match.captured(4);
+
+        if (field.name.isEmpty()) {
+            field.name = QString("field%1").arg(fields.size());
+        }
+
+        if (!match.captured(3).isEmpty()) {
+            bool ok = false;
+
+            field.count = match.captured(3).toInt(&ok);
+
+            if (!ok || field.count < 1 || field.count > MaximumElementCount) {
+                *error = QString("Invalid array length in \"%1\".").arg(definition);
+
+                return false;
+            }
+
+            // Element offsets of arrays are calculated, not decoded one after another
+            if (BinaryDecoder::fixedSize(field.type) < 0) {
+                *error = QString("Arrays of %1 are not supported.").arg(BinaryDecoder::typeDisplayName(field.type));
+
+                return false;
+            }
+        }
+
+        firstElements.append((int)elementCount);
+        elementCount += field.count;
+
+        if (elementCount > MaximumElementCount) {
+            *error = QString("The layout has more than %1 elements.").arg(MaximumElementCount);
+
+            return false;
+        }
+
+        fields.append(field);
+    }
+
+    m_fields = fields;
+    m_firstElements = firstElements;
+    m_elementCount = (int)elementCount;
+
+    return true;
+}
+
+int BinaryStructLayout::fieldForElement(int element) const
+{
+    Q_ASSERT(element >= 0 && element < m_elementCount);
+
+    return std::upper_bound(m_firstElements.constBegin(), m_firstElements.constEnd(), element)
+           - m_firstElements.constBegin() - 1;
+}
@@ -0,0 +1,97 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BINARYDECODER_H
+#define BINARYDECODER_H
+
+#include <QString>
+#include <QVector>
+
+class BinaryDecoder
+{
+public:
+    enum Type {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Float,
+        Double,
+        ULeb128,
+        SLeb128,
+        UnixTime32,
+        UnixTime64,
+        FileTime,
+        TypeCount
+    };
+
+    enum {
+        MaximumSize = 10 // Longest encoding of any type, a 64-bit LEB128 value
+    };
+
+    static QString typeName(Type type);
+    static QString typeDisplayName(Type type);
+    static bool typeFromName(const QString &name, Type *type);
+    static int fixedSize(Type type); // -1 for LEB128
+    static bool hasEndianness(Type type);
+
+    // Decodes the value at the start of data. Returns the number of bytes used or -1 if length isn't enough.
+    static int decode(const char *data, int length, Type type, bool bigEndian, QString *value);
+};
+
+class BinaryStructLayout
+{
+public:
+    struct Field {
+        QString name;
+        BinaryDecoder::Type type;
+        bool bigEndian;
+        int count; // Array length, 1 for scalars
+    };
+
+    enum {
+        MaximumElementCount = 1 << 20
+    };
+
+    BinaryStructLayout() : m_elementCount(0) { }
+
+    // Parses fields of the form "[le|be] <type>[\[<count>\]] [<name>]" separated by semicolons or new lines, e.g.
+    // "u32 magic; be u16 version; u8[4] reserved"
+    bool parse(const QString &text, QString *error);
+
+    bool isEmpty() const { return m_fields.isEmpty(); }
+    int fieldCount() const { return m_fields.size(); }
+    const Field &field(int index) const { return m_fields.at(index); }
+
+    // Arrays are expanded into one element per item
+    int elementCount() const { return m_elementCount; }
+    int fieldForElement(int element) const;
+    int firstElement(int field) const { return m_firstElements.at(field); }
+
+private:
+    QVector<Field> m_fields;
+    QVector<int> m_firstElements;
+    int m_elementCount;
+};
+
+#endif // BINARYDECODER_H
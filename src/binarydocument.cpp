@@ -48,10 +48,10 @@ bool BinaryDocument::save(QByteArray *data, QString *error)
     return true;
 }
 
-void BinaryDocument::setByteAt(int i, quint8 byte)
+void BinaryDocument::setByteAt(qint64 i, quint8 byte)
 {
-    if (m_data.at(i) != byte) {
-        m_data[i] = byte;
+    if ((quint8)m_data.at((int)i) != byte) {
+        m_data[(int)i] = byte;
 
         setModified(true);
     }
@@ -34,12 +34,17 @@ public:
     bool load(const QByteArray &data, QString *error);
     bool save(QByteArray *data, QString *error);
 
-    int length() const { return m_data.length(); }
+    // Positions are 64-bit throughout, so that the editor side doesn't need to change once the storage isn't limited
+    // to what a single QByteArray can hold anymore.
+    qint64 length() const { return m_data.length(); }
 
-    quint8 byteAt(int i) const { return m_data.at(i); }
-    void setByteAt(int i, quint8 byte);
+    quint8 byteAt(qint64 i) const { return m_data.at((int)i); }
+    void setByteAt(qint64 i, quint8 byte);
 
-    QByteArray slice(int i, int length = -1) { return m_data.mid(i, length); }
+    QByteArray slice(qint64 i, qint64 length = -1) { return m_data.mid((int)i, (int)length); }
+
+    // Implicitly shared, a background reader can keep working on this snapshot while the document gets edited
+    QByteArray data() const { return m_data; }
 
 private:
     QByteArray m_data;
@@ -30,3 +30,18 @@ BinaryEditor::~BinaryEditor()
     delete m_widget;
     delete m_document;
 }
+
+qint64 BinaryEditor::cursorPosition() const
+{
+    return m_widget->cursorPosition();
+}
+
+// The first visible line follows from the cursor position
+void BinaryEditor::restorePosition(qint64 cursorPosition, qint64 firstVisibleLine)
+{
+    Q_UNUSED(firstVisibleLine)
+
+    if (cursorPosition >= 0) {
+        m_widget->goToOffset(cursorPosition);
+    }
+}
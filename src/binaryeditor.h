@@ -37,6 +37,9 @@ public:
     Document *document() const { return m_document; }
     QWidget *widget() const { return m_widget; }
 
+    qint64 cursorPosition() const;
+    void restorePosition(qint64 cursorPosition, qint64 firstVisibleLine);
+
 private:
     QPointer<BinaryDocument> m_document; // owned by DocumentManager
     QPointer<BinaryEditorWidget> m_widget; // owned by its parent widget if any
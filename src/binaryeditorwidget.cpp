@@ -19,19 +19,63 @@
 #include "binaryeditorwidget.h"
 
 #include "binarydocument.h"
+#include "binaryinspectorwidget.h"
+#include "binarymimedata.h"
 #include "editorcolors.h"
+#include "eventfilter.h"
+#include "filedialog.h"
 #include "monospacefontmetrics.h"
+#include "settings.h"
 
 #include <QtMath>
 #include <QApplication>
 #include <QClipboard>
+#include <QComboBox>
 #include <QDebug>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
 #include <QPaintEvent>
+#include <QRegularExpressionValidator>
 #include <QScrollBar>
 #include <QTextDocument>
+#include <QToolButton>
 #include <QWheelEvent>
 
+#include <algorithm>
+
+// Fills in the hex and printable characters of a line. There is one instance per supported line width, so the
+// compiler can unroll the loop for each of them.
+template<int BytesPerLine>
+static void formatLine(const QByteArray &data, QChar *hexChars, QChar *printableChars)
+{
+    const char *hexDigits = "0123456789ABCDEF";
+    const char *bytes = data.constData();
+    int length = data.length();
+
+    for (int i = 0; i < BytesPerLine; ++i) {
+        if (i < length) {
+            quint8 byte = bytes[i];
+
+            hexChars[i * 3] = hexDigits[(byte >> 4) & 0x0F];
+            hexChars[i * 3 + 1] = hexDigits[byte & 0x0F];
+
+            if (byte >= 32 && byte <= 126) {
+                printableChars[i] = (char)byte;
+            } else {
+                printableChars[i] = 0x00B7;
+            }
+        } else {
+            hexChars[i * 3] = ' ';
+            hexChars[i * 3 + 1] = ' ';
+            printableChars[i] = ' ';
+        }
+    }
+}
+
 class BinaryEditorExtraArea : public QWidget
 {
 public:
@@ -64,27 +108,242 @@ private:
     BinaryEditorWidget *m_editor;
 };
 
+class BinaryEditorInfoArea : public QWidget
+{
+public:
+    enum Mode {
+        Hidden,
+        GoToOffset,
+        Find
+    };
+
+    BinaryEditorInfoArea(BinaryEditorWidget *editor) :
+        QWidget(editor),
+        m_editor(editor),
+        m_mode(Hidden)
+    {
+        Q_ASSERT(editor != NULL);
+
+        QPalette palette = EditorColors::basicPalette();
+
+        palette.setColor(QPalette::Background, EditorColors::infoBackgroundColor());
+
+        setFont(QApplication::font());
+        setPalette(palette);
+        setAutoFillBackground(true);
+
+        QHBoxLayout *layout = new QHBoxLayout(this);
+
+        layout->setContentsMargins(6, 4, 4, 4);
+
+        m_label = new QLabel;
+        m_syntaxCombo = new QComboBox;
+        m_edit = new QLineEdit;
+        m_statusLabel = new QLabel;
+        m_button = new QToolButton;
+
+        m_syntaxCombo->addItem("Hex", BinarySearchPattern::Hex);
+        m_syntaxCombo->addItem("Text (UTF-8)", BinarySearchPattern::Text);
+        m_syntaxCombo->addItem("Text (UTF-16LE)", BinarySearchPattern::Utf16LE);
+        m_syntaxCombo->addItem("Text (UTF-16BE)", BinarySearchPattern::Utf16BE);
+        m_syntaxCombo->hide();
+
+        m_statusLabel->hide();
+
+        m_edit->installEventFilter(EventFilter::instance());
+        m_edit->setClearButtonEnabled(true);
+
+        m_offsetValidator = new QRegularExpressionValidator(QRegularExpression("(0[xX])?[0-9A-Fa-f]{0,16}"), m_edit);
+
+        m_button->setText("Hide");
+        m_button->setAutoRaise(true);
+
+        layout->addWidget(m_label);
+        layout->addWidget(m_syntaxCombo);
+        layout->addWidget(m_edit, 1);
+        layout->addWidget(m_statusLabel);
+        layout->addWidget(m_button);
+
+        connect(m_edit, &QLineEdit::returnPressed, m_editor, &BinaryEditorWidget::performInfoAreaAction);
+        connect(m_edit, &QLineEdit::textChanged, this, &BinaryEditorInfoArea::clearInvalidMark);
+        connect(m_syntaxCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+                this, &BinaryEditorInfoArea::updateSyntax);
+        connect(m_button, &QToolButton::clicked, m_editor, &BinaryEditorWidget::hideInfoArea);
+
+        hide();
+    }
+
+    Mode mode() const { return m_mode; }
+
+    void setMode(Mode mode)
+    {
+        if (m_mode != mode) {
+            m_mode = mode;
+
+            switch (mode) {
+            case Hidden:
+                hide();
+
+                break;
+
+            case GoToOffset:
+                m_label->setText("Go to Offset:");
+                m_edit->setPlaceholderText("Hexadecimal offset");
+                m_edit->setValidator(m_offsetValidator);
+                m_syntaxCombo->hide();
+                m_statusLabel->hide();
+
+                show();
+
+                break;
+
+            case Find:
+                m_label->setText("Find:");
+                m_edit->setValidator(NULL);
+                m_syntaxCombo->show();
+                m_statusLabel->show();
+
+                updateSyntax();
+                show();
+
+                break;
+            }
+        }
+
+        if (m_mode != Hidden) {
+            m_edit->setFocus();
+            m_edit->selectAll();
+        }
+    }
+
+    QString text() const { return m_edit->text(); }
+
+    BinarySearchPattern::Syntax syntax() const
+    {
+        return (BinarySearchPattern::Syntax)m_syntaxCombo->currentData().toInt();
+    }
+
+    void setStatus(const QString &status)
+    {
+        m_statusLabel->setText(status);
+    }
+
+    void markTextAsValid(bool mark)
+    {
+        m_edit->setStyleSheet(mark ? "" : "QLineEdit { color: red }");
+    }
+
+    void clearInvalidMark()
+    {
+        markTextAsValid(true);
+    }
+
+    void updateSyntax()
+    {
+        if (syntax() == BinarySearchPattern::Hex) {
+            m_edit->setPlaceholderText("Hexadecimal bytes, ? matches any nibble");
+        } else {
+            m_edit->setPlaceholderText("Text");
+        }
+
+        clearInvalidMark();
+    }
+
+    QSize sizeHint() const
+    {
+        return QWidget::sizeHint() + QSize(0, 1); // +1 for the bottom line
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event)
+    {
+        m_editor->infoAreaPaintEvent(event);
+    }
+
+    void keyPressEvent(QKeyEvent *event)
+    {
+        // QLineEdit ignores the escape key, so it ends up here
+        if (event->key() == Qt::Key_Escape) {
+            event->accept();
+            m_editor->hideInfoArea();
+
+            return;
+        }
+
+        QWidget::keyPressEvent(event);
+    }
+
+    void showEvent(QShowEvent *event)
+    {
+        QWidget::showEvent(event);
+
+        m_editor->updateViewportMargins();
+    }
+
+    void hideEvent(QHideEvent *event)
+    {
+        QWidget::hideEvent(event);
+
+        m_editor->updateViewportMargins();
+    }
+
+private:
+    BinaryEditorWidget *m_editor;
+    Mode m_mode;
+    QLabel *m_label;
+    QComboBox *m_syntaxCombo;
+    QLineEdit *m_edit;
+    QLabel *m_statusLabel;
+    QValidator *m_offsetValidator;
+    QToolButton *m_button;
+};
+
 BinaryEditorWidget::BinaryEditorWidget(BinaryDocument *document, QWidget *parent) :
     QAbstractScrollArea(parent),
     m_document(document),
     m_extraArea(new BinaryEditorExtraArea(this)),
-    m_lineCount(document->length() / BytesPerLine + 1),
+    m_addressDigits(8),
+    m_infoArea(new BinaryEditorInfoArea(this)),
+    m_inspector(new BinaryInspectorWidget(document, this)),
+    m_bytesPerLineShift(bytesPerLineShift(Settings::settings()->value("BinaryEditor/BytesPerLine").toInt())),
+    m_bytesPerLine(1 << m_bytesPerLineShift),
+    m_lineCount(lineOf(document->length()) + 1),
+    m_firstVisibleLine(0),
+    m_settingScrollBarValue(false),
     m_cursorVisible(false),
     m_cursorInHexSection(true),
     m_cursorAtLowNibble(false),
     m_cursorPosition(0),
     m_anchorPosition(0),
-    m_lastVerticalScrollBarValue(-1),
+    m_wheelDelta(0),
     m_documentMargin(QTextDocument(this).documentMargin()),
-    m_highlightCurrentLine(false)
+    m_highlightCurrentLine(false),
+    m_searcher(NULL),
+    m_searchGeneration(0),
+    m_matchesTruncated(false)
 {
     Q_ASSERT(m_document->length() > 0);
 
+    // Use at least 8 hex digits for the addresses, but more if the document is bigger than 4 GiB
+    for (qint64 maximum = (m_document->length() - 1) >> 32; maximum > 0; maximum >>= 4) {
+        ++m_addressDigits;
+    }
+
     setFont(MonospaceFontMetrics::font());
     setPalette(EditorColors::basicPalette());
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+
+    m_inspector->setVisible(Settings::settings()->value("BinaryEditor/InspectorVisible", true).toBool());
+
+    connect(m_inspector, &BinaryInspectorWidget::overlayChanged, this, &BinaryEditorWidget::updateOverlay);
+
     updateScrollBarRanges();
-    setViewportMargins(extraAreaWidth(), 0, 0, 0);
+    updateViewportMargins();
+}
+
+BinaryEditorWidget::~BinaryEditorWidget()
+{
+    cancelSearch();
 }
 
 void BinaryEditorWidget::undo()
@@ -99,45 +358,69 @@ void BinaryEditorWidget::redo()
 
 void BinaryEditorWidget::copy()
 {
-    int selectionStart = qMin(m_anchorPosition, m_cursorPosition);
-    int selectionEnd = qMax(m_anchorPosition, m_cursorPosition);
-    int selectionLength = selectionEnd - selectionStart + 1;
-    QByteArray selectedData = m_document->slice(selectionStart, selectionLength);
+    qint64 selectionStart = qMin(m_anchorPosition, m_cursorPosition);
+    qint64 selectionEnd = qMax(m_anchorPosition, m_cursorPosition);
+    qint64 selectionLength = selectionEnd - selectionStart + 1;
+    BinaryMimeData::Encoding encoding = m_cursorInHexSection ? BinaryMimeData::Hex : BinaryMimeData::Printable;
+    qint64 encodedLength = BinaryMimeData::encodedLength(selectionLength, encoding);
+    qint64 warningLength = Settings::settings()->value("BinaryEditor/ClipboardWarningLength",
+                                                       (qint64)DefaultClipboardWarningLength).toLongLong();
+
+    // Huge clipboard contents are of little use to most applications and can make them hang on paste. Offer to write
+    // the selection to a file instead, or require it if the text wouldn't fit into the clipboard at all.
+    if (encodedLength > BinaryMimeData::MaximumEncodedLength) {
+        QString message = QString("The selection is too big to be copied to the clipboard (%1 MiB as text).")
+                          .arg(encodedLength / (1024 * 1024));
+
+        if (QMessageBox::question(this, "Copy Selection", message, "Export to File...", "Cancel",
+                                  QString(), 0, 1) == 0) {
+            exportSelection(selectionStart, selectionLength, encoding);
+        }
 
-    if (m_cursorInHexSection) {
-        const char *hexDigits= "0123456789ABCDEF";
-        QString hexString;
+        return;
+    } else if (warningLength >= 0 && encodedLength > warningLength) {
+        QString message = QString("The selection is big (%1 MiB as text). Copying it to the clipboard might make "
+                                  "other applications unresponsive when pasting it.")
+                          .arg(encodedLength / (1024 * 1024));
 
-        hexString.reserve(3 * selectedData.size());
+        int button = QMessageBox::question(this, "Copy Selection", message, "Export to File...", "Copy Anyway",
+                                           "Cancel", 0, 2);
 
-        for (int i = 0; i < selectedData.size(); ++i) {
-            quint8 byte = selectedData.at(i);
+        if (button == 0) {
+            exportSelection(selectionStart, selectionLength, encoding);
 
-            hexString += hexDigits[(byte >> 4) & 0x0F];
-            hexString += hexDigits[byte & 0x0F];
-            hexString += ' ';
+            return;
+        } else if (button != 1) {
+            return;
         }
+    }
 
-        hexString.chop(1);
+    // The text is encoded lazily once the clipboard content is requested
+    QApplication::clipboard()->setMimeData(new BinaryMimeData(m_document->data(), selectionStart, selectionLength,
+                                                              encoding));
+}
 
-        QApplication::clipboard()->setText(hexString);
-    } else {
-        QString printableString;
+void BinaryEditorWidget::setBytesPerLine(int bytesPerLine)
+{
+    int shift = bytesPerLineShift(bytesPerLine);
 
-        printableString.reserve(selectedData.size());
+    if (shift == m_bytesPerLineShift) {
+        return;
+    }
 
-        for (int i = 0; i < selectedData.size(); ++i) {
-            quint8 byte = selectedData.at(i);
+    // Keep the line containing the cursor at the same row of the viewport
+    qint64 cursorRow = lineOf(m_cursorPosition) - m_firstVisibleLine;
 
-            if (byte >= 1 && byte <= 126) {
-                printableString += (char)byte;
-            } else {
-                printableString += ' ';
-            }
-        }
+    m_bytesPerLineShift = shift;
+    m_bytesPerLine = 1 << shift;
+    m_lineCount = lineOf(m_document->length()) + 1;
+    m_firstVisibleLine = qBound(Q_INT64_C(0), lineOf(m_cursorPosition) - cursorRow, maximumFirstVisibleLine());
 
-        QApplication::clipboard()->setText(printableString);
-    }
+    Settings::settings()->setValue("BinaryEditor/BytesPerLine", m_bytesPerLine);
+
+    updateScrollBarRanges();
+    viewport()->update();
+    m_extraArea->update();
 }
 
 void BinaryEditorWidget::selectAll()
@@ -146,19 +429,57 @@ void BinaryEditorWidget::selectAll()
     setCursorPosition(m_document->length() - 1, KeepAnchor);
 }
 
-int BinaryEditorWidget::extraAreaWidth() const
+void BinaryEditorWidget::goToOffset(qint64 offset)
+{
+    offset = qBound(Q_INT64_C(0), offset, m_document->length() - 1);
+
+    // Show the target line in the middle of the viewport, unless it is already visible
+    qint64 line = lineOf(offset);
+
+    if (line < m_firstVisibleLine || line >= m_firstVisibleLine + visibleLineCount()) {
+        setFirstVisibleLine(line - visibleLineCount() / 2);
+    }
+
+    setCursorPosition(offset, MoveAnchor);
+}
+
+void BinaryEditorWidget::findNext()
+{
+    if (m_matches.isEmpty()) {
+        return;
+    }
+
+    // Find the first match after the cursor, wrap around at the end
+    int index = std::upper_bound(m_matches.constBegin(), m_matches.constEnd(), m_cursorPosition)
+                - m_matches.constBegin();
+
+    selectMatch(index < m_matches.size() ? index : 0);
+}
+
+void BinaryEditorWidget::findPrevious()
 {
-    int digits = 8;
+    if (m_matches.isEmpty()) {
+        return;
+    }
+
+    // Find the last match before the cursor, wrap around at the start
+    int index = std::lower_bound(m_matches.constBegin(), m_matches.constEnd(), m_cursorPosition)
+                - m_matches.constBegin();
 
-    return 8 + MonospaceFontMetrics::charWidth() * digits + 8;
+    selectMatch(index > 0 ? index - 1 : m_matches.size() - 1);
+}
+
+int BinaryEditorWidget::extraAreaWidth() const
+{
+    return 8 + MonospaceFontMetrics::charWidth() * m_addressDigits + 8;
 }
 
 void BinaryEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
 {
     QPainter painter(m_extraArea);
     int extraAreaWidth = m_extraArea->width();
-    int selectionStart;
-    int selectionEnd;
+    qint64 selectionStart;
+    qint64 selectionEnd;
 
     if (m_cursorPosition >= m_anchorPosition) {
         selectionStart = m_anchorPosition;
@@ -168,7 +489,7 @@ void BinaryEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
         selectionEnd = m_anchorPosition;
     }
 
-    int line = verticalScrollBar()->value();
+    qint64 line = m_firstVisibleLine;
     int lineHeight = MonospaceFontMetrics::lineHeight();
     int top = 0;
 
@@ -183,16 +504,16 @@ void BinaryEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
 
     while (line < m_lineCount && top <= event->rect().bottom()) {
         if (bottom >= event->rect().top()) {
-            int linePosition = BytesPerLine * line;
+            qint64 linePosition = lineStart(line);
 
             // Highlight the line containing the cursor
             if (m_highlightCurrentLine && m_cursorPosition >= linePosition
-                    && m_cursorPosition < linePosition + BytesPerLine) {
+                    && m_cursorPosition < linePosition + m_bytesPerLine) {
                 painter.fillRect(QRect(0, top, extraAreaWidth, lineHeight), EditorColors::currentLineHighlightColor());
             }
 
             // Highlight selected line number
-            bool selected = selectionStart < linePosition + BytesPerLine && selectionEnd >= linePosition;
+            bool selected = selectionStart < linePosition + m_bytesPerLine && selectionEnd >= linePosition;
 
             if (selected) {
                 painter.setPen(m_extraArea->palette().color(QPalette::Highlight).darker(100));
@@ -200,7 +521,7 @@ void BinaryEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
 
             // Draw line number
             painter.drawText(QRect(0, top, extraAreaWidth - 8, lineHeight), Qt::AlignRight,
-                             QString::asprintf("%08X", line * BytesPerLine));
+                             QString::asprintf("%0*llX", m_addressDigits, (unsigned long long)linePosition));
 
             // Reset text color
             if (selected) {
@@ -214,30 +535,129 @@ void BinaryEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
     }
 }
 
-// protected
-void BinaryEditorWidget::scrollContentsBy(int dx, int dy)
+int BinaryEditorWidget::infoAreaHeight() const
 {
-    Q_UNUSED(dx)
+    if (m_infoArea->isVisible()) {
+        return m_infoArea->sizeHint().height();
+    } else {
+        return 0;
+    }
+}
 
-    // The vertical scroll bar operates in lines, but the scroll function operates in pixels. Multiply dy by the line
-    // spacing to convert between the two.
-    dy *= MonospaceFontMetrics::lineHeight();
+void BinaryEditorWidget::infoAreaPaintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
 
-    // Check if the scroll operation resulted in showing/hiding the first line. If that is the case then an extra top
-    // margin of 4px (see QTextDocument::documentMargin) is added/subtracted to mimic the document margin of the
-    // QPlainTextEdit.
-    int verticalScrollBarValue = verticalScrollBar()->value();
+    QPainter painter(m_infoArea);
 
-    if (verticalScrollBarValue == 0 && m_lastVerticalScrollBarValue != 0) {
-        dy += m_documentMargin;
-    } else if (verticalScrollBarValue != 0 && m_lastVerticalScrollBarValue == 0) {
-        dy -= m_documentMargin;
+    painter.fillRect(0, m_infoArea->height() - 1, m_infoArea->width(), 1, palette().color(QPalette::Mid));
+}
+
+int BinaryEditorWidget::inspectorWidth() const
+{
+    if (m_inspector->isHidden()) {
+        return 0;
+    } else {
+        return MonospaceFontMetrics::charWidth() * 64;
     }
+}
 
-    m_lastVerticalScrollBarValue = verticalScrollBarValue;
+// public slot
+void BinaryEditorWidget::updateViewportMargins()
+{
+    setViewportMargins(extraAreaWidth(), infoAreaHeight(), inspectorWidth(), 0);
+    updateAreaGeometries();
+    updateScrollBarRanges();
+}
 
-    viewport()->scroll(dx, dy);
-    m_extraArea->scroll(0, dy);
+// public slot
+void BinaryEditorWidget::showGoToOffsetArea()
+{
+    m_infoArea->setMode(BinaryEditorInfoArea::GoToOffset);
+}
+
+// public slot
+void BinaryEditorWidget::showFindArea()
+{
+    m_infoArea->setMode(BinaryEditorInfoArea::Find);
+}
+
+// public slot
+void BinaryEditorWidget::hideInfoArea()
+{
+    m_infoArea->setMode(BinaryEditorInfoArea::Hidden);
+
+    setFocus();
+}
+
+// public slot
+void BinaryEditorWidget::setInspectorVisible(bool visible)
+{
+    m_inspector->setVisible(visible);
+
+    Settings::settings()->setValue("BinaryEditor/InspectorVisible", visible);
+
+    updateViewportMargins();
+    viewport()->update();
+}
+
+// public slot
+void BinaryEditorWidget::performInfoAreaAction()
+{
+    if (m_infoArea->mode() == BinaryEditorInfoArea::GoToOffset) {
+        QString text = m_infoArea->text();
+
+        if (text.startsWith("0x", Qt::CaseInsensitive)) {
+            text = text.mid(2);
+        }
+
+        bool ok = false;
+        qint64 offset = text.toLongLong(&ok, 16);
+
+        if (!ok || offset < 0 || offset >= m_document->length()) {
+            m_infoArea->markTextAsValid(false);
+
+            return;
+        }
+
+        hideInfoArea();
+        goToOffset(offset);
+    } else if (m_infoArea->mode() == BinaryEditorInfoArea::Find) {
+        BinarySearchPattern pattern;
+        QString error;
+
+        if (!pattern.parse(m_infoArea->text(), m_infoArea->syntax(), &error)) {
+            m_infoArea->markTextAsValid(false);
+            m_infoArea->setStatus(error);
+
+            return;
+        }
+
+        // Pressing return again for the same pattern moves to the next match instead of searching again
+        if (pattern == m_searchPattern) {
+            if (m_searcher == NULL) {
+                findNext();
+            }
+
+            return;
+        }
+
+        startSearch(pattern);
+    }
+}
+
+// protected
+void BinaryEditorWidget::scrollContentsBy(int dx, int dy)
+{
+    qint64 line = m_firstVisibleLine;
+
+    // A vertical scroll bar change that wasn't triggered by setFirstVisibleLine() comes from the user interacting with
+    // the scroll bar. Map the (potentially scaled) scroll bar value back to a line in that case.
+    if (dy != 0 && !m_settingScrollBarValue) {
+        line = lineForScrollBarValue(verticalScrollBar()->value());
+    }
+
+    scrollToLine(line, dx);
 }
 
 // protected
@@ -249,7 +669,12 @@ bool BinaryEditorWidget::event(QEvent *event)
         if (keyEvent == QKeySequence::Undo
                 || keyEvent == QKeySequence::Redo
                 || keyEvent == QKeySequence::Copy
-                || keyEvent == QKeySequence::SelectAll) {
+                || keyEvent == QKeySequence::SelectAll
+                || keyEvent == QKeySequence::Find
+                || keyEvent == QKeySequence::FindNext
+                || keyEvent == QKeySequence::FindPrevious
+                || (keyEvent->key() == Qt::Key_I && keyEvent->modifiers() == Qt::ControlModifier)
+                || (keyEvent->key() == Qt::Key_L && keyEvent->modifiers() == Qt::ControlModifier)) {
             keyEvent->accept();
         }
     }
@@ -262,12 +687,7 @@ void BinaryEditorWidget::resizeEvent(QResizeEvent *event)
 {
     QAbstractScrollArea::resizeEvent(event);
 
-    QRect rect = contentsRect();
-
-    rect.setWidth(extraAreaWidth());
-
-    m_extraArea->setGeometry(rect);
-
+    updateAreaGeometries();
     updateScrollBarRanges();
 }
 
@@ -277,8 +697,8 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
     QPainter painter(viewport());
     int charWidth = MonospaceFontMetrics::charWidth();
     int lineHeight = MonospaceFontMetrics::lineHeight();
-    int selectionStart;
-    int selectionEnd;
+    qint64 selectionStart;
+    qint64 selectionEnd;
 
     if (m_cursorPosition >= m_anchorPosition) {
         selectionStart = m_anchorPosition;
@@ -289,9 +709,9 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
     }
 
     int leftHex = m_documentMargin - horizontalScrollBar()->value();
-    int leftPrintable = leftHex + (HexColumnsPerLine + 1) * charWidth + 1 + charWidth;
+    int leftPrintable = leftHex + (hexColumnsPerLine() + 1) * charWidth + 1 + charWidth;
     int right = viewport()->width() + horizontalScrollBar()->value() - m_documentMargin;
-    int line = verticalScrollBar()->value();
+    qint64 line = m_firstVisibleLine;
     int top = 0;
 
     // If the first line is visible then offset it by the document margin to mimic the QPlainTextEdit margin behavior.
@@ -300,14 +720,13 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
     }
 
     int bottom = top + lineHeight;
-    QString hexString(HexColumnsPerLine, ' ');
+    QString hexString(hexColumnsPerLine(), ' ');
     QChar *hexChars = hexString.data();
-    const char *hexDigits= "0123456789ABCDEF";
-    QString printableString(BytesPerLine, '_');
+    QString printableString(m_bytesPerLine, '_');
     QChar *printableChars = printableString.data();
 
     // Draw divider line between hex amd printable section
-    int divider = leftHex + (HexColumnsPerLine + 1) * charWidth;
+    int divider = leftHex + (hexColumnsPerLine() + 1) * charWidth;
 
     if (divider < viewport()->width()) {
         painter.setPen(palette().color(QPalette::Midlight));
@@ -316,12 +735,17 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
 
     painter.setPen(palette().color(QPalette::Text));
 
+    // Only resolve the struct overlay for the visible lines
+    QVector<BinaryInspectorWidget::OverlayRange> overlays =
+            m_inspector->overlayRanges(lineStart(m_firstVisibleLine),
+                                       lineStart(m_firstVisibleLine + visibleLineCount() + 1));
+
     while (line < m_lineCount && top <= event->rect().bottom()) {
         if (bottom >= event->rect().top()) {
-            int linePosition = BytesPerLine * line;
-            bool cursorInLine = m_cursorPosition >= linePosition && m_cursorPosition < linePosition + BytesPerLine;
-            QRect hexRect(leftHex, top, HexColumnsPerLine * charWidth, lineHeight);
-            QRect printableRect(leftPrintable, top, BytesPerLine * charWidth, lineHeight);
+            qint64 linePosition = lineStart(line);
+            bool cursorInLine = m_cursorPosition >= linePosition && m_cursorPosition < linePosition + m_bytesPerLine;
+            QRect hexRect(leftHex, top, hexColumnsPerLine() * charWidth, lineHeight);
+            QRect printableRect(leftPrintable, top, m_bytesPerLine * charWidth, lineHeight);
 
             // Highlight the line containing the cursor
             if (m_highlightCurrentLine && cursorInLine) {
@@ -329,6 +753,34 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
                                  EditorColors::currentLineHighlightColor());
             }
 
+            qint64 lineEnd = linePosition + m_bytesPerLine;
+
+            // Highlight struct fields overlapping this line
+            for (int i = 0; i < overlays.size(); ++i) {
+                const BinaryInspectorWidget::OverlayRange &range = overlays.at(i);
+
+                if (range.start < lineEnd && range.end > linePosition) {
+                    paintByteRange(&painter, hexRect, printableRect,
+                                   (int)(qMax(range.start, linePosition) - linePosition),
+                                   (int)(qMin(range.end, lineEnd) - linePosition),
+                                   EditorColors::structFieldColor(range.field));
+                }
+            }
+
+            // Highlight search matches overlapping this line. Matches can start in previous lines, so look for the
+            // first one that could reach into this line.
+            if (!m_matches.isEmpty()) {
+                QVector<qint64>::const_iterator match = std::lower_bound(m_matches.constBegin(), m_matches.constEnd(),
+                                                                         linePosition - m_searchPattern.length() + 1);
+
+                for (; match != m_matches.constEnd() && *match < lineEnd; ++match) {
+                    paintByteRange(&painter, hexRect, printableRect,
+                                   (int)(qMax(*match, linePosition) - linePosition),
+                                   (int)(qMin(*match + m_searchPattern.length(), lineEnd) - linePosition),
+                                   EditorColors::searchMatchColor());
+                }
+            }
+
             // Highlight selected bytes
             int fullWidthSelection = 0;
             int hexSelectionLeft = -1;
@@ -341,47 +793,50 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
                 hexSelectionLeft = hexRect.left();
                 printableSelectionLeft = printableRect.left();
                 ++fullWidthSelection;
-            } else if (selectionStart >= linePosition && selectionStart < linePosition + BytesPerLine) {
+            } else if (selectionStart >= linePosition && selectionStart < linePosition + m_bytesPerLine) {
                 // Selection starts in this line
-                int offset = (selectionStart % BytesPerLine) * charWidth;
+                int offset = columnOf(selectionStart) * charWidth;
 
                 hexSelectionLeft = hexRect.left() + offset * 3;
                 printableSelectionLeft = printableRect.left() + offset;
             }
 
-            if (selectionEnd >= linePosition + BytesPerLine) {
+            if (selectionEnd >= linePosition + m_bytesPerLine) {
                 // Selection ends after this line, +1 because right() returns the last position INSIDE the QRect
                 hexSelectionRight = hexRect.right() + 1;
                 printableSelectionRight = printableRect.right() + 1;
                 ++fullWidthSelection;
-            } else if (selectionEnd >= linePosition && selectionEnd < linePosition + BytesPerLine) {
+            } else if (selectionEnd >= linePosition && selectionEnd < linePosition + m_bytesPerLine) {
                 // Selection ends in this line
-                int offset = ((selectionEnd % BytesPerLine) + 1) * charWidth;
+                int offset = (columnOf(selectionEnd) + 1) * charWidth;
 
                 hexSelectionRight = hexRect.left() + qMax(offset * 3 - charWidth, 0);
                 printableSelectionRight = printableRect.left() + offset;
             }
 
             // Prepare hex nibbles and printable text
-            for (int i = 0; i < BytesPerLine; ++i) {
-                int offset = line * BytesPerLine + i;
+            QByteArray lineData = m_document->slice(linePosition, m_bytesPerLine);
 
-                if (offset < m_document->length()) {
-                    quint8 byte = m_document->byteAt(offset);
+            switch (m_bytesPerLine) {
+            case 8:
+                formatLine<8>(lineData, hexChars, printableChars);
+                break;
 
-                    hexChars[i * 3] = hexDigits[(byte >> 4) & 0x0F];
-                    hexChars[i * 3 + 1] = hexDigits[byte & 0x0F];
+            case 16:
+                formatLine<16>(lineData, hexChars, printableChars);
+                break;
 
-                    if (byte >= 32 && byte <= 126) {
-                        printableChars[i] = (char)byte;
-                    } else {
-                        printableChars[i] = 0x00B7;
-                    }
-                } else {
-                    hexChars[i * 3] = ' ';
-                    hexChars[i * 3 + 1] = ' ';
-                    printableChars[i] = ' ';
-                }
+            case 32:
+                formatLine<32>(lineData, hexChars, printableChars);
+                break;
+
+            case 64:
+                formatLine<64>(lineData, hexChars, printableChars);
+                break;
+
+            default:
+                Q_ASSERT(false);
+                break;
             }
 
             // Draw non-fully selected lines
@@ -415,7 +870,7 @@ void BinaryEditorWidget::paintEvent(QPaintEvent *event)
             }
 
             if (m_cursorVisible && cursorInLine) {
-                int offset = (m_cursorPosition % BytesPerLine) * charWidth;
+                int offset = columnOf(m_cursorPosition) * charWidth;
 
                 // Draw hex cursor
                 QRect hexCursorRect;
@@ -488,6 +943,33 @@ void BinaryEditorWidget::mouseMoveEvent(QMouseEvent *event)
 // protected
 void BinaryEditorWidget::mouseReleaseEvent(QMouseEvent *event)
 {
+    Q_UNUSED(event)
+}
+
+// protected
+void BinaryEditorWidget::wheelEvent(QWheelEvent *event)
+{
+    int delta = event->angleDelta().y();
+
+    if (delta == 0) {
+        QAbstractScrollArea::wheelEvent(event);
+
+        return;
+    }
+
+    // Scroll by lines here instead of letting the vertical scroll bar handle the wheel event, because the scroll bar
+    // value might be scaled and a single scroll bar step could skip many lines in that case. One wheel step is 120
+    // units (see QWheelEvent::angleDelta), but high-resolution wheels and touchpads report smaller deltas that need to
+    // be accumulated.
+    m_wheelDelta += delta;
+
+    int steps = m_wheelDelta / 120;
+
+    m_wheelDelta -= steps * 120;
+
+    setFirstVisibleLine(m_firstVisibleLine - (qint64)steps * QApplication::wheelScrollLines());
+
+    event->accept();
 }
 
 // protected
@@ -512,29 +994,55 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
         event->accept();
         selectAll();
 
+        return;
+    } else if (event->key() == Qt::Key_L && event->modifiers() == Qt::ControlModifier) {
+        event->accept();
+        showGoToOffsetArea();
+
+        return;
+    } else if (event == QKeySequence::Find) {
+        event->accept();
+        showFindArea();
+
+        return;
+    } else if (event == QKeySequence::FindNext) {
+        event->accept();
+        findNext();
+
+        return;
+    } else if (event == QKeySequence::FindPrevious) {
+        event->accept();
+        findPrevious();
+
+        return;
+    } else if (event->key() == Qt::Key_I && event->modifiers() == Qt::ControlModifier) {
+        event->accept();
+        setInspectorVisible(m_inspector->isHidden());
+
         return;
     }
 
     MoveMode moveMode = event->modifiers() & Qt::ShiftModifier ? KeepAnchor : MoveAnchor;
     bool ctrlPressed = event->modifiers() & Qt::ControlModifier;
-    int line;
-    int position;
+    qint64 line;
+    qint64 position;
+    int pageStep;
 
     switch (event->key()) {
     case Qt::Key_Up:
         if (ctrlPressed) {
-            verticalScrollBar()->triggerAction(QScrollBar::SliderSingleStepSub);
-        } else if (m_cursorPosition - BytesPerLine >= 0) {
-            setCursorPosition(m_cursorPosition - BytesPerLine, moveMode);
+            setFirstVisibleLine(m_firstVisibleLine - 1);
+        } else if (m_cursorPosition - m_bytesPerLine >= 0) {
+            setCursorPosition(m_cursorPosition - m_bytesPerLine, moveMode);
         }
 
         break;
 
     case Qt::Key_Down:
         if (ctrlPressed) {
-            verticalScrollBar()->triggerAction(QScrollBar::SliderSingleStepAdd);
-        } else if (m_cursorPosition + BytesPerLine < m_document->length()) {
-            setCursorPosition(m_cursorPosition + BytesPerLine, moveMode);
+            setFirstVisibleLine(m_firstVisibleLine + 1);
+        } else if (m_cursorPosition + m_bytesPerLine < m_document->length()) {
+            setCursorPosition(m_cursorPosition + m_bytesPerLine, moveMode);
         }
 
         break;
@@ -550,14 +1058,13 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
     case Qt::Key_PageUp:
     case Qt::Key_PageDown:
         // FIXME: does not jet jump to the start and end of the document
-        line = qMax(m_cursorPosition / BytesPerLine - verticalScrollBar()->value(), 0);
+        line = qMax(lineOf(m_cursorPosition) - m_firstVisibleLine, Q_INT64_C(0));
+        pageStep = qMax(visibleLineCount(), 1);
 
-        verticalScrollBar()->triggerAction(event->key() == Qt::Key_PageUp ? QScrollBar::SliderPageStepSub
-                                                                          : QScrollBar::SliderPageStepAdd);
+        setFirstVisibleLine(m_firstVisibleLine + (event->key() == Qt::Key_PageUp ? -pageStep : pageStep));
 
         if (!ctrlPressed) {
-            setCursorPosition((verticalScrollBar()->value() + line) * BytesPerLine + m_cursorPosition % BytesPerLine,
-                              moveMode);
+            setCursorPosition(lineStart(m_firstVisibleLine + line) + columnOf(m_cursorPosition), moveMode);
         }
 
         break;
@@ -566,7 +1073,7 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
         if (ctrlPressed) {
             position = 0;
         } else {
-            position = m_cursorPosition - (m_cursorPosition % BytesPerLine);
+            position = lineStart(lineOf(m_cursorPosition));
         }
 
         setCursorPosition(position, moveMode);
@@ -577,7 +1084,7 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
         if (ctrlPressed) {
             position = m_document->length() - 1;
         } else {
-            position = m_cursorPosition / BytesPerLine * BytesPerLine + (BytesPerLine - 1);
+            position = lineStart(lineOf(m_cursorPosition)) + m_bytesPerLine - 1;
         }
 
         setCursorPosition(position, moveMode);
@@ -605,6 +1112,8 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
                     continue;
                 }
 
+                invalidateSearch();
+
                 if (m_cursorAtLowNibble) {
                     m_document->setByteAt(m_cursorPosition, nibble + (m_document->byteAt(m_cursorPosition) & 0xF0));
                     m_cursorAtLowNibble = false;
@@ -621,16 +1130,50 @@ void BinaryEditorWidget::keyPressEvent(QKeyEvent *event)
                     continue;
                 }
 
+                invalidateSearch();
+
                 m_document->setByteAt(m_cursorPosition, c.unicode());
 
                 setCursorPosition(m_cursorPosition + 1, MoveAnchor);
             }
         }
+
+        if (!text.isEmpty()) {
+            m_inspector->refresh();
+        }
     }
 
     event->accept();
 }
 
+// protected
+void BinaryEditorWidget::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu;
+    QMenu *bytesPerLineMenu = menu.addMenu("Bytes per Line");
+
+    for (int bytesPerLine = 8; bytesPerLine <= 64; bytesPerLine *= 2) {
+        QAction *action = bytesPerLineMenu->addAction(QString::number(bytesPerLine));
+
+        action->setData(bytesPerLine);
+        action->setCheckable(true);
+        action->setChecked(bytesPerLine == m_bytesPerLine);
+    }
+
+    QAction *inspector = menu.addAction("Show Inspector");
+
+    inspector->setCheckable(true);
+    inspector->setChecked(!m_inspector->isHidden());
+
+    QAction *selected = menu.exec(event->globalPos());
+
+    if (selected == inspector) {
+        setInspectorVisible(inspector->isChecked());
+    } else if (selected != NULL) {
+        setBytesPerLine(selected->data().toInt());
+    }
+}
+
 // protected
 void BinaryEditorWidget::focusInEvent(QFocusEvent *event)
 {
@@ -667,41 +1210,239 @@ void BinaryEditorWidget::timerEvent(QTimerEvent *event)
     QAbstractScrollArea::timerEvent(event);
 }
 
+// private slot
+void BinaryEditorWidget::updateSearchProgress(int generation, int percent)
+{
+    if (generation != m_searchGeneration) {
+        return;
+    }
+
+    m_infoArea->setStatus(QString("Searching... %1%").arg(percent));
+}
+
+// private slot
+void BinaryEditorWidget::updateOverlay()
+{
+    viewport()->update();
+}
+
+// private slot
+void BinaryEditorWidget::finishSearch(int generation)
+{
+    if (generation != m_searchGeneration || m_searcher == NULL) {
+        return;
+    }
+
+    m_searcher->wait();
+
+    m_matches = m_searcher->matches();
+    m_matchesTruncated = m_searcher->isTruncated();
+
+    m_searcher->deleteLater();
+    m_searcher = NULL;
+
+    viewport()->update();
+
+    if (m_matches.isEmpty()) {
+        m_infoArea->setStatus("No matches");
+
+        return;
+    }
+
+    // Select the first match at or after the cursor
+    int index = std::lower_bound(m_matches.constBegin(), m_matches.constEnd(), m_cursorPosition)
+                - m_matches.constBegin();
+
+    selectMatch(index < m_matches.size() ? index : 0);
+}
+
+// private static
+int BinaryEditorWidget::bytesPerLineShift(int bytesPerLine)
+{
+    switch (bytesPerLine) {
+    case 8:
+        return 3;
+
+    case 16:
+        return 4;
+
+    case 32:
+        return 5;
+
+    case 64:
+        return 6;
+
+    default:
+        return DefaultBytesPerLineShift;
+    }
+}
+
+// private
+void BinaryEditorWidget::updateAreaGeometries()
+{
+    QRect extraAreaRect = contentsRect();
+
+    extraAreaRect.setTop(extraAreaRect.top() + infoAreaHeight());
+    extraAreaRect.setWidth(extraAreaWidth());
+
+    m_extraArea->setGeometry(extraAreaRect);
+
+    QRect infoAreaRect = contentsRect();
+
+    infoAreaRect.setHeight(infoAreaHeight());
+    infoAreaRect.setRight(infoAreaRect.right() - verticalScrollBar()->width());
+
+    m_infoArea->setGeometry(infoAreaRect);
+
+    // The inspector fills the right viewport margin
+    QRect viewportRect = viewport()->geometry();
+
+    m_inspector->setGeometry(viewportRect.right() + 1, viewportRect.top(), inspectorWidth(), viewportRect.height());
+}
+
 // private
 void BinaryEditorWidget::updateScrollBarRanges()
 {
     int charWidth = MonospaceFontMetrics::charWidth();
-    int lineHeight = MonospaceFontMetrics::lineHeight();
+    int contentWidth = (hexColumnsPerLine() + 1) * charWidth + 1 + (1 + m_bytesPerLine) * charWidth;
+
+    horizontalScrollBar()->setRange(0, contentWidth + m_documentMargin * 2 - viewport()->width());
+    horizontalScrollBar()->setPageStep(viewport()->width());
+
+    qint64 maximumLine = maximumFirstVisibleLine();
+
+    if (m_firstVisibleLine > maximumLine) {
+        m_firstVisibleLine = maximumLine;
+
+        viewport()->update();
+        m_extraArea->update();
+    }
+
+    m_settingScrollBarValue = true;
+
+    verticalScrollBar()->setRange(0, scrollBarValueForLine(maximumLine));
+    verticalScrollBar()->setPageStep(qMax(scrollBarValueForLine(visibleLineCount()), 1));
+    verticalScrollBar()->setValue(scrollBarValueForLine(m_firstVisibleLine));
+    //ensureCursorVisible(); // FIXME
 
+    m_settingScrollBarValue = false;
+}
+
+// private
+int BinaryEditorWidget::visibleLineCount() const
+{
     // Mimic the logic QPlainTextWidget uses to calculate the visible line count. QPlainTextWidget basically takes the
     // viewport height, subtracts the document top/bottom margins (defaults to 4px, see QTextDocument::documentMargin),
     // sutracts 1px (to avoid that the last line could touch the widget bottom) and then calcualtes how many lines fit
     // into the remaining height.
-    int visibleLineCount = qMax(viewport()->height() - m_documentMargin * 2 - 1, 0) / lineHeight;
-    int contentWidth = (HexColumnsPerLine + 1) * charWidth + 1 + (1 + BytesPerLine) * charWidth;
+    return qMax(viewport()->height() - m_documentMargin * 2 - 1, 0) / MonospaceFontMetrics::lineHeight();
+}
 
-    horizontalScrollBar()->setRange(0, contentWidth + m_documentMargin * 2 - viewport()->width());
-    horizontalScrollBar()->setPageStep(viewport()->width());
+// private
+qint64 BinaryEditorWidget::maximumFirstVisibleLine() const
+{
+    return qMax(m_lineCount - visibleLineCount(), Q_INT64_C(0));
+}
 
-    verticalScrollBar()->setRange(0, m_lineCount - visibleLineCount);
-    verticalScrollBar()->setPageStep(visibleLineCount);
-    //ensureCursorVisible(); // FIXME
+// private
+int BinaryEditorWidget::scrollBarValueForLine(qint64 line) const
+{
+    qint64 maximumLine = maximumFirstVisibleLine();
 
-    m_lastVerticalScrollBarValue = verticalScrollBar()->value();
+    if (maximumLine <= MaximumScrollBarRange) {
+        return (int)line;
+    }
+
+    // Calculate in double, because line * MaximumScrollBarRange can overflow qint64 for huge documents
+    return (int)qRound64((double)line * MaximumScrollBarRange / maximumLine);
+}
+
+// private
+qint64 BinaryEditorWidget::lineForScrollBarValue(int value) const
+{
+    qint64 maximumLine = maximumFirstVisibleLine();
+
+    if (maximumLine <= MaximumScrollBarRange) {
+        return value;
+    }
+
+    return qBound(Q_INT64_C(0), qRound64((double)value * maximumLine / MaximumScrollBarRange), maximumLine);
+}
+
+// private
+void BinaryEditorWidget::setFirstVisibleLine(qint64 line)
+{
+    line = qBound(Q_INT64_C(0), line, maximumFirstVisibleLine());
+
+    if (line == m_firstVisibleLine) {
+        return;
+    }
+
+    // Update the scroll bar without letting scrollContentsBy() map its value back to a line, because that mapping is
+    // lossy if the scroll bar value is scaled.
+    m_settingScrollBarValue = true;
+
+    verticalScrollBar()->setValue(scrollBarValueForLine(line));
+
+    m_settingScrollBarValue = false;
+
+    scrollToLine(line, 0);
 }
 
 // private
-void BinaryEditorWidget::redrawLines(int fromPosition, int toPosition)
+void BinaryEditorWidget::scrollToLine(qint64 line, int dx)
+{
+    qint64 lastLine = m_firstVisibleLine;
+    qint64 deltaLines = lastLine - line;
+
+    m_firstVisibleLine = line;
+
+    if (deltaLines == 0 && dx == 0) {
+        return;
+    }
+
+    // Nothing of the old content would stay visible, just redraw everything instead of scrolling
+    if (qAbs(deltaLines) > visibleLineCount()) {
+        viewport()->update();
+        m_extraArea->update();
+
+        return;
+    }
+
+    // The scroll function operates in pixels. Multiply the line delta by the line spacing to convert between the two.
+    int dy = (int)deltaLines * MonospaceFontMetrics::lineHeight();
+
+    // Check if the scroll operation resulted in showing/hiding the first line. If that is the case then an extra top
+    // margin of 4px (see QTextDocument::documentMargin) is added/subtracted to mimic the document margin of the
+    // QPlainTextEdit.
+    if (line == 0 && lastLine != 0) {
+        dy += m_documentMargin;
+    } else if (line != 0 && lastLine == 0) {
+        dy -= m_documentMargin;
+    }
+
+    viewport()->scroll(dx, dy);
+    m_extraArea->scroll(0, dy);
+}
+
+// private
+void BinaryEditorWidget::redrawLines(qint64 fromPosition, qint64 toPosition)
 {
     int lineHeight = MonospaceFontMetrics::lineHeight();
-    int line = verticalScrollBar()->value();
-    int firstLine = qMin(fromPosition, toPosition) / BytesPerLine;
-    int lastLine = qMax(fromPosition, toPosition) / BytesPerLine;
-    int y = (firstLine - line) * lineHeight;
-    int height = (lastLine - firstLine + 1) * lineHeight;
+
+    // Limit the range to the visible lines, it could be far outside of the viewport in a big document
+    qint64 firstLine = qMax(lineOf(qMin(fromPosition, toPosition)), m_firstVisibleLine);
+    qint64 lastLine = qMin(lineOf(qMax(fromPosition, toPosition)), m_firstVisibleLine + visibleLineCount() + 1);
+
+    if (firstLine > lastLine) {
+        return;
+    }
+
+    int y = (int)(firstLine - m_firstVisibleLine) * lineHeight;
+    int height = (int)(lastLine - firstLine + 1) * lineHeight;
 
     // If the first line is visible then offset it by the document margin to mimic the QPlainTextEdit margin behavior.
-    if (line == 0) {
+    if (m_firstVisibleLine == 0) {
         y += m_documentMargin;
     }
 
@@ -730,21 +1471,21 @@ void BinaryEditorWidget::setBlinkingCursorEnabled(bool enable)
 }
 
 // private
-int BinaryEditorWidget::positionAt(const QPoint &position, bool *inHexSection) const
+qint64 BinaryEditorWidget::positionAt(const QPoint &position, bool *inHexSection) const
 {
     int charWidth = MonospaceFontMetrics::charWidth();
     int lineHeight = MonospaceFontMetrics::lineHeight();
-    int maxPosition = m_document->length() - 1;
+    qint64 maxPosition = m_document->length() - 1;
 
     // Calculate x relative to the left edge of the first hex column
     int x = position.x() + horizontalScrollBar()->value() - m_documentMargin;
 
     // Check if x is in the hex section
-    *inHexSection = x < (HexColumnsPerLine + 1) * charWidth;
+    *inHexSection = x < (hexColumnsPerLine() + 1) * charWidth;
 
     // Calculate line relative to the top edge of the first hex line. Use qFloor, because truncation would round
     // towards zero which would produce a wrong result if the position is in the line immediatly above the first line.
-    int line = verticalScrollBar()->value() + qFloor((position.y() - m_documentMargin) / (float)lineHeight);
+    qint64 line = m_firstVisibleLine + qFloor((position.y() - m_documentMargin) / (float)lineHeight);
 
     // Check if position is before the first or after the last line
     if (line < 0) {
@@ -756,28 +1497,28 @@ int BinaryEditorWidget::positionAt(const QPoint &position, bool *inHexSection) c
     if (*inHexSection) {
         // Use qFloor, because truncation would round towards zero which would produce a wrong result if the position
         // is in the column immediatly left to the first hex column.
-        int hexColumn = qBound(0, qFloor((x + (float)charWidth / 2) / (charWidth * 3)), BytesPerLine - 1);
+        int hexColumn = qBound(0, qFloor((x + (float)charWidth / 2) / (charWidth * 3)), m_bytesPerLine - 1);
 
-        return qMin(BytesPerLine * line + hexColumn, maxPosition);
+        return qMin(lineStart(line) + hexColumn, maxPosition);
     } else {
         // Shift x to calculate printable column relative to the left edge of the first printable column
-        x -= BytesPerLine * 3 * charWidth + 1 + charWidth;
+        x -= m_bytesPerLine * 3 * charWidth + 1 + charWidth;
 
         // Use qFloor, because truncation would round towards zero which would produce a wrong result if the position
         // is in the column immediatly left to the first printable column.
-        int printableColumn = qBound(0, qFloor(x / (float)charWidth), BytesPerLine - 1);
+        int printableColumn = qBound(0, qFloor(x / (float)charWidth), m_bytesPerLine - 1);
 
-        return qMin(BytesPerLine * line + printableColumn, maxPosition);
+        return qMin(lineStart(line) + printableColumn, maxPosition);
     }
 }
 
 // private
-void BinaryEditorWidget::setCursorPosition(int position, MoveMode moveMode)
+void BinaryEditorWidget::setCursorPosition(qint64 position, MoveMode moveMode)
 {
-    int lastCursorPosition = m_cursorPosition;
+    qint64 lastCursorPosition = m_cursorPosition;
 
     m_cursorAtLowNibble = false;
-    m_cursorPosition = qBound(0, position, m_document->length() - 1);
+    m_cursorPosition = qBound(Q_INT64_C(0), position, m_document->length() - 1);
 
     if (moveMode == MoveAnchor) {
         redrawLines(m_anchorPosition, lastCursorPosition);
@@ -787,40 +1528,134 @@ void BinaryEditorWidget::setCursorPosition(int position, MoveMode moveMode)
 
     redrawLines(lastCursorPosition, m_cursorPosition);
     ensureCursorVisible();
+
+    m_inspector->setPosition(m_cursorPosition);
 }
 
 // private
 void BinaryEditorWidget::ensureCursorVisible()
 {
+    qint64 cursorLine = lineOf(m_cursorPosition);
+    int visibleLines = qMax(visibleLineCount(), 1);
+
+    // FIXME: need to handle horizontal scrolling
+    if (cursorLine < m_firstVisibleLine) {
+        setFirstVisibleLine(cursorLine);
+    } else if (cursorLine >= m_firstVisibleLine + visibleLines) {
+        setFirstVisibleLine(cursorLine - visibleLines + 1);
+    }
+}
+
+// private
+void BinaryEditorWidget::paintByteRange(QPainter *painter, const QRect &hexRect, const QRect &printableRect, int first,
+                                        int last, const QColor &color) const
+{
+    // The range is given in columns from first to last (exclusive), the trailing space of the last hex column isn't
+    // highlighted
     int charWidth = MonospaceFontMetrics::charWidth();
-    int line = verticalScrollBar()->value();
-    int lineHeight = MonospaceFontMetrics::lineHeight();
-    int y = (m_cursorPosition / BytesPerLine - line) * lineHeight;
-    int leftHex = m_documentMargin - horizontalScrollBar()->value();
-    int leftPrintable = leftHex + (HexColumnsPerLine + 1) * charWidth + 1 + charWidth;
-    int offset = (m_cursorPosition % BytesPerLine) * charWidth;
-    int visibleLineCount = qMax(viewport()->height() - m_documentMargin * 2 - 1, 0) / lineHeight;
-    QRect cursorRect;
 
-    // If the first line is visible then offset it by the document margin to mimic the QPlainTextEdit margin behavior.
-    if (line == 0) {
-        y += m_documentMargin;
+    painter->fillRect(QRect(hexRect.left() + first * 3 * charWidth, hexRect.top(),
+                            (last - first) * 3 * charWidth - charWidth, hexRect.height()), color);
+    painter->fillRect(QRect(printableRect.left() + first * charWidth, printableRect.top(),
+                            (last - first) * charWidth, printableRect.height()), color);
+}
+
+// private
+void BinaryEditorWidget::exportSelection(qint64 position, qint64 length, BinaryMimeData::Encoding encoding)
+{
+    Location suggestion;
+
+    if (!m_document->location().isEmpty()) {
+        suggestion = m_document->location().path() + ".txt";
     }
 
-    if (m_cursorInHexSection) {
-        cursorRect = QRect(leftHex + offset * 3, y, charWidth * 2, lineHeight);
-    } else {
-        cursorRect = QRect(leftPrintable + offset, y, charWidth, lineHeight);
+    const Location &location = FileDialog::getSaveLocation(this, suggestion);
+
+    if (location.isEmpty()) {
+        return;
     }
 
-    QRect viewportRect = viewport()->rect();
+    QString error;
 
-    // FIXME: need to handle horizontal scrolling
-    if (!viewportRect.contains(cursorRect)) {
-        if (cursorRect.top() < viewportRect.top()) {
-            verticalScrollBar()->setValue(m_cursorPosition / BytesPerLine);
-        } else if (cursorRect.bottom() > viewportRect.bottom()) {
-            verticalScrollBar()->setValue(m_cursorPosition / BytesPerLine - visibleLineCount + 1);
-        }
+    if (!BinaryMimeData::exportToFile(m_document->data(), position, length, encoding, location.path(), &error)) {
+        QMessageBox::critical(this, "Export Selection Error", error);
     }
 }
+
+// private
+void BinaryEditorWidget::startSearch(const BinarySearchPattern &pattern)
+{
+    cancelSearch();
+
+    m_searchPattern = pattern;
+    m_matches.clear();
+    m_matchesTruncated = false;
+
+    viewport()->update();
+
+    // The searcher works on an implicitly shared copy of the data, editing the document while the search is running
+    // detaches the document data and the search results are discarded by invalidateSearch()
+    m_searcher = new BinarySearcher(++m_searchGeneration, m_document->data(), pattern, this);
+
+    connect(m_searcher, &BinarySearcher::progressChanged, this, &BinaryEditorWidget::updateSearchProgress);
+    connect(m_searcher, &BinarySearcher::searchFinished, this, &BinaryEditorWidget::finishSearch);
+
+    m_infoArea->setStatus("Searching...");
+    m_searcher->start();
+}
+
+// private
+void BinaryEditorWidget::cancelSearch()
+{
+    if (m_searcher == NULL) {
+        return;
+    }
+
+    // Queued signals of the canceled search might still arrive, bump the generation to ignore them
+    ++m_searchGeneration;
+
+    m_searcher->requestInterruption();
+    m_searcher->wait();
+    m_searcher->deleteLater();
+    m_searcher = NULL;
+}
+
+// private
+void BinaryEditorWidget::invalidateSearch()
+{
+    if (m_searchPattern.isEmpty()) {
+        return;
+    }
+
+    cancelSearch();
+
+    m_searchPattern = BinarySearchPattern();
+    m_matches.clear();
+    m_matchesTruncated = false;
+
+    viewport()->update();
+    m_infoArea->setStatus("");
+}
+
+// private
+void BinaryEditorWidget::selectMatch(int index)
+{
+    qint64 position = m_matches.at(index);
+
+    // Put the cursor at the start of the match, so that findNext() and findPrevious() continue from there
+    goToOffset(position);
+    setCursorPosition(position + m_searchPattern.length() - 1, MoveAnchor);
+    setCursorPosition(position, KeepAnchor);
+
+    m_infoArea->setStatus(QString("Match %1 of %2").arg(index + 1).arg(matchCountText()));
+}
+
+// private
+QString BinaryEditorWidget::matchCountText() const
+{
+    if (m_matchesTruncated) {
+        return QString("more than %1").arg(m_matches.size());
+    }
+
+    return QString::number(m_matches.size());
+}
@@ -22,9 +22,16 @@
 #include <QAbstractScrollArea>
 #include <QBasicTimer>
 #include <QByteArray>
+#include <QVector>
+
+#include "binarymimedata.h"
+#include "binarysearcher.h"
 
 class BinaryDocument;
 class BinaryEditorExtraArea;
+class BinaryEditorInfoArea;
+class BinaryInspectorWidget;
+class QPainter;
 
 class BinaryEditorWidget : public QAbstractScrollArea
 {
@@ -33,6 +40,7 @@ class BinaryEditorWidget : public QAbstractScrollArea
 
 public:
     BinaryEditorWidget(BinaryDocument *document, QWidget *parent = NULL);
+    ~BinaryEditorWidget();
 
     QByteArray data() const;
     void setData(const QByteArray &data);
@@ -42,9 +50,30 @@ public:
     void copy();
     void selectAll();
 
+    int bytesPerLine() const { return m_bytesPerLine; }
+    void setBytesPerLine(int bytesPerLine);
+
+    qint64 cursorPosition() const { return m_cursorPosition; }
+    void goToOffset(qint64 offset);
+    void findNext();
+    void findPrevious();
+
     int extraAreaWidth() const;
     void extraAreaPaintEvent(QPaintEvent *event);
 
+    int infoAreaHeight() const;
+    void infoAreaPaintEvent(QPaintEvent *event);
+
+    int inspectorWidth() const;
+
+public slots:
+    void updateViewportMargins();
+    void showGoToOffsetArea();
+    void showFindArea();
+    void hideInfoArea();
+    void setInspectorVisible(bool visible);
+    void performInfoAreaAction();
+
 protected:
     void scrollContentsBy(int dx, int dy);
     bool event(QEvent *event);
@@ -53,15 +82,32 @@ protected:
     void mousePressEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
+    void wheelEvent(QWheelEvent *event);
     void keyPressEvent(QKeyEvent *event);
+    void contextMenuEvent(QContextMenuEvent *event);
     void focusInEvent(QFocusEvent *event);
     void focusOutEvent(QFocusEvent *event);
     void timerEvent(QTimerEvent *event);
 
+private slots:
+    void updateSearchProgress(int generation, int percent);
+    void finishSearch(int generation);
+    void updateOverlay();
+
 private:
     enum {
-        BytesPerLine = 16,
-        HexColumnsPerLine = BytesPerLine * 3 - 1 // Including the interior whitespace
+        DefaultBytesPerLineShift = 4 // 16 bytes per line
+    };
+
+    enum {
+        // QScrollBar ranges are int. If the document has more lines than this then the vertical scroll bar doesn't
+        // operate in lines anymore, but its value is scaled to map the full range of lines onto this range.
+        MaximumScrollBarRange = 0x3FFFFFFF
+    };
+
+    enum {
+        // Asks before copying more text than this to the clipboard, configurable as BinaryEditor/ClipboardWarningLength
+        DefaultClipboardWarningLength = 64 * 1024 * 1024
     };
 
     enum MoveMode {
@@ -69,30 +115,69 @@ private:
         MoveAnchor
     };
 
+    static int bytesPerLineShift(int bytesPerLine);
+
+    // Lines are always a power of two bytes wide, so positions are mapped to lines and columns by shifting and masking
+    // instead of dividing by a runtime value
+    qint64 lineOf(qint64 position) const { return position >> m_bytesPerLineShift; }
+    int columnOf(qint64 position) const { return (int)(position & (m_bytesPerLine - 1)); }
+    qint64 lineStart(qint64 line) const { return line << m_bytesPerLineShift; }
+    int hexColumnsPerLine() const { return m_bytesPerLine * 3 - 1; } // Including the interior whitespace
+
+    void updateAreaGeometries();
     void updateScrollBarRanges();
-    void redrawLines(int fromPosition, int toPosition);
+    int visibleLineCount() const;
+    qint64 maximumFirstVisibleLine() const;
+    int scrollBarValueForLine(qint64 line) const;
+    qint64 lineForScrollBarValue(int value) const;
+    void setFirstVisibleLine(qint64 line);
+    void scrollToLine(qint64 line, int dx);
+    void redrawLines(qint64 fromPosition, qint64 toPosition);
     void redrawCursorLine();
     void setBlinkingCursorEnabled(bool enable);
-    int positionAt(const QPoint &position, bool *inHexSection) const;
-    void setCursorPosition(int position, MoveMode moveMode);
+    qint64 positionAt(const QPoint &position, bool *inHexSection) const;
+    void setCursorPosition(qint64 position, MoveMode moveMode);
     void ensureCursorVisible();
+    void paintByteRange(QPainter *painter, const QRect &hexRect, const QRect &printableRect, int first, int last,
+                        const QColor &color) const;
+    void exportSelection(qint64 position, qint64 length, BinaryMimeData::Encoding encoding);
+    void startSearch(const BinarySearchPattern &pattern);
+    void cancelSearch();
+    void invalidateSearch();
+    void selectMatch(int index);
+    QString matchCountText() const;
 
     BinaryDocument *m_document; // owned by BinaryEditor
 
     BinaryEditorExtraArea *m_extraArea;
+    int m_addressDigits;
+
+    BinaryEditorInfoArea *m_infoArea;
 
-    int m_lineCount;
+    BinaryInspectorWidget *m_inspector;
+
+    int m_bytesPerLineShift;
+    int m_bytesPerLine;
+    qint64 m_lineCount;
+    qint64 m_firstVisibleLine;
+    bool m_settingScrollBarValue;
 
     bool m_cursorVisible;
     bool m_cursorInHexSection;
     bool m_cursorAtLowNibble;
-    int m_cursorPosition; // in bytes
-    int m_anchorPosition; // in bytes
+    qint64 m_cursorPosition; // in bytes
+    qint64 m_anchorPosition; // in bytes
     QBasicTimer m_cursorBlinkTimer;
 
-    int m_lastVerticalScrollBarValue;
+    int m_wheelDelta; // Accumulates partial wheel steps
     int m_documentMargin; // FIXME: Replace with BinaryDocument::documentMargin()
     bool m_highlightCurrentLine;
+
+    BinarySearcher *m_searcher; // NULL if no search is running
+    int m_searchGeneration; // Identifies the current search, signals of canceled searches are ignored
+    BinarySearchPattern m_searchPattern;
+    QVector<qint64> m_matches; // Sorted start positions
+    bool m_matchesTruncated;
 };
 
 #endif // BINARYEDITORWIDGET_H
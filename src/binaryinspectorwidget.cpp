@@ -0,0 +1,491 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "binaryinspectorwidget.h"
+
+#include "binarydocument.h"
+#include "eventfilter.h"
+#include "monospacefontmetrics.h"
+#include "settings.h"
+
+#include <QAbstractTableModel>
+#include <QApplication>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QToolButton>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+class BinaryValueModel : public QAbstractTableModel
+{
+public:
+    enum {
+        TypeColumn,
+        LittleEndianColumn,
+        BigEndianColumn,
+        ColumnCount
+    };
+
+    BinaryValueModel(BinaryDocument *document, QObject *parent) :
+        QAbstractTableModel(parent),
+        m_document(document),
+        m_position(0)
+    {
+    }
+
+    void setPosition(qint64 position)
+    {
+        m_position = position;
+
+        refresh();
+    }
+
+    void refresh()
+    {
+        // All values only depend on the bytes in this window. If they didn't change then nothing has to be decoded
+        // again, otherwise the views will ask for the values of their visible rows.
+        QByteArray window = m_document->slice(m_position, BinaryDecoder::MaximumSize);
+
+        if (window != m_window) {
+            m_window = window;
+
+            emit dataChanged(index(0, LittleEndianColumn), index(rowCount() - 1, BigEndianColumn));
+        }
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : BinaryDecoder::TypeCount;
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : ColumnCount;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if (!index.isValid() || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        BinaryDecoder::Type type = (BinaryDecoder::Type)index.row();
+
+        if (index.column() == TypeColumn) {
+            return BinaryDecoder::typeDisplayName(type);
+        }
+
+        if (index.column() == BigEndianColumn && !BinaryDecoder::hasEndianness(type)) {
+            return QVariant();
+        }
+
+        QString value;
+
+        if (BinaryDecoder::decode(m_window.constData(), m_window.length(), type, index.column() == BigEndianColumn,
+                                  &value) < 0) {
+            return QVariant();
+        }
+
+        return value;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        switch (section) {
+        case TypeColumn:
+            return "Type";
+
+        case LittleEndianColumn:
+            return "Little Endian";
+
+        case BigEndianColumn:
+            return "Big Endian";
+        }
+
+        return QVariant();
+    }
+
+private:
+    BinaryDocument *m_document;
+    qint64 m_position;
+    QByteArray m_window;
+};
+
+class BinaryStructModel : public QAbstractTableModel
+{
+public:
+    enum {
+        OffsetColumn,
+        NameColumn,
+        TypeColumn,
+        ValueColumn,
+        ColumnCount
+    };
+
+    BinaryStructModel(BinaryDocument *document, QObject *parent) :
+        QAbstractTableModel(parent),
+        m_document(document),
+        m_base(0)
+    {
+    }
+
+    const BinaryStructLayout &layout() const { return m_layout; }
+
+    void setLayout(const BinaryStructLayout &layout)
+    {
+        beginResetModel();
+
+        m_layout = layout;
+        m_fieldOffsets.clear();
+
+        endResetModel();
+    }
+
+    void setBase(qint64 base)
+    {
+        if (m_base != base) {
+            m_base = base;
+
+            refresh();
+        }
+    }
+
+    void refresh()
+    {
+        // LEB128 fields might have changed their length, so the offsets of all following fields are resolved again
+        m_fieldOffsets.clear();
+
+        if (rowCount() > 0) {
+            emit dataChanged(index(0, 0), index(rowCount() - 1, ColumnCount - 1));
+        }
+    }
+
+    // Offsets are resolved lazily in field order, because the offset of a field depends on the length of all fields
+    // before it. Returns -1 if the field starts beyond the end of the document.
+    qint64 fieldOffset(int field) const
+    {
+        while (m_fieldOffsets.size() <= field) {
+            int previous = m_fieldOffsets.size() - 1;
+
+            if (previous < 0) {
+                m_fieldOffsets.append(m_base);
+            } else {
+                qint64 length = fieldLength(previous);
+
+                m_fieldOffsets.append(length < 0 ? -1 : m_fieldOffsets.at(previous) + length);
+            }
+        }
+
+        return m_fieldOffsets.at(field);
+    }
+
+    // The last field starting at or before the offset among the fields resolved so far, 0 if there is none. Painting
+    // resolves the fields up to the visible ones, so this finds the first visible field without walking the fields
+    // before it again.
+    int resolvedFieldBefore(qint64 offset) const
+    {
+        int low = 0;
+        int high = m_fieldOffsets.size();
+
+        // Resolved offsets only grow, except for the -1 of fields beyond the end of the document at the back
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            qint64 fieldOffset = m_fieldOffsets.at(middle);
+
+            if (fieldOffset >= 0 && fieldOffset <= offset) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        return qMax(low - 1, 0);
+    }
+
+    qint64 fieldLength(int field) const
+    {
+        const BinaryStructLayout::Field &definition = m_layout.field(field);
+        int size = BinaryDecoder::fixedSize(definition.type);
+
+        if (size >= 0) {
+            return (qint64)size * definition.count;
+        }
+
+        qint64 offset = fieldOffset(field);
+
+        if (offset < 0) {
+            return -1;
+        }
+
+        QByteArray window = m_document->slice(offset, BinaryDecoder::MaximumSize);
+        QString value;
+
+        return BinaryDecoder::decode(window.constData(), window.length(), definition.type, definition.bigEndian,
+                                     &value);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : m_layout.elementCount();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : ColumnCount;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if (!index.isValid() || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        int field = m_layout.fieldForElement(index.row());
+        const BinaryStructLayout::Field &definition = m_layout.field(field);
+        int element = index.row() - m_layout.firstElement(field);
+
+        switch (index.column()) {
+        case NameColumn:
+            if (definition.count > 1) {
+                return QString("%1[%2]").arg(definition.name).arg(element);
+            }
+
+            return definition.name;
+
+        case TypeColumn:
+            if (BinaryDecoder::hasEndianness(definition.type)) {
+                return QString(definition.bigEndian ? "be " : "le ") + BinaryDecoder::typeName(definition.type);
+            }
+
+            return BinaryDecoder::typeName(definition.type);
+
+        default:
+            break;
+        }
+
+        qint64 offset = fieldOffset(field);
+
+        if (offset < 0) {
+            return QVariant();
+        }
+
+        offset += (qint64)element * qMax(BinaryDecoder::fixedSize(definition.type), 0);
+
+        if (index.column() == OffsetColumn) {
+            return QString::asprintf("%08llX", (unsigned long long)offset);
+        }
+
+        QByteArray window = m_document->slice(offset, BinaryDecoder::MaximumSize);
+        QString value;
+
+        if (BinaryDecoder::decode(window.constData(), window.length(), definition.type, definition.bigEndian,
+                                  &value) < 0) {
+            return QVariant();
+        }
+
+        return value;
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+            return QVariant();
+        }
+
+        switch (section) {
+        case OffsetColumn:
+            return "Offset";
+
+        case NameColumn:
+            return "Name";
+
+        case TypeColumn:
+            return "Type";
+
+        case ValueColumn:
+            return "Value";
+        }
+
+        return QVariant();
+    }
+
+private:
+    BinaryDocument *m_document;
+    BinaryStructLayout m_layout;
+    qint64 m_base;
+    mutable QVector<qint64> m_fieldOffsets;
+};
+
+BinaryInspectorWidget::BinaryInspectorWidget(BinaryDocument *document, QWidget *parent) :
+    QWidget(parent),
+    m_document(document),
+    m_valueModel(new BinaryValueModel(document, this)),
+    m_structModel(new BinaryStructModel(document, this)),
+    m_valueView(new QTreeView),
+    m_layoutEdit(new QLineEdit),
+    m_pinButton(new QToolButton),
+    m_structView(new QTreeView),
+    m_position(0)
+{
+    setFont(QApplication::font());
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    QHBoxLayout *layoutLayout = new QHBoxLayout;
+
+    layout->setContentsMargins(0, 0, 0, 0);
+    layoutLayout->addWidget(new QLabel("Struct:"));
+    layoutLayout->addWidget(m_layoutEdit, 1);
+    layoutLayout->addWidget(m_pinButton);
+    layout->addWidget(m_valueView, 3);
+    layout->addLayout(layoutLayout);
+    layout->addWidget(m_structView, 2);
+
+    QTreeView *views[] = {m_valueView, m_structView};
+
+    for (int i = 0; i < 2; ++i) {
+        views[i]->setFont(MonospaceFontMetrics::font());
+        views[i]->setRootIsDecorated(false);
+        views[i]->setUniformRowHeights(true); // Required to only query the data of visible rows
+        views[i]->setEditTriggers(QTreeView::NoEditTriggers);
+    }
+
+    m_valueView->setModel(m_valueModel);
+    m_valueView->header()->resizeSection(BinaryValueModel::TypeColumn, MonospaceFontMetrics::charWidth() * 18);
+    m_structView->setModel(m_structModel);
+
+    m_layoutEdit->installEventFilter(EventFilter::instance());
+    m_layoutEdit->setPlaceholderText("e.g. u32 magic; be u16 version; u8[4] reserved");
+    m_layoutEdit->setText(Settings::settings()->value("BinaryEditor/StructLayout").toString());
+
+    m_pinButton->setText("Pin");
+    m_pinButton->setToolTip("Keep the struct at its current offset instead of following the cursor");
+    m_pinButton->setCheckable(true);
+    m_pinButton->setAutoRaise(true);
+
+    connect(m_layoutEdit, &QLineEdit::editingFinished, this, &BinaryInspectorWidget::applyLayout);
+    connect(m_pinButton, &QToolButton::toggled, this, &BinaryInspectorWidget::setPinned);
+
+    applyLayout();
+    m_valueModel->setPosition(m_position);
+}
+
+void BinaryInspectorWidget::setPosition(qint64 position)
+{
+    m_position = position;
+    m_valueModel->setPosition(position);
+
+    if (!m_pinButton->isChecked() && !m_structModel->layout().isEmpty()) {
+        m_structModel->setBase(position);
+
+        emit overlayChanged();
+    }
+}
+
+void BinaryInspectorWidget::refresh()
+{
+    m_valueModel->refresh();
+
+    if (!m_structModel->layout().isEmpty()) {
+        m_structModel->refresh();
+
+        emit overlayChanged();
+    }
+}
+
+QVector<BinaryInspectorWidget::OverlayRange> BinaryInspectorWidget::overlayRanges(qint64 start, qint64 end) const
+{
+    QVector<OverlayRange> ranges;
+
+    if (!isVisible()) {
+        return ranges;
+    }
+
+    // Field offsets only grow, so the search can start at the last field starting at or before the start and stop at
+    // the first field starting at or after the end
+    for (int field = m_structModel->resolvedFieldBefore(start); field < m_structModel->layout().fieldCount(); ++field) {
+        qint64 offset = m_structModel->fieldOffset(field);
+
+        if (offset < 0 || offset >= end) {
+            break;
+        }
+
+        qint64 length = m_structModel->fieldLength(field);
+
+        if (length <= 0) {
+            break;
+        }
+
+        if (offset + length > start) {
+            OverlayRange range;
+
+            range.start = offset;
+            range.end = offset + length;
+            range.field = field;
+
+            ranges.append(range);
+        }
+    }
+
+    return ranges;
+}
+
+// private slot
+void BinaryInspectorWidget::applyLayout()
+{
+    BinaryStructLayout layout;
+    QString error;
+
+    if (!layout.parse(m_layoutEdit->text(), &error)) {
+        m_layoutEdit->setStyleSheet("QLineEdit { color: red }");
+        m_layoutEdit->setToolTip(error);
+
+        return;
+    }
+
+    m_layoutEdit->setStyleSheet("");
+    m_layoutEdit->setToolTip("");
+
+    Settings::settings()->setValue("BinaryEditor/StructLayout", m_layoutEdit->text());
+
+    m_structModel->setLayout(layout);
+
+    if (!m_pinButton->isChecked()) {
+        m_structModel->setBase(m_position);
+    }
+
+    emit overlayChanged();
+}
+
+// private slot
+void BinaryInspectorWidget::setPinned(bool pinned)
+{
+    if (!pinned) {
+        m_structModel->setBase(m_position);
+
+        emit overlayChanged();
+    }
+}
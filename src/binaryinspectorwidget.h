@@ -0,0 +1,74 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BINARYINSPECTORWIDGET_H
+#define BINARYINSPECTORWIDGET_H
+
+#include "binarydecoder.h"
+
+#include <QWidget>
+
+class BinaryDocument;
+class BinaryStructModel;
+class BinaryValueModel;
+class QLineEdit;
+class QToolButton;
+class QTreeView;
+
+// Shows the bytes at the cursor decoded as various types and an optional user defined struct layout. Values are only
+// decoded when the views ask for them, which they only do for visible rows.
+class BinaryInspectorWidget : public QWidget
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BinaryInspectorWidget)
+
+public:
+    struct OverlayRange {
+        qint64 start;
+        qint64 end; // exclusive
+        int field;
+    };
+
+    explicit BinaryInspectorWidget(BinaryDocument *document, QWidget *parent = NULL);
+
+    void setPosition(qint64 position);
+    void refresh();
+
+    // Fields of the struct layout that overlap the range from start to end (exclusive)
+    QVector<OverlayRange> overlayRanges(qint64 start, qint64 end) const;
+
+signals:
+    void overlayChanged();
+
+private slots:
+    void applyLayout();
+    void setPinned(bool pinned);
+
+private:
+    BinaryDocument *m_document;
+    BinaryValueModel *m_valueModel;
+    BinaryStructModel *m_structModel;
+    QTreeView *m_valueView;
+    QLineEdit *m_layoutEdit;
+    QToolButton *m_pinButton;
+    QTreeView *m_structView;
+    qint64 m_position;
+};
+
+#endif // BINARYINSPECTORWIDGET_H
@@ -0,0 +1,218 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "binarymimedata.h"
+
+#include <QSaveFile>
+#include <QStringList>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BINARYMIMEDATA_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#define BINARYMIMEDATA_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static const char *s_hexDigits = "0123456789ABCDEF";
+
+BinaryMimeData::BinaryMimeData(const QByteArray &data, qint64 position, qint64 length, Encoding encoding) :
+    m_data(data),
+    m_position(position),
+    m_length(length),
+    m_encoding(encoding)
+{
+    Q_ASSERT(position >= 0 && length >= 0 && position + length <= data.length());
+    Q_ASSERT(encodedLength(length, encoding) <= MaximumEncodedLength);
+}
+
+QStringList BinaryMimeData::formats() const
+{
+    return QStringList() << "text/plain";
+}
+
+bool BinaryMimeData::hasFormat(const QString &mimeType) const
+{
+    return mimeType == "text/plain";
+}
+
+// static
+qint64 BinaryMimeData::encodedLength(qint64 length, Encoding encoding)
+{
+    if (encoding == Hex) {
+        return qMax(length * 3 - 1, Q_INT64_C(0)); // No space after the last byte
+    } else {
+        return length;
+    }
+}
+
+// static
+qint64 BinaryMimeData::encode(const char *data, qint64 length, Encoding encoding, char *output)
+{
+    // The hex encoding writes a space after every byte, the caller has to drop the last one if necessary. This allows
+    // to encode a selection in chunks.
+    if (encoding == Hex) {
+        encodeHex(data, length, output);
+
+        return length * 3;
+    } else {
+        encodePrintable(data, length, output);
+
+        return length;
+    }
+}
+
+// static
+bool BinaryMimeData::exportToFile(const QByteArray &data, qint64 position, qint64 length, Encoding encoding,
+                                  const QString &path, QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    // Written to a temporary file that only replaces the target once everything was written, so a failed export
+    // doesn't leave a truncated file behind
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = QString("Could not open \"%1\" for writing: %2").arg(path, file.errorString());
+
+        return false;
+    }
+
+    // Encode chunk by chunk into one reused buffer instead of encoding the whole selection at once
+    const qint64 chunkLength = 1024 * 1024;
+    QByteArray buffer((int)encodedLength(chunkLength, encoding) + 1, Qt::Uninitialized);
+
+    for (qint64 offset = 0; offset < length; offset += chunkLength) {
+        qint64 currentLength = qMin(chunkLength, length - offset);
+        qint64 outputLength = encode(data.constData() + position + offset, currentLength, encoding, buffer.data());
+
+        if (offset + currentLength == length && encoding == Hex) {
+            --outputLength; // No space after the last byte
+        }
+
+        if (file.write(buffer.constData(), outputLength) < outputLength) {
+            *error = QString("Could not write to \"%1\": %2").arg(path, file.errorString());
+
+            return false; // The temporary file is removed when the QSaveFile is destroyed without commit()
+        }
+    }
+
+    if (!file.commit()) {
+        *error = QString("Could not write to \"%1\": %2").arg(path, file.errorString());
+
+        return false;
+    }
+
+    return true;
+}
+
+// protected
+QVariant BinaryMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+    Q_UNUSED(type)
+
+    if (mimeType != "text/plain") {
+        return QVariant();
+    }
+
+    if (m_text.isEmpty() && m_length > 0) {
+        // Allocate the output once and encode directly into it
+        m_text = QByteArray((int)encodedLength(m_length, m_encoding) + 1, Qt::Uninitialized);
+
+        encode(m_data.constData() + m_position, m_length, m_encoding, m_text.data());
+
+        m_text.resize((int)encodedLength(m_length, m_encoding));
+    }
+
+    return m_text;
+}
+
+// private
+void BinaryMimeData::encodeHex(const char *data, qint64 length, char *output)
+{
+    qint64 i = 0;
+
+#ifdef BINARYMIMEDATA_USE_SSSE3
+    // Look up the digits of 16 high and 16 low nibbles at once with a byte shuffle, interleave them into two registers
+    // holding the digits of bytes 0 to 7 and 8 to 15 and then spread those over 48 output bytes with another round of
+    // shuffles. Shuffle indices with the high bit set produce zero, those positions get the spaces.
+    const __m128i digits = _mm_loadu_si128((const __m128i *)s_hexDigits);
+    const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+    const __m128i spread0 = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i spread1First = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i spread1Second = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 0, 1, -1, 2, 3, -1, 4, 5);
+    const __m128i spread2 = _mm_setr_epi8(-1, 6, 7, -1, 8, 9, -1, 10, 11, -1, 12, 13, -1, 14, 15, -1);
+    const __m128i spaces0 = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0);
+    const __m128i spaces1 = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0);
+    const __m128i spaces2 = _mm_setr_epi8(' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ');
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibbleMask));
+        __m128i first = _mm_unpacklo_epi8(high, low);
+        __m128i second = _mm_unpackhi_epi8(high, low);
+        char *current = output + i * 3;
+
+        _mm_storeu_si128((__m128i *)current, _mm_or_si128(_mm_shuffle_epi8(first, spread0), spaces0));
+        _mm_storeu_si128((__m128i *)(current + 16),
+                         _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, spread1First),
+                                                   _mm_shuffle_epi8(second, spread1Second)), spaces1));
+        _mm_storeu_si128((__m128i *)(current + 32), _mm_or_si128(_mm_shuffle_epi8(second, spread2), spaces2));
+    }
+#endif
+
+    for (; i < length; ++i) {
+        quint8 byte = data[i];
+
+        output[i * 3] = s_hexDigits[byte >> 4];
+        output[i * 3 + 1] = s_hexDigits[byte & 0x0F];
+        output[i * 3 + 2] = ' ';
+    }
+}
+
+// private
+void BinaryMimeData::encodePrintable(const char *data, qint64 length, char *output)
+{
+    qint64 i = 0;
+
+#ifdef BINARYMIMEDATA_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i del = _mm_set1_epi8(127);
+    const __m128i space = _mm_set1_epi8(' ');
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+
+        // As signed chars the bytes from 1 to 126 are exactly the ones greater than 0 and less than 127
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, zero), _mm_cmplt_epi8(bytes, del));
+
+        _mm_storeu_si128((__m128i *)(output + i),
+                         _mm_or_si128(_mm_and_si128(printable, bytes), _mm_andnot_si128(printable, space)));
+    }
+#endif
+
+    for (; i < length; ++i) {
+        quint8 byte = data[i];
+
+        output[i] = byte >= 1 && byte <= 126 ? (char)byte : ' ';
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BINARYMIMEDATA_H
+#define BINARYMIMEDATA_H
+
+#include <QByteArray>
+#include <QMimeData>
+
+// Provides a selection of binary data as text/plain in hex or printable form. The text is only encoded once another
+// application actually asks for the clipboard content, copying a big selection doesn't cost anything up front.
+class BinaryMimeData : public QMimeData
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BinaryMimeData)
+
+public:
+    enum Encoding {
+        Hex, // "0A 1B 2C"
+        Printable // Bytes from 1 to 126 as is, everything else as space
+    };
+
+    enum {
+        // A QByteArray can hold slightly less than 2 GiB
+        MaximumEncodedLength = 0x7FFF0000
+    };
+
+    BinaryMimeData(const QByteArray &data, qint64 position, qint64 length, Encoding encoding);
+
+    QStringList formats() const;
+    bool hasFormat(const QString &mimeType) const;
+
+    static qint64 encodedLength(qint64 length, Encoding encoding);
+    static qint64 encode(const char *data, qint64 length, Encoding encoding, char *output);
+    static bool exportToFile(const QByteArray &data, qint64 position, qint64 length, Encoding encoding,
+                             const QString &path, QString *error);
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const;
+
+private:
+    static void encodeHex(const char *data, qint64 length, char *output);
+    static void encodePrintable(const char *data, qint64 length, char *output);
+
+    QByteArray m_data; // Implicitly shared with the BinaryDocument, edits detach it
+    qint64 m_position;
+    qint64 m_length;
+    Encoding m_encoding;
+    mutable QByteArray m_text; // Encoded on first request
+};
+
+#endif // BINARYMIMEDATA_H
@@ -0,0 +1,269 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "binarysearcher.h"
+
+#include <QtAlgorithms>
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BINARYSEARCHER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+bool BinarySearchPattern::parse(const QString &text, Syntax syntax, QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    m_bytes.clear();
+    m_mask.clear();
+
+    if (syntax == Hex) {
+        int nibbleCount = 0;
+        int byte = 0;
+        int mask = 0;
+
+        for (int i = 0; i < text.length(); ++i) {
+            ushort c = text.at(i).toLower().unicode();
+            int nibble;
+            int nibbleMask = 0x0F;
+
+            if (text.at(i).isSpace()) {
+                continue;
+            } else if (c >= '0' && c <= '9') {
+                nibble = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                nibble = c - 'a' + 10;
+            } else if (c == '?') {
+                nibble = 0;
+                nibbleMask = 0x00;
+            } else {
+                *error = QString("Invalid character '%1' in hex pattern.").arg(text.at(i));
+
+                return false;
+            }
+
+            byte = (byte << 4) | nibble;
+            mask = (mask << 4) | nibbleMask;
+
+            if (++nibbleCount % 2 == 0) {
+                m_bytes.append((char)byte);
+                m_mask.append((char)mask);
+
+                byte = 0;
+                mask = 0;
+            }
+        }
+
+        if (nibbleCount % 2 != 0) {
+            *error = "Hex pattern has an odd number of digits.";
+
+            return false;
+        }
+    } else if (syntax == Text) {
+        m_bytes = text.toUtf8();
+        m_mask.fill((char)0xFF, m_bytes.length());
+    } else if (syntax == Utf16LE || syntax == Utf16BE) {
+        for (int i = 0; i < text.length(); ++i) {
+            ushort c = text.at(i).unicode();
+
+            if (syntax == Utf16LE) {
+                m_bytes.append((char)(c & 0xFF));
+                m_bytes.append((char)(c >> 8));
+            } else {
+                m_bytes.append((char)(c >> 8));
+                m_bytes.append((char)(c & 0xFF));
+            }
+        }
+
+        m_mask.fill((char)0xFF, m_bytes.length());
+    } else {
+        Q_ASSERT(false);
+    }
+
+    if (m_bytes.isEmpty()) {
+        *error = "Pattern is empty.";
+
+        return false;
+    }
+
+    if (m_mask.count((char)0x00) == m_mask.length()) {
+        *error = "Pattern consists of wildcards only.";
+
+        m_bytes.clear();
+        m_mask.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool BinarySearchPattern::matchesAt(const char *data) const
+{
+    const char *bytes = m_bytes.constData();
+    const char *mask = m_mask.constData();
+    int length = m_bytes.length();
+
+    for (int i = 0; i < length; ++i) {
+        if ((data[i] & mask[i]) != bytes[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BinarySearcher::BinarySearcher(int generation, const QByteArray &data, const BinarySearchPattern &pattern,
+                               QObject *parent) :
+    QThread(parent),
+    m_generation(generation),
+    m_data(data),
+    m_pattern(pattern),
+    m_firstAnchor(-1),
+    m_lastAnchor(-1),
+    m_truncated(false)
+{
+    Q_ASSERT(!m_pattern.isEmpty());
+
+    for (int i = 0; i < m_pattern.length(); ++i) {
+        if ((quint8)m_pattern.m_mask.at(i) == 0xFF) {
+            if (m_firstAnchor < 0) {
+                m_firstAnchor = i;
+            }
+
+            m_lastAnchor = i;
+        }
+    }
+}
+
+// protected
+void BinarySearcher::run()
+{
+    // Scan in chunks to be able to report progress and to react to interruption requests in a timely manner
+    const qint64 chunkSize = 16 * 1024 * 1024;
+    qint64 candidateCount = (qint64)m_data.length() - m_pattern.length() + 1;
+    int lastPercent = -1;
+
+    for (qint64 from = 0; from < candidateCount && !m_truncated; from += chunkSize) {
+        if (isInterruptionRequested()) {
+            return;
+        }
+
+        qint64 to = qMin(from + chunkSize, candidateCount);
+
+        scan(from, to);
+
+        int percent = (int)(to * 100 / candidateCount);
+
+        if (percent != lastPercent) {
+            lastPercent = percent;
+
+            emit progressChanged(m_generation, percent);
+        }
+    }
+
+    emit searchFinished(m_generation);
+}
+
+// private
+void BinarySearcher::scan(qint64 from, qint64 to)
+{
+    const char *data = m_data.constData();
+    qint64 position = from;
+
+    if (m_firstAnchor < 0) {
+        // Every pattern byte contains a wildcard nibble, there is nothing to prefilter on
+        for (; position < to && !m_truncated; ++position) {
+            if (m_pattern.matchesAt(data + position)) {
+                addMatch(position);
+            }
+        }
+
+        return;
+    }
+
+    char first = m_pattern.m_bytes.at(m_firstAnchor);
+
+#ifdef BINARYSEARCHER_USE_SSE2
+    if (m_lastAnchor != m_firstAnchor) {
+        // Compare 16 candidate positions at once against the first and the last significant pattern byte and only
+        // verify the whole pattern where both match. Checking two bytes instead of one avoids most false candidates
+        // in data dominated by a few byte values, such as zero-filled areas in disk images. All loads stay in bounds,
+        // because position + 15 is a valid candidate position and the anchors are inside the pattern.
+        const __m128i firsts = _mm_set1_epi8(first);
+        const __m128i lasts = _mm_set1_epi8(m_pattern.m_bytes.at(m_lastAnchor));
+
+        for (; position + 16 <= to; position += 16) {
+            __m128i blockFirst = _mm_loadu_si128((const __m128i *)(data + position + m_firstAnchor));
+            __m128i blockLast = _mm_loadu_si128((const __m128i *)(data + position + m_lastAnchor));
+            quint32 bits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firsts, blockFirst),
+                                                           _mm_cmpeq_epi8(lasts, blockLast)));
+
+            while (bits != 0) {
+                qint64 candidate = position + qCountTrailingZeroBits(bits);
+
+                if (m_pattern.matchesAt(data + candidate)) {
+                    addMatch(candidate);
+
+                    if (m_truncated) {
+                        return;
+                    }
+                }
+
+                bits &= bits - 1;
+            }
+        }
+    }
+#endif
+
+    // Use memchr for the rest, it is vectorized in all relevant C libraries
+    while (position < to) {
+        const char *found = (const char *)memchr(data + position + m_firstAnchor, first, (size_t)(to - position));
+
+        if (found == NULL) {
+            break;
+        }
+
+        qint64 candidate = found - data - m_firstAnchor;
+
+        if (m_pattern.matchesAt(data + candidate)) {
+            addMatch(candidate);
+
+            if (m_truncated) {
+                return;
+            }
+        }
+
+        position = candidate + 1;
+    }
+}
+
+// private
+void BinarySearcher::addMatch(qint64 position)
+{
+    if (m_matches.size() >= MaximumMatchCount) {
+        m_truncated = true;
+
+        return;
+    }
+
+    m_matches.append(position);
+}
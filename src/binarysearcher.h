@@ -0,0 +1,92 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BINARYSEARCHER_H
+#define BINARYSEARCHER_H
+
+#include <QByteArray>
+#include <QThread>
+#include <QVector>
+
+class BinarySearchPattern
+{
+public:
+    enum Syntax {
+        Hex, // Hex digits, "?" is a wildcard nibble, whitespace is ignored
+        Text, // UTF-8
+        Utf16LE,
+        Utf16BE
+    };
+
+    BinarySearchPattern() { }
+
+    bool parse(const QString &text, Syntax syntax, QString *error);
+
+    bool isEmpty() const { return m_bytes.isEmpty(); }
+    int length() const { return m_bytes.length(); }
+
+    bool operator==(const BinarySearchPattern &other) const { return m_bytes == other.m_bytes && m_mask == other.m_mask; }
+    bool operator!=(const BinarySearchPattern &other) const { return !(*this == other); }
+
+    bool matchesAt(const char *data) const;
+
+private:
+    QByteArray m_bytes; // Already masked
+    QByteArray m_mask; // 0xFF for significant bytes, 0x00 for wildcard bytes, 0xF0 and 0x0F for wildcard nibbles
+
+    friend class BinarySearcher;
+};
+
+class BinarySearcher : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BinarySearcher)
+
+public:
+    enum {
+        MaximumMatchCount = 1000000
+    };
+
+    BinarySearcher(int generation, const QByteArray &data, const BinarySearchPattern &pattern, QObject *parent = NULL);
+
+    // Only valid after searchFinished() was emitted
+    QVector<qint64> matches() const { return m_matches; }
+    bool isTruncated() const { return m_truncated; }
+
+signals:
+    void progressChanged(int generation, int percent);
+    void searchFinished(int generation);
+
+protected:
+    void run();
+
+private:
+    void scan(qint64 from, qint64 to);
+    void addMatch(qint64 position);
+
+    int m_generation;
+    QByteArray m_data; // Implicitly shared with the BinaryDocument, edits detach it
+    BinarySearchPattern m_pattern;
+    int m_firstAnchor; // Index of the first fully significant pattern byte, -1 if there is none
+    int m_lastAnchor; // Index of the last fully significant pattern byte, -1 if there is none
+    QVector<qint64> m_matches;
+    bool m_truncated;
+};
+
+#endif // BINARYSEARCHER_H
@@ -0,0 +1,104 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "diffmodel.h"
+
+#include "monospacefontmetrics.h"
+
+#include <QBrush>
+
+#include <algorithm>
+
+DiffModel::DiffModel(QObject *parent) :
+    QAbstractListModel(parent),
+    m_rowCount(0)
+{
+}
+
+void DiffModel::setDiff(const QSharedPointer<LineInterner> &interner, const QVector<LineDiff::Hunk> &hunks,
+                        const QVector<int> &oldLines, const QVector<int> &newLines)
+{
+    beginResetModel();
+
+    m_interner = interner;
+    m_hunks = hunks;
+    m_oldLines = oldLines;
+    m_newLines = newLines;
+    m_hunkRows.clear();
+    m_rowCount = 0;
+
+    foreach (const LineDiff::Hunk &hunk, m_hunks) {
+        m_hunkRows.append(m_rowCount);
+        m_rowCount += 1 + hunk.oldCount + hunk.newCount;
+    }
+
+    endResetModel();
+}
+
+void DiffModel::clear()
+{
+    setDiff(QSharedPointer<LineInterner>(), QVector<LineDiff::Hunk>(), QVector<int>(), QVector<int>());
+}
+
+int DiffModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+QVariant DiffModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (role == Qt::FontRole) {
+        return MonospaceFontMetrics::font();
+    }
+
+    int row = index.row();
+    const int *hunkRow = std::upper_bound(m_hunkRows.constBegin(), m_hunkRows.constEnd(), row);
+    int hunkIndex = hunkRow - m_hunkRows.constBegin() - 1;
+    const LineDiff::Hunk &hunk = m_hunks.at(hunkIndex);
+    int offset = row - m_hunkRows.at(hunkIndex);
+
+    if (offset == 0) {
+        if (role == Qt::DisplayRole) {
+            // Same numbering as unified diffs, an empty side refers to the line before it
+            return QString("@@ -%1,%2 +%3,%4 @@")
+                   .arg(hunk.oldCount > 0 ? hunk.oldStart + 1 : hunk.oldStart).arg(hunk.oldCount)
+                   .arg(hunk.newCount > 0 ? hunk.newStart + 1 : hunk.newStart).arg(hunk.newCount);
+        } else if (role == Qt::ForegroundRole) {
+            return QBrush(Qt::darkGray);
+        }
+    } else if (offset <= hunk.oldCount) {
+        if (role == Qt::DisplayRole) {
+            return "-" + m_interner->line(m_oldLines.at(hunk.oldStart + offset - 1));
+        } else if (role == Qt::ForegroundRole) {
+            return QBrush(Qt::darkRed);
+        }
+    } else {
+        if (role == Qt::DisplayRole) {
+            return "+" + m_interner->line(m_newLines.at(hunk.newStart + offset - 1 - hunk.oldCount));
+        } else if (role == Qt::ForegroundRole) {
+            return QBrush(Qt::darkGreen);
+        }
+    }
+
+    return QVariant();
+}
@@ -0,0 +1,52 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DIFFMODEL_H
+#define DIFFMODEL_H
+
+#include "linediff.h"
+
+#include <QAbstractListModel>
+#include <QSharedPointer>
+
+// Lists the hunks of a line diff, each as a header row followed by its removed and added lines
+class DiffModel : public QAbstractListModel
+{
+    Q_DISABLE_COPY(DiffModel)
+
+public:
+    explicit DiffModel(QObject *parent = NULL);
+
+    void setDiff(const QSharedPointer<LineInterner> &interner, const QVector<LineDiff::Hunk> &hunks,
+                 const QVector<int> &oldLines, const QVector<int> &newLines);
+    void clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+
+private:
+    QSharedPointer<LineInterner> m_interner;
+    QVector<LineDiff::Hunk> m_hunks;
+    QVector<int> m_oldLines;
+    QVector<int> m_newLines;
+    QVector<int> m_hunkRows; // first row of each hunk
+    int m_rowCount;
+};
+
+#endif // DIFFMODEL_H
@@ -0,0 +1,466 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "directorymodel.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileIconProvider>
+#include <QMutexLocker>
+#include <QTimerEvent>
+
+#include <algorithm>
+
+// Orders entry indexes of a DirectoryListing, directories first, then by name, case-insensitively
+class DirectoryListingLessThan
+{
+public:
+    DirectoryListingLessThan(const QVector<QString> &names, const QVector<bool> &directories) :
+        m_names(names),
+        m_directories(directories)
+    {
+    }
+
+    bool operator()(int index, int other) const
+    {
+        if (m_directories.at(index) != m_directories.at(other)) {
+            return m_directories.at(index);
+        }
+
+        int result = m_names.at(index).compare(m_names.at(other), Qt::CaseInsensitive);
+
+        if (result != 0) {
+            return result < 0;
+        }
+
+        return m_names.at(index) < m_names.at(other);
+    }
+
+private:
+    const QVector<QString> &m_names;
+    const QVector<bool> &m_directories;
+};
+
+void DirectoryListing::append(const QFileInfo &fileInfo)
+{
+    m_names.append(fileInfo.fileName());
+    m_directories.append(fileInfo.isDir());
+    m_fileSizes.append(fileInfo.isDir() ? 0 : fileInfo.size());
+    m_lastModified.append(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+void DirectoryListing::append(const DirectoryListing &other)
+{
+    m_names += other.m_names;
+    m_directories += other.m_directories;
+    m_fileSizes += other.m_fileSizes;
+    m_lastModified += other.m_lastModified;
+}
+
+void DirectoryListing::sort()
+{
+    QVector<int> order(size());
+
+    for (int i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), DirectoryListingLessThan(m_names, m_directories));
+
+    QVector<QString> names(order.size());
+    QVector<bool> directories(order.size());
+    QVector<qint64> fileSizes(order.size());
+    QVector<qint64> lastModified(order.size());
+
+    for (int i = 0; i < order.size(); ++i) {
+        int index = order.at(i);
+
+        names[i] = m_names.at(index);
+        directories[i] = m_directories.at(index);
+        fileSizes[i] = m_fileSizes.at(index);
+        lastModified[i] = m_lastModified.at(index);
+    }
+
+    m_names = names;
+    m_directories = directories;
+    m_fileSizes = fileSizes;
+    m_lastModified = lastModified;
+}
+
+void DirectoryListing::clear()
+{
+    m_names.clear();
+    m_directories.clear();
+    m_fileSizes.clear();
+    m_lastModified.clear();
+}
+
+DirectoryEnumerator::DirectoryEnumerator(const QString &directoryPath, QObject *parent) :
+    QThread(parent),
+    m_directoryPath(directoryPath)
+{
+}
+
+DirectoryListing DirectoryEnumerator::takeBatch()
+{
+    QMutexLocker locker(&m_batchMutex);
+    DirectoryListing batch = m_batch;
+
+    m_batch.clear();
+
+    return batch;
+}
+
+// protected
+void DirectoryEnumerator::run()
+{
+    // QDirIterator reads the directory in large blocks (getdents on Linux), hand the entries over in batches as well
+    QDirIterator iterator(m_directoryPath, QDir::AllEntries | QDir::AllDirs | QDir::NoDotAndDotDot);
+    DirectoryListing batch;
+
+    while (iterator.hasNext() && !isInterruptionRequested()) {
+        iterator.next();
+        batch.append(iterator.fileInfo());
+
+        if (batch.size() >= BatchSize || !iterator.hasNext()) {
+            m_listing.append(batch);
+
+            {
+                QMutexLocker locker(&m_batchMutex);
+
+                m_batch.append(batch);
+            }
+
+            batch.clear();
+
+            emit batchReady(m_directoryPath);
+        }
+    }
+
+    m_listing.sort();
+
+    emit enumerationFinished(m_directoryPath);
+}
+
+DirectoryCache *DirectoryCache::s_instance = NULL;
+
+DirectoryCache::DirectoryCache(QObject *parent) :
+    QObject(parent)
+{
+    s_instance = this;
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &DirectoryCache::markStale);
+}
+
+DirectoryCache::~DirectoryCache()
+{
+    foreach (DirectoryEnumerator *enumerator, m_enumerators) {
+        enumerator->requestInterruption();
+        enumerator->wait();
+    }
+
+    s_instance = NULL;
+}
+
+// static
+bool DirectoryCache::listing(const QString &directoryPath, DirectoryListing *listing)
+{
+    Q_ASSERT(listing != NULL);
+
+    DirectoryCache *cache = s_instance;
+    QHash<QString, DirectoryListing>::const_iterator iterator = cache->m_listings.constFind(directoryPath);
+
+    if (iterator != cache->m_listings.constEnd()) {
+        cache->m_recentDirectoryPaths.removeOne(directoryPath);
+        cache->m_recentDirectoryPaths.append(directoryPath);
+
+        *listing = iterator.value();
+
+        return true;
+    }
+
+    if (!cache->m_enumerators.contains(directoryPath)) {
+        cache->startEnumeration(directoryPath);
+    }
+
+    listing->clear();
+
+    return false;
+}
+
+// protected
+void DirectoryCache::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_refreshTimer.timerId()) {
+        m_refreshTimer.stop();
+
+        foreach (const QString &directoryPath, m_staleDirectoryPaths) {
+            if (!m_listings.contains(directoryPath)) {
+                m_staleDirectoryPaths.remove(directoryPath); // evicted in the meantime
+            } else if (!m_enumerators.contains(directoryPath)) {
+                m_staleDirectoryPaths.remove(directoryPath);
+                m_refreshingDirectoryPaths.insert(directoryPath);
+
+                startEnumeration(directoryPath);
+            }
+        }
+
+        // Directories that are still being read are refreshed once that is done
+        if (!m_staleDirectoryPaths.isEmpty()) {
+            m_refreshTimer.start(300, this);
+        }
+    }
+
+    QObject::timerEvent(event);
+}
+
+// private slot
+void DirectoryCache::forwardBatch(const QString &directoryPath)
+{
+    DirectoryEnumerator *enumerator = m_enumerators.value(directoryPath, NULL);
+
+    if (enumerator == NULL) {
+        return;
+    }
+
+    const DirectoryListing &batch = enumerator->takeBatch();
+
+    // A refresh replaces the whole listing at the end instead of adding to the one that is already shown
+    if (!batch.isEmpty() && !m_refreshingDirectoryPaths.contains(directoryPath)) {
+        emit batchLoaded(directoryPath, batch);
+    }
+}
+
+// private slot
+void DirectoryCache::finishEnumeration(const QString &directoryPath)
+{
+    DirectoryEnumerator *enumerator = m_enumerators.take(directoryPath);
+
+    if (enumerator == NULL) {
+        return;
+    }
+
+    enumerator->wait();
+
+    insert(directoryPath, enumerator->listing());
+
+    enumerator->deleteLater();
+
+    m_refreshingDirectoryPaths.remove(directoryPath);
+
+    emit listingChanged(directoryPath);
+}
+
+// private slot
+void DirectoryCache::markStale(const QString &directoryPath)
+{
+    m_staleDirectoryPaths.insert(directoryPath);
+
+    m_refreshTimer.start(300, this);
+}
+
+// private
+void DirectoryCache::startEnumeration(const QString &directoryPath)
+{
+    Q_ASSERT(!m_enumerators.contains(directoryPath));
+
+    DirectoryEnumerator *enumerator = new DirectoryEnumerator(directoryPath, this);
+
+    connect(enumerator, &DirectoryEnumerator::batchReady, this, &DirectoryCache::forwardBatch);
+    connect(enumerator, &DirectoryEnumerator::enumerationFinished, this, &DirectoryCache::finishEnumeration);
+
+    m_enumerators.insert(directoryPath, enumerator);
+
+    enumerator->start();
+}
+
+// private
+void DirectoryCache::insert(const QString &directoryPath, const DirectoryListing &listing)
+{
+    if (!m_listings.contains(directoryPath)) {
+        m_watcher.addPath(directoryPath);
+    }
+
+    m_listings.insert(directoryPath, listing);
+    m_recentDirectoryPaths.removeOne(directoryPath);
+    m_recentDirectoryPaths.append(directoryPath);
+
+    while (m_recentDirectoryPaths.size() > MaximumDirectoryCount) {
+        const QString &evictedDirectoryPath = m_recentDirectoryPaths.takeFirst();
+
+        m_listings.remove(evictedDirectoryPath);
+        m_watcher.removePath(evictedDirectoryPath);
+    }
+}
+
+DirectoryModel::DirectoryModel(QObject *parent) :
+    QAbstractTableModel(parent),
+    m_loading(false)
+{
+    QFileIconProvider iconProvider;
+
+    m_directoryIcon = iconProvider.icon(QFileIconProvider::Folder);
+    m_fileIcon = iconProvider.icon(QFileIconProvider::File);
+
+    connect(DirectoryCache::instance(), &DirectoryCache::batchLoaded, this, &DirectoryModel::appendBatch);
+    connect(DirectoryCache::instance(), &DirectoryCache::listingChanged, this, &DirectoryModel::updateListing);
+}
+
+int DirectoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_listing.size();
+}
+
+int DirectoryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant DirectoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    int row = index.row();
+
+    if (index.column() == NameColumn) {
+        if (role == Qt::DisplayRole) {
+            return m_listing.name(row);
+        } else if (role == Qt::DecorationRole) {
+            return m_listing.isDirectory(row) ? m_directoryIcon : m_fileIcon;
+        }
+    } else if (index.column() == SizeColumn) {
+        if (role == Qt::DisplayRole) {
+            return m_listing.isDirectory(row) ? QString() : formatFileSize(m_listing.fileSize(row));
+        } else if (role == Qt::TextAlignmentRole) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+    } else if (index.column() == LastModifiedColumn) {
+        if (role == Qt::DisplayRole) {
+            return QDateTime::fromMSecsSinceEpoch(m_listing.lastModified(row)).toString(Qt::SystemLocaleShortDate);
+        }
+    }
+
+    return QVariant();
+}
+
+QVariant DirectoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case NameColumn:
+        return "Name";
+
+    case SizeColumn:
+        return "Size";
+
+    case LastModifiedColumn:
+        return "Date Modified";
+
+    default:
+        return QVariant();
+    }
+}
+
+void DirectoryModel::setDirectoryPath(const QString &directoryPath)
+{
+    beginResetModel();
+
+    m_directoryPath = directoryPath;
+    m_loading = !DirectoryCache::listing(directoryPath, &m_listing);
+    m_rows.clear();
+
+    endResetModel();
+}
+
+QModelIndex DirectoryModel::index(int row, int column, const QModelIndex &parent) const
+{
+    return QAbstractTableModel::index(row, column, parent);
+}
+
+QModelIndex DirectoryModel::index(const QString &fileName) const
+{
+    if (m_rows.isEmpty()) {
+        for (int row = 0; row < m_listing.size(); ++row) {
+            m_rows.insert(m_listing.name(row), row);
+        }
+    }
+
+    int row = m_rows.value(fileName, -1);
+
+    return row >= 0 ? index(row, NameColumn) : QModelIndex();
+}
+
+// private slot
+void DirectoryModel::appendBatch(const QString &directoryPath, const DirectoryListing &batch)
+{
+    if (directoryPath != m_directoryPath || !m_loading) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_listing.size(), m_listing.size() + batch.size() - 1);
+
+    m_listing.append(batch);
+    m_rows.clear();
+
+    endInsertRows();
+}
+
+// private slot
+void DirectoryModel::updateListing(const QString &directoryPath)
+{
+    if (directoryPath != m_directoryPath) {
+        return;
+    }
+
+    emit listingAboutToBeUpdated();
+
+    beginResetModel();
+
+    m_loading = !DirectoryCache::listing(directoryPath, &m_listing);
+    m_rows.clear();
+
+    endResetModel();
+
+    emit listingUpdated();
+}
+
+// private static
+QString DirectoryModel::formatFileSize(qint64 size)
+{
+    static const char *units[] = { "KiB", "MiB", "GiB", "TiB" };
+
+    if (size < 1024) {
+        return QString("%1 bytes").arg(size);
+    }
+
+    double value = size / 1024.0;
+    int unit = 0;
+
+    while (value >= 1024 && unit < 3) {
+        value /= 1024;
+        ++unit;
+    }
+
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(units[unit]);
+}
@@ -0,0 +1,194 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DIRECTORYMODEL_H
+#define DIRECTORYMODEL_H
+
+#include <QAbstractTableModel>
+#include <QBasicTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QIcon>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+class QFileInfo;
+
+// Entries of a single directory, one array per property
+class DirectoryListing
+{
+public:
+    int size() const { return m_names.size(); }
+    bool isEmpty() const { return m_names.isEmpty(); }
+
+    QString name(int index) const { return m_names.at(index); }
+    bool isDirectory(int index) const { return m_directories.at(index); }
+    qint64 fileSize(int index) const { return m_fileSizes.at(index); }
+    qint64 lastModified(int index) const { return m_lastModified.at(index); } // msecs since epoch
+
+    void append(const QFileInfo &fileInfo);
+    void append(const DirectoryListing &other);
+    void sort(); // directories first, then by name, case-insensitively
+    void clear();
+
+private:
+    QVector<QString> m_names;
+    QVector<bool> m_directories;
+    QVector<qint64> m_fileSizes;
+    QVector<qint64> m_lastModified;
+};
+
+// Reads a directory on a worker thread. The entries are handed over in batches while reading, so that the first
+// entries of a huge directory can be shown before all of them are read.
+class DirectoryEnumerator : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DirectoryEnumerator)
+
+public:
+    enum {
+        BatchSize = 4096
+    };
+
+    DirectoryEnumerator(const QString &directoryPath, QObject *parent = NULL);
+
+    QString directoryPath() const { return m_directoryPath; }
+
+    DirectoryListing takeBatch();
+
+    // Only valid after enumerationFinished() was emitted, sorted
+    DirectoryListing listing() const { return m_listing; }
+
+signals:
+    void batchReady(const QString &directoryPath);
+    void enumerationFinished(const QString &directoryPath);
+
+protected:
+    void run();
+
+private:
+    QString m_directoryPath;
+    DirectoryListing m_listing;
+    QMutex m_batchMutex;
+    DirectoryListing m_batch; // protected by m_batchMutex
+};
+
+// Keeps the listings of the most recently visited directories for the lifetime of the application, so that opening a
+// FileDialog again doesn't read them again. A QFileSystemWatcher triggers a background refresh of a cached directory
+// when it changes.
+class DirectoryCache : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DirectoryCache)
+
+public:
+    enum {
+        MaximumDirectoryCount = 16
+    };
+
+    explicit DirectoryCache(QObject *parent = NULL);
+    ~DirectoryCache();
+
+    static DirectoryCache *instance() { return s_instance; }
+
+    // Returns true and the cached listing if there is one. Otherwise starts reading the directory, batchLoaded() and
+    // listingChanged() follow.
+    static bool listing(const QString &directoryPath, DirectoryListing *listing);
+
+signals:
+    void batchLoaded(const QString &directoryPath, const DirectoryListing &batch);
+    void listingChanged(const QString &directoryPath);
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void forwardBatch(const QString &directoryPath);
+    void finishEnumeration(const QString &directoryPath);
+    void markStale(const QString &directoryPath);
+
+private:
+    void startEnumeration(const QString &directoryPath);
+    void insert(const QString &directoryPath, const DirectoryListing &listing);
+
+    static DirectoryCache *s_instance;
+
+    QHash<QString, DirectoryListing> m_listings;
+    QStringList m_recentDirectoryPaths; // most recent last
+    QHash<QString, DirectoryEnumerator *> m_enumerators;
+    QSet<QString> m_refreshingDirectoryPaths; // enumerators that refresh a cached listing and don't forward batches
+    QSet<QString> m_staleDirectoryPaths;
+    QFileSystemWatcher m_watcher;
+    QBasicTimer m_refreshTimer; // Coalesces change notifications, a directory often changes several times in a row
+};
+
+// Flat model of the entries of one directory for the FileDialog, backed by the DirectoryCache
+class DirectoryModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DirectoryModel)
+
+public:
+    enum Column {
+        NameColumn,
+        SizeColumn,
+        LastModifiedColumn,
+        ColumnCount
+    };
+
+    explicit DirectoryModel(QObject *parent = NULL);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    QString directoryPath() const { return m_directoryPath; } // with trailing separator
+    void setDirectoryPath(const QString &directoryPath);
+    bool isLoading() const { return m_loading; }
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex index(const QString &fileName) const; // invalid if there is no such entry (yet)
+    QString fileName(const QModelIndex &index) const { return m_listing.name(index.row()); }
+    QString filePath(const QModelIndex &index) const { return m_directoryPath + m_listing.name(index.row()); }
+    bool isDir(const QModelIndex &index) const { return m_listing.isDirectory(index.row()); }
+
+signals:
+    // Emitted around replacing the shown entries after the directory was read or changed on disk
+    void listingAboutToBeUpdated();
+    void listingUpdated();
+
+private slots:
+    void appendBatch(const QString &directoryPath, const DirectoryListing &batch);
+    void updateListing(const QString &directoryPath);
+
+private:
+    static QString formatFileSize(qint64 size);
+
+    QString m_directoryPath;
+    DirectoryListing m_listing;
+    bool m_loading;
+    mutable QHash<QString, int> m_rows; // keyed by name, built on demand
+    QIcon m_directoryIcon;
+    QIcon m_fileIcon;
+};
+
+#endif // DIRECTORYMODEL_H
@@ -32,6 +32,9 @@ void Document::setLocation(const Location &location)
     if (m_location != location) {
         m_location = location;
 
+        // Done once here, so that DocumentManager::find() can recognize other paths of this file without file access
+        m_location.resolveFileId();
+
         emit locationChanged(m_location);
     }
 }
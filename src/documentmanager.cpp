@@ -22,11 +22,15 @@
 #include "binaryeditor.h"
 #include "encodingdialog.h"
 #include "filedialog.h"
+#include "filewatcher.h"
 #include "mainwindow.h"
+#include "settings.h"
 #include "textdocument.h"
 #include "textcodec.h"
 #include "texteditor.h"
+#include "textviewer.h"
 
+#include <QDataStream>
 #include <QDebug>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -54,12 +58,8 @@ DocumentManager::~DocumentManager()
 void DocumentManager::create()
 {
     TextDocument *document = new TextDocument(TextCodec::fromName("UTF-8"));
-    TextEditor *editor = new TextEditor(document);
 
-    s_instance->m_documents.append(document);
-    s_instance->m_editors.insert(document, editor);
-
-    connect(document, &Document::modificationChanged, s_instance, &DocumentManager::updateModificationCount);
+    add(document, new TextEditor(document));
 
     emit s_instance->opened(document);
 
@@ -90,30 +90,42 @@ Document *DocumentManager::open(const Location &location, Document::Type type, T
     Q_ASSERT(type == Document::Text || codec == NULL);
     Q_ASSERT(error != NULL);
 
+    // Also catches the file being open under another path, for example through a symlink
     if (find(location) != NULL) {
         *error = QString("File \"%1\" is already open.").arg(location.path());
 
         return NULL;
     }
 
-    QFile file(location.path());
+    Document *document;
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        *error = QString("Could not open \"%1\" for reading: %2").arg(location.path(), file.errorString());
+    if (type == Document::Text) {
+        document = new TextDocument(codec, s_instance);
+    } else if (type == Document::Binary) {
+        document = new BinaryDocument(s_instance);
+    } else {
+        Q_ASSERT(false);
 
         return NULL;
     }
 
-    // FIXME: do this in chunks to avoid blocking the UI if the file is big
-    const QByteArray &data = file.readAll();
+    document->setLocation(location);
 
-    if (file.error() != QFile::NoError) {
-        *error = QString("Could not read from \"%1\": %2").arg(location.path(), file.errorString());
+    Editor *editor = read(document, error);
+
+    if (editor == NULL) {
+        delete document;
 
         return NULL;
     }
 
-    return load(location, type, data, codec, error);
+    add(document, editor);
+
+    emit s_instance->opened(document);
+
+    setCurrent(document);
+
+    return document;
 }
 
 // static
@@ -162,10 +174,9 @@ Document *DocumentManager::load(const Location &location, Document::Type type, c
         Q_ASSERT(false);
     }
 
-    s_instance->m_documents.append(document);
-    s_instance->m_editors.insert(document, editor);
+    add(document, editor);
 
-    connect(document, &Document::modificationChanged, s_instance, &DocumentManager::updateModificationCount);
+    FileWatcher::watch(document, data);
 
     emit s_instance->opened(document);
 
@@ -229,8 +240,12 @@ void DocumentManager::saveAs(Document *document, const Location &location)
         return;
     }
 
+    file.close(); // Flush now, the file watcher needs to see the final modification time
+
     document->setModified(false);
     document->setLocation(location);
+
+    FileWatcher::watch(document, data);
 }
 
 // static
@@ -264,10 +279,23 @@ void DocumentManager::close(Document *document)
     emit s_instance->aboutToBeClosed(document);
 
     s_instance->m_documents.removeAll(document);
+    s_instance->removeFromIndex(document);
+
+    FileWatcher::unwatch(document);
+
+    disconnect(document, &Document::locationChanged, s_instance, &DocumentManager::updateLocationOfSender);
 
     // Need to delete-later the editor and the document here to avoid deleting them too early in the middle of a reopen
-    // cycle, which in turn would trigger a segfault.
-    s_instance->m_editors.take(document)->deleteLater();
+    // cycle, which in turn would trigger a segfault. A restored document that was never read has no editor yet.
+    Editor *editor = s_instance->m_editors.take(document);
+
+    if (editor != NULL) {
+        editor->deleteLater();
+    } else {
+        document->deleteLater();
+    }
+
+    s_instance->m_restoredPositions.remove(document);
 
     s_instance->updateModificationCount();
 }
@@ -277,13 +305,27 @@ Document *DocumentManager::find(const Location &location)
 {
     Q_ASSERT(!location.isEmpty());
 
-    foreach (Document *document, s_instance->m_documents) {
-        if (document->location() == location) {
-            return document;
-        }
+    Document *document = s_instance->m_documentsByLocation.value(location, NULL);
+
+    if (document != NULL || s_instance->m_documentsByFileId.isEmpty()) {
+        return document;
+    }
+
+    // Another path of the same file, for example through a symlink. The file ID is resolved here, callers usually pass
+    // a location that was just made from a path.
+    if (location.hasFileId()) {
+        return s_instance->m_documentsByFileId.value(location.fileId(), NULL);
     }
 
-    return NULL;
+    Location resolvedLocation(location);
+
+    resolvedLocation.resolveFileId();
+
+    if (resolvedLocation.hasFileId()) {
+        document = s_instance->m_documentsByFileId.value(resolvedLocation.fileId(), NULL);
+    }
+
+    return document;
 }
 
 // static
@@ -300,6 +342,10 @@ void DocumentManager::setCurrent(Document *document)
 {
     Q_ASSERT(document == NULL || s_instance->m_documents.contains(document));
 
+    if (document != NULL && !s_instance->m_editors.contains(document) && !materialize(document)) {
+        return;
+    }
+
     if (document != s_instance->m_current) {
         s_instance->m_current = document;
 
@@ -364,7 +410,7 @@ void DocumentManager::showEncodingDialog(Document *document)
         TextDocument *textDocument = static_cast<TextDocument *>(document);
 
         codec = textDocument->codec();
-        hasDecodingError = textDocument->hasDecodingError();
+        hasDecodingError = textDocument->hasDecodingError() || textDocument->isMapped();
     }
 
     EncodingDialog dialog(codec, MainWindow::instance());
@@ -378,7 +424,8 @@ void DocumentManager::showEncodingDialog(Document *document)
     if (hasDecodingError) {
         // If the TextDocument has a decoding error then it was never correctly loaded in the first place and doesn't
         // contain the actual text from the underlying file in a reusable way. In this case reopen the file with the
-        // selected codec. There are no unsaved changes to be lost.
+        // selected codec. There are no unsaved changes to be lost. The same applies to a mapped TextDocument, it can't
+        // be modified and its text is only ever decoded line by line.
         const Location &location = document->location();
         Document::Type type = codec != NULL ? Document::Text : Document::Binary;
         QString error;
@@ -466,6 +513,128 @@ void DocumentManager::showEncodingDialog(Document *document)
     }
 }
 
+// static
+void DocumentManager::saveSession()
+{
+    QList<Document *> documents;
+
+    foreach (Document *document, s_instance->m_documents) {
+        if (!document->location().isEmpty()) {
+            documents.append(document);
+        }
+    }
+
+    QByteArray session;
+    QDataStream stream(&session, QIODevice::WriteOnly);
+
+    stream << (quint8)SessionFormatVersion;
+    stream << (qint32)documents.indexOf(s_instance->m_current);
+    stream << (quint32)documents.length();
+
+    foreach (Document *document, documents) {
+        Editor *editor = s_instance->m_editors.value(document, NULL);
+        ViewPosition position = s_instance->m_restoredPositions.value(document);
+        qint64 codecNumber = -1;
+
+        if (editor != NULL) {
+            position.cursorPosition = editor->cursorPosition();
+            position.firstVisibleLine = editor->firstVisibleLine();
+        }
+
+        if (document->type() == Document::Text) {
+            TextCodec *codec = static_cast<TextDocument *>(document)->codec();
+
+            if (codec != NULL) {
+                codecNumber = codec->number();
+            }
+        }
+
+        stream << document->location().path().toUtf8();
+        stream << (quint8)document->type();
+        stream << codecNumber;
+        stream << position.cursorPosition;
+        stream << position.firstVisibleLine;
+    }
+
+    Settings::settings()->setValue("DocumentManager/Session", session);
+}
+
+// static
+void DocumentManager::restoreSession()
+{
+    const QByteArray &session = Settings::settings()->value("DocumentManager/Session").toByteArray();
+
+    if (session.isEmpty()) {
+        return;
+    }
+
+    QDataStream stream(session);
+    quint8 formatVersion;
+
+    stream >> formatVersion;
+
+    if (formatVersion != SessionFormatVersion) {
+        qDebug() << "DocumentManager::restoreSession: Ignoring session with unknown format version" << formatVersion;
+
+        return;
+    }
+
+    qint32 currentIndex;
+    quint32 count;
+    Document *current = NULL;
+
+    stream >> currentIndex;
+    stream >> count;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QByteArray path;
+        quint8 type;
+        qint64 codecNumber;
+        ViewPosition position;
+
+        stream >> path;
+        stream >> type;
+        stream >> codecNumber;
+        stream >> position.cursorPosition;
+        stream >> position.firstVisibleLine;
+
+        if (stream.status() != QDataStream::Ok || path.isEmpty() ||
+            (type != Document::Text && type != Document::Binary)) {
+            continue;
+        }
+
+        // Only metadata is touched here, the file is read once the document becomes current
+        Location location(QString::fromUtf8(path));
+
+        if (!location.exists() || find(location) != NULL) {
+            continue;
+        }
+
+        Document *document;
+
+        if (type == Document::Text) {
+            // Without a known codec the encoding is detected again on reading, the same as for a newly opened file
+            document = new TextDocument(codecNumber >= 0 ? TextCodec::fromNumber(codecNumber) : NULL, s_instance);
+        } else {
+            document = new BinaryDocument(s_instance);
+        }
+
+        document->setLocation(location);
+
+        s_instance->m_restoredPositions.insert(document, position);
+
+        add(document, NULL);
+
+        emit s_instance->opened(document);
+
+        if ((qint32)i == currentIndex) {
+            current = document;
+        }
+    }
+
+    setCurrent(current);
+}
+
 // private slot
 void DocumentManager::updateModificationCount()
 {
@@ -483,3 +652,167 @@ void DocumentManager::updateModificationCount()
         emit modificationCountChanged(m_modificationCount);
     }
 }
+
+// private slot
+void DocumentManager::updateLocationOfSender()
+{
+    Document *document = qobject_cast<Document *>(sender());
+
+    Q_ASSERT(document != NULL);
+
+    removeFromIndex(document);
+    addToIndex(document);
+}
+
+// private static
+void DocumentManager::add(Document *document, Editor *editor)
+{
+    s_instance->m_documents.append(document);
+
+    if (editor != NULL) {
+        s_instance->m_editors.insert(document, editor);
+    }
+
+    s_instance->addToIndex(document);
+
+    connect(document, &Document::modificationChanged, s_instance, &DocumentManager::updateModificationCount);
+    connect(document, &Document::locationChanged, s_instance, &DocumentManager::updateLocationOfSender);
+}
+
+// private static
+Editor *DocumentManager::read(Document *document, QString *error)
+{
+    Q_ASSERT(document != NULL);
+    Q_ASSERT(error != NULL);
+
+    const QString &path = document->location().path();
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Could not open \"%1\" for reading: %2").arg(path, file.errorString());
+
+        return NULL;
+    }
+
+    // Huge text files are only viewed, a QTextDocument would take ages to load them and need several times their size.
+    // The viewer finds the lines in the raw bytes, files in encodings like UTF-16 are still loaded as a whole.
+    qint64 viewerThreshold = Settings::settings()->value("TextDocument/ViewerThreshold",
+                                                         (qint64)TextDocument::DefaultViewerThreshold).toLongLong();
+
+    if (document->type() == Document::Text && viewerThreshold > 0 && file.size() > viewerThreshold &&
+        canMap(static_cast<TextDocument *>(document), &file)) {
+        TextDocument *textDocument = static_cast<TextDocument *>(document);
+
+        if (!textDocument->map(path, error)) {
+            return NULL;
+        }
+
+        FileWatcher::watch(document, QByteArray()); // remaps the file when it changes
+
+        return new TextViewer(textDocument);
+    }
+
+    // FIXME: do this in chunks to avoid blocking the UI if the file is big
+    const QByteArray &data = file.readAll();
+
+    if (file.error() != QFile::NoError) {
+        *error = QString("Could not read from \"%1\": %2").arg(path, file.errorString());
+
+        return NULL;
+    }
+
+    if (!document->load(data, error)) {
+        return NULL;
+    }
+
+    FileWatcher::watch(document, data);
+
+    if (document->type() == Document::Text) {
+        return new TextEditor(static_cast<TextDocument *>(document));
+    }
+
+    return new BinaryEditor(static_cast<BinaryDocument *>(document));
+}
+
+// private static
+bool DocumentManager::canMap(TextDocument *document, QFile *file)
+{
+    // Same detection as TextDocument::map() does for a document without a codec
+    TextCodec *codec = document->codec();
+
+    if (codec == NULL) {
+        codec = TextCodec::fromByteOrderMark(file->peek(4));
+    }
+
+    if (codec == NULL) {
+        codec = TextCodec::fromName("UTF-8");
+    }
+
+    return codec->hasAsciiLineBreaks();
+}
+
+// private static
+bool DocumentManager::materialize(Document *document)
+{
+    // If reading fails then the document is closed, the file might have been removed or become unreadable since the
+    // session was saved
+    QString error;
+    Editor *editor = read(document, &error);
+
+    if (editor == NULL) {
+        if (error.isEmpty()) {
+            error = QString("Could not open \"%1\": Unknown error.").arg(document->location().path());
+        }
+
+        QMessageBox::critical(MainWindow::instance(), "Open File Error", error);
+
+        close(document);
+
+        return false;
+    }
+
+    s_instance->m_editors.insert(document, editor);
+
+    ViewPosition position = s_instance->m_restoredPositions.take(document);
+
+    editor->restorePosition(position.cursorPosition, position.firstVisibleLine);
+
+    return true;
+}
+
+// private
+void DocumentManager::addToIndex(Document *document)
+{
+    const Location &location = document->location();
+
+    if (location.isEmpty()) {
+        return;
+    }
+
+    m_documentsByLocation.insert(location, document);
+
+    if (location.hasFileId()) {
+        m_documentsByFileId.insert(location.fileId(), document);
+    }
+
+    m_indexedLocations.insert(document, location);
+}
+
+// private
+void DocumentManager::removeFromIndex(Document *document)
+{
+    if (!m_indexedLocations.contains(document)) {
+        return;
+    }
+
+    const Location &location = m_indexedLocations.take(document);
+
+    // Only remove entries that still refer to this document
+    if (m_documentsByLocation.value(location, NULL) == document) {
+        m_documentsByLocation.remove(location);
+    }
+
+    if (location.hasFileId() && m_documentsByFileId.value(location.fileId(), NULL) == document) {
+        m_documentsByFileId.remove(location.fileId());
+    }
+}
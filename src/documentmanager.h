@@ -21,11 +21,15 @@
 
 #include <QHash>
 #include <QObject>
+#include <QPair>
 
 #include "document.h"
 
+class QFile;
+
 class Editor;
 class TextCodec;
+class TextDocument;
 
 class DocumentManager : public QObject
 {
@@ -49,6 +53,7 @@ public:
     static void saveAll();
     static void close(Document *document);
     static Document *find(const Location &location);
+    static QList<Document *> documents() { return s_instance->m_documents; }
 
     static Editor *editor(Document *document);
 
@@ -61,6 +66,11 @@ public:
     static void showSaveAsDialog(Document *document);
     static void showEncodingDialog(Document *document);
 
+    // The open documents are saved on exit. On startup they are listed right away, but each one is only read once it
+    // becomes current for the first time.
+    static void saveSession();
+    static void restoreSession();
+
 signals:
     void opened(Document *document);
     void aboutToBeClosed(Document *document);
@@ -69,12 +79,39 @@ signals:
 
 private slots:
     void updateModificationCount();
+    void updateLocationOfSender();
 
 private:
+    enum {
+        SessionFormatVersion = 1
+    };
+
+    struct ViewPosition
+    {
+        ViewPosition() : cursorPosition(-1), firstVisibleLine(-1) { }
+
+        qint64 cursorPosition;
+        qint64 firstVisibleLine;
+    };
+
+    static void add(Document *document, Editor *editor);
+    static Editor *read(Document *document, QString *error);
+    static bool canMap(TextDocument *document, QFile *file);
+    static bool materialize(Document *document);
+
+    void addToIndex(Document *document);
+    void removeFromIndex(Document *document);
+
     static DocumentManager *s_instance;
 
-    QList<Document *> m_documents; // owned by their editors
-    QHash<Document *, Editor *> m_editors;
+    QList<Document *> m_documents; // owned by their editors, or by this if they don't have one yet
+    QHash<Document *, Editor *> m_editors; // restored documents don't have an editor until they are read
+    QHash<Document *, ViewPosition> m_restoredPositions; // of the restored documents that weren't read yet
+
+    // Index of the named documents for find(), kept in sync with their locations
+    QHash<Location, Document *> m_documentsByLocation;
+    QHash<QPair<quint64, quint64>, Document *> m_documentsByFileId;
+    QHash<Document *, Location> m_indexedLocations; // the location each document is indexed by
     Document *m_current; // can be NULL if there is no current document
     int m_modificationCount;
 };
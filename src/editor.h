@@ -42,7 +42,8 @@ public:
     };
 
     enum Feature {
-        WordWrapping
+        WordWrapping,
+        Following
     };
 
     explicit Editor(QObject *parent = NULL);
@@ -54,6 +55,16 @@ public:
     virtual bool hasFeature(Feature feature) const { Q_UNUSED(feature) return false; }
 
     virtual bool isWordWrapping() const { return false; }
+    virtual bool isFollowing() const { return false; }
+
+    // Saved with the session and restored once the document is read again, -1 if the editor doesn't have one
+    virtual qint64 cursorPosition() const { return -1; }
+    virtual qint64 firstVisibleLine() const { return -1; }
+    virtual void restorePosition(qint64 cursorPosition, qint64 firstVisibleLine)
+    {
+        Q_UNUSED(cursorPosition)
+        Q_UNUSED(firstVisibleLine)
+    }
 
 public slots:
     virtual void undo() { }
@@ -66,9 +77,11 @@ public slots:
     virtual void toggleCase() { }
 
     virtual void setWordWrapping(bool enable) { Q_UNUSED(enable) }
+    virtual void setFollowing(bool enable) { Q_UNUSED(enable) }
 
 signals:
     void actionAvailabilityChanged(Action action, bool available);
+    void followingChanged(bool following);
 };
 
 #endif // EDITOR_H
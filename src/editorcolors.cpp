@@ -24,6 +24,12 @@ QColor EditorColors::s_currentLineHighlightColor;
 QColor EditorColors::s_innerWrapMarkerColor;
 QColor EditorColors::s_outerWrapMarkerColor;
 QColor EditorColors::s_infoBackgroundColor;
+QColor EditorColors::s_searchMatchColor;
+QColor EditorColors::s_evenStructFieldColor;
+QColor EditorColors::s_oddStructFieldColor;
+QColor EditorColors::s_gitAddedColor;
+QColor EditorColors::s_gitModifiedColor;
+QColor EditorColors::s_gitDeletedColor;
 
 // static
 void EditorColors::initialize()
@@ -56,4 +62,10 @@ void EditorColors::initialize()
     s_innerWrapMarkerColor = QColor(194, 235, 194);
     s_outerWrapMarkerColor = QColor(235, 194, 194);
     s_infoBackgroundColor = QColor(255, 255, 225);
+    s_searchMatchColor = QColor(255, 239, 11, 160);
+    s_evenStructFieldColor = QColor(194, 220, 245);
+    s_oddStructFieldColor = QColor(220, 235, 250);
+    s_gitAddedColor = QColor(84, 178, 84);
+    s_gitModifiedColor = QColor(92, 140, 214);
+    s_gitDeletedColor = QColor(214, 76, 76);
 }
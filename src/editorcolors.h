@@ -32,6 +32,11 @@ public:
     static QColor innerWrapMarkerColor() { return s_innerWrapMarkerColor; }
     static QColor outerWrapMarkerColor() { return s_outerWrapMarkerColor; }
     static QColor infoBackgroundColor() { return s_infoBackgroundColor; }
+    static QColor searchMatchColor() { return s_searchMatchColor; }
+    static QColor structFieldColor(int field) { return (field % 2) ? s_oddStructFieldColor : s_evenStructFieldColor; }
+    static QColor gitAddedColor() { return s_gitAddedColor; }
+    static QColor gitModifiedColor() { return s_gitModifiedColor; }
+    static QColor gitDeletedColor() { return s_gitDeletedColor; }
 
 private:
     static QPalette *s_basicPalette;
@@ -39,6 +44,12 @@ private:
     static QColor s_innerWrapMarkerColor;
     static QColor s_outerWrapMarkerColor;
     static QColor s_infoBackgroundColor;
+    static QColor s_searchMatchColor;
+    static QColor s_evenStructFieldColor;
+    static QColor s_oddStructFieldColor;
+    static QColor s_gitAddedColor;
+    static QColor s_gitModifiedColor;
+    static QColor s_gitDeletedColor;
 };
 
 #endif // EDITORCOLORS_H
@@ -19,13 +19,13 @@
 #include "filedialog.h"
 #include "ui_filedialog.h"
 
+#include "directorymodel.h"
 #include "eventfilter.h"
 #include "settings.h"
 #include "utils.h"
 
 #include <QDebug>
 #include <QFileIconProvider>
-#include <QFileSystemModel>
 #include <QMenu>
 #include <QMessageBox>
 #include <QStandardItemModel>
@@ -269,26 +269,26 @@ void FileDialog::pick()
 
     if (!text.isEmpty()) {
         const Location &location = QDir::isAbsolutePath(text) ? text : rootDirectoryPath() + text;
-        const QModelIndex &directoryIndex = m_filesModel->index(location.directoryPath());
+        const QFileInfo directoryInfo(QDir::cleanPath(location.directoryPath()));
 
         // If the directory part of the picked location doesn't exist then neither can a file be opened from it nor can
         // a file be saved to it.
-        if (!directoryIndex.isValid()) {
+        if (!directoryInfo.exists()) {
             reportError(QString("\"%1\" does not exist.").arg(location.directoryPath()));
 
             return;
         }
 
         // The directory part of the picked location might exist, but as a file
-        if (!m_filesModel->isDir(directoryIndex)) {
+        if (!directoryInfo.isDir()) {
             reportError(QString("\"%1\" does exist, but is not a directory.").arg(location.directoryPath()));
 
             return;
         }
 
-        const QModelIndex &index = m_filesModel->index(location.path());
+        const QFileInfo info(location.path());
 
-        if (!index.isValid()) {
+        if (!info.exists()) {
             if (m_saveFileMode && location.isFile()) {
                 m_pickedLocations << location;
 
@@ -300,13 +300,11 @@ void FileDialog::pick()
             return;
         }
 
-        if (m_filesModel->isDir(index)) {
-            const QString &directoryPath = m_filesModel->filePath(index) + "/"; // Append slash to indicate directory
+        if (info.isDir()) {
+            const QString &directoryPath = location.path() + "/"; // Append slash to indicate directory
 
             setNavigation(setLocation(directoryPath));
         } else {
-            const Location &location = m_filesModel->filePath(index);
-
             if (m_saveFileMode && !confirmOverwrite(location)) {
                 return;
             }
@@ -369,6 +367,50 @@ void FileDialog::saveBookmarks()
     settings->endArray();
 }
 
+// private slot
+void FileDialog::rememberSelection()
+{
+    const QItemSelection &selection = m_ui->treeFiles->selectionModel()->selection();
+    const QModelIndexList &indexes = Utils::convertItemSelectionToIndexList(selection, 0);
+
+    // Keep the names that are still waiting to be selected if nothing was selected in the meantime
+    if (indexes.isEmpty()) {
+        return;
+    }
+
+    m_pendingSelection.clear();
+
+    foreach (const QModelIndex &index, indexes) {
+        m_pendingSelection << m_filesModel->fileName(index);
+    }
+}
+
+// private slot
+void FileDialog::restoreSelection()
+{
+    if (m_filesModel->isLoading()) {
+        return; // Wait for the whole directory, it is sorted then
+    }
+
+    QItemSelection selection;
+
+    foreach (const QString &fileName, m_pendingSelection) {
+        const QModelIndex &index = m_filesModel->index(fileName);
+
+        if (index.isValid()) {
+            selection.select(index, index);
+        }
+    }
+
+    m_pendingSelection.clear();
+
+    if (!selection.isEmpty()) {
+        m_ui->treeFiles->selectionModel()->select(selection,
+                                                  QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+        m_ui->treeFiles->scrollTo(selection.first().topLeft());
+    }
+}
+
 // private
 FileDialog::FileDialog(QWidget *parent, const QString &title, const QString &action,
                        QTreeView::SelectionMode selectionMode, bool saveFileMode, const Location &suggestion) :
@@ -376,7 +418,7 @@ FileDialog::FileDialog(QWidget *parent, const QString &title, const QString &act
     m_ui(new Ui::FileDialog),
     m_fileIconProvider(new QFileIconProvider()),
     m_bookmarksModel(new QStandardItemModel(this)),
-    m_filesModel(new QFileSystemModel(this)),
+    m_filesModel(new DirectoryModel(this)),
     m_buttonActiveNavigation(NULL),
     m_saveFileMode(saveFileMode)
 {
@@ -430,7 +472,6 @@ FileDialog::FileDialog(QWidget *parent, const QString &title, const QString &act
 
     m_ui->treeFiles->setModel(m_filesModel);
     m_ui->treeFiles->setSelectionMode(selectionMode);
-    m_ui->treeFiles->setColumnHidden(2, true); // Hide type column
     m_ui->treeFiles->setColumnWidth(0, 400);
     m_ui->treeFiles->setFocus();
 
@@ -445,6 +486,8 @@ FileDialog::FileDialog(QWidget *parent, const QString &title, const QString &act
     connect(m_ui->treeFiles->selectionModel(), &QItemSelectionModel::selectionChanged, this, &FileDialog::updateLocationEdit);
     connect(m_ui->treeFiles, &QTreeView::activated, this, &FileDialog::pick);
     connect(m_ui->treeFiles, &QTreeView::customContextMenuRequested, this, &FileDialog::showFileMenu);
+    connect(m_filesModel, &DirectoryModel::listingAboutToBeUpdated, this, &FileDialog::rememberSelection);
+    connect(m_filesModel, &DirectoryModel::listingUpdated, this, &FileDialog::restoreSelection);
     connect(m_ui->editLocation, &QLineEdit::textChanged, this, &FileDialog::updateCreateDirectoryButton);
     connect(m_ui->buttonCreateDirectory, &QPushButton::clicked, this, &FileDialog::createDirectory);
     connect(m_ui->buttonPick, &QPushButton::clicked, this, &FileDialog::pick);
@@ -463,35 +506,26 @@ FileDialog::FileDialog(QWidget *parent, const QString &title, const QString &act
 // private
 QString FileDialog::rootDirectoryPath() const
 {
-    const QModelIndex &index = m_ui->treeFiles->rootIndex();
-
-    Q_ASSERT(index.isValid());
-
-    const QString &directoryPath = m_filesModel->filePath(index) + "/"; // Append slash to indicate directory
-
-    Q_ASSERT(Location(directoryPath).exists());
-
-    return directoryPath;
+    return m_filesModel->directoryPath();
 }
 
 // private
 Location FileDialog::setLocation(const Location &location)
 {
-    const QModelIndex &root = m_filesModel->setRootPath(location.directoryPath());
+    const QString &directoryPath = location.directoryPath();
 
-    m_ui->treeFiles->setRootIndex(root);
+    m_pendingSelection.clear();
+    m_filesModel->setDirectoryPath(directoryPath);
     m_ui->treeFiles->selectionModel()->clear();
     m_ui->editLocation->setText("");
 
     if (location.isFile()) {
-        const QModelIndex &index = m_filesModel->index(location.path());
+        m_pendingSelection << location.fileName();
 
-        if (index.isValid()) {
-            m_ui->treeFiles->selectionModel()->select(index, QItemSelectionModel::Select | QItemSelectionModel::Rows);
-        }
+        restoreSelection();
     }
 
-    return m_filesModel->filePath(root) + "/"; // Append slash to indicate directory
+    return directoryPath;
 }
 
 // private
@@ -24,8 +24,8 @@
 #include <QDialog>
 #include <QTreeView>
 
+class DirectoryModel;
 class QFileIconProvider;
-class QFileSystemModel;
 class QStandardItemModel;
 class QToolButton;
 
@@ -54,6 +54,8 @@ private slots:
     void createDirectory();
     void pick();
     void saveBookmarks();
+    void rememberSelection();
+    void restoreSelection();
 
 private:
     enum {
@@ -75,10 +77,11 @@ private:
 
     QFileIconProvider *m_fileIconProvider;
     QStandardItemModel *m_bookmarksModel;
-    QFileSystemModel *m_filesModel;
+    DirectoryModel *m_filesModel;
     QToolButton *m_buttonActiveNavigation;
     bool m_saveFileMode;
     QList<Location> m_pickedLocations;
+    QStringList m_pendingSelection; // file names to select once the directory has been read
 };
 
 #endif // FILEDIALOG_H
@@ -0,0 +1,321 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "fileindex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QStringList>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FILEINDEX_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+enum {
+    BoundaryBonus = 8, // Match at the start of a path component or word
+    CamelCaseBonus = 6, // Match at an uppercase letter following a lowercase one
+    ConsecutiveBonus = 5, // Match right after the previous match
+    FileNameBonus = 4, // Match inside the file name instead of the directory path
+    FileNamePrefixBonus = 32, // The file name starts with the query
+    OpenSourceBonus = 24,
+    RecentSourceBonus = 12
+};
+
+static bool isBoundary(QChar character)
+{
+    switch (character.unicode()) {
+    case '/':
+    case '\\':
+    case '_':
+    case '-':
+    case '.':
+    case ' ':
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Min-heap order, the worst match of the heap is at its front
+static bool isBetterMatch(const FileIndex::Match &match, const FileIndex::Match &other)
+{
+    return match.score > other.score || (match.score == other.score && match.entry < other.entry);
+}
+
+static void addMatch(QVector<FileIndex::Match> *matches, int maximumMatchCount, int entry, int score)
+{
+    if (score < 0) {
+        return;
+    }
+
+    FileIndex::Match match;
+
+    match.entry = entry;
+    match.score = score;
+
+    if (matches->size() < maximumMatchCount) {
+        matches->append(match);
+
+        std::push_heap(matches->begin(), matches->end(), isBetterMatch);
+    } else if (isBetterMatch(match, matches->first())) {
+        std::pop_heap(matches->begin(), matches->end(), isBetterMatch);
+
+        matches->last() = match;
+
+        std::push_heap(matches->begin(), matches->end(), isBetterMatch);
+    }
+}
+
+FileIndex::FileIndex()
+{
+    m_offsets.append(0);
+}
+
+void FileIndex::clear()
+{
+    m_paths.clear();
+    m_lowerCasePaths.clear();
+    m_offsets.resize(1);
+    m_fileNameOffsets.clear();
+    m_bags.clear();
+    m_sources.clear();
+}
+
+void FileIndex::add(const QString &path, Source source)
+{
+    // Offsets into m_paths are used for m_lowerCasePaths as well, so both have to be of the same length
+    QString lowerCasePath = toLowerCase(path);
+    int fileNameOffset = qMax(path.lastIndexOf('/'), path.lastIndexOf('\\')) + 1;
+
+    m_paths += path;
+    m_lowerCasePaths += lowerCasePath;
+    m_offsets.append(m_paths.length());
+    m_fileNameOffsets.append(fileNameOffset);
+    m_bags.append(characterBag(lowerCasePath.constData(), lowerCasePath.length()));
+    m_sources.append(quint8(source));
+}
+
+QString FileIndex::path(int entry) const
+{
+    return m_paths.mid(m_offsets.at(entry), m_offsets.at(entry + 1) - m_offsets.at(entry));
+}
+
+QString FileIndex::fileName(int entry) const
+{
+    int start = m_offsets.at(entry) + m_fileNameOffsets.at(entry);
+
+    return m_paths.mid(start, m_offsets.at(entry + 1) - start);
+}
+
+QString FileIndex::directoryPath(int entry) const
+{
+    return m_paths.mid(m_offsets.at(entry), m_fileNameOffsets.at(entry));
+}
+
+QVector<FileIndex::Match> FileIndex::search(const QString &query, int maximumMatchCount) const
+{
+    QVector<Match> matches;
+    QString lowerCaseQuery = toLowerCase(query);
+
+    lowerCaseQuery.remove(' ');
+
+    if (lowerCaseQuery.isEmpty() || maximumMatchCount <= 0) {
+        return matches;
+    }
+
+    matches.reserve(maximumMatchCount);
+
+    quint64 queryBag = characterBag(lowerCaseQuery.constData(), lowerCaseQuery.length());
+    const quint64 *bags = m_bags.constData();
+    int count = m_bags.size();
+    int entry = 0;
+
+#ifdef FILEINDEX_USE_SSE2
+    // Test two bags per iteration. A bag passes if both 32-bit halves of (bag & query) equal the query's halves.
+    __m128i queryBags = _mm_set_epi32(int(queryBag >> 32), int(queryBag), int(queryBag >> 32), int(queryBag));
+
+    for (; entry + 2 <= count; entry += 2) {
+        __m128i candidateBags = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bags + entry));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(candidateBags, queryBags), queryBags));
+
+        if ((mask & 0x00FF) == 0x00FF) {
+            addMatch(&matches, maximumMatchCount, entry, score(entry, lowerCaseQuery));
+        }
+
+        if ((mask & 0xFF00) == 0xFF00) {
+            addMatch(&matches, maximumMatchCount, entry + 1, score(entry + 1, lowerCaseQuery));
+        }
+    }
+#endif
+
+    for (; entry < count; ++entry) {
+        if ((bags[entry] & queryBag) == queryBag) {
+            addMatch(&matches, maximumMatchCount, entry, score(entry, lowerCaseQuery));
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(), isBetterMatch);
+
+    return matches;
+}
+
+// private static
+QString FileIndex::toLowerCase(const QString &string)
+{
+    QString lowerCase(string);
+    QChar *characters = lowerCase.data();
+
+    for (int i = 0; i < lowerCase.length(); ++i) {
+        characters[i] = characters[i].toLower();
+    }
+
+    return lowerCase;
+}
+
+// private static
+quint64 FileIndex::characterBag(const QChar *characters, int length)
+{
+    quint64 bag = 0;
+
+    for (int i = 0; i < length; ++i) {
+        ushort character = characters[i].unicode();
+        int bit;
+
+        if (character >= 'a' && character <= 'z') {
+            bit = character - 'a';
+        } else if (character >= '0' && character <= '9') {
+            bit = 26 + character - '0';
+        } else if (character < 128) {
+            bit = 36 + character % 27;
+        } else {
+            bit = 63;
+        }
+
+        bag |= Q_UINT64_C(1) << bit;
+    }
+
+    return bag;
+}
+
+// private
+int FileIndex::score(int entry, const QString &query) const
+{
+    // Match the query backwards from the end of the path, so that matches cluster in the file name and the last
+    // directories, which are the parts users type
+    int start = m_offsets.at(entry);
+    int length = m_offsets.at(entry + 1) - start;
+    int fileNameOffset = m_fileNameOffsets.at(entry);
+    const QChar *lowerCasePath = m_lowerCasePaths.constData() + start;
+    const QChar *path = m_paths.constData() + start;
+    const QChar *characters = query.constData();
+    int position = length - 1;
+    int previousMatch = -1;
+    int score = 0;
+
+    for (int i = query.length() - 1; i >= 0; --i) {
+        while (position >= 0 && lowerCasePath[position] != characters[i]) {
+            --position;
+        }
+
+        if (position < 0) {
+            return -1;
+        }
+
+        score += 1;
+
+        if (position == 0 || isBoundary(path[position - 1])) {
+            score += BoundaryBonus;
+        } else if (path[position].isUpper() && path[position - 1].isLower()) {
+            score += CamelCaseBonus;
+        }
+
+        if (previousMatch == position + 1) {
+            score += ConsecutiveBonus;
+        }
+
+        if (position >= fileNameOffset) {
+            score += FileNameBonus;
+        }
+
+        previousMatch = position;
+        --position;
+    }
+
+    int fileNameLength = length - fileNameOffset;
+
+    if (query.length() <= fileNameLength
+        && QString::fromRawData(lowerCasePath + fileNameOffset, fileNameLength).startsWith(query)) {
+        score += FileNamePrefixBonus;
+    }
+
+    if (m_sources.at(entry) == OpenSource) {
+        score += OpenSourceBonus;
+    } else if (m_sources.at(entry) == RecentSource) {
+        score += RecentSourceBonus;
+    }
+
+    // Prefer shorter paths among otherwise equal matches
+    return score * 16 + qMax(0, 15 - length / 16);
+}
+
+FileIndexer::FileIndexer(int generation, const QString &rootPath, QObject *parent) :
+    QThread(parent),
+    m_generation(generation),
+    m_rootPath(rootPath),
+    m_truncated(false)
+{
+}
+
+// protected
+void FileIndexer::run()
+{
+    QStringList pendingDirectories;
+
+    pendingDirectories.append(m_rootPath);
+
+    while (!pendingDirectories.isEmpty() && !isInterruptionRequested()) {
+        QDirIterator iterator(pendingDirectories.takeLast(), QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
+
+        while (iterator.hasNext()) {
+            iterator.next();
+
+            const QFileInfo &fileInfo = iterator.fileInfo();
+            const QString &fileName = fileInfo.fileName();
+
+            if (fileInfo.isDir()) {
+                if (!fileInfo.isSymLink() && fileName != ".git" && fileName != ".hg" && fileName != ".svn") {
+                    pendingDirectories.append(fileInfo.filePath());
+                }
+            } else if (m_index.size() < FileIndex::MaximumEntryCount) {
+                // Use the same separators as Location, so that paths of open documents are recognized
+                m_index.add(QDir::toNativeSeparators(fileInfo.filePath()), FileIndex::ProjectSource);
+            } else {
+                m_truncated = true;
+                pendingDirectories.clear();
+                break;
+            }
+        }
+    }
+
+    emit indexFinished(m_generation);
+}
@@ -0,0 +1,106 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+// Flat index of file paths for fuzzy matching. All paths are stored back-to-back in one string, next to a lowercase
+// copy that is matched against. Each path also has a 64-bit character bag with one bit per character class that occurs
+// in it. A path can only match a query if its bag contains all bits of the query's bag, so most paths are rejected by
+// a single AND and compare before they are scored.
+class FileIndex
+{
+public:
+    enum Source {
+        OpenSource,
+        RecentSource,
+        ProjectSource
+    };
+
+    enum {
+        MaximumEntryCount = 500000
+    };
+
+    struct Match {
+        int entry;
+        int score;
+    };
+
+    FileIndex();
+
+    void clear();
+    void add(const QString &path, Source source);
+
+    int size() const { return m_bags.size(); }
+    bool isEmpty() const { return m_bags.isEmpty(); }
+
+    QString path(int entry) const;
+    QString fileName(int entry) const;
+    QString directoryPath(int entry) const;
+    Source source(int entry) const { return Source(m_sources.at(entry)); }
+
+    // Returns up to maximumMatchCount matches, best first. The query is matched case-insensitively as a subsequence of
+    // the path, spaces in the query are ignored.
+    QVector<Match> search(const QString &query, int maximumMatchCount) const;
+
+private:
+    static QString toLowerCase(const QString &string); // keeps the length, unlike QString::toLower()
+    static quint64 characterBag(const QChar *characters, int length);
+    int score(int entry, const QString &query) const; // returns -1 if the query doesn't match
+
+    QString m_paths;
+    QString m_lowerCasePaths;
+    QVector<int> m_offsets; // Start of each path in m_paths, plus the end of the last path
+    QVector<int> m_fileNameOffsets; // Start of the file name relative to the start of the path
+    QVector<quint64> m_bags;
+    QVector<quint8> m_sources;
+};
+
+// Walks a directory tree and collects the files in it into a FileIndex, skipping hidden and version control
+// directories. Stops after FileIndex::MaximumEntryCount files.
+class FileIndexer : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FileIndexer)
+
+public:
+    FileIndexer(int generation, const QString &rootPath, QObject *parent = NULL);
+
+    // Only valid after indexFinished() was emitted
+    FileIndex index() const { return m_index; }
+    bool isTruncated() const { return m_truncated; }
+
+signals:
+    void indexFinished(int generation);
+
+protected:
+    void run();
+
+private:
+    int m_generation;
+    QString m_rootPath;
+    FileIndex m_index;
+    bool m_truncated;
+};
+
+#endif // FILEINDEX_H
@@ -0,0 +1,482 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "filesmodel.h"
+
+#include <QBrush>
+#include <QFont>
+
+FilesModel::FilesModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    m_directoryIcon(":/icons/16x16/folder.png"),
+    m_fileIcon(":/icons/16x16/file.png")
+{
+}
+
+// Directory indexes have an internal ID of 0, file indexes have the ID of their directory plus 1 as internal ID
+QModelIndex FilesModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0) {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid()) {
+        if (row >= m_directoryOrder.size()) {
+            return QModelIndex();
+        }
+
+        return createIndex(row, column, quintptr(0));
+    }
+
+    if (parent.internalId() != 0) {
+        return QModelIndex(); // files have no children
+    }
+
+    int directory = m_directoryOrder.at(parent.row());
+
+    if (row >= m_directoryFiles.at(directory).size()) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, quintptr(directory + 1));
+}
+
+QModelIndex FilesModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0) {
+        return QModelIndex();
+    }
+
+    return directoryIndex(int(index.internalId() - 1));
+}
+
+int FilesModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return m_directoryOrder.size();
+    }
+
+    if (parent.column() != 0 || parent.internalId() != 0) {
+        return 0;
+    }
+
+    return m_directoryFiles.at(m_directoryOrder.at(parent.row())).size();
+}
+
+int FilesModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+
+    return 1;
+}
+
+QVariant FilesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    int directory = directoryFromIndex(index);
+
+    if (directory >= 0) {
+        const QString &path = m_directoryPaths.at(directory);
+
+        if (role == Qt::DecorationRole) {
+            return m_directoryIcon;
+        } else if (role == Qt::ToolTipRole) {
+            return path;
+        }
+
+        return displayData(path, m_directoryMarkers.at(directory), role);
+    }
+
+    int file = fileFromIndex(index);
+
+    if (role == Qt::DecorationRole) {
+        return m_fileIcon;
+    } else if (role == Qt::ToolTipRole) {
+        return m_filePaths.at(file);
+    }
+
+    return displayData(m_fileNames.at(file), m_fileMarkers.at(file), role);
+}
+
+int FilesModel::addDirectory(const QString &path, const QString &sortKey)
+{
+    Q_ASSERT(!m_directoryIds.contains(path));
+
+    int directory;
+
+    if (!m_freeDirectories.isEmpty()) {
+        directory = m_freeDirectories.takeLast();
+
+        m_directoryPaths[directory] = path;
+        m_directorySortKeys[directory] = sortKey;
+        m_directoryMarkers[directory] = 0;
+        m_directoryHidden[directory] = false;
+    } else {
+        directory = m_directoryPaths.size();
+
+        m_directoryPaths.append(path);
+        m_directorySortKeys.append(sortKey);
+        m_directoryMarkers.append(0);
+        m_directoryHidden.append(false);
+        m_directoryRows.append(-1);
+        m_directoryFiles.append(QVector<int>());
+    }
+
+    // Binary search for the row after the last directory that doesn't sort after the new one
+    int low = 0;
+    int high = m_directoryOrder.size();
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+
+        if (sortKey < m_directorySortKeys.at(m_directoryOrder.at(middle))) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    beginInsertRows(QModelIndex(), low, low);
+
+    m_directoryOrder.insert(low, directory);
+
+    for (int row = low; row < m_directoryOrder.size(); ++row) {
+        m_directoryRows[m_directoryOrder.at(row)] = row;
+    }
+
+    m_directoryIds.insert(path, directory);
+
+    endInsertRows();
+
+    return directory;
+}
+
+void FilesModel::removeDirectory(int directory)
+{
+    Q_ASSERT(m_directoryFiles.at(directory).isEmpty());
+
+    int directoryRow = m_directoryRows.at(directory);
+
+    Q_ASSERT(directoryRow >= 0);
+
+    beginRemoveRows(QModelIndex(), directoryRow, directoryRow);
+
+    m_directoryOrder.remove(directoryRow);
+    m_directoryRows[directory] = -1;
+
+    for (int row = directoryRow; row < m_directoryOrder.size(); ++row) {
+        m_directoryRows[m_directoryOrder.at(row)] = row;
+    }
+
+    m_directoryIds.remove(m_directoryPaths.at(directory));
+
+    endRemoveRows();
+
+    m_directoryPaths[directory].clear();
+    m_directorySortKeys[directory].clear();
+    m_freeDirectories.append(directory);
+}
+
+void FilesModel::setDirectoryMarker(int directory, Marker marker, bool enable)
+{
+    Markers markers(m_directoryMarkers.at(directory));
+
+    if (markers.testFlag(marker) == enable) {
+        return;
+    }
+
+    markers.setFlag(marker, enable);
+
+    m_directoryMarkers[directory] = quint8(markers);
+
+    const QModelIndex &index = directoryIndex(directory);
+
+    emit dataChanged(index, index);
+}
+
+bool FilesModel::setDirectoryHidden(int directory, bool hidden)
+{
+    if (m_directoryHidden.at(directory) == hidden) {
+        return false;
+    }
+
+    m_directoryHidden[directory] = hidden;
+
+    return true;
+}
+
+QModelIndex FilesModel::directoryIndex(int directory) const
+{
+    int row = m_directoryRows.at(directory);
+
+    if (row < 0) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, 0, quintptr(0));
+}
+
+int FilesModel::directoryFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() != 0) {
+        return -1;
+    }
+
+    return m_directoryOrder.at(index.row());
+}
+
+int FilesModel::createFile(Document *document, const QString &fileName, const QString &sortKey, const QString &path)
+{
+    int file;
+
+    if (!m_freeFiles.isEmpty()) {
+        file = m_freeFiles.takeLast();
+
+        m_fileDocuments[file] = document;
+        m_fileNames[file] = fileName;
+        m_fileSortKeys[file] = sortKey;
+        m_filePaths[file] = path;
+        m_fileDocumentTypes[file] = -1;
+        m_fileTextCodecs[file] = NULL;
+        m_fileMarkers[file] = 0;
+        m_fileHidden[file] = false;
+        m_fileDirectories[file] = -1;
+    } else {
+        file = m_fileDocuments.size();
+
+        m_fileDocuments.append(document);
+        m_fileNames.append(fileName);
+        m_fileSortKeys.append(sortKey);
+        m_filePaths.append(path);
+        m_fileDocumentTypes.append(-1);
+        m_fileTextCodecs.append(NULL);
+        m_fileMarkers.append(0);
+        m_fileHidden.append(false);
+        m_fileDirectories.append(-1);
+    }
+
+    return file;
+}
+
+void FilesModel::destroyFile(int file)
+{
+    if (m_fileDirectories.at(file) >= 0) {
+        takeFile(file);
+    }
+
+    m_fileDocuments[file] = NULL;
+    m_fileNames[file].clear();
+    m_fileSortKeys[file].clear();
+    m_filePaths[file].clear();
+    m_fileTextCodecs[file] = NULL;
+    m_freeFiles.append(file);
+}
+
+void FilesModel::insertFile(int directory, int file)
+{
+    Q_ASSERT(m_fileDirectories.at(file) < 0);
+
+    QVector<int> &files = m_directoryFiles[directory];
+    const QString &sortKey = m_fileSortKeys.at(file);
+
+    // Binary search for the row after the last file that doesn't sort after the new one. This keeps the files in the
+    // same order as sorting all of them by their sort key would.
+    int low = 0;
+    int high = files.size();
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+
+        if (sortKey < m_fileSortKeys.at(files.at(middle))) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    beginInsertRows(directoryIndex(directory), low, low);
+
+    files.insert(low, file);
+    m_fileDirectories[file] = directory;
+
+    endInsertRows();
+}
+
+void FilesModel::takeFile(int file)
+{
+    int directory = m_fileDirectories.at(file);
+
+    Q_ASSERT(directory >= 0);
+
+    int row = fileRow(file);
+
+    beginRemoveRows(directoryIndex(directory), row, row);
+
+    m_directoryFiles[directory].remove(row);
+    m_fileDirectories[file] = -1;
+
+    endRemoveRows();
+}
+
+void FilesModel::setFileName(int file, const QString &fileName, const QString &sortKey, const QString &path)
+{
+    // The sort key decides the row, so the file has to be detached while it changes
+    Q_ASSERT(m_fileDirectories.at(file) < 0);
+
+    m_fileNames[file] = fileName;
+    m_fileSortKeys[file] = sortKey;
+    m_filePaths[file] = path;
+}
+
+void FilesModel::setDocument(int file, Document *document)
+{
+    m_fileDocuments[file] = document;
+    m_fileDocumentTypes[file] = -1;
+    m_fileTextCodecs[file] = NULL;
+}
+
+void FilesModel::setClosed(int file, int documentType, TextCodec *codec)
+{
+    m_fileDocuments[file] = NULL;
+    m_fileDocumentTypes[file] = qint8(documentType);
+    m_fileTextCodecs[file] = codec;
+}
+
+void FilesModel::setFileMarker(int file, Marker marker, bool enable)
+{
+    Markers markers(m_fileMarkers.at(file));
+
+    if (markers.testFlag(marker) == enable) {
+        return;
+    }
+
+    markers.setFlag(marker, enable);
+
+    m_fileMarkers[file] = quint8(markers);
+
+    if (m_fileDirectories.at(file) >= 0) {
+        const QModelIndex &index = fileIndex(file);
+
+        emit dataChanged(index, index);
+    }
+}
+
+bool FilesModel::setFileHidden(int file, bool hidden)
+{
+    if (m_fileHidden.at(file) == hidden) {
+        return false;
+    }
+
+    m_fileHidden[file] = hidden;
+
+    return true;
+}
+
+QModelIndex FilesModel::fileIndex(int file) const
+{
+    int directory = m_fileDirectories.at(file);
+
+    if (directory < 0) {
+        return QModelIndex();
+    }
+
+    return createIndex(fileRow(file), 0, quintptr(directory + 1));
+}
+
+int FilesModel::fileFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0) {
+        return -1;
+    }
+
+    return m_directoryFiles.at(int(index.internalId() - 1)).at(index.row());
+}
+
+bool FilesModel::isHidden(const QModelIndex &index) const
+{
+    int directory = directoryFromIndex(index);
+
+    if (directory >= 0) {
+        return m_directoryHidden.at(directory);
+    }
+
+    int file = fileFromIndex(index);
+
+    return file >= 0 && m_fileHidden.at(file);
+}
+
+// private
+int FilesModel::fileRow(int file) const
+{
+    const QVector<int> &files = m_directoryFiles.at(m_fileDirectories.at(file));
+    const QString &sortKey = m_fileSortKeys.at(file);
+
+    // Binary search for the first file with the same sort key, then step over files that share it
+    int low = 0;
+    int high = files.size();
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+
+        if (m_fileSortKeys.at(files.at(middle)) < sortKey) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    while (low < files.size() && files.at(low) != file) {
+        ++low;
+    }
+
+    Q_ASSERT(low < files.size());
+
+    return low;
+}
+
+// private
+QVariant FilesModel::displayData(const QString &text, int markers, int role) const
+{
+    if (role == Qt::DisplayRole) {
+        if ((markers & ModifiedMarker) != 0) {
+            return text + "*";
+        }
+
+        return text;
+    } else if (role == Qt::ForegroundRole) {
+        if ((markers & ModifiedMarker) != 0) {
+            return QBrush(Qt::red);
+        } else if ((markers & ClosedMarker) != 0) {
+            return QBrush(Qt::darkGray);
+        }
+    } else if (role == Qt::FontRole) {
+        if ((markers & CurrentMarker) != 0) {
+            QFont font;
+
+            font.setUnderline(true);
+
+            return font;
+        }
+    }
+
+    return QVariant();
+}
@@ -0,0 +1,132 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef FILESMODEL_H
+#define FILESMODEL_H
+
+#include <QAbstractItemModel>
+#include <QFlags>
+#include <QHash>
+#include <QIcon>
+#include <QVector>
+
+class Document;
+class TextCodec;
+
+// Two level model of directories and the files in them, as shown by FilesWidget. Directories and files are referred
+// to by integer IDs that stay stable while rows are inserted and removed. Their properties are kept in one array per
+// property indexed by ID, instead of one heap allocated item with a list of variants per row. Display text, colors and
+// fonts are derived from the markers on demand in data().
+class FilesModel : public QAbstractItemModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FilesModel)
+
+public:
+    enum Marker {
+        CurrentMarker = (1 << 0),
+        ModifiedMarker = (1 << 1),
+        ClosedMarker = (1 << 2)
+    };
+
+    Q_DECLARE_FLAGS(Markers, Marker)
+
+    explicit FilesModel(QObject *parent = NULL);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    // Directories, sorted by their sort key
+    int directoryCount() const { return m_directoryOrder.size(); }
+    int directoryAt(int row) const { return m_directoryOrder.at(row); }
+    int findDirectory(const QString &path) const { return m_directoryIds.value(path, -1); }
+    int addDirectory(const QString &path, const QString &sortKey);
+    void removeDirectory(int directory);
+    QString directoryPath(int directory) const { return m_directoryPaths.at(directory); }
+    Markers directoryMarkers(int directory) const { return Markers(m_directoryMarkers.at(directory)); }
+    void setDirectoryMarker(int directory, Marker marker, bool enable);
+    bool isDirectoryHidden(int directory) const { return m_directoryHidden.at(directory); }
+    bool setDirectoryHidden(int directory, bool hidden); // returns true if the visibility changed
+    QModelIndex directoryIndex(int directory) const;
+    int directoryFromIndex(const QModelIndex &index) const; // -1 for file indexes
+
+    // Files, sorted by their sort key inside their directory. A file can be detached from its directory to be moved
+    // or to be inserted again at a new sorted position.
+    int fileCount(int directory) const { return m_directoryFiles.at(directory).size(); }
+    int fileAt(int directory, int row) const { return m_directoryFiles.at(directory).at(row); }
+    int createFile(Document *document, const QString &fileName, const QString &sortKey, const QString &path);
+    void destroyFile(int file);
+    void insertFile(int directory, int file);
+    void takeFile(int file);
+    int directoryOf(int file) const { return m_fileDirectories.at(file); } // -1 if detached
+    QString fileName(int file) const { return m_fileNames.at(file); }
+    QString filePath(int file) const { return m_filePaths.at(file); }
+    void setFileName(int file, const QString &fileName, const QString &sortKey, const QString &path);
+    Document *document(int file) const { return m_fileDocuments.at(file); }
+    void setDocument(int file, Document *document);
+    void setClosed(int file, int documentType, TextCodec *codec); // keeps what's needed to reopen the document
+    int documentType(int file) const { return m_fileDocumentTypes.at(file); }
+    TextCodec *textCodec(int file) const { return m_fileTextCodecs.at(file); }
+    Markers fileMarkers(int file) const { return Markers(m_fileMarkers.at(file)); }
+    void setFileMarker(int file, Marker marker, bool enable);
+    bool isFileHidden(int file) const { return m_fileHidden.at(file); }
+    bool setFileHidden(int file, bool hidden); // returns true if the visibility changed
+    QModelIndex fileIndex(int file) const;
+    int fileFromIndex(const QModelIndex &index) const; // -1 for directory indexes
+
+    bool isHidden(const QModelIndex &index) const;
+
+private:
+    int directoryRow(int directory) const { return m_directoryRows.at(directory); }
+    int fileRow(int file) const;
+    QVariant displayData(const QString &text, int markers, int role) const;
+
+    QIcon m_directoryIcon;
+    QIcon m_fileIcon;
+
+    // Directories, indexed by ID
+    QVector<QString> m_directoryPaths;
+    QVector<QString> m_directorySortKeys;
+    QVector<quint8> m_directoryMarkers;
+    QVector<bool> m_directoryHidden;
+    QVector<int> m_directoryRows; // -1 for free IDs
+    QVector<QVector<int> > m_directoryFiles; // file IDs in row order
+    QVector<int> m_freeDirectories;
+    QVector<int> m_directoryOrder; // directory IDs in row order
+    QHash<QString, int> m_directoryIds; // keyed by path
+
+    // Files, indexed by ID
+    QVector<Document *> m_fileDocuments; // NULL for closed files
+    QVector<QString> m_fileNames;
+    QVector<QString> m_fileSortKeys;
+    QVector<QString> m_filePaths;
+    QVector<qint8> m_fileDocumentTypes; // for reopening closed files
+    QVector<TextCodec *> m_fileTextCodecs; // for reopening closed files
+    QVector<quint8> m_fileMarkers;
+    QVector<bool> m_fileHidden;
+    QVector<int> m_fileDirectories; // -1 for detached or free IDs
+    QVector<int> m_freeFiles;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(FilesModel::Markers)
+
+#endif // FILESMODEL_H
@@ -22,14 +22,40 @@
 #include "documentmanager.h"
 #include "textcodec.h"
 #include "textdocument.h"
-#include "utils.h"
 
+#include <QSortFilterProxyModel>
+#include <QTimerEvent>
 #include <QTreeView>
 #include <QVBoxLayout>
 
+// Hides the rows FilesWidget::applyFilter() marked as hidden in the FilesModel. Rows are not tested against the filter
+// here, filterAcceptsRow() only looks up the precomputed visibility. After changing the visibility of existing rows,
+// invalidate() applies all changes with a single layoutChanged signal instead of one signal per row.
+class FilesFilterModel : public QSortFilterProxyModel
+{
+public:
+    FilesFilterModel(FilesModel *model, QObject *parent) :
+        QSortFilterProxyModel(parent),
+        m_model(model)
+    {
+        setDynamicSortFilter(false);
+        setSourceModel(model);
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+    {
+        return !m_model->isHidden(m_model->index(sourceRow, 0, sourceParent));
+    }
+
+private:
+    FilesModel *m_model;
+};
+
 FilesWidget::FilesWidget(QWidget *parent) :
     QWidget(parent),
-    m_currentChild(NULL),
+    m_currentChild(-1),
+    m_filterModel(new FilesFilterModel(&m_model, this)),
     m_treeFiles(new QTreeView(this)),
     m_showModifiedFilesOnly(false),
     m_filterEnabled(false)
@@ -39,15 +65,14 @@ FilesWidget::FilesWidget(QWidget *parent) :
     layout->setContentsMargins(0, 0, 0, 0);
     layout->addWidget(m_treeFiles);
 
-    m_model.setSortRole(LowerCaseNameRole);
-
     // FIXME: enable edit triggers to allow renaming files on disk from the open documents tree?
 
     m_treeFiles->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     m_treeFiles->setEditTriggers(QTreeView::NoEditTriggers);
     m_treeFiles->setTextElideMode(Qt::ElideLeft);
     m_treeFiles->setHeaderHidden(true);
-    m_treeFiles->setModel(&m_model);
+    m_treeFiles->setUniformRowHeights(true);
+    m_treeFiles->setModel(m_filterModel);
 
     connect(m_treeFiles, &QTreeView::activated, this, &FilesWidget::setCurrentDocument);
     connect(m_treeFiles, &QTreeView::expanded, this, &FilesWidget::updateParentIndexMarkers);
@@ -64,7 +89,7 @@ void FilesWidget::showModifiedDocumentsOnly(bool enable)
     if (m_showModifiedFilesOnly != enable) {
         m_showModifiedFilesOnly = enable;
 
-        applyFilter();
+        applyFilter(enable);
     }
 }
 
@@ -74,26 +99,33 @@ void FilesWidget::setFilterEnabled(bool enable)
     if (m_filterEnabled != enable) {
         m_filterEnabled = enable;
 
-        applyFilter();
+        applyFilter(enable);
     }
 }
 
 // slot
 void FilesWidget::setFilterPattern(const QString &pattern)
 {
-    if (m_filterRegularExpression.pattern() != pattern) {
-        bool wasValid = m_filterRegularExpression.isValid();
+    // Wait for typing to pause before compiling the pattern and filtering
+    m_pendingFilterPattern = pattern;
 
-        m_filterRegularExpression = QRegularExpression(pattern);
+    m_filterTimer.start(150, this);
+}
 
-        bool isValid = m_filterRegularExpression.isValid();
+// protected
+void FilesWidget::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_filterTimer.timerId()) {
+        m_filterTimer.stop();
 
-        if (isValid != wasValid) {
-            emit filterValidityChanged(isValid);
-        }
+        applyFilterPattern();
+    } else if (event->timerId() == m_invalidateTimer.timerId()) {
+        m_invalidateTimer.stop();
 
-        applyFilter();
+        m_filterModel->invalidate();
     }
+
+    QWidget::timerEvent(event);
 }
 
 // private slot
@@ -103,61 +135,43 @@ void FilesWidget::addDocument(Document *document)
     Q_ASSERT(document != DocumentManager::current());
 
     const Location &location = document->location();
-    QStandardItem *child = m_closedChildren.value(location, NULL);
-
-    Q_ASSERT(hasOption(KeepAfterClose) || child == NULL);
-
-    QStandardItem *parent;
+    int child = m_closedChildren.value(location, -1);
 
-    if (child != NULL) {
-        // Reopen closed child item
-        parent = child->parent();
+    Q_ASSERT(hasOption(KeepAfterClose) || child < 0);
 
-        child->setData(QVariant::fromValue(document), DocumentRole);
-        child->setData(QVariant(), PathRole);
-        child->setData(QVariant(), DocumentTypeRole);
-        child->setData(QVariant(), TextCodecRole);
+    if (child >= 0) {
+        // Reopen closed child
+        m_model.setDocument(child, document);
 
         m_closedChildren.remove(location);
         m_openChildren.insert(document, child);
 
-        setMarker(child, ClosedMarker, false);
+        m_model.setFileMarker(child, FilesModel::ClosedMarker, false);
     } else {
-        // Find or create parent item
-        parent = findOrCreateParent(location);
+        // Find or create parent
+        int parent = findOrCreateParent(location);
 
-        // Create child item
+        // Create child
         const QString &fileName = location.fileName("unnamed");
 
-        child = new QStandardItem(QIcon(":/icons/16x16/file.png"), fileName);
-
-        child->setToolTip(location.path("unnamed"));
-        child->setData(QVariant::fromValue(document), DocumentRole);
-        child->setData(fileName, FileNameRole);
-        child->setData(location.isEmpty() ? "" : fileName.toLower(), LowerCaseNameRole);
-        child->setData(QVariant::fromValue(Markers()), MarkersRole);
+        child = m_model.createFile(document, fileName, location.isEmpty() ? "" : fileName.toLower(),
+                                   location.path("unnamed"));
 
         m_openChildren.insert(document, child);
 
-        parent->appendRow(child);
-        parent->sortChildren(0);
+        // Mark the child as hidden before inserting it, so the filter model hides it right away
+        m_model.setFileHidden(child, !filterAcceptsChild(child));
+        m_model.insertFile(parent, child);
     }
 
     connect(document, &Document::locationChanged, this, &FilesWidget::updateLocationOfSender);
     connect(document, &Document::modificationChanged, this, &FilesWidget::updateModifiedMarkerOfSender);
 
     // Apply current filter
-    if (!filterAcceptsChild(child->index())) {
-        m_treeFiles->setRowHidden(child->row(), parent->index(), true);
-
-        if (parent->rowCount() == 1) {
-            m_treeFiles->setRowHidden(parent->row(), m_model.invisibleRootItem()->index(), true);
-        }
-    }
+    updateVisibility(child);
 
     // Show modification marker, if necessary
     updateModifiedMarker(document);
-    updateParentItemMarkers(parent);
 }
 
 // private slot
@@ -169,36 +183,38 @@ void FilesWidget::removeDocument(Document *document)
     disconnect(document, &Document::modificationChanged, this, &FilesWidget::updateModifiedMarkerOfSender);
     disconnect(document, &Document::locationChanged, this, &FilesWidget::updateLocationOfSender);
 
-    QStandardItem *child = m_openChildren.value(document, NULL);
+    int child = m_openChildren.value(document, -1);
 
-    Q_ASSERT(child != NULL);
+    Q_ASSERT(child >= 0);
     Q_ASSERT(child != m_currentChild);
 
     const Location &location = document->location();
 
     if (hasOption(KeepAfterClose) && !location.isEmpty()) {
-        child->setData(QVariant::fromValue(NULL), DocumentRole);
-        child->setData(location.path(), PathRole);
-        child->setData(QVariant::fromValue(document->type()), DocumentTypeRole);
+        TextCodec *codec = NULL;
 
         if (document->type() == Document::Text) {
-            child->setData(QVariant::fromValue(static_cast<TextDocument *>(document)->codec()), TextCodecRole);
-        } else {
-            child->setData(QVariant::fromValue(NULL), TextCodecRole);
+            codec = static_cast<TextDocument *>(document)->codec();
         }
 
+        m_model.setClosed(child, document->type(), codec);
+
         m_openChildren.remove(document);
         m_closedChildren.insert(location, child);
 
-        setMarker(child, ModifiedMarker, false);
-        setMarker(child, ClosedMarker, true);
-        updateParentItemMarkers(child->parent());
+        m_model.setFileMarker(child, FilesModel::ModifiedMarker, false);
+        m_model.setFileMarker(child, FilesModel::ClosedMarker, true);
+
+        if (m_showModifiedFilesOnly) {
+            updateVisibility(child);
+        }
+
+        updateParentMarkers(m_model.directoryOf(child));
     } else {
         takeChildFromParent(child);
 
         m_openChildren.remove(document);
-
-        delete child;
+        m_model.destroyFile(child);
     }
 }
 
@@ -207,23 +223,24 @@ void FilesWidget::setCurrentDocument(const QModelIndex &index)
 {
     Q_ASSERT(index.isValid());
 
-    if (!index.parent().isValid()) {
-        return; // ignore activation of parent item
+    int child = m_model.fileFromIndex(m_filterModel->mapToSource(index));
+
+    if (child < 0) {
+        return; // ignore activation of parent
     }
 
-    Document *document = index.data(DocumentRole).value<Document *>();
+    Document *document = m_model.document(child);
 
     if (hasOption(KeepAfterClose)) {
         if (document != NULL) {
             DocumentManager::setCurrent(document);
         } else {
-            const QString &filePath = index.data(PathRole).value<QString>();
-            Document::Type type = index.data(DocumentTypeRole).value<Document::Type>();
-            TextCodec *codec = index.data(TextCodecRole).value<TextCodec *>();
+            Document::Type type = Document::Type(m_model.documentType(child));
+            TextCodec *codec = m_model.textCodec(child);
 
             Q_ASSERT(type != Document::Text || codec != NULL);
 
-            DocumentManager::open(filePath, type, codec);
+            DocumentManager::open(m_model.filePath(child), type, codec);
         }
     } else {
         Q_ASSERT(document != NULL);
@@ -236,37 +253,38 @@ void FilesWidget::setCurrentDocument(const QModelIndex &index)
 void FilesWidget::setCurrentChild(Document *document)
 {
     // Set current child and parent back to normal
-    if (m_currentChild != NULL) {
-        setMarker(m_currentChild, CurrentMarker, false);
+    if (m_currentChild >= 0) {
+        m_model.setFileMarker(m_currentChild, FilesModel::CurrentMarker, false);
 
-        QStandardItem *parent = m_currentChild->parent();
+        int parent = m_model.directoryOf(m_currentChild);
 
-        m_treeFiles->scrollTo(parent->index());
-        m_treeFiles->selectionModel()->select(parent->index(), QItemSelectionModel::ClearAndSelect);
+        m_treeFiles->scrollTo(viewIndex(m_model.directoryIndex(parent)));
+        m_treeFiles->selectionModel()->select(viewIndex(m_model.directoryIndex(parent)),
+                                              QItemSelectionModel::ClearAndSelect);
 
-        m_currentChild = NULL;
+        m_currentChild = -1;
 
-        updateParentItemMarkers(parent);
+        updateParentMarkers(parent);
     }
 
     // Mark new current child as current
     if (document != NULL) {
-        QStandardItem *child = m_openChildren.value(document, NULL);
+        int child = m_openChildren.value(document, -1);
 
-        Q_ASSERT(child != NULL);
+        Q_ASSERT(child >= 0);
 
-        QStandardItem *parent = child->parent();
+        int parent = m_model.directoryOf(child);
 
-        Q_ASSERT(parent != NULL);
+        Q_ASSERT(parent >= 0);
 
-        m_treeFiles->expand(parent->index());
-        m_treeFiles->scrollTo(child->index());
-        m_treeFiles->selectionModel()->select(child->index(), QItemSelectionModel::ClearAndSelect);
+        m_treeFiles->expand(viewIndex(m_model.directoryIndex(parent)));
+        m_treeFiles->scrollTo(viewIndex(m_model.fileIndex(child)));
+        m_treeFiles->selectionModel()->select(viewIndex(m_model.fileIndex(child)), QItemSelectionModel::ClearAndSelect);
 
         m_currentChild = child;
 
-        setMarker(m_currentChild, CurrentMarker, true);
-        updateParentItemMarkers(parent);
+        m_model.setFileMarker(m_currentChild, FilesModel::CurrentMarker, true);
+        updateParentMarkers(parent);
     }
 }
 
@@ -275,53 +293,97 @@ void FilesWidget::updateParentIndexMarkers(const QModelIndex &index)
 {
     Q_ASSERT(index.isValid());
 
-    updateParentItemMarkers(m_model.itemFromIndex(index));
+    updateParentMarkers(m_model.directoryFromIndex(m_filterModel->mapToSource(index)));
 }
 
 // private slot
-void FilesWidget::updateParentItemMarkers(QStandardItem *parent)
+void FilesWidget::updateLocationOfSender()
 {
-    Q_ASSERT(parent != NULL);
-    Q_ASSERT(parent->parent() == NULL);
+    Document *document = qobject_cast<Document *>(sender());
 
-    if (m_treeFiles->isExpanded(parent->index())) {
-        // Check if this is the parent of the hidden current child
-        bool hasHiddenCurrentChild = false;
+    Q_ASSERT(document != NULL);
 
-        if (m_currentChild != NULL && m_currentChild->parent() == parent) {
-            hasHiddenCurrentChild = m_treeFiles->isRowHidden(m_currentChild->row(), parent->index());
-        }
+    int child = m_openChildren.value(document, -1);
+
+    Q_ASSERT(child >= 0);
 
-        setMarker(parent, CurrentMarker, hasHiddenCurrentChild);
+    const Location &location = document->location();
+
+    Q_ASSERT(!location.isEmpty());
+
+    int parent = m_model.directoryOf(child);
+    bool parentChanged = m_model.directoryPath(parent) != location.directoryPath();
+
+    if (parentChanged) {
+        takeChildFromParent(child);
+
+        parent = findOrCreateParent(location);
+    } else {
+        // Take the child out and insert it again at its new sorted position. Don't use takeChildFromParent() here,
+        // because that would remove the parent if this is its only child.
+        m_model.takeFile(child);
+    }
+
+    const QString &fileName = location.fileName();
+
+    m_model.setFileName(child, fileName, fileName.toLower(), location.path());
+    m_model.insertFile(parent, child);
+
+    if (parentChanged) {
+        updateParentMarkers(parent);
+    }
+
+    updateVisibility(child);
+
+    m_treeFiles->expand(viewIndex(m_model.directoryIndex(parent)));
+    m_treeFiles->scrollTo(viewIndex(m_model.fileIndex(child)));
+    m_treeFiles->selectionModel()->select(viewIndex(m_model.fileIndex(child)), QItemSelectionModel::ClearAndSelect);
+}
+
+// private slot
+void FilesWidget::updateModifiedMarkerOfSender()
+{
+    updateModifiedMarker(qobject_cast<Document *>(sender()));
+}
+
+// private
+void FilesWidget::updateParentMarkers(int parent)
+{
+    Q_ASSERT(parent >= 0);
+
+    int childCount = m_model.fileCount(parent);
+    bool hasCurrentChild = m_currentChild >= 0 && m_model.directoryOf(m_currentChild) == parent;
+
+    if (m_treeFiles->isExpanded(viewIndex(m_model.directoryIndex(parent)))) {
+        // Check if this is the parent of the hidden current child
+        m_model.setDirectoryMarker(parent, FilesModel::CurrentMarker,
+                                   hasCurrentChild && m_model.isFileHidden(m_currentChild));
 
         // Check if this is a parent of hidden modified children
-        int childRowCount = parent->rowCount();
         bool hasHiddenModifiedChild = false;
 
-        for (int childRow = 0; childRow < childRowCount; ++childRow) {
-            QStandardItem *child = parent->child(childRow);
-            Document *document = child->data(DocumentRole).value<Document *>();
+        for (int childRow = 0; childRow < childCount; ++childRow) {
+            int child = m_model.fileAt(parent, childRow);
+            Document *document = m_model.document(child);
 
-            if (m_treeFiles->isRowHidden(childRow, parent->index()) && document != NULL && document->isModified()) {
+            if (m_model.isFileHidden(child) && document != NULL && document->isModified()) {
                 hasHiddenModifiedChild = true;
                 break;
             }
         }
 
-        setMarker(parent, ModifiedMarker, hasHiddenModifiedChild);
-        setMarker(parent, ClosedMarker, false);
+        m_model.setDirectoryMarker(parent, FilesModel::ModifiedMarker, hasHiddenModifiedChild);
+        m_model.setDirectoryMarker(parent, FilesModel::ClosedMarker, false);
     } else {
         // Check if this is the parent of the current child
-        setMarker(parent, CurrentMarker, m_currentChild != NULL && m_currentChild->parent() == parent);
+        m_model.setDirectoryMarker(parent, FilesModel::CurrentMarker, hasCurrentChild);
 
         // Check if this is a parent of modified children or has only closed children
-        int childRowCount = parent->rowCount();
         bool hasModifiedChild = false;
         bool hasClosedChild = false;
 
-        for (int childRow = 0; childRow < childRowCount; ++childRow) {
-            QStandardItem *child = parent->child(childRow);
-            Document *document = child->data(DocumentRole).value<Document *>();
+        for (int childRow = 0; childRow < childCount; ++childRow) {
+            Document *document = m_model.document(m_model.fileAt(parent, childRow));
 
             if (document != NULL && document->isModified()) {
                 hasModifiedChild = true;
@@ -336,236 +398,200 @@ void FilesWidget::updateParentItemMarkers(QStandardItem *parent)
             }
         }
 
-        setMarker(parent, ModifiedMarker, hasModifiedChild);
-        setMarker(parent, ClosedMarker, hasClosedChild);
+        m_model.setDirectoryMarker(parent, FilesModel::ModifiedMarker, hasModifiedChild);
+        m_model.setDirectoryMarker(parent, FilesModel::ClosedMarker, hasClosedChild);
     }
 }
 
-// private slot
-void FilesWidget::updateLocationOfSender()
+// private
+void FilesWidget::updateModifiedMarker(Document *document)
 {
-    Document *document = qobject_cast<Document *>(sender());
-
     Q_ASSERT(document != NULL);
 
-    QStandardItem *child = m_openChildren.value(document, NULL);
-
-    Q_ASSERT(child != NULL);
-
-    const Location &location = document->location();
+    int child = m_openChildren.value(document, -1);
 
-    Q_ASSERT(!location.isEmpty());
+    Q_ASSERT(child >= 0);
 
-    QStandardItem *parent = child->parent();
+    m_model.setFileMarker(child, FilesModel::ModifiedMarker, document->isModified());
 
-    if (parent->data(DirectoryPathRole).value<QString>() != location.directoryPath()) {
-        takeChildFromParent(child);
+    // Keep the visibility up-to-date, applyFilter() relies on it when the filter gets narrower
+    if (m_showModifiedFilesOnly) {
+        updateVisibility(child);
+    }
 
-        parent = findOrCreateParent(location);
+    updateParentMarkers(m_model.directoryOf(child));
+}
 
-        parent->appendRow(child);
+// private
+void FilesWidget::applyFilterPattern()
+{
+    const QString &previousPattern = m_filterRegularExpression.pattern();
+    bool wasValid = m_filterRegularExpression.isValid();
 
-        updateParentItemMarkers(child->parent());
+    if (previousPattern == m_pendingFilterPattern) {
+        return;
     }
 
-    const QString &fileName = location.fileName();
-
-    child->setText(fileName);
-    child->setToolTip(location.path());
-    child->setData(fileName, FileNameRole);
-    child->setData(fileName.toLower(), LowerCaseNameRole);
+    // An empty or invalid pattern accepts everything. Otherwise only plain literals are known to narrow each other: a
+    // name containing "abc" also contains "ab". Checking this for arbitrary regular expressions isn't worth it.
+    bool narrowing = !wasValid || previousPattern.isEmpty()
+                     || (QRegularExpression::escape(previousPattern) == previousPattern
+                         && QRegularExpression::escape(m_pendingFilterPattern) == m_pendingFilterPattern
+                         && m_pendingFilterPattern.contains(previousPattern));
 
-    parent->sortChildren(0);
+    m_filterRegularExpression = QRegularExpression(m_pendingFilterPattern);
 
-    m_treeFiles->expand(parent->index());
-    m_treeFiles->scrollTo(child->index());
-    m_treeFiles->selectionModel()->select(child->index(), QItemSelectionModel::ClearAndSelect);
+    bool isValid = m_filterRegularExpression.isValid();
 
-    applyFilter();
-}
+    if (isValid != wasValid) {
+        emit filterValidityChanged(isValid);
+    }
 
-// private slot
-void FilesWidget::updateModifiedMarkerOfSender()
-{
-    updateModifiedMarker(qobject_cast<Document *>(sender()));
+    applyFilter(narrowing && isValid);
 }
 
 // private
-void FilesWidget::updateModifiedMarker(Document *document)
+void FilesWidget::applyFilter(bool narrowing)
 {
-    Q_ASSERT(document != NULL);
-
-    QStandardItem *child = m_openChildren.value(document, NULL);
+    int parentCount = m_model.directoryCount();
+    bool changed = false;
 
-    Q_ASSERT(child != NULL);
-
-    setMarker(child, ModifiedMarker, document->isModified());
-    updateParentItemMarkers(child->parent());
-}
-
-// private
-void FilesWidget::setMarker(QStandardItem *item, Marker marker, bool enable) const
-{
-    Q_ASSERT(item != NULL);
+    for (int parentRow = 0; parentRow < parentCount; ++parentRow) {
+        int parent = m_model.directoryAt(parentRow);
+        int childCount = m_model.fileCount(parent);
+        bool hideParent = true;
+        bool childrenChanged = false;
 
-    Markers markers = item->data(MarkersRole).value<Markers>();
+        for (int childRow = 0; childRow < childCount; ++childRow) {
+            int child = m_model.fileAt(parent, childRow);
 
-    if (markers.testFlag(marker) == enable) {
-        return;
-    }
+            // If the filter only got narrower then hidden children stay hidden and don't need to be tested again
+            bool hideChild = narrowing && m_model.isFileHidden(child);
 
-    markers.setFlag(marker, enable);
+            if (!hideChild) {
+                hideChild = !filterAcceptsChild(child);
+                childrenChanged |= m_model.setFileHidden(child, hideChild);
+            }
 
-    item->setData(QVariant::fromValue(markers), MarkersRole);
+            if (!hideChild) {
+                hideParent = false;
+            }
+        }
 
-    if (marker == CurrentMarker) {
-        Utils::setFontUnderline(item, enable);
-    } else if (marker == ModifiedMarker) {
-        QString text;
+        changed |= m_model.setDirectoryHidden(parent, hideParent) || childrenChanged;
 
-        if (item->parent() == NULL) {
-            text = item->data(DirectoryPathRole).value<QString>();
-        } else {
-            text = item->data(FileNameRole).value<QString>();
+        if (childrenChanged) {
+            updateParentMarkers(parent);
         }
+    }
 
-        if (enable) {
-            item->setText(text + "*");
-            item->setForeground(Qt::red);
-        } else {
-            item->setText(text);
+    // Apply all visibility changes at once, including the ones updateVisibility() deferred
+    if (changed || m_invalidateTimer.isActive()) {
+        m_invalidateTimer.stop();
 
-            if (markers.testFlag(ClosedMarker)) {
-                item->setForeground(Qt::darkGray);
-            } else {
-                item->setForeground(palette().color(QPalette::Text));
-            }
-        }
-    } else if (marker == ClosedMarker) {
-        if (!markers.testFlag(ModifiedMarker)) {
-            if (enable) {
-                item->setForeground(Qt::darkGray);
-            } else {
-                item->setForeground(palette().color(QPalette::Text));
-            }
-        }
+        m_filterModel->invalidate();
     }
 }
 
 // private
-void FilesWidget::applyFilter()
+void FilesWidget::updateVisibility(int child)
 {
-    QStandardItem *root = m_model.invisibleRootItem();
-    int parentRowCount = root->rowCount();
+    Q_ASSERT(child >= 0);
 
-    for (int parentRow = 0; parentRow < parentRowCount; ++parentRow) {
-        QStandardItem *parent = root->child(parentRow);
-        int childRowCount = parent->rowCount();
-        bool hideParent = true;
+    int parent = m_model.directoryOf(child);
 
-        for (int childRow = 0; childRow < childRowCount; ++childRow) {
-            QStandardItem *child = parent->child(childRow);
-            bool hideChild = !filterAcceptsChild(child->index());
+    Q_ASSERT(parent >= 0);
 
-            if (!hideChild) {
-                hideParent = false;
-            }
+    bool changed = m_model.setFileHidden(child, !filterAcceptsChild(child));
+    int childCount = m_model.fileCount(parent);
+    bool hideParent = true;
 
-            m_treeFiles->setRowHidden(childRow, parent->index(), hideChild);
+    for (int childRow = 0; childRow < childCount; ++childRow) {
+        if (!m_model.isFileHidden(m_model.fileAt(parent, childRow))) {
+            hideParent = false;
+            break;
         }
+    }
 
-        updateParentItemMarkers(parent);
+    changed |= m_model.setDirectoryHidden(parent, hideParent);
 
-        m_treeFiles->setRowHidden(parentRow, root->index(), hideParent);
+    // Many rows change in a row when documents are opened, closed or saved together. Invalidating once per row would
+    // make that quadratic, the changes are applied together once control returns to the event loop.
+    if (changed && !m_invalidateTimer.isActive()) {
+        m_invalidateTimer.start(0, this);
     }
 }
 
 // private
-bool FilesWidget::filterAcceptsChild(const QModelIndex &index) const
+bool FilesWidget::filterAcceptsChild(int child) const
 {
-    Q_ASSERT(index.isValid());
+    Q_ASSERT(child >= 0);
 
     if (!m_showModifiedFilesOnly && !m_filterEnabled) {
         return true;
     }
 
-    Document *document = index.data(DocumentRole).value<Document *>();
+    Document *document = m_model.document(child);
 
     if (m_showModifiedFilesOnly && (document == NULL || !document->isModified())) {
         return false;
     }
 
     if (m_filterEnabled && m_filterRegularExpression.isValid() && !m_filterRegularExpression.pattern().isEmpty()) {
-        const QString &fileName = index.data(FileNameRole).value<QString>();
-
-        return m_filterRegularExpression.match(fileName).hasMatch();
+        return m_filterRegularExpression.match(m_model.fileName(child)).hasMatch();
     }
 
     return true;
 }
 
 // private
-QStandardItem *FilesWidget::findOrCreateParent(const Location &location)
+int FilesWidget::findOrCreateParent(const Location &location)
 {
     const QString &directoryPath = location.directoryPath("unnamed");
-    const QModelIndexList &parents = m_model.match(m_model.index(0, 0, QModelIndex()), DirectoryPathRole,
-                                                   directoryPath, 1, Qt::MatchExactly);
-    QStandardItem *parent;
+    int parent = m_model.findDirectory(directoryPath);
 
-    if (parents.isEmpty()) {
-        parent = new QStandardItem(QIcon(":/icons/16x16/folder.png"), directoryPath);
-
-        parent->setToolTip(directoryPath);
-        parent->setData(directoryPath, DirectoryPathRole);
-        parent->setData(location.isEmpty() ? "" : directoryPath.toLower(), LowerCaseNameRole);
-        parent->setData(QVariant::fromValue(Markers()), MarkersRole);
-
-        m_model.appendRow(parent);
-        m_model.sort(0);
-    } else {
-        parent = m_model.itemFromIndex(parents.first());
+    if (parent < 0) {
+        parent = m_model.addDirectory(directoryPath, location.isEmpty() ? "" : directoryPath.toLower());
     }
 
     return parent;
 }
 
 // private
-void FilesWidget::takeChildFromParent(QStandardItem *child)
+void FilesWidget::takeChildFromParent(int child)
 {
-    Q_ASSERT(child != NULL);
+    Q_ASSERT(child >= 0);
 
-    QStandardItem *parent = child->parent();
+    int parent = m_model.directoryOf(child);
 
-    Q_ASSERT(parent != NULL);
+    Q_ASSERT(parent >= 0);
 
-    // Save currently selected item, because the QStandardItem::removeRow call seems to affect the selection even if
-    // the currently selected item is not the one being removed
+    // Save currently selected row, because removing rows seems to affect the selection even if the currently selected
+    // row is not the one being removed. The persistent index becomes invalid if the selected row itself is removed.
     const QItemSelection &selection = m_treeFiles->selectionModel()->selection();
-    QStandardItem *selectedItem = NULL;
+    QPersistentModelIndex selectedIndex;
 
     if (!selection.isEmpty()) {
-        selectedItem = m_model.itemFromIndex(selection.first().indexes().first());
-
-        Q_ASSERT(selectedItem != NULL);
-
-        if (selectedItem == child) {
-            selectedItem = NULL;
-        }
+        selectedIndex = m_filterModel->mapToSource(selection.first().indexes().first());
     }
 
-    parent->takeRow(child->row());
+    m_model.takeFile(child);
+    m_model.setFileHidden(child, false);
 
-    if (parent->rowCount() > 0) {
-        updateParentItemMarkers(parent);
+    if (m_model.fileCount(parent) > 0) {
+        updateParentMarkers(parent);
     } else {
-        if (selectedItem == parent) {
-            selectedItem = NULL;
-        }
-
-        m_model.removeRow(parent->row());
+        m_model.setDirectoryHidden(parent, false);
+        m_model.removeDirectory(parent);
     }
 
-    if (selectedItem != NULL) {
-        m_treeFiles->selectionModel()->select(selectedItem->index(), QItemSelectionModel::ClearAndSelect);
+    if (selectedIndex.isValid()) {
+        m_treeFiles->selectionModel()->select(viewIndex(selectedIndex), QItemSelectionModel::ClearAndSelect);
     }
 }
+
+// private
+QModelIndex FilesWidget::viewIndex(const QModelIndex &index) const
+{
+    return m_filterModel->mapFromSource(index);
+}
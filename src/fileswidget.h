@@ -19,16 +19,18 @@
 #ifndef FILESWIDGET_H
 #define FILESWIDGET_H
 
+#include "filesmodel.h"
 #include "location.h"
 
+#include <QBasicTimer>
 #include <QFlags>
 #include <QHash>
 #include <QRegularExpression>
-#include <QStandardItemModel>
 #include <QWidget>
 
 class QTreeView;
 class Document;
+class FilesFilterModel;
 
 class FilesWidget : public QWidget
 {
@@ -42,14 +44,6 @@ public:
 
     Q_DECLARE_FLAGS(Options, Option)
 
-    enum Marker {
-        CurrentMarker = (1 << 0),
-        ModifiedMarker = (1 << 1),
-        ClosedMarker = (1 << 2)
-    };
-
-    Q_DECLARE_FLAGS(Markers, Marker)
-
     explicit FilesWidget(QWidget *parent = NULL);
 
     void setOptions(const Options &options) { m_options = options; }
@@ -58,6 +52,9 @@ public:
     Options options() const { return m_options; }
     bool hasOption(Option option) const { return m_options.testFlag(option); }
 
+protected:
+    void timerEvent(QTimerEvent *event);
+
 signals:
     void filterValidityChanged(bool valid);
 
@@ -72,45 +69,39 @@ private slots:
     void setCurrentDocument(const QModelIndex &index);
     void setCurrentChild(Document *document);
     void updateParentIndexMarkers(const QModelIndex &index);
-    void updateParentItemMarkers(QStandardItem *parent);
     void updateLocationOfSender();
     void updateModifiedMarkerOfSender();
 
 private:
-    enum {
-        DocumentRole = Qt::UserRole,
-        PathRole, // for reopening closed documents
-        DocumentTypeRole, // for reopening closed documents
-        TextCodecRole, // for reopening closed documents
-        DirectoryPathRole, // for parents
-        FileNameRole, // for children
-        LowerCaseNameRole, // for sorting
-        MarkersRole
-    };
-
+    void updateParentMarkers(int parent);
     void updateModifiedMarker(Document *document);
-    void setMarker(QStandardItem *item, Marker marker, bool enable) const;
-    void applyFilter();
-    bool filterAcceptsChild(const QModelIndex &index) const;
-    QStandardItem *findOrCreateParent(const Location &location);
-    void takeChildFromParent(QStandardItem *child);
+    void applyFilterPattern();
+    void applyFilter(bool narrowing);
+    void updateVisibility(int child);
+    bool filterAcceptsChild(int child) const;
+    QModelIndex viewIndex(const QModelIndex &index) const;
+    int findOrCreateParent(const Location &location);
+    void takeChildFromParent(int child);
 
     Options m_options;
 
-    QStandardItemModel m_model;
-    QHash<Document *, QStandardItem *> m_openChildren; // values owned by QStandardItemModel
-    QHash<Location, QStandardItem *> m_closedChildren; // values owned by QStandardItemModel
-    QStandardItem *m_currentChild;
+    // Parents are FilesModel directory IDs, children are FilesModel file IDs
+    FilesModel m_model;
+    QHash<Document *, int> m_openChildren;
+    QHash<Location, int> m_closedChildren;
+    int m_currentChild; // -1 if there is none
+    FilesFilterModel *m_filterModel;
     QTreeView *m_treeFiles;
 
     bool m_showModifiedFilesOnly;
 
     bool m_filterEnabled;
     QRegularExpression m_filterRegularExpression;
+    QString m_pendingFilterPattern;
+    QBasicTimer m_filterTimer; // Delays applying the pattern until typing pauses
+    QBasicTimer m_invalidateTimer; // Batches the visibility changes made by updateVisibility()
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(FilesWidget::Options)
-Q_DECLARE_OPERATORS_FOR_FLAGS(FilesWidget::Markers)
-Q_DECLARE_METATYPE(FilesWidget::Markers)
 
 #endif // FILESWIDGET_H
@@ -0,0 +1,336 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "filewatcher.h"
+#include "textdocument.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimerEvent>
+
+FileReloader::FileReloader(const QString &path, qint64 size, const QDateTime &modificationTime, const QByteArray &probe,
+                           bool mapped, QObject *parent) :
+    QThread(parent),
+    m_path(path),
+    m_size(size),
+    m_modificationTime(modificationTime),
+    m_probe(probe),
+    m_isMapped(mapped),
+    m_result(Failed),
+    m_hasMore(false)
+{
+}
+
+// protected
+void FileReloader::run()
+{
+    QFile file(m_path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (!isInterruptionRequested()) {
+            emit reloadFinished(m_path);
+        }
+
+        return;
+    }
+
+    const QDateTime &modificationTime = QFileInfo(file).lastModified();
+    qint64 size = file.size();
+
+    bool unchanged = size == m_size && modificationTime == m_modificationTime;
+    bool appended = !unchanged && m_size >= 0 && size > m_size && file.seek(m_size - m_probe.length()) &&
+                    file.read(m_probe.length()) == m_probe;
+
+    if (unchanged) {
+        m_result = Unchanged;
+    } else if (m_isMapped) {
+        // The document maps the file itself, only the bytes at the new end are needed to recognize the next append
+        if (file.seek(size - qMin(size, (qint64)ProbeSize))) {
+            m_probe = file.read(ProbeSize);
+            m_result = appended ? Appended : Replaced;
+            m_size = size;
+        }
+    } else if (appended) {
+        m_data = file.read(BatchSize);
+        m_hasMore = !file.atEnd();
+        m_result = Appended;
+        m_size += m_data.length();
+
+        if (m_data.length() >= ProbeSize) {
+            m_probe = m_data.right(ProbeSize);
+        } else {
+            m_probe = (m_probe + m_data).right(ProbeSize);
+        }
+    } else if (file.seek(0)) {
+        m_data = file.readAll();
+        m_result = Replaced;
+        m_size = m_data.length();
+        m_probe = m_data.right(ProbeSize);
+    }
+
+    if (file.error() != QFile::NoError) {
+        m_data.clear();
+        m_hasMore = false;
+        m_result = Failed;
+    }
+
+    m_modificationTime = modificationTime;
+
+    if (!isInterruptionRequested()) {
+        emit reloadFinished(m_path);
+    }
+}
+
+FileWatcher *FileWatcher::s_instance = NULL;
+
+FileWatcher::FileWatcher(QObject *parent) :
+    QObject(parent)
+{
+    s_instance = this;
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &FileWatcher::scheduleReload);
+}
+
+FileWatcher::~FileWatcher()
+{
+    foreach (FileReloader *reloader, m_reloaders) {
+        reloader->requestInterruption();
+        reloader->wait();
+    }
+
+    s_instance = NULL;
+}
+
+// static
+void FileWatcher::watch(Document *document, const QByteArray &data)
+{
+    Q_ASSERT(document != NULL);
+
+    unwatch(document);
+
+    TextDocument *textDocument = qobject_cast<TextDocument *>(document);
+    const QString &path = document->location().path();
+
+    if (textDocument == NULL || path.isEmpty()) {
+        return;
+    }
+
+    FileWatcher *watcher = s_instance;
+    WatchedFile file;
+
+    file.document = textDocument;
+    file.isMapped = textDocument->isMapped();
+    file.modificationTime = QFileInfo(path).lastModified();
+
+    if (file.isMapped) {
+        file.size = textDocument->mappedSize();
+        file.probe = textDocument->mappedTail(FileReloader::ProbeSize);
+    } else {
+        file.size = data.length();
+        file.probe = data.right(FileReloader::ProbeSize);
+    }
+
+    // A path is watched for one document only, the last one to claim it
+    if (watcher->m_files.contains(path)) {
+        watcher->m_paths.remove(watcher->m_files.value(path).document);
+    }
+
+    watcher->m_files.insert(path, file);
+    watcher->m_paths.insert(document, path);
+    watcher->m_watcher.addPath(path);
+}
+
+// static
+void FileWatcher::unwatch(Document *document)
+{
+    Q_ASSERT(document != NULL);
+
+    FileWatcher *watcher = s_instance;
+    const QString &path = watcher->m_paths.take(document);
+
+    if (path.isEmpty()) {
+        return;
+    }
+
+    FileReloader *reloader = watcher->m_reloaders.take(path);
+
+    if (reloader != NULL) {
+        reloader->requestInterruption();
+        reloader->wait();
+        reloader->deleteLater();
+    }
+
+    watcher->m_files.remove(path);
+    watcher->m_pendingPaths.remove(path);
+    watcher->m_watcher.removePath(path);
+}
+
+// static
+void FileWatcher::reload(Document *document)
+{
+    Q_ASSERT(document != NULL);
+
+    const QString &path = s_instance->m_paths.value(document);
+
+    if (!path.isEmpty()) {
+        s_instance->m_files[path].size = -1;
+        s_instance->scheduleReload(path);
+    }
+}
+
+// protected
+void FileWatcher::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_reloadTimer.timerId()) {
+        m_reloadTimer.stop();
+
+        // Files that are still being reloaded are reloaded again once that is done
+        foreach (const QString &path, m_pendingPaths) {
+            if (!m_files.contains(path)) {
+                m_pendingPaths.remove(path);
+            } else if (!m_reloaders.contains(path)) {
+                m_pendingPaths.remove(path);
+
+                startReload(path);
+            }
+        }
+    }
+
+    QObject::timerEvent(event);
+}
+
+// private slot
+void FileWatcher::scheduleReload(const QString &path)
+{
+    m_pendingPaths.insert(path);
+
+    // Don't restart an active timer, a file that is written to continuously would never be reloaded otherwise
+    if (!m_reloadTimer.isActive()) {
+        m_reloadTimer.start(ReloadDelay, this);
+    }
+}
+
+// private slot
+void FileWatcher::finishReload(const QString &path)
+{
+    FileReloader *reloader = m_reloaders.take(path);
+
+    if (reloader == NULL) {
+        return;
+    }
+
+    reloader->wait();
+
+    QHash<QString, WatchedFile>::iterator iterator = m_files.find(path);
+
+    if (iterator != m_files.end()) {
+        // Read the next batch of appended data right away, one batch per event loop iteration
+        if (applyReload(&iterator.value(), reloader) && reloader->hasMore() && !m_pendingPaths.contains(path)) {
+            startReload(path);
+        }
+
+        // A file that is replaced by renaming another file over it isn't watched anymore
+        if (!m_watcher.files().contains(path) && QFileInfo::exists(path)) {
+            m_watcher.addPath(path);
+        }
+    }
+
+    reloader->deleteLater();
+
+    if (!m_pendingPaths.isEmpty() && !m_reloadTimer.isActive()) {
+        m_reloadTimer.start(ReloadDelay, this);
+    }
+}
+
+// private
+void FileWatcher::startReload(const QString &path)
+{
+    const WatchedFile &file = m_files.value(path);
+    FileReloader *reloader = new FileReloader(path, file.size, file.modificationTime, file.probe, file.isMapped,
+                                              this);
+
+    m_reloaders.insert(path, reloader);
+
+    connect(reloader, &FileReloader::reloadFinished, this, &FileWatcher::finishReload);
+
+    reloader->start(QThread::LowPriority);
+}
+
+// private
+bool FileWatcher::applyReload(WatchedFile *file, FileReloader *reloader)
+{
+    Q_ASSERT(file != NULL);
+    Q_ASSERT(reloader != NULL);
+
+    // Leave edited documents alone, saving them overwrites the file anyway
+    if (file->document->isModified()) {
+        return false;
+    }
+
+    QString error;
+
+    switch (reloader->result()) {
+    case FileReloader::Unchanged:
+        file->modificationTime = reloader->modificationTime();
+        return true;
+
+    case FileReloader::Appended:
+        if (file->isMapped) {
+            if (!file->document->remap(true, &error)) {
+                qDebug() << "FileWatcher: Remapping" << reloader->path() << "failed:" << error;
+
+                return false;
+            }
+        } else if (!file->document->append(reloader->data())) {
+            // Can't continue decoding where the text ends, read the whole file instead
+            file->size = -1;
+
+            m_pendingPaths.insert(reloader->path());
+
+            return false;
+        }
+
+        break;
+
+    case FileReloader::Replaced:
+        if (file->isMapped) {
+            if (!file->document->remap(false, &error)) {
+                qDebug() << "FileWatcher: Remapping" << reloader->path() << "failed:" << error;
+
+                return false;
+            }
+        } else if (!file->document->load(reloader->data(), &error)) {
+            qDebug() << "FileWatcher: Reloading" << reloader->path() << "failed:" << error;
+
+            return false;
+        }
+
+        break;
+
+    case FileReloader::Failed:
+        return false; // For example the file is being replaced, the notification about the new file follows
+    }
+
+    file->size = reloader->size();
+    file->modificationTime = reloader->modificationTime();
+    file->probe = reloader->probe();
+
+    return true;
+}
@@ -0,0 +1,140 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <QBasicTimer>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+
+class Document;
+class TextDocument;
+
+// Reads a changed file on a worker thread. If the file grew and still ends with the same bytes at its old end then it
+// was most likely only appended to, like a log file, and only the new bytes are read. Those are read in batches, so
+// that a lot of new data is appended piece by piece without blocking the UI for long. For a mapped document nothing but
+// the bytes at the new end of the file is read, the document maps the file again itself.
+class FileReloader : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FileReloader)
+
+public:
+    enum {
+        ProbeSize = 4096, // bytes before the old end of the file that are compared
+        BatchSize = 4 * 1024 * 1024 // bytes
+    };
+
+    enum Result {
+        Unchanged,
+        Appended,
+        Replaced,
+        Failed
+    };
+
+    // A size of -1 forces the whole file to be read
+    FileReloader(const QString &path, qint64 size, const QDateTime &modificationTime, const QByteArray &probe,
+                 bool mapped, QObject *parent = NULL);
+
+    QString path() const { return m_path; }
+
+    // Only valid after reloadFinished() was emitted
+    Result result() const { return m_result; }
+    QByteArray data() const { return m_data; } // the appended bytes or the whole file, empty if mapped
+    bool hasMore() const { return m_hasMore; } // more bytes were appended than were read
+    qint64 size() const { return m_size; }
+    QDateTime modificationTime() const { return m_modificationTime; }
+    QByteArray probe() const { return m_probe; }
+
+signals:
+    void reloadFinished(const QString &path);
+
+protected:
+    void run();
+
+private:
+    QString m_path;
+    qint64 m_size;
+    QDateTime m_modificationTime;
+    QByteArray m_probe;
+    bool m_isMapped;
+    Result m_result;
+    QByteArray m_data;
+    bool m_hasMore;
+};
+
+// Watches the files of the open text documents. Unmodified documents are brought up-to-date in the background when
+// their file changes, files that were only appended to just get the new text appended.
+class FileWatcher : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FileWatcher)
+
+public:
+    explicit FileWatcher(QObject *parent = NULL);
+    ~FileWatcher();
+
+    static FileWatcher *instance() { return s_instance; }
+
+    // The document was loaded from or saved as the given data, changes to its file are relative to that. The data of a
+    // mapped document is ignored, the mapped file is the reference then.
+    static void watch(Document *document, const QByteArray &data);
+    static void unwatch(Document *document);
+
+    // Reads the whole file of the document again
+    static void reload(Document *document);
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void scheduleReload(const QString &path);
+    void finishReload(const QString &path);
+
+private:
+    enum {
+        ReloadDelay = 250 // milliseconds
+    };
+
+    struct WatchedFile {
+        TextDocument *document;
+        bool isMapped;
+        qint64 size; // -1 if the file has to be read completely
+        QDateTime modificationTime;
+        QByteArray probe; // the last bytes of the file
+    };
+
+    void startReload(const QString &path);
+    bool applyReload(WatchedFile *file, FileReloader *reloader);
+
+    static FileWatcher *s_instance;
+
+    QHash<QString, WatchedFile> m_files;
+    QHash<Document *, QString> m_paths; // the key of each document in m_files
+    QHash<QString, FileReloader *> m_reloaders;
+    QSet<QString> m_pendingPaths;
+    QFileSystemWatcher m_watcher;
+    QBasicTimer m_reloadTimer; // Coalesces change notifications, a file that is written to changes many times in a row
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,273 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "gitchangetracker.h"
+#include "gitrepository.h"
+#include "textcodec.h"
+#include "textdocument.h"
+
+#include <QTextBlock>
+#include <QTextDocument>
+
+GitBlobLoader::GitBlobLoader(int generation, const QString &path, TextCodec *codec, const QStringList &documentLines,
+                             QObject *parent) :
+    QThread(parent),
+    m_generation(generation),
+    m_path(path),
+    m_codec(codec),
+    m_documentLines(documentLines),
+    m_hasBlob(false),
+    m_interner(new LineInterner())
+{
+}
+
+// protected
+void GitBlobLoader::run()
+{
+    const QSharedPointer<GitRepository> &repository = GitRepository::forPath(m_path);
+    const QString &relativePath = repository.isNull() ? QString() : repository->relativePath(m_path);
+    QByteArray blobId;
+    GitRepository::ObjectType type;
+    QByteArray blob;
+    QString error; // The Git diff widget reports errors, there is no room for them in the gutter
+
+    if (!relativePath.isEmpty() && repository->findHeadBlob(relativePath, &blobId, &error) && !blobId.isEmpty() &&
+        repository->readObject(blobId, &type, &blob, &error)) {
+        TextCodecState state;
+        QVector<int> blobLines;
+        QVector<int> documentLines;
+
+        m_interner->internLines(m_codec->decode(blob.constData(), blob.length(), &state), &blobLines);
+
+        documentLines.reserve(m_documentLines.size());
+
+        foreach (const QString &line, m_documentLines) {
+            documentLines.append(m_interner->intern(line));
+        }
+
+        if (!isInterruptionRequested()) {
+            m_diff.reset(blobLines, documentLines);
+            m_hasBlob = true;
+        }
+    }
+
+    if (!isInterruptionRequested()) {
+        emit loadFinished(m_generation);
+    }
+}
+
+GitChangeTracker::GitChangeTracker(TextDocument *document, QObject *parent) :
+    QObject(parent),
+    m_document(document),
+    m_loader(NULL),
+    m_generation(0),
+    m_editedFirst(0),
+    m_editedTail(0),
+    m_hasBlob(false)
+{
+    Q_ASSERT(document != NULL);
+
+    connect(m_document, &Document::locationChanged, this, &GitChangeTracker::loadBlob);
+    connect(m_document, &Document::modificationChanged, this, &GitChangeTracker::reloadBlob);
+    connect(m_document->internalDocument(), &QTextDocument::contentsChange, this, &GitChangeTracker::updateLines);
+
+    loadBlob();
+}
+
+GitChangeTracker::~GitChangeTracker()
+{
+    stopLoad();
+}
+
+int GitChangeTracker::markers(int blockNumber) const
+{
+    if (!m_hasBlob) {
+        return NoMarker;
+    }
+
+    const QVector<LineDiff::Hunk> &hunks = m_diff.hunks();
+    int markers = NoMarker;
+
+    for (int i = m_diff.findHunk(blockNumber); i < hunks.size() && hunks.at(i).newStart <= blockNumber; ++i) {
+        const LineDiff::Hunk &hunk = hunks.at(i);
+
+        if (hunk.newCount == 0) {
+            markers |= DeletedAboveMarker;
+        } else if (blockNumber < hunk.newStart + hunk.newCount) {
+            markers |= hunk.oldCount > 0 ? ModifiedMarker : AddedMarker;
+        }
+    }
+
+    int lineCount = m_diff.newLineCount();
+
+    if (blockNumber == lineCount - 1 && !hunks.isEmpty() && hunks.last().newCount == 0 &&
+        hunks.last().newStart == lineCount) {
+        markers |= DeletedBelowMarker;
+    }
+
+    return markers;
+}
+
+// private slot
+void GitChangeTracker::loadBlob()
+{
+    stopLoad();
+
+    const Location &location = m_document->location();
+
+    if (location.isEmpty()) {
+        if (m_hasBlob) {
+            m_hasBlob = false;
+            m_interner.clear();
+            m_diff.clear();
+
+            emit markersChanged();
+        }
+
+        return;
+    }
+
+    // The lines are diffed on the loader thread, edits made in the meantime are diffed again once it's done. Keep
+    // showing the current markers until then.
+    QStringList lines;
+
+    for (QTextBlock block = m_document->internalDocument()->begin(); block.isValid(); block = block.next()) {
+        lines.append(block.text());
+    }
+
+    m_editedFirst = lines.size();
+    m_editedTail = lines.size();
+    m_loader = new GitBlobLoader(++m_generation, location.path(), m_document->codec(), lines, this);
+
+    connect(m_loader, &GitBlobLoader::loadFinished, this, &GitChangeTracker::finishLoad);
+
+    m_loader->start(QThread::LowPriority);
+}
+
+// private slot
+void GitChangeTracker::reloadBlob(bool modified)
+{
+    // After saving HEAD might point to a new commit, reading it again is cheap as the repository caches objects
+    if (!modified) {
+        loadBlob();
+    }
+}
+
+// private slot
+void GitChangeTracker::finishLoad(int generation)
+{
+    if (generation != m_generation || m_loader == NULL) {
+        return;
+    }
+
+    m_loader->wait();
+
+    bool hadBlob = m_hasBlob;
+
+    m_hasBlob = m_loader->hasBlob();
+
+    if (m_hasBlob) {
+        m_interner = m_loader->interner();
+        m_diff = m_loader->diff();
+
+        // Replace the lines that were edited after the snapshot was taken in one go
+        int snapshotCount = m_diff.newLineCount();
+        int blockCount = m_document->internalDocument()->blockCount();
+        int first = qMin(m_editedFirst, qMin(snapshotCount, blockCount));
+        int tail = qMin(m_editedTail, qMin(snapshotCount, blockCount) - first);
+        int removedCount = snapshotCount - first - tail;
+        int addedCount = blockCount - first - tail;
+
+        if (removedCount > 0 || addedCount > 0) {
+            QVector<int> lines;
+
+            BlockLines::internBlocks(m_interner.data(), m_document->internalDocument(), first, addedCount, &lines);
+
+            m_diff.replace(first, removedCount, lines);
+        }
+    } else {
+        m_interner.clear();
+        m_diff.clear();
+    }
+
+    m_loader->deleteLater();
+    m_loader = NULL;
+
+    if (m_hasBlob || hadBlob) {
+        emit markersChanged();
+    }
+}
+
+// private slot
+void GitChangeTracker::updateLines(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+
+    if (!m_hasBlob && m_loader == NULL) {
+        return;
+    }
+
+    // Replace the IDs of the blocks that were touched by the change, the rest of the lines are still valid
+    QTextDocument *document = m_document->internalDocument();
+    BlockLines::Change change;
+    bool inSync = BlockLines::findChange(document, position, charsAdded, m_diff.newLineCount(), &change);
+
+    if (m_loader != NULL) {
+        m_editedFirst = qMin(m_editedFirst, change.first);
+        m_editedTail = qMin(m_editedTail, document->blockCount() - change.first - change.addedCount);
+    }
+
+    if (!m_hasBlob) {
+        return;
+    }
+
+    if (!inSync) {
+        // Out of sync, start over
+        m_hasBlob = false;
+        m_interner.clear();
+        m_diff.clear();
+
+        emit markersChanged();
+
+        loadBlob();
+
+        return;
+    }
+
+    QVector<int> lines;
+
+    BlockLines::internBlocks(m_interner.data(), document, change.first, change.addedCount, &lines);
+
+    m_diff.replace(change.first, change.removedCount, lines);
+
+    emit markersChanged();
+}
+
+// private
+void GitChangeTracker::stopLoad()
+{
+    ++m_generation;
+
+    if (m_loader != NULL) {
+        m_loader->requestInterruption();
+        m_loader->wait();
+        m_loader->deleteLater();
+        m_loader = NULL;
+    }
+}
@@ -0,0 +1,108 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GITCHANGETRACKER_H
+#define GITCHANGETRACKER_H
+
+#include "linediff.h"
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThread>
+
+class TextCodec;
+class TextDocument;
+
+// Reads the lines of the blob of a file in the commit that HEAD points to and diffs them against a snapshot of the
+// lines of the document
+class GitBlobLoader : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(GitBlobLoader)
+
+public:
+    GitBlobLoader(int generation, const QString &path, TextCodec *codec, const QStringList &documentLines,
+                  QObject *parent = NULL);
+
+    // Only valid after loadFinished() was emitted
+    bool hasBlob() const { return m_hasBlob; }
+    QSharedPointer<LineInterner> interner() const { return m_interner; }
+    IncrementalLineDiff diff() const { return m_diff; } // the document lines are the new side
+
+signals:
+    void loadFinished(int generation);
+
+protected:
+    void run();
+
+private:
+    int m_generation;
+    QString m_path;
+    TextCodec *m_codec;
+    QStringList m_documentLines;
+    bool m_hasBlob;
+    QSharedPointer<LineInterner> m_interner;
+    IncrementalLineDiff m_diff;
+};
+
+// Tracks which lines of a text document differ from the blob of its file in HEAD. The blob is read once per location
+// and again after saving. Edits only diff the touched lines again together with the hunks next to them, so the cost
+// of an edit doesn't depend on the size of the document.
+class GitChangeTracker : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(GitChangeTracker)
+
+public:
+    enum Marker {
+        NoMarker = 0x00,
+        AddedMarker = 0x01,
+        ModifiedMarker = 0x02,
+        DeletedAboveMarker = 0x04, // lines were deleted above this line
+        DeletedBelowMarker = 0x08 // lines were deleted below the last line
+    };
+
+    explicit GitChangeTracker(TextDocument *document, QObject *parent = NULL);
+    ~GitChangeTracker();
+
+    int markers(int blockNumber) const;
+
+signals:
+    void markersChanged();
+
+private slots:
+    void loadBlob();
+    void reloadBlob(bool modified);
+    void finishLoad(int generation);
+    void updateLines(int position, int charsRemoved, int charsAdded);
+
+private:
+    void stopLoad();
+
+    TextDocument *m_document;
+    GitBlobLoader *m_loader;
+    int m_generation;
+    int m_editedFirst; // lines [0, m_editedFirst) are unchanged since the loader took its snapshot
+    int m_editedTail; // and so are the last m_editedTail lines
+    QSharedPointer<LineInterner> m_interner;
+    bool m_hasBlob;
+    IncrementalLineDiff m_diff;
+};
+
+#endif // GITCHANGETRACKER_H
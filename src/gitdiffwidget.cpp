@@ -19,16 +19,293 @@
 #include "gitdiffwidget.h"
 #include "ui_gitdiffwidget.h"
 
+#include "diffmodel.h"
+#include "gitrepository.h"
+#include "textcodec.h"
+#include "textdocument.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTimerEvent>
+
+GitDiffWorker::GitDiffWorker(int generation, const QString &path, TextCodec *codec, QObject *parent) :
+    QThread(parent),
+    m_generation(generation),
+    m_path(path),
+    m_codec(codec),
+    m_result(Failed),
+    m_interner(new LineInterner())
+{
+}
+
+// protected
+void GitDiffWorker::run()
+{
+    const QSharedPointer<GitRepository> &repository = GitRepository::forPath(m_path);
+    const QString &relativePath = repository.isNull() ? QString() : repository->relativePath(m_path);
+
+    if (relativePath.isEmpty()) {
+        m_result = NotInRepository;
+
+        emit diffFinished(m_generation);
+
+        return;
+    }
+
+    QByteArray blobId;
+
+    if (!repository->findHeadBlob(relativePath, &blobId, &m_error)) {
+        m_result = Failed;
+    } else if (blobId.isEmpty()) {
+        m_result = NotInHead;
+    } else {
+        GitRepository::IndexEntry entry;
+        QDateTime indexModificationTime;
+        const QFileInfo info(m_path);
+
+        if (!repository->findIndexEntry(relativePath, &entry, &indexModificationTime, &m_error)) {
+            m_result = Failed;
+        } else if (entry.id == blobId && info.exists() && entry.size == quint32(info.size()) &&
+                   entry.modificationTime == quint32(info.lastModified().toTime_t()) &&
+                   info.lastModified().toTime_t() < indexModificationTime.toTime_t()) {
+            // Same check as Git does, a file modified in the same second as the index was written might have changed
+            // without its size changing
+            m_result = Unchanged;
+        } else {
+            GitRepository::ObjectType type;
+            QByteArray blob;
+            QByteArray data;
+            QFile file(m_path);
+
+            if (!repository->readObject(blobId, &type, &blob, &m_error)) {
+                m_result = Failed;
+            } else if (file.exists() && !file.open(QFile::ReadOnly)) {
+                m_error = QString("Could not open \"%1\": %2").arg(m_path, file.errorString());
+                m_result = Failed;
+            } else {
+                if (file.isOpen()) {
+                    data = file.readAll();
+                }
+
+                if (blob == data) {
+                    m_result = Unchanged;
+                } else {
+                    TextCodecState oldState;
+                    TextCodecState newState;
+
+                    m_interner->internLines(m_codec->decode(blob.constData(), blob.length(), &oldState), &m_oldLines);
+                    m_interner->internLines(m_codec->decode(data.constData(), data.length(), &newState), &m_newLines);
+
+                    m_hunks = LineDiff::compute(m_oldLines, m_newLines, this);
+                    m_result = m_hunks.isEmpty() ? Unchanged : Changed; // Only line endings differ
+                }
+            }
+        }
+    }
+
+    if (!isInterruptionRequested()) {
+        emit diffFinished(m_generation);
+    }
+}
+
 GitDiffWidget::GitDiffWidget(QWidget *parent) :
     QWidget(parent),
-    m_ui(new Ui::GitDiffWidget)
+    m_ui(new Ui::GitDiffWidget),
+    m_model(new DiffModel(this)),
+    m_document(NULL),
+    m_worker(NULL),
+    m_generation(0),
+    m_diffPending(false)
 {
     m_ui->setupUi(this);
 
+    m_ui->listHunks->setModel(m_model);
+    m_ui->listHunks->setUniformItemSizes(true);
+
     connect(m_ui->buttonHide, &QToolButton::clicked, this, &GitDiffWidget::hideClicked);
 }
 
 GitDiffWidget::~GitDiffWidget()
 {
+    stopDiff();
+
     delete m_ui;
 }
+
+void GitDiffWidget::setDocument(Document *document)
+{
+    TextDocument *textDocument = qobject_cast<TextDocument *>(document);
+
+    // A mapped document is too big to be diffed and can't have unsaved changes anyway
+    if (textDocument != NULL && textDocument->isMapped()) {
+        textDocument = NULL;
+    }
+
+    if (textDocument == m_document) {
+        return;
+    }
+
+    if (m_document != NULL) {
+        m_document->disconnect(this);
+    }
+
+    stopDiff();
+
+    m_document = textDocument;
+    m_model->clear();
+
+    setStatus(QString());
+
+    if (m_document != NULL) {
+        connect(m_document, &Document::locationChanged, this, &GitDiffWidget::scheduleDiff);
+        connect(m_document, &Document::modificationChanged, this, &GitDiffWidget::scheduleDiff);
+        connect(m_document, &QObject::destroyed, this, &GitDiffWidget::forgetDocument);
+    }
+
+    scheduleDiff();
+}
+
+// protected
+void GitDiffWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    // The repository might have changed while this widget was hidden, the index makes refreshing cheap
+    if (m_worker == NULL) {
+        startDiff();
+    } else {
+        m_diffPending = true;
+    }
+}
+
+// protected
+void GitDiffWidget::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_diffTimer.timerId()) {
+        m_diffTimer.stop();
+
+        // Otherwise the diff is started once the running one is done or once this widget is shown
+        if (m_worker == NULL && isVisible()) {
+            startDiff();
+        } else {
+            m_diffPending = true;
+        }
+    }
+
+    QWidget::timerEvent(event);
+}
+
+// private slot
+void GitDiffWidget::scheduleDiff()
+{
+    m_diffTimer.start(DiffDelay, this);
+}
+
+// private slot
+void GitDiffWidget::forgetDocument()
+{
+    // The document is being destroyed, its signals are already disconnected
+    m_document = NULL;
+
+    stopDiff();
+
+    m_model->clear();
+
+    setStatus(QString());
+}
+
+// private slot
+void GitDiffWidget::finishDiff(int generation)
+{
+    if (generation != m_generation || m_worker == NULL) {
+        return;
+    }
+
+    m_worker->wait();
+
+    switch (m_worker->result()) {
+    case GitDiffWorker::NotInRepository:
+        setStatus("not in a Git repository");
+        break;
+
+    case GitDiffWorker::NotInHead:
+        setStatus("not in HEAD");
+        break;
+
+    case GitDiffWorker::Unchanged:
+        setStatus("unchanged");
+        break;
+
+    case GitDiffWorker::Changed:
+        setStatus(QString());
+        break;
+
+    case GitDiffWorker::Failed:
+        setStatus(m_worker->error());
+        break;
+    }
+
+    if (m_worker->result() == GitDiffWorker::Changed) {
+        m_model->setDiff(m_worker->interner(), m_worker->hunks(), m_worker->oldLines(), m_worker->newLines());
+    } else {
+        m_model->clear();
+    }
+
+    m_worker->deleteLater();
+    m_worker = NULL;
+
+    if (m_diffPending && isVisible()) {
+        startDiff();
+    }
+}
+
+// private
+void GitDiffWidget::startDiff()
+{
+    Q_ASSERT(m_worker == NULL);
+
+    m_diffPending = false;
+
+    if (m_document == NULL) {
+        return;
+    }
+
+    const Location &location = m_document->location();
+
+    if (location.isEmpty()) {
+        m_model->clear();
+
+        setStatus("not saved yet");
+
+        return;
+    }
+
+    m_worker = new GitDiffWorker(++m_generation, location.path(), m_document->codec(), this);
+
+    connect(m_worker, &GitDiffWorker::diffFinished, this, &GitDiffWidget::finishDiff);
+
+    m_worker->start(QThread::LowPriority);
+}
+
+// private
+void GitDiffWidget::stopDiff()
+{
+    m_diffTimer.stop();
+    m_diffPending = false;
+
+    ++m_generation;
+
+    if (m_worker != NULL) {
+        m_worker->requestInterruption();
+        m_worker->wait();
+        m_worker->deleteLater();
+        m_worker = NULL;
+    }
+}
+
+// private
+void GitDiffWidget::setStatus(const QString &status)
+{
+    m_ui->labelTitle->setText(status.isEmpty() ? "Git Diff" : QString("Git Diff (%1)").arg(status));
+    m_ui->labelTitle->setToolTip(status);
+}
@@ -19,12 +19,68 @@
 #ifndef GITDIFFWIDGET_H
 #define GITDIFFWIDGET_H
 
+#include "linediff.h"
+
+#include <QBasicTimer>
+#include <QSharedPointer>
+#include <QThread>
 #include <QWidget>
 
+class DiffModel;
+class Document;
+class TextCodec;
+class TextDocument;
+
 namespace Ui {
 class GitDiffWidget;
 }
 
+// Diffs the blob of a file in the commit that HEAD points to against the file in the work tree. Files whose index
+// entry still matches their size and modification time are known to be unchanged without reading them.
+class GitDiffWorker : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(GitDiffWorker)
+
+public:
+    enum Result {
+        NotInRepository,
+        NotInHead,
+        Unchanged,
+        Changed,
+        Failed
+    };
+
+    GitDiffWorker(int generation, const QString &path, TextCodec *codec, QObject *parent = NULL);
+
+    // Only valid after diffFinished() was emitted
+    Result result() const { return m_result; }
+    QString error() const { return m_error; }
+    QSharedPointer<LineInterner> interner() const { return m_interner; }
+    QVector<int> oldLines() const { return m_oldLines; }
+    QVector<int> newLines() const { return m_newLines; }
+    QVector<LineDiff::Hunk> hunks() const { return m_hunks; }
+
+signals:
+    void diffFinished(int generation);
+
+protected:
+    void run();
+
+private:
+    int m_generation;
+    QString m_path;
+    TextCodec *m_codec;
+    Result m_result;
+    QString m_error;
+    QSharedPointer<LineInterner> m_interner;
+    QVector<int> m_oldLines;
+    QVector<int> m_newLines;
+    QVector<LineDiff::Hunk> m_hunks;
+};
+
+// Shows how the file of the current text document differs from its version in HEAD. The repository is read directly
+// by GitRepository on a worker thread, the diff is refreshed whenever the document is saved or this widget is shown.
 class GitDiffWidget : public QWidget
 {
     Q_OBJECT
@@ -34,11 +90,36 @@ public:
     explicit GitDiffWidget(QWidget *parent = NULL);
     ~GitDiffWidget();
 
+    void setDocument(Document *document);
+
 signals:
     void hideClicked();
 
+protected:
+    void showEvent(QShowEvent *event);
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void scheduleDiff();
+    void forgetDocument();
+    void finishDiff(int generation);
+
 private:
+    enum {
+        DiffDelay = 150 // milliseconds
+    };
+
+    void startDiff();
+    void stopDiff();
+    void setStatus(const QString &status);
+
     Ui::GitDiffWidget *m_ui;
+    DiffModel *m_model;
+    TextDocument *m_document;
+    GitDiffWorker *m_worker;
+    int m_generation;
+    bool m_diffPending;
+    QBasicTimer m_diffTimer;
 };
 
 #endif // GITDIFFWIDGET_H
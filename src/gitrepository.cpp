@@ -0,0 +1,1061 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "gitrepository.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <algorithm>
+
+static bool parseId(const char *hex, int length, QByteArray *id)
+{
+    if (length < 2 * GitRepository::IdSize) {
+        return false;
+    }
+
+    for (int i = 0; i < 2 * GitRepository::IdSize; ++i) {
+        char c = hex[i];
+
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return false;
+        }
+    }
+
+    *id = QByteArray::fromHex(QByteArray(hex, 2 * GitRepository::IdSize));
+
+    return true;
+}
+
+static int compareBytes(const char *data, int length, const char *otherData, int otherLength)
+{
+    int result = memcmp(data, otherData, qMin(length, otherLength));
+
+    if (result != 0) {
+        return result;
+    }
+
+    return length - otherLength;
+}
+
+GitPack::GitPack(const QString &indexPath, const QString &packPath) :
+    m_indexFile(indexPath),
+    m_packFile(packPath),
+    m_indexData(NULL),
+    m_packData(NULL),
+    m_indexVersion(0),
+    m_objectCount(0)
+{
+}
+
+bool GitPack::open(QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    if (!m_indexFile.open(QFile::ReadOnly) || (m_indexData = m_indexFile.map(0, m_indexFile.size())) == NULL) {
+        *error = QString("Could not map \"%1\": %2").arg(m_indexFile.fileName(), m_indexFile.errorString());
+
+        return false;
+    }
+
+    if (!m_packFile.open(QFile::ReadOnly) || (m_packData = m_packFile.map(0, m_packFile.size())) == NULL) {
+        *error = QString("Could not map \"%1\": %2").arg(m_packFile.fileName(), m_packFile.errorString());
+
+        return false;
+    }
+
+    qint64 indexSize = m_indexFile.size();
+    qint64 fanoutOffset;
+
+    // Version 1 has no header and starts with the fanout table right away
+    if (indexSize >= 8 && memcmp(m_indexData, "\377tOc", 4) == 0) {
+        m_indexVersion = qFromBigEndian<quint32>(m_indexData + 4);
+        fanoutOffset = 8;
+    } else {
+        m_indexVersion = 1;
+        fanoutOffset = 0;
+    }
+
+    if (m_indexVersion != 1 && m_indexVersion != 2) {
+        *error = QString("\"%1\" has unsupported version %2").arg(m_indexFile.fileName()).arg(m_indexVersion);
+
+        return false;
+    }
+
+    if (indexSize < fanoutOffset + 256 * 4 || m_packFile.size() < 12 + GitRepository::IdSize ||
+        memcmp(m_packData, "PACK", 4) != 0) {
+        *error = QString("\"%1\" is malformed").arg(m_packFile.fileName());
+
+        return false;
+    }
+
+    // find() searches the entries between two adjacent fanout entries, so they have to be non-decreasing. The last one
+    // is the object count, which bounds all others then
+    quint32 objectCount = 0;
+
+    for (int i = 0; i < 256; ++i) {
+        quint32 count = qFromBigEndian<quint32>(m_indexData + fanoutOffset + i * 4);
+
+        if (count < objectCount || count > INT_MAX) {
+            *error = QString("\"%1\" is malformed").arg(m_indexFile.fileName());
+
+            return false;
+        }
+
+        objectCount = count;
+    }
+
+    m_objectCount = objectCount;
+
+    qint64 entriesSize = m_indexVersion == 1 ? qint64(m_objectCount) * 24 : qint64(m_objectCount) * 28;
+
+    if (indexSize < fanoutOffset + 256 * 4 + entriesSize + 2 * GitRepository::IdSize) {
+        *error = QString("\"%1\" is truncated").arg(m_indexFile.fileName());
+
+        return false;
+    }
+
+    // Version 2 stores offsets that don't fit into 31 bits in a table of 8 byte entries between the 4 byte offsets and
+    // the trailing checksums
+    qint64 largeOffsetCount = (indexSize - fanoutOffset - 256 * 4 - entriesSize - 2 * GitRepository::IdSize) / 8;
+
+    // Sorted offsets bound the compressed data of each object
+    const uchar *offsets = m_indexData + fanoutOffset + 256 * 4;
+    const uchar *largeOffsets = offsets + qint64(m_objectCount) * 28;
+
+    if (m_indexVersion == 2) {
+        offsets += qint64(m_objectCount) * 24;
+    }
+
+    m_sortedOffsets.reserve(m_objectCount);
+
+    for (int i = 0; i < m_objectCount; ++i) {
+        qint64 offset;
+
+        if (m_indexVersion == 1) {
+            offset = qFromBigEndian<quint32>(offsets + qint64(i) * 24);
+        } else {
+            offset = qFromBigEndian<quint32>(offsets + qint64(i) * 4);
+
+            if ((offset & 0x80000000) != 0) {
+                // find() reads large offsets without checking, so every index has to be in bounds here
+                if ((offset & 0x7fffffff) >= largeOffsetCount) {
+                    *error = QString("\"%1\" is malformed").arg(m_indexFile.fileName());
+
+                    return false;
+                }
+
+                offset = qFromBigEndian<quint64>(largeOffsets + (offset & 0x7fffffff) * 8);
+            }
+        }
+
+        m_sortedOffsets.append(offset);
+    }
+
+    std::sort(m_sortedOffsets.begin(), m_sortedOffsets.end());
+
+    return true;
+}
+
+qint64 GitPack::find(const QByteArray &id) const
+{
+    Q_ASSERT(id.size() == GitRepository::IdSize);
+
+    qint64 fanoutOffset = m_indexVersion == 1 ? 0 : 8;
+    int firstByte = uchar(id.at(0));
+    int low = firstByte == 0 ? 0 : qFromBigEndian<quint32>(m_indexData + fanoutOffset + (firstByte - 1) * 4);
+    int high = qFromBigEndian<quint32>(m_indexData + fanoutOffset + firstByte * 4);
+    const uchar *entries = m_indexData + fanoutOffset + 256 * 4;
+    int stride = m_indexVersion == 1 ? 24 : GitRepository::IdSize;
+    int idOffset = m_indexVersion == 1 ? 4 : 0;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        int result = memcmp(entries + qint64(middle) * stride + idOffset, id.constData(), GitRepository::IdSize);
+
+        if (result < 0) {
+            low = middle + 1;
+        } else if (result > 0) {
+            high = middle;
+        } else if (m_indexVersion == 1) {
+            return qFromBigEndian<quint32>(entries + qint64(middle) * stride);
+        } else {
+            const uchar *offsets = entries + qint64(m_objectCount) * 24;
+            qint64 offset = qFromBigEndian<quint32>(offsets + qint64(middle) * 4);
+
+            if ((offset & 0x80000000) != 0) {
+                const uchar *largeOffsets = entries + qint64(m_objectCount) * 28;
+
+                offset = qFromBigEndian<quint64>(largeOffsets + (offset & 0x7fffffff) * 8);
+            }
+
+            return offset;
+        }
+    }
+
+    return -1;
+}
+
+qint64 GitPack::endOfObject(qint64 offset) const
+{
+    QVector<qint64>::const_iterator next = std::upper_bound(m_sortedOffsets.constBegin(), m_sortedOffsets.constEnd(),
+                                                            offset);
+
+    // The pack ends with the checksum of its contents
+    return next != m_sortedOffsets.constEnd() ? *next : packSize() - GitRepository::IdSize;
+}
+
+QMutex GitRepository::s_repositoriesMutex;
+QHash<QString, QSharedPointer<GitRepository> > GitRepository::s_repositories;
+
+GitRepository::~GitRepository()
+{
+    qDeleteAll(m_packs);
+}
+
+// static
+QSharedPointer<GitRepository> GitRepository::forPath(const QString &path)
+{
+    QFileInfo info(path);
+    QDir directory(info.isDir() ? info.absoluteFilePath() : info.absolutePath());
+
+    forever {
+        QFileInfo dotGit(directory.filePath(".git"));
+
+        if (dotGit.exists()) {
+            QString gitDirectoryPath;
+
+            if (dotGit.isDir()) {
+                gitDirectoryPath = dotGit.absoluteFilePath();
+            } else {
+                // Linked work trees and submodules have a ".git" file that points to the actual Git directory
+                QFile file(dotGit.absoluteFilePath());
+
+                if (!file.open(QFile::ReadOnly)) {
+                    return QSharedPointer<GitRepository>();
+                }
+
+                const QByteArray &content = file.readAll().trimmed();
+
+                if (!content.startsWith("gitdir: ")) {
+                    return QSharedPointer<GitRepository>();
+                }
+
+                gitDirectoryPath = QDir::cleanPath(directory.absoluteFilePath(QString::fromUtf8(content.mid(8))));
+            }
+
+            gitDirectoryPath += "/";
+
+            QMutexLocker locker(&s_repositoriesMutex);
+            QSharedPointer<GitRepository> repository = s_repositories.value(gitDirectoryPath);
+
+            if (repository.isNull()) {
+                QString commonDirectoryPath = gitDirectoryPath;
+                QFile commonDirectoryFile(gitDirectoryPath + "commondir");
+
+                if (commonDirectoryFile.open(QFile::ReadOnly)) {
+                    const QString &relativePath = QString::fromUtf8(commonDirectoryFile.readAll().trimmed());
+
+                    commonDirectoryPath = QDir::cleanPath(QDir(gitDirectoryPath).absoluteFilePath(relativePath)) + "/";
+                }
+
+                repository = QSharedPointer<GitRepository>(new GitRepository(gitDirectoryPath, commonDirectoryPath,
+                                                                             directory.absolutePath() + "/"));
+
+                s_repositories.insert(gitDirectoryPath, repository);
+            }
+
+            return repository;
+        }
+
+        if (!directory.cdUp()) {
+            return QSharedPointer<GitRepository>();
+        }
+    }
+}
+
+// static
+QString GitRepository::formatId(const QByteArray &id)
+{
+    return QString::fromLatin1(id.toHex());
+}
+
+QString GitRepository::relativePath(const QString &path) const
+{
+    const QString &absolutePath = QDir::fromNativeSeparators(QFileInfo(path).absoluteFilePath());
+
+#ifdef Q_OS_WIN
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive;
+#else
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive;
+#endif
+
+    if (!absolutePath.startsWith(m_workTreePath, caseSensitivity)) {
+        return QString();
+    }
+
+    return absolutePath.mid(m_workTreePath.length());
+}
+
+bool GitRepository::readObject(const QByteArray &id, ObjectType *type, QByteArray *data, QString *error)
+{
+    Q_ASSERT(id.size() == IdSize);
+    Q_ASSERT(type != NULL);
+    Q_ASSERT(data != NULL);
+    Q_ASSERT(error != NULL);
+
+    QMutexLocker locker(&m_mutex);
+    const Object *cached = m_objectCache.object(id);
+
+    if (cached != NULL) {
+        *type = cached->type;
+        *data = cached->data;
+
+        return true;
+    }
+
+    bool found = false;
+
+    // Most objects of a big repository are packed, look there first. New packs might have appeared since the last
+    // time, look again once the packs are reloaded.
+    for (int attempt = 0; attempt < 2 && !found; ++attempt) {
+        if (!loadPacks(error)) {
+            return false;
+        }
+
+        foreach (GitPack *pack, m_packs) {
+            qint64 offset = pack->find(id);
+
+            if (offset >= 0) {
+                if (!readPackedObject(pack, offset, type, data, 0, error)) {
+                    return false;
+                }
+
+                found = true;
+
+                break;
+            }
+        }
+
+        if (!found && attempt == 0) {
+            if (!readLooseObject(id, type, data, &found, error)) {
+                return false;
+            }
+        }
+    }
+
+    if (!found) {
+        *error = QString("Object %1 does not exist").arg(formatId(id));
+
+        return false;
+    }
+
+    Object *object = new Object;
+
+    object->type = *type;
+    object->data = *data;
+
+    m_objectCache.insert(id, object, qMax(1, data->size()));
+
+    return true;
+}
+
+bool GitRepository::resolveReference(const QString &name, QByteArray *id, QString *error)
+{
+    Q_ASSERT(id != NULL);
+    Q_ASSERT(error != NULL);
+
+    QString current = name;
+
+    // Follow symbolic references like HEAD to a branch, but not in circles
+    for (int depth = 0; depth < 10; ++depth) {
+        // HEAD belongs to the work tree, all other references are shared between work trees
+        QFile file((current == "HEAD" ? m_gitDirectoryPath : m_commonDirectoryPath) + current);
+
+        if (file.open(QFile::ReadOnly)) {
+            const QByteArray &content = file.readAll().trimmed();
+
+            if (content.startsWith("ref: ")) {
+                current = QString::fromUtf8(content.mid(5).trimmed());
+
+                continue;
+            }
+
+            if (!parseId(content.constData(), content.size(), id)) {
+                *error = QString("Reference %1 is malformed").arg(current);
+
+                return false;
+            }
+
+            return true;
+        }
+
+        QFile packedFile(m_commonDirectoryPath + "packed-refs");
+
+        if (packedFile.open(QFile::ReadOnly)) {
+            const QByteArray &currentUtf8 = current.toUtf8();
+
+            while (!packedFile.atEnd()) {
+                const QByteArray &line = packedFile.readLine().trimmed();
+
+                // Skip comments and the targets of annotated tags
+                if (line.startsWith('#') || line.startsWith('^') || line.size() <= 2 * IdSize + 1) {
+                    continue;
+                }
+
+                if (line.mid(2 * IdSize + 1) == currentUtf8) {
+                    if (!parseId(line.constData(), line.size(), id)) {
+                        *error = QString("Reference %1 is malformed").arg(current);
+
+                        return false;
+                    }
+
+                    return true;
+                }
+            }
+        }
+
+        id->clear(); // For example the branch of a repository without commits
+
+        return true;
+    }
+
+    *error = QString("Reference %1 is nested too deeply").arg(name);
+
+    return false;
+}
+
+bool GitRepository::findHeadBlob(const QString &relativePath, QByteArray *id, QString *error)
+{
+    Q_ASSERT(id != NULL);
+    Q_ASSERT(error != NULL);
+
+    QByteArray commitId;
+
+    if (!resolveReference("HEAD", &commitId, error)) {
+        return false;
+    }
+
+    id->clear();
+
+    if (commitId.isEmpty()) {
+        return true;
+    }
+
+    ObjectType type;
+    QByteArray data;
+
+    if (!readObject(commitId, &type, &data, error)) {
+        return false;
+    }
+
+    QByteArray treeId;
+
+    if (type != CommitObject || !data.startsWith("tree ") ||
+        !parseId(data.constData() + 5, data.size() - 5, &treeId)) {
+        *error = QString("Commit %1 is malformed").arg(formatId(commitId));
+
+        return false;
+    }
+
+    const QStringList &components = relativePath.split('/');
+
+    for (int i = 0; i < components.size(); ++i) {
+        if (!readObject(treeId, &type, &data, error)) {
+            return false;
+        }
+
+        if (type != TreeObject) {
+            *error = QString("Object %1 is not a tree").arg(formatId(treeId));
+
+            return false;
+        }
+
+        // Each tree entry is "<octal mode> <name>\0<binary ID>"
+        const QByteArray &component = components.at(i).toUtf8();
+        const char *entry = data.constData();
+        const char *end = entry + data.size();
+        bool found = false;
+
+        while (entry < end && !found) {
+            const char *space = (const char *)memchr(entry, ' ', end - entry);
+            const char *name = space != NULL ? space + 1 : end;
+            const char *terminator = name < end ? (const char *)memchr(name, '\0', end - name) : NULL;
+
+            if (terminator == NULL || terminator + 1 + IdSize > end) {
+                *error = QString("Tree %1 is malformed").arg(formatId(treeId));
+
+                return false;
+            }
+
+            if (compareBytes(name, terminator - name, component.constData(), component.size()) == 0) {
+                bool isTree = space - entry == 5 && memcmp(entry, "40000", 5) == 0;
+                bool isLast = i == components.size() - 1;
+
+                // Submodules and directories cannot be diffed, neither can a path through a file
+                if (isTree == isLast || (isLast && memcmp(entry, "160000", 6) == 0)) {
+                    return true;
+                }
+
+                treeId = QByteArray(terminator + 1, IdSize);
+                found = true;
+            }
+
+            entry = terminator + 1 + IdSize;
+        }
+
+        if (!found) {
+            return true;
+        }
+    }
+
+    *id = treeId;
+
+    return true;
+}
+
+bool GitRepository::findIndexEntry(const QString &relativePath, IndexEntry *entry, QDateTime *indexModificationTime,
+                                   QString *error)
+{
+    Q_ASSERT(entry != NULL);
+    Q_ASSERT(indexModificationTime != NULL);
+    Q_ASSERT(error != NULL);
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!loadIndex(error)) {
+        return false;
+    }
+
+    const QByteArray &path = relativePath.toUtf8();
+    int low = 0;
+    int high = m_indexEntryOffsets.size();
+
+    entry->id.clear();
+    *indexModificationTime = m_indexModificationTime;
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        int offset = m_indexPathOffsets.at(middle);
+        int result = compareBytes(m_indexPaths.constData() + offset, m_indexPathOffsets.at(middle + 1) - offset,
+                                  path.constData(), path.size());
+
+        if (result < 0) {
+            low = middle + 1;
+        } else if (result > 0) {
+            high = middle;
+        } else {
+            const uchar *data = (const uchar *)m_indexData.constData() + m_indexEntryOffsets.at(middle);
+
+            entry->modificationTime = qFromBigEndian<quint32>(data + 8);
+            entry->mode = qFromBigEndian<quint32>(data + 24);
+            entry->size = qFromBigEndian<quint32>(data + 36);
+            entry->id = QByteArray((const char *)data + 40, IdSize);
+
+            break;
+        }
+    }
+
+    return true;
+}
+
+// private
+GitRepository::GitRepository(const QString &gitDirectoryPath, const QString &commonDirectoryPath,
+                             const QString &workTreePath) :
+    m_mutex(QMutex::Recursive), // Delta bases are read while reading an object
+    m_gitDirectoryPath(gitDirectoryPath),
+    m_commonDirectoryPath(commonDirectoryPath),
+    m_workTreePath(workTreePath),
+    m_objectCache(MaximumCacheSize),
+    m_packObjectCache(MaximumCacheSize),
+    m_indexSize(-1)
+{
+}
+
+// private
+bool GitRepository::readLooseObject(const QByteArray &id, ObjectType *type, QByteArray *data, bool *found,
+                                    QString *error)
+{
+    const QString &hex = formatId(id);
+    QFile file(m_commonDirectoryPath + "objects/" + hex.left(2) + "/" + hex.mid(2));
+
+    *found = false;
+
+    if (!file.exists()) {
+        return true;
+    }
+
+    if (!file.open(QFile::ReadOnly)) {
+        *error = QString("Could not open \"%1\": %2").arg(file.fileName(), file.errorString());
+
+        return false;
+    }
+
+    // The inflated size is not known up front, qUncompress() grows its buffer as needed
+    const QByteArray &compressed = file.readAll();
+    QByteArray input(4, '\0');
+
+    qToBigEndian<quint32>(quint32(qMin<qint64>(compressed.size() * 4LL, 64 * 1024 * 1024)), (uchar *)input.data());
+    input += compressed;
+
+    const QByteArray &object = qUncompress(input);
+    int space = object.indexOf(' ');
+    int terminator = object.indexOf('\0');
+
+    if (space < 0 || terminator < space) {
+        *error = QString("Object %1 is malformed").arg(hex);
+
+        return false;
+    }
+
+    const QByteArray &typeName = object.left(space);
+
+    if (typeName == "commit") {
+        *type = CommitObject;
+    } else if (typeName == "tree") {
+        *type = TreeObject;
+    } else if (typeName == "blob") {
+        *type = BlobObject;
+    } else if (typeName == "tag") {
+        *type = TagObject;
+    } else {
+        *error = QString("Object %1 has unknown type").arg(hex);
+
+        return false;
+    }
+
+    *data = object.mid(terminator + 1);
+    *found = true;
+
+    return true;
+}
+
+// private
+bool GitRepository::readPackedObject(GitPack *pack, qint64 offset, ObjectType *type, QByteArray *data, int depth,
+                                     QString *error)
+{
+    const QPair<GitPack *, qint64> key(pack, offset);
+    const Object *cached = m_packObjectCache.object(key);
+
+    if (cached != NULL) {
+        *type = cached->type;
+        *data = cached->data;
+
+        return true;
+    }
+
+    if (offset < 12 || offset >= pack->packSize() - IdSize || depth > MaximumDeltaDepth) {
+        *error = QString("Object at offset %1 in \"%2\" is malformed").arg(offset).arg(pack->packPath());
+
+        return false;
+    }
+
+    const uchar *p = pack->packData() + offset;
+    const uchar *end = pack->packData() + pack->endOfObject(offset);
+
+    // Header with the type and the inflated size in a variable length encoding
+    uchar c = *p++;
+    int packType = (c >> 4) & 7;
+    qint64 size = c & 15;
+    int shift = 4;
+
+    while ((c & 0x80) != 0 && p < end && shift < 57) {
+        c = *p++;
+        size |= qint64(c & 0x7f) << shift;
+        shift += 7;
+    }
+
+    bool success = false;
+
+    if (packType >= CommitObject && packType <= TagObject) {
+        *type = ObjectType(packType);
+        success = inflate(p, end - p, size, data);
+    } else if (packType == 6 || packType == 7) {
+        // Delta against a base object that is given by its offset in this pack or by its ID
+        ObjectType baseType;
+        QByteArray base;
+        bool haveBase = false;
+
+        if (packType == 6) {
+            qint64 baseDistance = 0;
+
+            if (p < end) {
+                c = *p++;
+                baseDistance = c & 0x7f;
+
+                while ((c & 0x80) != 0 && p < end) {
+                    c = *p++;
+                    baseDistance = ((baseDistance + 1) << 7) | (c & 0x7f);
+                }
+            }
+
+            if (baseDistance <= 0 || baseDistance > offset) {
+                *error = QString("Object at offset %1 in \"%2\" is malformed").arg(offset).arg(pack->packPath());
+
+                return false;
+            }
+
+            haveBase = readPackedObject(pack, offset - baseDistance, &baseType, &base, depth + 1, error);
+        } else {
+            if (p + IdSize > end) {
+                *error = QString("Object at offset %1 in \"%2\" is malformed").arg(offset).arg(pack->packPath());
+
+                return false;
+            }
+
+            const QByteArray baseId((const char *)p, IdSize);
+            bool packed = false;
+
+            p += IdSize;
+
+            // Don't go through readObject(), it might reload the packs while this one is in use
+            foreach (GitPack *basePack, m_packs) {
+                qint64 baseOffset = basePack->find(baseId);
+
+                if (baseOffset >= 0) {
+                    packed = true;
+                    haveBase = readPackedObject(basePack, baseOffset, &baseType, &base, depth + 1, error);
+
+                    break;
+                }
+            }
+
+            if (!packed) {
+                if (!readLooseObject(baseId, &baseType, &base, &haveBase, error)) {
+                    return false;
+                }
+
+                if (!haveBase) {
+                    *error = QString("Object %1 does not exist").arg(formatId(baseId));
+                }
+            }
+        }
+
+        if (!haveBase) {
+            return false;
+        }
+
+        QByteArray delta;
+
+        *type = baseType;
+        success = inflate(p, end - p, size, &delta) && applyDelta(base, delta, data);
+    }
+
+    if (!success) {
+        *error = QString("Object at offset %1 in \"%2\" is malformed").arg(offset).arg(pack->packPath());
+
+        return false;
+    }
+
+    Object *object = new Object;
+
+    object->type = *type;
+    object->data = *data;
+
+    m_packObjectCache.insert(key, object, qMax(1, data->size()));
+
+    return true;
+}
+
+// private
+bool GitRepository::loadPacks(QString *error)
+{
+    const QString &packDirectoryPath = m_commonDirectoryPath + "objects/pack";
+    const QDateTime &modificationTime = QFileInfo(packDirectoryPath).lastModified();
+
+    if (modificationTime.isValid() && modificationTime == m_packDirectoryModificationTime) {
+        return true;
+    }
+
+    m_packObjectCache.clear();
+    qDeleteAll(m_packs);
+    m_packs.clear();
+
+    m_packDirectoryModificationTime = modificationTime;
+
+    foreach (const QString &indexName, QDir(packDirectoryPath).entryList(QStringList() << "*.idx", QDir::Files)) {
+        const QString &basePath = packDirectoryPath + "/" + indexName.left(indexName.length() - 4);
+        GitPack *pack = new GitPack(basePath + ".idx", basePath + ".pack");
+
+        if (!pack->open(error)) {
+            delete pack;
+
+            return false;
+        }
+
+        m_packs.append(pack);
+    }
+
+    return true;
+}
+
+// private
+bool GitRepository::loadIndex(QString *error)
+{
+    QFile file(m_gitDirectoryPath + "index");
+    const QFileInfo info(file);
+
+    if (!info.exists()) {
+        clearIndex(); // A repository without an index yet
+
+        return true;
+    }
+
+    if (info.lastModified() == m_indexModificationTime && info.size() == m_indexSize) {
+        return true;
+    }
+
+    clearIndex();
+
+    if (!file.open(QFile::ReadOnly)) {
+        *error = QString("Could not open \"%1\": %2").arg(file.fileName(), file.errorString());
+
+        return false;
+    }
+
+    m_indexData = file.readAll();
+
+    // The cache keys are only set for a complete index, a failed parse is tried again on the next lookup instead of
+    // serving a partial index until the file changes
+    if (!parseIndex(file.fileName(), error)) {
+        clearIndex();
+
+        return false;
+    }
+
+    m_indexModificationTime = info.lastModified();
+    m_indexSize = info.size();
+
+    return true;
+}
+
+// private
+bool GitRepository::parseIndex(const QString &fileName, QString *error)
+{
+    const uchar *data = (const uchar *)m_indexData.constData();
+    const uchar *end = data + m_indexData.size();
+
+    if (m_indexData.size() < 12 || memcmp(data, "DIRC", 4) != 0) {
+        *error = QString("\"%1\" is malformed").arg(fileName);
+
+        return false;
+    }
+
+    quint32 version = qFromBigEndian<quint32>(data + 4);
+    quint32 count = qFromBigEndian<quint32>(data + 8);
+
+    if (version < 2 || version > 4) {
+        *error = QString("\"%1\" has unsupported version %2").arg(fileName).arg(version);
+
+        return false;
+    }
+
+    const uchar *entry = data + 12;
+    QByteArray path; // Version 4 stores each path relative to the previous one
+
+    for (quint32 i = 0; i < count; ++i) {
+        if (entry + 62 > end) {
+            *error = QString("\"%1\" is truncated").arg(fileName);
+
+            return false;
+        }
+
+        quint16 flags = qFromBigEndian<quint16>(entry + 60);
+        const uchar *name = entry + ((version >= 3 && (flags & 0x4000) != 0) ? 64 : 62);
+        int stage = (flags >> 12) & 3;
+
+        if (version == 4) {
+            // Number of bytes to strip from the previous path in Git's offset varint encoding, then the rest of the
+            // path terminated by NUL
+            quint64 strip = 0;
+            uchar c;
+
+            do {
+                if (name >= end) {
+                    *error = QString("\"%1\" is truncated").arg(fileName);
+
+                    return false;
+                }
+
+                c = *name++;
+                strip = (strip << 7) | (c & 0x7f);
+
+                if ((c & 0x80) != 0) {
+                    ++strip;
+                }
+            } while ((c & 0x80) != 0);
+
+            if (strip > quint64(path.size())) {
+                *error = QString("\"%1\" is malformed").arg(fileName);
+
+                return false;
+            }
+
+            path.chop(int(strip));
+        } else {
+            path.clear();
+        }
+
+        const uchar *terminator = name < end ? (const uchar *)memchr(name, '\0', end - name) : NULL;
+
+        if (terminator == NULL) {
+            *error = QString("\"%1\" is truncated").arg(fileName);
+
+            return false;
+        }
+
+        path.append((const char *)name, terminator - name);
+
+        if (stage == 0) {
+            m_indexPaths += path;
+            m_indexPathOffsets.append(m_indexPaths.size());
+            m_indexEntryOffsets.append(entry - data);
+        }
+
+        if (version == 4) {
+            entry = terminator + 1;
+        } else {
+            // Entries are padded with 1 to 8 NULs to a multiple of 8 bytes
+            int length = terminator - entry;
+
+            entry += (length + 8) & ~7;
+        }
+    }
+
+    return true;
+}
+
+// private
+void GitRepository::clearIndex()
+{
+    m_indexData.clear();
+    m_indexPaths.clear();
+    m_indexPathOffsets = QVector<int>() << 0;
+    m_indexEntryOffsets.clear();
+    m_indexModificationTime = QDateTime();
+    m_indexSize = -1;
+}
+
+// private static
+bool GitRepository::inflate(const uchar *input, qint64 length, qint64 size, QByteArray *output)
+{
+    if (length <= 0 || length > 0x7fffffff - 4 || size < 0 || size > 0x3fffffff) {
+        return false;
+    }
+
+    // qUncompress() expects the inflated size up front. Data after the end of the zlib stream is ignored.
+    QByteArray compressed;
+
+    compressed.reserve(int(length) + 4);
+    compressed.resize(4);
+    qToBigEndian<quint32>(quint32(size), (uchar *)compressed.data());
+    compressed.append((const char *)input, int(length));
+
+    *output = qUncompress(compressed);
+
+    return output->size() == size;
+}
+
+// private static
+bool GitRepository::applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray *output)
+{
+    const uchar *p = (const uchar *)delta.constData();
+    const uchar *end = p + delta.size();
+    qint64 sizes[2] = { 0, 0 }; // Base and result size as little endian base 128 numbers
+
+    for (int i = 0; i < 2; ++i) {
+        int shift = 0;
+        uchar c;
+
+        do {
+            if (p >= end || shift > 56) {
+                return false;
+            }
+
+            c = *p++;
+            sizes[i] |= qint64(c & 0x7f) << shift;
+            shift += 7;
+        } while ((c & 0x80) != 0);
+    }
+
+    if (sizes[0] != base.size() || sizes[1] > 0x3fffffff) {
+        return false;
+    }
+
+    output->resize(int(sizes[1]));
+
+    char *out = output->data();
+    char *outEnd = out + output->size();
+
+    while (p < end) {
+        uchar c = *p++;
+
+        if ((c & 0x80) != 0) {
+            // Copy from the base, the bits tell which bytes of offset and length follow
+            qint64 copyOffset = 0;
+            qint64 copyLength = 0;
+
+            for (int i = 0; i < 4; ++i) {
+                if ((c & (1 << i)) != 0) {
+                    if (p >= end) {
+                        return false;
+                    }
+
+                    copyOffset |= qint64(*p++) << (8 * i);
+                }
+            }
+
+            for (int i = 0; i < 3; ++i) {
+                if ((c & (0x10 << i)) != 0) {
+                    if (p >= end) {
+                        return false;
+                    }
+
+                    copyLength |= qint64(*p++) << (8 * i);
+                }
+            }
+
+            if (copyLength == 0) {
+                copyLength = 0x10000;
+            }
+
+            if (copyOffset + copyLength > base.size() || copyLength > outEnd - out) {
+                return false;
+            }
+
+            memcpy(out, base.constData() + copyOffset, copyLength);
+            out += copyLength;
+        } else if (c != 0) {
+            // Insert the next bytes of the delta
+            if (c > end - p || c > outEnd - out) {
+                return false;
+            }
+
+            memcpy(out, p, c);
+            out += c;
+            p += c;
+        } else {
+            return false;
+        }
+    }
+
+    return out == outEnd;
+}
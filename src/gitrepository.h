@@ -0,0 +1,157 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GITREPOSITORY_H
+#define GITREPOSITORY_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+// Read-only access to one packfile through its .idx file. Both files are memory mapped.
+class GitPack
+{
+    Q_DISABLE_COPY(GitPack)
+
+public:
+    GitPack(const QString &indexPath, const QString &packPath);
+
+    bool open(QString *error);
+
+    // Returns -1 if the object is not in this pack
+    qint64 find(const QByteArray &id) const;
+
+    // End of the object data that starts at the given offset, used to bound the compressed data
+    qint64 endOfObject(qint64 offset) const;
+
+    const uchar *packData() const { return m_packData; }
+    qint64 packSize() const { return m_packFile.size(); }
+    QString packPath() const { return m_packFile.fileName(); }
+
+private:
+    QFile m_indexFile;
+    QFile m_packFile;
+    const uchar *m_indexData;
+    const uchar *m_packData;
+    int m_indexVersion; // 1 or 2
+    int m_objectCount;
+    QVector<qint64> m_sortedOffsets;
+};
+
+// Reads objects, references and the index of a Git repository straight from its .git directory, without running git.
+// Loose objects and packfiles are supported, including delta compressed objects. Inflated objects are kept in a cache
+// limited by size. Thread-safe.
+class GitRepository
+{
+    Q_DISABLE_COPY(GitRepository)
+
+public:
+    enum ObjectType {
+        InvalidObject = 0,
+        CommitObject = 1,
+        TreeObject = 2,
+        BlobObject = 3,
+        TagObject = 4
+    };
+
+    enum {
+        IdSize = 20, // SHA-1
+        MaximumCacheSize = 32 * 1024 * 1024, // bytes
+        MaximumDeltaDepth = 128
+    };
+
+    struct IndexEntry {
+        QByteArray id;
+        quint32 modificationTime; // seconds since epoch
+        quint32 size; // truncated to 32 bits, like Git does
+        quint32 mode;
+    };
+
+    ~GitRepository();
+
+    // Returns the repository that contains the given path in its work tree, NULL if there is none. Repositories are
+    // shared and kept open for the lifetime of the application.
+    static QSharedPointer<GitRepository> forPath(const QString &path);
+
+    static QString formatId(const QByteArray &id);
+
+    QString workTreePath() const { return m_workTreePath; } // with trailing separator
+    QString relativePath(const QString &path) const; // separated by "/", empty if not inside the work tree
+
+    bool readObject(const QByteArray &id, ObjectType *type, QByteArray *data, QString *error);
+    bool resolveReference(const QString &name, QByteArray *id, QString *error);
+
+    // Finds the blob of a path in the tree of the commit that HEAD points to. The ID is empty if there is no such blob.
+    bool findHeadBlob(const QString &relativePath, QByteArray *id, QString *error);
+
+    // Finds the stage 0 entry of a path in the index. The ID of the entry is empty if there is no such entry. The
+    // modification time of the index is returned as well, entries that are not older than it cannot be trusted.
+    bool findIndexEntry(const QString &relativePath, IndexEntry *entry, QDateTime *indexModificationTime,
+                        QString *error);
+
+private:
+    struct Object {
+        ObjectType type;
+        QByteArray data;
+    };
+
+    GitRepository(const QString &gitDirectoryPath, const QString &commonDirectoryPath, const QString &workTreePath);
+
+    bool readLooseObject(const QByteArray &id, ObjectType *type, QByteArray *data, bool *found, QString *error);
+    bool readPackedObject(GitPack *pack, qint64 offset, ObjectType *type, QByteArray *data, int depth,
+                          QString *error);
+    bool loadPacks(QString *error);
+    bool loadIndex(QString *error);
+    bool parseIndex(const QString &fileName, QString *error);
+    void clearIndex();
+
+    static bool inflate(const uchar *input, qint64 length, qint64 size, QByteArray *output);
+    static bool applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray *output);
+
+    mutable QMutex m_mutex;
+    QString m_gitDirectoryPath; // with trailing slash
+    QString m_commonDirectoryPath; // with trailing slash, differs from the Git directory for linked work trees
+    QString m_workTreePath;
+
+    QList<GitPack *> m_packs; // owned by this
+    QDateTime m_packDirectoryModificationTime;
+    QCache<QByteArray, Object> m_objectCache; // by ID
+    QCache<QPair<GitPack *, qint64>, Object> m_packObjectCache; // by offset, for delta bases
+
+    // The index is kept as read, only the paths of its stage 0 entries are expanded for the binary search
+    QByteArray m_indexData;
+    QByteArray m_indexPaths; // back-to-back
+    QVector<int> m_indexPathOffsets; // start of each path in m_indexPaths, plus the end of the last path
+    QVector<int> m_indexEntryOffsets; // start of each entry in m_indexData
+    QDateTime m_indexModificationTime;
+    qint64 m_indexSize;
+
+    static QMutex s_repositoriesMutex;
+    static QHash<QString, QSharedPointer<GitRepository> > s_repositories; // by Git directory
+};
+
+#endif // GITREPOSITORY_H
@@ -0,0 +1,132 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "latencydialog.h"
+
+#include "filedialog.h"
+#include "latencytracer.h"
+#include "location.h"
+#include "monospacefontmetrics.h"
+
+#include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTimerEvent>
+#include <QVBoxLayout>
+
+LatencyDialog::LatencyDialog(QWidget *parent) :
+    QDialog(parent),
+    m_checkRecording(new QCheckBox("Record typing latency", this)),
+    m_editReport(new QPlainTextEdit(this))
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton *buttonReset = buttonBox->addButton("Reset", QDialogButtonBox::ResetRole);
+    QPushButton *buttonExport = buttonBox->addButton("Export...", QDialogButtonBox::ActionRole);
+
+    layout->addWidget(m_checkRecording);
+    layout->addWidget(m_editReport);
+    layout->addWidget(buttonBox);
+
+    m_checkRecording->setChecked(LatencyTracer::isEnabled());
+
+    m_editReport->setReadOnly(true);
+    m_editReport->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_editReport->setFont(MonospaceFontMetrics::font());
+
+    connect(m_checkRecording, &QCheckBox::toggled, this, &LatencyDialog::setRecording);
+    connect(buttonReset, &QPushButton::clicked, this, &LatencyDialog::reset);
+    connect(buttonExport, &QPushButton::clicked, this, &LatencyDialog::exportHistograms);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::hide);
+
+    setWindowTitle("Typing Latency");
+    resize(700, 600);
+}
+
+// protected
+void LatencyDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+
+    updateReport();
+
+    m_updateTimer.start(UpdateInterval, this);
+}
+
+// protected
+void LatencyDialog::hideEvent(QHideEvent *event)
+{
+    m_updateTimer.stop();
+
+    QDialog::hideEvent(event);
+}
+
+// protected
+void LatencyDialog::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_updateTimer.timerId()) {
+        updateReport();
+    } else {
+        QDialog::timerEvent(event);
+    }
+}
+
+// private slot
+void LatencyDialog::setRecording(bool enable)
+{
+    LatencyTracer::setEnabled(enable);
+}
+
+// private slot
+void LatencyDialog::reset()
+{
+    LatencyTracer::reset();
+
+    updateReport();
+}
+
+// private slot
+void LatencyDialog::exportHistograms()
+{
+    const Location &location = FileDialog::getSaveLocation(this, Location::home().file("typing-latency.csv"));
+    QString error;
+
+    if (!location.isEmpty() && !LatencyTracer::exportHistograms(location.path(), &error)) {
+        QMessageBox::critical(this, "Export Error", error);
+    }
+}
+
+// private
+void LatencyDialog::updateReport()
+{
+    const QString &report = LatencyTracer::report();
+
+    if (report == m_editReport->toPlainText()) {
+        return;
+    }
+
+    // Keep the scroll position while the report is updated
+    int value = m_editReport->verticalScrollBar()->value();
+
+    m_editReport->setPlainText(report);
+    m_editReport->verticalScrollBar()->setValue(value);
+}
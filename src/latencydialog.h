@@ -0,0 +1,60 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef LATENCYDIALOG_H
+#define LATENCYDIALOG_H
+
+#include <QBasicTimer>
+#include <QDialog>
+
+class QCheckBox;
+class QPlainTextEdit;
+
+// Debug panel showing the typing latency histograms of the LatencyTracer while they are recorded
+class LatencyDialog : public QDialog
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(LatencyDialog)
+
+public:
+    explicit LatencyDialog(QWidget *parent = NULL);
+
+protected:
+    void showEvent(QShowEvent *event);
+    void hideEvent(QHideEvent *event);
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void setRecording(bool enable);
+    void reset();
+    void exportHistograms();
+
+private:
+    enum {
+        UpdateInterval = 500 // milliseconds
+    };
+
+    void updateReport();
+
+    QCheckBox *m_checkRecording;
+    QPlainTextEdit *m_editReport;
+    QBasicTimer m_updateTimer;
+};
+
+#endif // LATENCYDIALOG_H
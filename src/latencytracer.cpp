@@ -0,0 +1,320 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "latencytracer.h"
+
+#include "settings.h"
+
+#include <QFile>
+#include <QTimer>
+
+static const qint64 s_bucketUpperBounds[LatencyHistogram::BucketCount - 1] = { // microseconds
+    1000, 2000, 4000, 8000, 16000, 33000, 50000, 100000, 250000, 500000
+};
+
+LatencyTracer *LatencyTracer::s_instance = NULL;
+bool LatencyTracer::s_enabled = false;
+
+LatencyHistogram::LatencyHistogram() :
+    m_bucketCounts(BucketCount, 0),
+    m_count(0),
+    m_sum(0),
+    m_maximum(0)
+{
+}
+
+void LatencyHistogram::add(qint64 latency)
+{
+    int bucket = 0;
+
+    while (bucket < BucketCount - 1 && latency >= s_bucketUpperBounds[bucket]) {
+        ++bucket;
+    }
+
+    ++m_bucketCounts[bucket];
+    ++m_count;
+
+    m_sum += latency;
+    m_maximum = qMax(m_maximum, latency);
+}
+
+void LatencyHistogram::clear()
+{
+    m_bucketCounts.fill(0);
+
+    m_count = 0;
+    m_sum = 0;
+    m_maximum = 0;
+}
+
+int LatencyHistogram::countAbove(qint64 latency) const
+{
+    int count = 0;
+
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        if (bucketLowerBound(bucket) >= latency) {
+            count += m_bucketCounts.at(bucket);
+        }
+    }
+
+    return count;
+}
+
+// static
+qint64 LatencyHistogram::bucketLowerBound(int bucket)
+{
+    return bucket > 0 ? s_bucketUpperBounds[bucket - 1] : 0;
+}
+
+// static
+qint64 LatencyHistogram::bucketUpperBound(int bucket)
+{
+    return bucket < BucketCount - 1 ? s_bucketUpperBounds[bucket] : -1;
+}
+
+LatencyTracer::LatencyTracer(QObject *parent) :
+    QObject(parent),
+    m_keyStart(-1),
+    m_documentChanged(false),
+    m_highlighting(0),
+    m_painting(0),
+    m_paintEnd(0),
+    m_paintFinishScheduled(false)
+{
+    s_instance = this;
+    s_enabled = Settings::settings()->value("LatencyTracer/Enabled", false).toBool() ||
+                !qgetenv("ZERO_EDITOR_LATENCY_TRACE").isEmpty();
+
+    m_timer.start();
+}
+
+LatencyTracer::~LatencyTracer()
+{
+    s_enabled = false;
+    s_instance = NULL;
+}
+
+// static
+void LatencyTracer::setEnabled(bool enabled)
+{
+    s_enabled = enabled;
+
+    // Don't let keys from before a pause be finished by the first paint after it
+    s_instance->m_keyStart = -1;
+    s_instance->m_unpaintedKeys.clear();
+    s_instance->m_highlighting = 0;
+    s_instance->m_painting = 0;
+}
+
+// static
+QString LatencyTracer::stageName(Stage stage)
+{
+    switch (stage) {
+    case KeyToPaint:
+        return "Key to paint";
+
+    case KeyHandling:
+        return "Key handling";
+
+    case DocumentChange:
+        return "Key to contentsChange";
+
+    case Highlighting:
+        return "Highlighting";
+
+    case Painting:
+        return "Painting";
+
+    case StageCount:
+        break;
+    }
+
+    Q_ASSERT(false);
+
+    return QString();
+}
+
+// static
+void LatencyTracer::reset()
+{
+    for (int stage = 0; stage < StageCount; ++stage) {
+        s_instance->m_histograms[stage].clear();
+    }
+}
+
+// static
+QString LatencyTracer::report()
+{
+    QString report;
+
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const LatencyHistogram &histogram = s_instance->m_histograms[stage];
+        int maximumCount = 0;
+
+        for (int bucket = 0; bucket < LatencyHistogram::BucketCount; ++bucket) {
+            maximumCount = qMax(maximumCount, histogram.bucketCount(bucket));
+        }
+
+        report += QString("%1: %2 samples, mean %3 ms, maximum %4 ms, %5 at %6 ms or more\n")
+                  .arg(stageName((Stage)stage)).arg(histogram.count())
+                  .arg(QString::number(histogram.mean() / 1000.0, 'f', 1))
+                  .arg(QString::number(histogram.maximum() / 1000.0, 'f', 1))
+                  .arg(histogram.countAbove(RegressionThreshold)).arg(RegressionThreshold / 1000);
+
+        for (int bucket = 0; bucket < LatencyHistogram::BucketCount && histogram.count() > 0; ++bucket) {
+            qint64 upperBound = LatencyHistogram::bucketUpperBound(bucket);
+            int count = histogram.bucketCount(bucket);
+            QString range = QString("%1 - %2 ms").arg(LatencyHistogram::bucketLowerBound(bucket) / 1000)
+                                                 .arg(upperBound >= 0 ? QString::number(upperBound / 1000) : "");
+
+            report += QString("  %1 %2 %3\n").arg(range, -14).arg(count, 7)
+                                             .arg(QString(maximumCount > 0 ? count * 50 / maximumCount : 0, '#'));
+        }
+
+        report += "\n";
+    }
+
+    return report;
+}
+
+// static
+bool LatencyTracer::exportHistograms(const QString &path, QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = QString("Could not open \"%1\" for writing: %2").arg(path, file.errorString());
+
+        return false;
+    }
+
+    // One row per bucket, the upper bound of the last one is empty
+    QByteArray data("stage,lower_bound_us,upper_bound_us,count\n");
+
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const LatencyHistogram &histogram = s_instance->m_histograms[stage];
+
+        for (int bucket = 0; bucket < LatencyHistogram::BucketCount; ++bucket) {
+            qint64 upperBound = LatencyHistogram::bucketUpperBound(bucket);
+
+            data += QString("%1,%2,%3,%4\n").arg(stageName((Stage)stage))
+                                            .arg(LatencyHistogram::bucketLowerBound(bucket))
+                                            .arg(upperBound >= 0 ? QString::number(upperBound) : QString())
+                                            .arg(histogram.bucketCount(bucket)).toUtf8();
+        }
+    }
+
+    if (file.write(data) < data.length()) {
+        *error = QString("Short write to \"%1\" occurred.").arg(path);
+
+        return false;
+    }
+
+    return true;
+}
+
+// static
+void LatencyTracer::beginKeyPress(qint64 start)
+{
+    s_instance->m_keyStart = start;
+    s_instance->m_documentChanged = false;
+}
+
+// static
+void LatencyTracer::endKeyPress(bool changed)
+{
+    LatencyTracer *tracer = s_instance;
+
+    if (tracer->m_keyStart < 0) {
+        return;
+    }
+
+    tracer->m_histograms[KeyHandling].add(now() - tracer->m_keyStart);
+
+    if (changed) {
+        tracer->m_unpaintedKeys.append(tracer->m_keyStart);
+    }
+
+    tracer->m_keyStart = -1;
+}
+
+// static
+void LatencyTracer::recordDocumentChange()
+{
+    LatencyTracer *tracer = s_instance;
+
+    if (tracer->m_keyStart >= 0 && !tracer->m_documentChanged) {
+        tracer->m_histograms[DocumentChange].add(now() - tracer->m_keyStart);
+
+        tracer->m_documentChanged = true;
+    }
+}
+
+// static
+void LatencyTracer::add(Stage stage, qint64 start)
+{
+    LatencyTracer *tracer = s_instance;
+
+    // Highlighting and painting that isn't caused by typing, like scrolling, isn't counted
+    if (tracer->m_keyStart < 0 && tracer->m_unpaintedKeys.isEmpty()) {
+        return;
+    }
+
+    qint64 end = now();
+
+    if (stage == Highlighting) {
+        tracer->m_highlighting += end - start;
+    } else if (stage == Painting) {
+        tracer->m_painting += end - start;
+        tracer->m_paintEnd = end;
+
+        // The text and the extra area are painted in the same pass, finish once both are done
+        if (!tracer->m_unpaintedKeys.isEmpty() && !tracer->m_paintFinishScheduled) {
+            tracer->m_paintFinishScheduled = true;
+
+            QTimer::singleShot(0, tracer, &LatencyTracer::finishPaint);
+        }
+    } else {
+        tracer->m_histograms[stage].add(end - start);
+    }
+}
+
+// private slot
+void LatencyTracer::finishPaint()
+{
+    m_paintFinishScheduled = false;
+
+    if (!s_enabled || m_unpaintedKeys.isEmpty()) {
+        return;
+    }
+
+    foreach (qint64 keyStart, m_unpaintedKeys) {
+        m_histograms[KeyToPaint].add(m_paintEnd - keyStart);
+    }
+
+    m_histograms[Highlighting].add(m_highlighting);
+    m_histograms[Painting].add(m_painting);
+
+    m_unpaintedKeys.clear();
+
+    m_highlighting = 0;
+    m_painting = 0;
+}
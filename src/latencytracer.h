@@ -0,0 +1,146 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+// Counts latencies in buckets of growing width, from below 1 ms up to 500 ms and more
+class LatencyHistogram
+{
+public:
+    enum {
+        BucketCount = 11
+    };
+
+    LatencyHistogram();
+
+    void add(qint64 latency); // microseconds
+    void clear();
+
+    int count() const { return m_count; }
+    int bucketCount(int bucket) const { return m_bucketCounts.at(bucket); }
+    int countAbove(qint64 latency) const; // of the buckets that lie completely above it, in microseconds
+    qint64 mean() const { return m_count > 0 ? m_sum / m_count : 0; }
+    qint64 maximum() const { return m_maximum; }
+
+    // In microseconds, the upper bound of the last bucket is -1
+    static qint64 bucketLowerBound(int bucket);
+    static qint64 bucketUpperBound(int bucket);
+
+private:
+    QVector<int> m_bucketCounts;
+    int m_count;
+    qint64 m_sum;
+    qint64 m_maximum;
+};
+
+// Measures the typing latency of the text editors, from a key press to the end of the paint that shows its effect.
+// The key handling, the QTextDocument::contentsChange processing, the syntax highlighting and the painting are
+// measured on their own as well. Keystrokes that are typed faster than they are painted share the same paint, each
+// of them is counted with its own latency. Recording is off by default, it can be turned on in the typing latency
+// dialog, with the LatencyTracer/Enabled setting or the ZERO_EDITOR_LATENCY_TRACE environment variable.
+class LatencyTracer : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(LatencyTracer)
+
+public:
+    enum Stage {
+        KeyToPaint,
+        KeyHandling,
+        DocumentChange, // from the key press until the contentsChange was processed
+        Highlighting, // per paint
+        Painting, // per paint, the text and the extra area
+        StageCount
+    };
+
+    explicit LatencyTracer(QObject *parent = NULL);
+    ~LatencyTracer();
+
+    static LatencyTracer *instance() { return s_instance; }
+
+    static bool isEnabled() { return s_enabled; }
+    static void setEnabled(bool enabled);
+
+    static QString stageName(Stage stage);
+    static const LatencyHistogram &histogram(Stage stage) { return s_instance->m_histograms[stage]; }
+    static void reset();
+
+    static QString report();
+    static bool exportHistograms(const QString &path, QString *error);
+
+    // Only to be called if isEnabled() is true, all times are in microseconds
+    static qint64 now() { return s_instance->m_timer.nsecsElapsed() / 1000; }
+    static void beginKeyPress(qint64 start);
+    static void endKeyPress(bool changed); // a key that changed neither the text nor the cursor isn't painted
+    static void recordDocumentChange();
+    static void add(Stage stage, qint64 start);
+
+private slots:
+    void finishPaint();
+
+private:
+    enum {
+        RegressionThreshold = 16000 // microseconds, a frame at 60 Hz
+    };
+
+    static LatencyTracer *s_instance;
+    static bool s_enabled;
+
+    QElapsedTimer m_timer;
+    qint64 m_keyStart; // of the key press being handled, -1 if none
+    bool m_documentChanged; // by the key press being handled
+    QList<qint64> m_unpaintedKeys; // start times of the keys whose effect wasn't painted yet
+    qint64 m_highlighting;
+    qint64 m_painting;
+    qint64 m_paintEnd;
+    bool m_paintFinishScheduled;
+    LatencyHistogram m_histograms[StageCount];
+};
+
+// Adds the time until its destruction to a stage, if recording is enabled
+class LatencyTimer
+{
+    Q_DISABLE_COPY(LatencyTimer)
+
+public:
+    explicit LatencyTimer(LatencyTracer::Stage stage) :
+        m_stage(stage),
+        m_start(LatencyTracer::isEnabled() ? LatencyTracer::now() : -1)
+    {
+    }
+
+    ~LatencyTimer()
+    {
+        if (m_start >= 0 && LatencyTracer::isEnabled()) {
+            LatencyTracer::add(m_stage, m_start);
+        }
+    }
+
+private:
+    LatencyTracer::Stage m_stage;
+    qint64 m_start;
+};
+
+#endif // LATENCYTRACER_H
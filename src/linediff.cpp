@@ -0,0 +1,615 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "linediff.h"
+
+#include <QMutexLocker>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThread>
+
+#include <qmath.h>
+
+int LineInterner::intern(const QString &line)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, int>::const_iterator iterator = m_ids.constFind(line);
+
+    if (iterator != m_ids.constEnd()) {
+        return iterator.value();
+    }
+
+    int id = m_lines.size();
+
+    m_ids.insert(line, id);
+    m_lines.append(line);
+
+    return id;
+}
+
+void LineInterner::internLines(const QString &text, QVector<int> *ids)
+{
+    Q_ASSERT(ids != NULL);
+
+    const QChar *characters = text.constData();
+    int length = text.length();
+    int start = 0;
+
+    for (int i = 0; i < length; ++i) {
+        ushort character = characters[i].unicode();
+
+        if (character != '\n' && character != '\r') {
+            continue;
+        }
+
+        ids->append(intern(text.mid(start, i - start)));
+
+        if (character == '\r' && i + 1 < length && characters[i + 1] == '\n') {
+            ++i;
+        }
+
+        start = i + 1;
+    }
+
+    ids->append(intern(text.mid(start)));
+}
+
+QString LineInterner::line(int id) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_lines.at(id);
+}
+
+int LineInterner::size() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_lines.size();
+}
+
+struct LineDiffRange {
+    int oldBegin;
+    int oldEnd;
+    int newBegin;
+    int newEnd;
+};
+
+class LineDiffContext
+{
+public:
+    const int *oldLines;
+    const int *newLines;
+    QVector<bool> oldChanged;
+    QVector<bool> newChanged;
+    QVector<int> forward;
+    QVector<int> backward;
+    int maximumCost;
+    QThread *thread;
+};
+
+// Finds the middle snake of the shortest edit script for the given range and returns a point on it in oldSplit and
+// newSplit. The range must not be empty on either side and must neither start nor end with a common line. If the edit
+// script is longer than twice the maximum cost then the furthest reaching point of the forward search is returned
+// instead. Returns false if the thread was interrupted.
+static bool split(LineDiffContext *context, const LineDiffRange &range, int *oldSplit, int *newSplit)
+{
+    const int *a = context->oldLines + range.oldBegin;
+    const int *b = context->newLines + range.newBegin;
+    int n = range.oldEnd - range.oldBegin;
+    int m = range.newEnd - range.newBegin;
+    int maximumD = qMin((n + m + 1) / 2, context->maximumCost);
+    int offset = maximumD + 1;
+    int length = 2 * offset + 1;
+    int delta = n - m;
+    bool front = (delta & 1) != 0; // If the delta is odd then the forward search detects the overlap
+    int forwardStart = 0;
+    int forwardEnd = 0;
+    int backwardStart = 0;
+    int backwardEnd = 0;
+    int bestOld = 0;
+    int bestNew = 0;
+
+    context->forward.fill(-1, length);
+    context->backward.fill(-1, length);
+
+    int *forward = context->forward.data();
+    int *backward = context->backward.data();
+
+    forward[offset + 1] = 0;
+    backward[offset + 1] = 0;
+
+    for (int d = 0; d < maximumD; ++d) {
+        if (context->thread != NULL && context->thread->isInterruptionRequested()) {
+            return false;
+        }
+
+        // Walk the forward path one step
+        for (int k = -d + forwardStart; k <= d - forwardEnd; k += 2) {
+            int index = offset + k;
+            int x;
+
+            if (k == -d || (k != d && forward[index - 1] < forward[index + 1])) {
+                x = forward[index + 1];
+            } else {
+                x = forward[index - 1] + 1;
+            }
+
+            int y = x - k;
+
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+
+            forward[index] = x;
+
+            if (x > n) {
+                forwardEnd += 2; // Ran off the right of the graph
+            } else if (y > m) {
+                forwardStart += 2; // Ran off the bottom of the graph
+            } else {
+                if (x + y > bestOld + bestNew) {
+                    bestOld = x;
+                    bestNew = y;
+                }
+
+                if (front) {
+                    int backwardIndex = offset + delta - k;
+
+                    if (backwardIndex >= 0 && backwardIndex < length && backward[backwardIndex] != -1 &&
+                        x >= n - backward[backwardIndex]) {
+                        *oldSplit = range.oldBegin + x;
+                        *newSplit = range.newBegin + y;
+
+                        return true;
+                    }
+                }
+            }
+        }
+
+        // Walk the backward path one step
+        for (int k = -d + backwardStart; k <= d - backwardEnd; k += 2) {
+            int index = offset + k;
+            int x;
+
+            if (k == -d || (k != d && backward[index - 1] < backward[index + 1])) {
+                x = backward[index + 1];
+            } else {
+                x = backward[index - 1] + 1;
+            }
+
+            int y = x - k;
+
+            while (x < n && y < m && a[n - x - 1] == b[m - y - 1]) {
+                ++x;
+                ++y;
+            }
+
+            backward[index] = x;
+
+            if (x > n) {
+                backwardEnd += 2; // Ran off the left of the graph
+            } else if (y > m) {
+                backwardStart += 2; // Ran off the top of the graph
+            } else if (!front) {
+                int forwardIndex = offset + delta - k;
+
+                if (forwardIndex >= 0 && forwardIndex < length && forward[forwardIndex] != -1) {
+                    int forwardX = forward[forwardIndex];
+                    int forwardY = forwardX - (forwardIndex - offset);
+
+                    if (forwardX >= n - x) {
+                        *oldSplit = range.oldBegin + forwardX;
+                        *newSplit = range.newBegin + forwardY;
+
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    // Too expensive, split at the furthest point reached so far. The forward search cannot have reached the end without
+    // finding an overlap, but for tiny ranges it might not have moved at all.
+    *oldSplit = range.oldBegin + bestOld;
+    *newSplit = range.newBegin + bestNew;
+
+    return true;
+}
+
+// static
+QVector<LineDiff::Hunk> LineDiff::compute(const QVector<int> &oldLines, const QVector<int> &newLines, QThread *thread)
+{
+    int oldSize = oldLines.size();
+    int newSize = newLines.size();
+    int prefix = 0;
+    int suffix = 0;
+
+    while (prefix < oldSize && prefix < newSize && oldLines.at(prefix) == newLines.at(prefix)) {
+        ++prefix;
+    }
+
+    while (suffix < oldSize - prefix && suffix < newSize - prefix &&
+           oldLines.at(oldSize - suffix - 1) == newLines.at(newSize - suffix - 1)) {
+        ++suffix;
+    }
+
+    QVector<Hunk> hunks;
+    int oldCount = oldSize - prefix - suffix;
+    int newCount = newSize - prefix - suffix;
+
+    if (oldCount == 0 && newCount == 0) {
+        return hunks;
+    }
+
+    // Only the middle part that is not common to both sides is diffed. Lines in it that don't occur on the other side
+    // at all are changed for sure, leave them out of the search. This keeps rewritten parts of a file cheap to diff.
+    // The lookup tables are sized by the largest line ID, a small middle part is searched directly instead, otherwise
+    // diffing a single edited line of a large file would cost as much as the whole file.
+    const int *oldMiddle = oldLines.constData() + prefix;
+    const int *newMiddle = newLines.constData() + prefix;
+    bool filterLines = oldCount + newCount > FilterThreshold;
+    QVector<bool> occursInOld;
+    QVector<bool> occursInNew;
+
+    if (filterLines) {
+        int maximumId = 0;
+
+        for (int i = 0; i < oldCount; ++i) {
+            maximumId = qMax(maximumId, oldMiddle[i]);
+        }
+
+        for (int i = 0; i < newCount; ++i) {
+            maximumId = qMax(maximumId, newMiddle[i]);
+        }
+
+        occursInOld.fill(false, maximumId + 1);
+        occursInNew.fill(false, maximumId + 1);
+
+        for (int i = 0; i < oldCount; ++i) {
+            occursInOld[oldMiddle[i]] = true;
+        }
+
+        for (int i = 0; i < newCount; ++i) {
+            occursInNew[newMiddle[i]] = true;
+        }
+    }
+
+    QVector<bool> oldChanged;
+    QVector<bool> newChanged;
+    QVector<int> oldKeptLines;
+    QVector<int> newKeptLines;
+    QVector<int> oldKeptIndexes;
+    QVector<int> newKeptIndexes;
+
+    oldChanged.fill(false, oldCount);
+    newChanged.fill(false, newCount);
+    oldKeptLines.reserve(oldCount);
+    newKeptLines.reserve(newCount);
+    oldKeptIndexes.reserve(oldCount);
+    newKeptIndexes.reserve(newCount);
+
+    for (int i = 0; i < oldCount; ++i) {
+        if (!filterLines || occursInNew.at(oldMiddle[i])) {
+            oldKeptLines.append(oldMiddle[i]);
+            oldKeptIndexes.append(i);
+        } else {
+            oldChanged[i] = true;
+        }
+    }
+
+    for (int i = 0; i < newCount; ++i) {
+        if (!filterLines || occursInOld.at(newMiddle[i])) {
+            newKeptLines.append(newMiddle[i]);
+            newKeptIndexes.append(i);
+        } else {
+            newChanged[i] = true;
+        }
+    }
+
+    LineDiffContext context;
+
+    context.oldLines = oldKeptLines.constData();
+    context.newLines = newKeptLines.constData();
+    context.oldChanged.fill(false, oldKeptLines.size());
+    context.newChanged.fill(false, newKeptLines.size());
+    context.maximumCost = qMax(256, int(qSqrt(oldKeptLines.size() + newKeptLines.size())));
+    context.thread = thread;
+
+    QVector<LineDiffRange> ranges;
+    LineDiffRange initialRange = { 0, oldKeptLines.size(), 0, newKeptLines.size() };
+
+    ranges.append(initialRange);
+
+    while (!ranges.isEmpty()) {
+        LineDiffRange range = ranges.takeLast();
+
+        while (range.oldBegin < range.oldEnd && range.newBegin < range.newEnd &&
+               context.oldLines[range.oldBegin] == context.newLines[range.newBegin]) {
+            ++range.oldBegin;
+            ++range.newBegin;
+        }
+
+        while (range.oldBegin < range.oldEnd && range.newBegin < range.newEnd &&
+               context.oldLines[range.oldEnd - 1] == context.newLines[range.newEnd - 1]) {
+            --range.oldEnd;
+            --range.newEnd;
+        }
+
+        if (range.oldBegin == range.oldEnd) {
+            for (int i = range.newBegin; i < range.newEnd; ++i) {
+                context.newChanged[i] = true;
+            }
+        } else if (range.newBegin == range.newEnd) {
+            for (int i = range.oldBegin; i < range.oldEnd; ++i) {
+                context.oldChanged[i] = true;
+            }
+        } else {
+            int oldSplit;
+            int newSplit;
+
+            if (!split(&context, range, &oldSplit, &newSplit)) {
+                return QVector<Hunk>();
+            }
+
+            if (oldSplit == range.oldBegin && newSplit == range.newBegin) {
+                for (int i = range.oldBegin; i < range.oldEnd; ++i) {
+                    context.oldChanged[i] = true;
+                }
+
+                for (int i = range.newBegin; i < range.newEnd; ++i) {
+                    context.newChanged[i] = true;
+                }
+
+                continue;
+            }
+
+            LineDiffRange head = { range.oldBegin, oldSplit, range.newBegin, newSplit };
+            LineDiffRange tail = { oldSplit, range.oldEnd, newSplit, range.newEnd };
+
+            ranges.append(tail);
+            ranges.append(head);
+        }
+    }
+
+    for (int i = 0; i < oldKeptIndexes.size(); ++i) {
+        if (context.oldChanged.at(i)) {
+            oldChanged[oldKeptIndexes.at(i)] = true;
+        }
+    }
+
+    for (int i = 0; i < newKeptIndexes.size(); ++i) {
+        if (context.newChanged.at(i)) {
+            newChanged[newKeptIndexes.at(i)] = true;
+        }
+    }
+
+    // Collect runs of changed lines into hunks. Unchanged lines pair up one-to-one in order between the two sides.
+    int oldIndex = 0;
+    int newIndex = 0;
+
+    while (oldIndex < oldCount || newIndex < newCount) {
+        if (oldIndex < oldCount && newIndex < newCount &&
+            !oldChanged.at(oldIndex) && !newChanged.at(newIndex)) {
+            ++oldIndex;
+            ++newIndex;
+
+            continue;
+        }
+
+        Hunk hunk;
+
+        hunk.oldStart = prefix + oldIndex;
+        hunk.newStart = prefix + newIndex;
+
+        while (oldIndex < oldCount && oldChanged.at(oldIndex)) {
+            ++oldIndex;
+        }
+
+        while (newIndex < newCount && newChanged.at(newIndex)) {
+            ++newIndex;
+        }
+
+        hunk.oldCount = prefix + oldIndex - hunk.oldStart;
+        hunk.newCount = prefix + newIndex - hunk.newStart;
+
+        hunks.append(hunk);
+    }
+
+    return hunks;
+}
+
+void IncrementalLineDiff::reset(const QVector<int> &oldLines, const QVector<int> &newLines)
+{
+    m_oldLines = oldLines;
+    m_newLines = newLines;
+    m_hunks = LineDiff::compute(m_oldLines, m_newLines);
+}
+
+void IncrementalLineDiff::clear()
+{
+    m_oldLines.clear();
+    m_newLines.clear();
+    m_hunks.clear();
+}
+
+void IncrementalLineDiff::replace(int start, int removedCount, const QVector<int> &lines)
+{
+    Q_ASSERT(start >= 0 && removedCount >= 0 && start + removedCount <= m_newLines.size());
+
+    int addedCount = lines.size();
+    int removedEnd = start + removedCount;
+    int first = findHunk(start);
+    int last = first;
+
+    while (last < m_hunks.size() && m_hunks.at(last).newStart <= removedEnd) {
+        ++last;
+    }
+
+    // Outside of hunks the lines of both sides pair up with a constant distance between them. Use that to find the
+    // part of the old side that corresponds to the replaced lines and the hunks [first, last) touching them.
+    int newBegin = start;
+    int newEnd = removedEnd;
+    int distanceBefore = 0;
+
+    if (first > 0) {
+        const LineDiff::Hunk &previous = m_hunks.at(first - 1);
+
+        distanceBefore = (previous.oldStart + previous.oldCount) - (previous.newStart + previous.newCount);
+    }
+
+    int distanceAfter = distanceBefore;
+
+    if (last > first) {
+        const LineDiff::Hunk &firstHunk = m_hunks.at(first);
+        const LineDiff::Hunk &lastHunk = m_hunks.at(last - 1);
+
+        newBegin = qMin(newBegin, firstHunk.newStart);
+        newEnd = qMax(newEnd, lastHunk.newStart + lastHunk.newCount);
+        distanceAfter = (lastHunk.oldStart + lastHunk.oldCount) - (lastHunk.newStart + lastHunk.newCount);
+    }
+
+    int oldBegin = newBegin + distanceBefore;
+    int oldEnd = newEnd + distanceAfter;
+
+    // Apply the replacement
+    if (addedCount > removedCount) {
+        m_newLines.insert(start, addedCount - removedCount, -1);
+    } else if (addedCount < removedCount) {
+        m_newLines.remove(start, removedCount - addedCount);
+    }
+
+    for (int i = 0; i < addedCount; ++i) {
+        m_newLines[start + i] = lines.at(i);
+    }
+
+    // Diff the affected part again and splice its hunks in
+    int shift = addedCount - removedCount;
+    QVector<LineDiff::Hunk> hunks = LineDiff::compute(m_oldLines.mid(oldBegin, oldEnd - oldBegin),
+                                                      m_newLines.mid(newBegin, newEnd + shift - newBegin));
+
+    for (int i = 0; i < hunks.size(); ++i) {
+        hunks[i].oldStart += oldBegin;
+        hunks[i].newStart += newBegin;
+    }
+
+    if (hunks.size() == last - first) {
+        for (int i = 0; i < hunks.size(); ++i) {
+            m_hunks[first + i] = hunks.at(i);
+        }
+    } else {
+        QVector<LineDiff::Hunk> spliced;
+
+        spliced.reserve(m_hunks.size() - (last - first) + hunks.size());
+        spliced << m_hunks.mid(0, first) << hunks << m_hunks.mid(last);
+
+        m_hunks = spliced;
+        last = first + hunks.size();
+    }
+
+    for (int i = last; i < m_hunks.size(); ++i) {
+        m_hunks[i].newStart += shift;
+    }
+}
+
+int IncrementalLineDiff::findHunk(int newLine) const
+{
+    int low = 0;
+    int high = m_hunks.size();
+
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        const LineDiff::Hunk &hunk = m_hunks.at(middle);
+
+        if (hunk.newStart + hunk.newCount < newLine) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+// static
+bool BlockLines::findChange(const QTextDocument *document, int position, int charsAdded, int lineCount,
+                            Change *change)
+{
+    Q_ASSERT(change != NULL);
+
+    QTextBlock block = document->findBlock(position);
+    QTextBlock lastBlock = document->findBlock(position + charsAdded);
+
+    if (!block.isValid()) {
+        block = document->lastBlock();
+    }
+
+    if (!lastBlock.isValid()) {
+        lastBlock = document->lastBlock();
+    }
+
+    change->first = block.blockNumber();
+    change->addedCount = lastBlock.blockNumber() - change->first + 1;
+    change->removedCount = lineCount - document->blockCount() + change->addedCount;
+
+    return change->addedCount >= 1 && change->removedCount >= 0 && change->first + change->removedCount <= lineCount;
+}
+
+// static
+void BlockLines::internBlocks(LineInterner *interner, const QTextDocument *document, int first, int count,
+                              QVector<int> *ids)
+{
+    Q_ASSERT(ids != NULL);
+
+    QTextBlock block = document->findBlockByNumber(first);
+
+    ids->reserve(ids->size() + count);
+
+    for (int i = 0; i < count && block.isValid(); ++i, block = block.next()) {
+        ids->append(interner->intern(block.text()));
+    }
+}
+
+// static
+bool BlockLines::update(LineInterner *interner, const QTextDocument *document, int position, int charsAdded,
+                        QVector<int> *ids)
+{
+    Q_ASSERT(ids != NULL);
+
+    Change change;
+
+    if (!findChange(document, position, charsAdded, ids->size(), &change)) {
+        return false;
+    }
+
+    QTextBlock block = document->findBlockByNumber(change.first);
+
+    if (change.addedCount > change.removedCount) {
+        ids->insert(change.first, change.addedCount - change.removedCount, -1);
+    } else if (change.addedCount < change.removedCount) {
+        ids->remove(change.first, change.removedCount - change.addedCount);
+    }
+
+    for (int i = 0; i < change.addedCount; ++i, block = block.next()) {
+        (*ids)[change.first + i] = interner->intern(block.text());
+    }
+
+    return true;
+}
@@ -0,0 +1,124 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+class QTextDocument;
+class QThread;
+
+// Maps each distinct line to a small integer ID, so that lines can be compared by a single integer comparison. The same
+// interner has to be used for both sides of a diff. Thread-safe.
+class LineInterner
+{
+    Q_DISABLE_COPY(LineInterner)
+
+public:
+    LineInterner() { }
+
+    int intern(const QString &line);
+    void internLines(const QString &text, QVector<int> *ids); // splits at "\r\n", "\r" and "\n" like QTextDocument
+    QString line(int id) const;
+    int size() const;
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_ids;
+    QVector<QString> m_lines;
+};
+
+// Line based diff of two sequences of line IDs. Common leading and trailing lines are trimmed before running Myers'
+// O(ND) algorithm in linear space on the rest, so small edits to big files are cheap. If the two sides differ a lot
+// then the search is cut short and the result might not be minimal.
+class LineDiff
+{
+public:
+    // Lines [oldStart, oldStart + oldCount) of the old side are replaced by [newStart, newStart + newCount)
+    struct Hunk {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    // Returns an empty list if the thread is interrupted while diffing
+    static QVector<Hunk> compute(const QVector<int> &oldLines, const QVector<int> &newLines, QThread *thread = NULL);
+
+private:
+    enum {
+        FilterThreshold = 256 // lines
+    };
+};
+
+// Keeps a line diff up-to-date while lines of the new side are replaced. Only the replaced lines are diffed again,
+// together with the hunks that overlap or touch them, all other hunks are just moved.
+class IncrementalLineDiff
+{
+public:
+    IncrementalLineDiff() { }
+
+    void reset(const QVector<int> &oldLines, const QVector<int> &newLines);
+    void clear();
+
+    // Replaces lines [start, start + removedCount) of the new side with the given lines
+    void replace(int start, int removedCount, const QVector<int> &lines);
+
+    int newLineCount() const { return m_newLines.size(); }
+    QVector<LineDiff::Hunk> hunks() const { return m_hunks; }
+
+    // Index of the first hunk that ends at or after the given line of the new side
+    int findHunk(int newLine) const;
+
+private:
+    QVector<int> m_oldLines;
+    QVector<int> m_newLines;
+    QVector<LineDiff::Hunk> m_hunks;
+};
+
+// Keeps the line IDs of the blocks of a QTextDocument up-to-date with its contentsChange signal. A change only touches
+// a range of blocks, the IDs of all other lines stay valid, so only that range has to be interned again.
+class BlockLines
+{
+public:
+    // Blocks [first, first + addedCount) touched by a change replace removedCount lines of the old line count
+    struct Change {
+        int first;
+        int addedCount;
+        int removedCount;
+    };
+
+    // Sets first and addedCount in any case. Returns false if the change doesn't fit the line count the document had
+    // before, then the line IDs are out of sync with the document
+    static bool findChange(const QTextDocument *document, int position, int charsAdded, int lineCount, Change *change);
+
+    // Appends the IDs of count blocks starting at block first
+    static void internBlocks(LineInterner *interner, const QTextDocument *document, int first, int count,
+                             QVector<int> *ids);
+
+    // Returns false and leaves ids unchanged if they are out of sync with the document
+    static bool update(LineInterner *interner, const QTextDocument *document, int position, int charsAdded,
+                       QVector<int> *ids);
+};
+
+#endif // LINEDIFF_H
@@ -0,0 +1,449 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "lineindex.h"
+
+#include <QtAlgorithms>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+// The vector width is chosen at compile time, building with AVX2 enabled (-mavx2, /arch:AVX2) selects the wider one
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LINEINDEX_VECTOR_SIZE 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LINEINDEX_VECTOR_SIZE 16
+#endif
+
+enum {
+    MinimumChunkSize = 16 * 1024 * 1024, // bytes, smaller buffers are not worth another thread
+    InterruptionCheckInterval = 1024 * 1024 // bytes, also how often the size of a mapped file is checked
+};
+
+// A line ends with "\n", "\r\n" or a "\r" that isn't followed by "\n", the same as for QTextDocument::setPlainText.
+// A line break is identified by its last byte, end is the end of the whole buffer.
+static inline bool isLineBreak(const char *p, const char *end)
+{
+    return *p == '\n' || (*p == '\r' && (p + 1 >= end || p[1] != '\n'));
+}
+
+#ifdef LINEINDEX_VECTOR_SIZE
+
+// Bit i is set if isLineBreak() is true for p[i]. Reads LINEINDEX_VECTOR_SIZE + 1 bytes.
+static inline quint32 lineBreakMask(const char *p)
+{
+#if LINEINDEX_VECTOR_SIZE == 32
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+    quint32 lineFeeds = quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+    quint32 carriageReturns = quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+    quint32 followedByLineFeed = quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, _mm256_set1_epi8('\n'))));
+#else
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+    quint32 lineFeeds = quint32(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))));
+    quint32 carriageReturns = quint32(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+    quint32 followedByLineFeed = quint32(_mm_movemask_epi8(_mm_cmpeq_epi8(next, _mm_set1_epi8('\n'))));
+#endif
+
+    return lineFeeds | (carriageReturns & ~followedByLineFeed);
+}
+
+#endif
+
+// Returns the last byte of the first line break in [p, end), NULL if there is none
+static const char *findLineBreak(const char *p, const char *end, const char *bufferEnd)
+{
+#ifdef LINEINDEX_VECTOR_SIZE
+    while (end - p > LINEINDEX_VECTOR_SIZE) {
+        quint32 mask = lineBreakMask(p);
+
+        if (mask != 0) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+
+        p += LINEINDEX_VECTOR_SIZE;
+    }
+#endif
+
+    for (; p < end; ++p) {
+        if (isLineBreak(p, bufferEnd)) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+// Counts the line breaks in a part of the buffer and records the start of every CheckpointInterval-th line in it. The
+// lines are counted from the start of the part, LineIndex::build() shifts them once the preceding parts are counted.
+// A "\r\n" split between two parts is counted by the second one.
+class LineIndexChunk : public QThread
+{
+    Q_DISABLE_COPY(LineIndexChunk)
+
+public:
+    LineIndexChunk(const char *data, qint64 size, qint64 begin, qint64 end, QThread *thread, int fileHandle) :
+        m_data(data),
+        m_size(size),
+        m_begin(begin),
+        m_end(end),
+        m_thread(thread),
+        m_fileHandle(fileHandle),
+        m_lineBreakCount(0),
+        m_nextCheckpoint(LineIndex::CheckpointInterval),
+        m_interrupted(false)
+    {
+    }
+
+    qint64 lineBreakCount() const { return m_lineBreakCount; }
+    QVector<LineIndex::Checkpoint> checkpoints() const { return m_checkpoints; }
+    bool isInterrupted() const { return m_interrupted; }
+
+    void scan()
+    {
+        const char *p = m_data + m_begin;
+        const char *end = m_data + m_end;
+
+        while (p < end) {
+            const char *blockEnd = p + qMin(qint64(end - p), qint64(InterruptionCheckInterval));
+
+            if (m_thread != NULL && m_thread->isInterruptionRequested()) {
+                m_interrupted = true;
+
+                return;
+            }
+
+            // Reading the mapping of a file beyond its end raises SIGBUS. If the file shrank then give up, the file has
+            // to be mapped again anyway. The block is scanned including the byte after it.
+            if (m_fileHandle >= 0) {
+                qint64 fileSize = LineIndex::fileSize(m_fileHandle);
+
+                if (fileSize >= 0 && fileSize < qMin(qint64(blockEnd - m_data) + 1, m_size)) {
+                    m_interrupted = true;
+
+                    return;
+                }
+            }
+
+            p = scanBlock(p, blockEnd);
+        }
+    }
+
+protected:
+    void run()
+    {
+        scan();
+    }
+
+private:
+    const char *scanBlock(const char *p, const char *end)
+    {
+        const char *bufferEnd = m_data + m_size;
+
+#ifdef LINEINDEX_VECTOR_SIZE
+        while (end - p > LINEINDEX_VECTOR_SIZE) {
+            quint32 mask = lineBreakMask(p);
+            uint count = qPopulationCount(mask);
+
+            // Only look at the single line breaks if a checkpoint falls into this vector
+            if (m_lineBreakCount + count < m_nextCheckpoint) {
+                m_lineBreakCount += count;
+            } else {
+                while (mask != 0) {
+                    addLineBreak(p + qCountTrailingZeroBits(mask));
+
+                    mask &= mask - 1;
+                }
+            }
+
+            p += LINEINDEX_VECTOR_SIZE;
+        }
+#endif
+
+        for (; p < end; ++p) {
+            if (isLineBreak(p, bufferEnd)) {
+                addLineBreak(p);
+            }
+        }
+
+        return p;
+    }
+
+    void addLineBreak(const char *p)
+    {
+        ++m_lineBreakCount;
+
+        if (m_lineBreakCount == m_nextCheckpoint) {
+            LineIndex::Checkpoint checkpoint = { m_lineBreakCount, p + 1 - m_data };
+
+            m_checkpoints.append(checkpoint);
+
+            m_nextCheckpoint += LineIndex::CheckpointInterval;
+        }
+    }
+
+    const char *m_data;
+    qint64 m_size;
+    qint64 m_begin;
+    qint64 m_end;
+    QThread *m_thread;
+    int m_fileHandle;
+    qint64 m_lineBreakCount;
+    qint64 m_nextCheckpoint;
+    QVector<LineIndex::Checkpoint> m_checkpoints;
+    bool m_interrupted;
+};
+
+LineIndex::LineIndex() :
+    m_data(NULL),
+    m_size(0),
+    m_lineCount(-1)
+{
+    reset(NULL, 0);
+}
+
+void LineIndex::reset(const char *data, qint64 size)
+{
+    Checkpoint start = { 0, 0 };
+
+    m_data = data;
+    m_size = size;
+    m_checkpoints.clear();
+    m_checkpoints.append(start);
+    m_lineCount = -1;
+}
+
+bool LineIndex::build(QThread *thread, int fileHandle)
+{
+    int chunkCount = int(qBound(Q_INT64_C(1), m_size / MinimumChunkSize, qint64(qMax(QThread::idealThreadCount(), 1))));
+    QVector<LineIndexChunk *> chunks;
+
+    for (int i = 0; i < chunkCount; ++i) {
+        qint64 begin = m_size * i / chunkCount;
+        qint64 end = m_size * (i + 1) / chunkCount;
+
+        chunks.append(new LineIndexChunk(m_data, m_size, begin, end, thread, fileHandle));
+    }
+
+    // The first part is scanned on this thread
+    for (int i = 1; i < chunkCount; ++i) {
+        chunks.at(i)->start();
+    }
+
+    chunks.at(0)->scan();
+
+    bool interrupted = false;
+    QVector<Checkpoint> checkpoints;
+    qint64 lineBreakCount = 0;
+
+    checkpoints.append(m_checkpoints.first());
+
+    foreach (LineIndexChunk *chunk, chunks) {
+        chunk->wait();
+
+        interrupted = interrupted || chunk->isInterrupted();
+
+        foreach (Checkpoint checkpoint, chunk->checkpoints()) {
+            checkpoint.line += lineBreakCount;
+
+            checkpoints.append(checkpoint);
+        }
+
+        lineBreakCount += chunk->lineBreakCount();
+    }
+
+    qDeleteAll(chunks);
+
+    if (interrupted) {
+        return false;
+    }
+
+    m_checkpoints = checkpoints;
+    m_lineCount = lineBreakCount + 1;
+
+    return true;
+}
+
+void LineIndex::extend(const char *data, qint64 size)
+{
+    Q_ASSERT(isBuilt());
+    Q_ASSERT(size >= m_size);
+
+    qint64 oldSize = m_size;
+
+    m_data = data;
+    m_size = size;
+
+    const char *p = m_data + oldSize;
+    const char *end = m_data + m_size;
+
+    // A "\r" at the old end was counted as a line break. Followed by an appended "\n" the line break is the "\r\n",
+    // that ends with the "\n" instead.
+    if (oldSize > 0 && p < end && p[-1] == '\r' && *p == '\n') {
+        if (m_checkpoints.last().offset == oldSize) {
+            ++m_checkpoints.last().offset;
+        }
+
+        ++p;
+    }
+
+    qint64 lineBreakCount = m_lineCount - 1;
+    qint64 nextCheckpoint = m_checkpoints.last().line + CheckpointInterval;
+
+    while ((p = findLineBreak(p, end, end)) != NULL) {
+        ++p;
+        ++lineBreakCount;
+
+        if (lineBreakCount == nextCheckpoint) {
+            Checkpoint checkpoint = { lineBreakCount, p - m_data };
+
+            m_checkpoints.append(checkpoint);
+
+            nextCheckpoint += CheckpointInterval;
+        }
+    }
+
+    m_lineCount = lineBreakCount + 1;
+}
+
+// static
+qint64 LineIndex::fileSize(int fileHandle)
+{
+#ifdef Q_OS_UNIX
+    struct stat buffer;
+
+    if (::fstat(fileHandle, &buffer) == 0) {
+        return buffer.st_size;
+    }
+#else
+    Q_UNUSED(fileHandle)
+#endif
+
+    return -1;
+}
+
+qint64 LineIndex::lineStart(qint64 line) const
+{
+    if (line <= 0) {
+        return 0;
+    }
+
+    if (isBuilt() && line >= m_lineCount) {
+        return m_size;
+    }
+
+    const Checkpoint &checkpoint = m_checkpoints.at(checkpointBefore(line, &Checkpoint::line));
+    qint64 offset = checkpoint.offset;
+
+    for (qint64 i = checkpoint.line; i < line && offset >= 0; ++i) {
+        offset = nextLineStart(offset, NULL);
+    }
+
+    return offset >= 0 ? offset : m_size;
+}
+
+qint64 LineIndex::lineEnd(qint64 line) const
+{
+    qint64 end;
+
+    nextLineStart(lineStart(line), &end);
+
+    return end;
+}
+
+qint64 LineIndex::lineAt(qint64 offset) const
+{
+    offset = qBound(Q_INT64_C(0), offset, m_size);
+
+    const Checkpoint &checkpoint = m_checkpoints.at(checkpointBefore(offset, &Checkpoint::offset));
+    const char *p = m_data + checkpoint.offset;
+    const char *end = m_data + offset;
+    qint64 line = checkpoint.line;
+
+    while ((p = findLineBreak(p, end, m_data + m_size)) != NULL) {
+        ++p;
+        ++line;
+    }
+
+    return line;
+}
+
+qint64 LineIndex::nextLineStart(qint64 offset, qint64 *lineEnd) const
+{
+    const char *start = m_data + offset;
+    const char *lineBreak = findLineBreak(start, m_data + m_size, m_data + m_size);
+
+    if (lineBreak == NULL) {
+        if (lineEnd != NULL) {
+            *lineEnd = m_size;
+        }
+
+        return -1;
+    }
+
+    if (lineEnd != NULL) {
+        const char *end = lineBreak;
+
+        if (*end == '\n' && end > start && end[-1] == '\r') {
+            --end;
+        }
+
+        *lineEnd = end - m_data;
+    }
+
+    return lineBreak + 1 - m_data;
+}
+
+// private
+int LineIndex::checkpointBefore(qint64 value, qint64 Checkpoint::*field) const
+{
+    int low = 0;
+    int high = m_checkpoints.size();
+
+    while (high - low > 1) {
+        int middle = low + (high - low) / 2;
+
+        if (m_checkpoints.at(middle).*field <= value) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+LineIndexBuilder::LineIndexBuilder(const char *data, qint64 size, int fileHandle, QObject *parent) :
+    QThread(parent),
+    m_fileHandle(fileHandle)
+{
+    m_index.reset(data, size);
+}
+
+// protected
+void LineIndexBuilder::run()
+{
+    if (m_index.build(this, m_fileHandle)) {
+        emit buildFinished();
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QThread>
+#include <QVector>
+
+// Sparse index of the line starts in a buffer. Only about every CheckpointInterval-th line start is stored, any other
+// line is found by scanning forward from the closest checkpoint. So the index stays small even for huge buffers and
+// each lookup costs a binary search plus a scan over at most CheckpointInterval lines. Lines end with "\n", "\r\n" or
+// "\r", the same as for QTextDocument::setPlainText, so the line count matches the block count of a QTextDocument.
+class LineIndex
+{
+public:
+    enum {
+        CheckpointInterval = 4096 // lines
+    };
+
+    struct Checkpoint {
+        qint64 line;
+        qint64 offset;
+    };
+
+    LineIndex();
+
+    // Resets the index to just the start of the buffer, lookups still work by scanning from there
+    void reset(const char *data, qint64 size);
+
+    // Indexes the whole buffer, splitting the work across threads. Returns false if the thread was interrupted. If the
+    // buffer maps the file of the given handle then the build also stops as soon as that file got shorter.
+    bool build(QThread *thread = NULL, int fileHandle = -1);
+
+    // Indexes data that was appended to the built buffer, only the new part is scanned. The buffer may have moved.
+    void extend(const char *data, qint64 size);
+
+    bool isBuilt() const { return m_lineCount >= 0; }
+    qint64 lineCount() const { return m_lineCount; } // -1 until built
+
+    qint64 lineStart(qint64 line) const; // the end of the buffer if there is no such line
+    qint64 lineEnd(qint64 line) const; // excluding the line break
+    qint64 lineAt(qint64 offset) const;
+
+    // Returns the start of the line after the line that contains offset, or -1 if that is the last line. Also returns
+    // the end of the line that contains offset, excluding the line break, if lineEnd isn't NULL.
+    qint64 nextLineStart(qint64 offset, qint64 *lineEnd) const;
+
+    // Current size of an open file or -1 if unknown. Only checked on Unix, Windows doesn't let mapped files shrink.
+    static qint64 fileSize(int fileHandle);
+
+private:
+    int checkpointBefore(qint64 value, qint64 Checkpoint::*field) const; // the last one with field <= value
+
+    const char *m_data;
+    qint64 m_size;
+    QVector<Checkpoint> m_checkpoints; // sorted by line and offset, starts with line 0 at offset 0
+    qint64 m_lineCount;
+};
+
+// Builds a LineIndex on a worker thread, a huge file can take seconds to read
+class LineIndexBuilder : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(LineIndexBuilder)
+
+public:
+    LineIndexBuilder(const char *data, qint64 size, int fileHandle = -1, QObject *parent = NULL);
+
+    // Only valid after buildFinished() was emitted
+    LineIndex index() const { return m_index; }
+
+signals:
+    void buildFinished();
+
+protected:
+    void run();
+
+private:
+    LineIndex m_index;
+    int m_fileHandle;
+};
+
+#endif // LINEINDEX_H
@@ -19,57 +19,216 @@
 #include "location.h"
 
 #include <QDir>
-#include <QRegularExpression>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
 
-LocationData::LocationData(const QString &path_)
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+// Many locations share the same few directories, which are interned here. The table maps each directory path to its
+// LocationDirectory, which is deleted together with its table entry once the last location in it is gone. The table is
+// split into shards with a lock each, so that threads creating locations rarely wait for each other. Copying and
+// releasing a location that isn't the last one in its directory only touches the atomic reference count.
+struct DirectoryShard {
+    QMutex mutex;
+    QHash<QString, LocationDirectory *> directories; // by path
+};
+
+enum {
+    DirectoryShardCount = 16
+};
+
+static DirectoryShard &directoryShard(const QString &path)
+{
+    // Never destroyed, locations might still be released while static objects are destroyed at exit
+    static DirectoryShard *shards = new DirectoryShard[DirectoryShardCount];
+
+    return shards[qHash(path) % DirectoryShardCount];
+}
+
+static LocationDirectory *internDirectory(const QString &path)
+{
+    DirectoryShard &shard = directoryShard(path);
+    QMutexLocker locker(&shard.mutex);
+    LocationDirectory *directory = shard.directories.value(path, NULL);
+
+    if (directory == NULL) {
+        directory = new LocationDirectory;
+        directory->path = path;
+
+        // The directory name is the last non-empty part of the directory path
+        int nameEnd = path.length() - 1;
+        int nameStart = nameEnd > 0 ? path.lastIndexOf(QDir::separator(), nameEnd - 1) + 1 : 0;
+
+        directory->name = path.mid(nameStart, nameEnd - nameStart);
+#ifdef LOCATION_CASELESS
+        directory->key = path.toCaseFolded();
+#endif
+
+        shard.directories.insert(path, directory);
+    }
+
+    directory->ref.ref();
+
+    return directory;
+}
+
+static void releaseDirectory(LocationDirectory *directory)
+{
+    // Only the last reference has to be released under the lock, interning might take a new one meanwhile otherwise
+    forever {
+        int count = directory->ref.load();
+
+        if (count <= 1) {
+            break;
+        }
+
+        if (directory->ref.testAndSetOrdered(count, count - 1)) {
+            return;
+        }
+    }
+
+    DirectoryShard &shard = directoryShard(directory->path);
+    QMutexLocker locker(&shard.mutex);
+
+    if (!directory->ref.deref()) {
+        shard.directories.remove(directory->path);
+
+        delete directory;
+    }
+}
+
+LocationData::LocationData(const QString &path_) :
+    isDirectory(false),
+    directory(NULL),
+    hash(0),
+    hasFileId(false),
+    device(0),
+    inode(0)
 {
     if (!path_.isEmpty()) {
         Q_ASSERT(QDir::isAbsolutePath(path_));
 
         isDirectory = path_.endsWith("/") || path_.endsWith("\\");
 
-        // Qt's QDir and QFileInfo are full of inconsistencies. For example, QDir::cleanPath() strips trailing
-        // separators (except from root directories), but QFileInfo relies on the trailing separator to tell apart a
-        // file path from a directory path. Also, the QFileInfo absolute and canonical path methods are inconsistent
-        // in the way they split a path into the directory path and the file name part. Therefore, only use
-        // QDir::cleanPath() do resolve dots and double-dots in the file path and do the rest by hand.
-        path = QDir::toNativeSeparators(QDir::cleanPath(path_));
+        // Qt's QDir and QFileInfo are full of inconsistencies. For example, QDir::cleanPath() strips trailing
+        // separators (except from root directories), but QFileInfo relies on the trailing separator to tell apart a
+        // file path from a directory path. Also, the QFileInfo absolute and canonical path methods are inconsistent
+        // in the way they split a path into the directory path and the file name part. Therefore, only use
+        // QDir::cleanPath() do resolve dots and double-dots in the file path and do the rest by hand.
+        QString path = QDir::toNativeSeparators(QDir::cleanPath(path_));
 
 #ifdef Q_OS_WIN
         // On Windows C:Blubb (drive relative) is not the same as C:\Blubb (absolute). But drive relative are not widely
         // known and difficult to use. Therefore, just pretend that drive relative paths are typos and just inject the
         // separator after the colon to force an absolute path. Also Qt doesn't understand drive relative paths and
         // treats them as absolute paths anyway.
-        path.replace(QRegularExpression("^([A-Za-z]:)([^\\\\])"), "\\1\\\\2");
+        if (path.length() > 2 && path.at(1) == ':' && path.at(2) != '\\' && path.at(0).unicode() < 128
+            && path.at(0).isLetter()) {
+            path.insert(2, '\\');
+        }
 #endif
 
+        int fileNameOffset;
+
         if (isDirectory) {
-            // QDir::cleanPath() strips trailing separators from all paths, except from root directories
-            if (!path.endsWith(QDir::separator())) {
-                path += QDir::separator(); // Add trailing separator to indicate directory
-            }
-
-            directoryPath = path;
-            fileName = "";
-        } else {
-            int index = path.lastIndexOf(QDir::separator());
+            // QDir::cleanPath() strips trailing separators from all paths, except from root directories
+            if (!path.endsWith(QDir::separator())) {
+                path += QDir::separator(); // Add trailing separator to indicate directory
+            }
 
-            Q_ASSERT(index >= 0);
+            fileNameOffset = path.length();
+        } else {
+            fileNameOffset = path.lastIndexOf(QDir::separator()) + 1;
 
-            directoryPath = path.left(index + 1);
-            fileName = path.mid(index + 1);
+            Q_ASSERT(fileNameOffset > 0);
         }
 
-        directoryName = directoryPath.split(QDir::separator(), QString::SkipEmptyParts).last();
+        directory = internDirectory(path.left(fileNameOffset));
+        fileName = path.mid(fileNameOffset);
+
+#ifdef LOCATION_CASELESS
+        fileKey = fileName.toCaseFolded();
+        hash = qHash(fileKey, qHash(directory->key));
+#else
+        hash = qHash(fileName, qHash(directory->path));
+#endif
     }
 }
 
 LocationData::LocationData(const LocationData &other) :
     QSharedData(other),
     isDirectory(other.isDirectory),
-    path(other.path),
-    directoryPath(other.directoryPath),
-    directoryName(other.directoryName),
-    fileName(other.fileName)
+    directory(other.directory),
+    fileName(other.fileName),
+#ifdef LOCATION_CASELESS
+    fileKey(other.fileKey),
+#endif
+    hash(other.hash),
+    hasFileId(other.hasFileId),
+    device(other.device),
+    inode(other.inode)
 {
+    if (directory != NULL) {
+        directory->ref.ref();
+    }
+}
+
+LocationData::~LocationData()
+{
+    if (directory != NULL) {
+        releaseDirectory(directory);
+    }
+}
+
+bool LocationData::hasSameKey(const LocationData &other) const
+{
+    if (directory == NULL || other.directory == NULL) {
+        return directory == other.directory;
+    }
+
+#ifdef LOCATION_CASELESS
+    return (directory == other.directory || directory->key == other.directory->key) && fileKey == other.fileKey;
+#else
+    return directory == other.directory && fileName == other.fileName; // Directories are interned by their path
+#endif
+}
+
+QString Location::path(const QString &empty) const
+{
+    if (isEmpty()) {
+        return empty;
+    }
+
+    return d->fileName.isEmpty() ? d->directory->path : d->directory->path + d->fileName;
+}
+
+void Location::resolveFileId()
+{
+    // Checked without detaching, hasFileId() is const
+    if (isEmpty() || hasFileId()) {
+        return;
+    }
+
+    // Not done on Windows, where the case-folded key already covers the most common way of naming a file differently
+#ifdef Q_OS_UNIX
+    struct stat buffer;
+
+    if (::stat(QFile::encodeName(path()).constData(), &buffer) == 0) {
+        d->hasFileId = true;
+        d->device = buffer.st_dev;
+        d->inode = buffer.st_ino;
+    }
+#endif
+}
+
+bool Location::isSameFile(const Location &other) const
+{
+    if (*this == other) {
+        return true;
+    }
+
+    return d->hasFileId && other.d->hasFileId && d->device == other.d->device && d->inode == other.d->inode;
 }
@@ -19,21 +19,48 @@
 #ifndef LOCATION_H
 #define LOCATION_H
 
+#include <QAtomicInt>
 #include <QDir>
 #include <QFileInfo>
+#include <QPair>
 #include <QSharedData>
 
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+// The default file systems on Windows and macOS are caseless
+#define LOCATION_CASELESS
+#endif
+
+// A directory shared by all locations in it. Directories are interned, so each is only stored once no matter how many
+// locations refer to it.
+struct LocationDirectory
+{
+    QAtomicInt ref; // number of LocationData referring to it
+    QString path; // Guaranteed to have a trailing separator
+    QString name; // Last non-empty part of <path>
+#ifdef LOCATION_CASELESS
+    QString key; // <path> case-folded
+#endif
+};
+
 class LocationData : public QSharedData
 {
 public:
     LocationData(const QString &path);
     LocationData(const LocationData &other);
+    ~LocationData();
+
+    bool hasSameKey(const LocationData &other) const;
 
     bool isDirectory;
-    QString path; // <directoryPath> + <fileName>
-    QString directoryPath; // Guaranteed to have a trailing separator
-    QString directoryName; // Last part of <directoryPath>
-    QString fileName; // Last part of <path>
+    LocationDirectory *directory; // NULL if empty
+    QString fileName; // path() is <directory->path> + <fileName>, empty for directories
+#ifdef LOCATION_CASELESS
+    QString fileKey; // <fileName> case-folded
+#endif
+    uint hash; // hash of the key, the path as compared, computed once
+    bool hasFileId; // <device> and <inode> are only valid after Location::resolveFileId()
+    quint64 device;
+    quint64 inode;
 };
 
 class Location
@@ -43,24 +70,36 @@ public:
     Location(const char *path) : d(new LocationData(path)) { }
     Location(const QString &path) : d(new LocationData(path)) { }
 
-    bool isEmpty() const { return d->path.isEmpty(); }
+    bool isEmpty() const { return d->directory == NULL; }
     bool isDirectory() const { return d->isDirectory; }
     bool isFile() const { return !isEmpty() && !isDirectory(); }
 
-    QString path(const QString &empty = QString()) const { return isEmpty() ? empty : d->path; }
-    QString directoryPath(const QString &empty = QString()) const { return isEmpty() ? empty : d->directoryPath; }
-    QString directoryName(const QString &empty = QString()) const { return isEmpty() ? empty : d->directoryName; }
+    QString path(const QString &empty = QString()) const;
+    QString directoryPath(const QString &empty = QString()) const { return isEmpty() ? empty : d->directory->path; }
+    QString directoryName(const QString &empty = QString()) const { return isEmpty() ? empty : d->directory->name; }
     QString fileName(const QString &empty = QString()) const { return isEmpty() ? empty : d->fileName; }
 
-    bool exists() const { return QFileInfo::exists(d->path); }
+    bool exists() const { return !isEmpty() && QFileInfo::exists(path()); }
 
-    Location file(const QString &name) { return d->directoryPath + name; }
+    Location file(const QString &name) { return directoryPath() + name; }
 
-    // Use QFileInfo for path comparison to avoid treating paths as different if they only differ in case but are
-    // located on a caseless file system and are actually identical. QFileInfo handles this case correctly.
-    bool operator==(const Location &other) const { return d == other.d || QFileInfo(d->path) == QFileInfo(other.d->path); }
+    // Compares the keys made at construction, this never touches the file system. Paths that only differ in case are
+    // equal on caseless file systems, because the key is case-folded there.
+    bool operator==(const Location &other) const
+    {
+        return d == other.d || (hash() == other.hash() && d->hasSameKey(*other.d));
+    }
     bool operator!=(const Location &other) const { return !(*this == other); }
 
+    uint hash() const { return d->hash; }
+
+    // Looks up the device and inode of the file once and keeps them. Afterwards isSameFile() also recognizes other
+    // paths of the same file, for example through symlinks or hard links, without touching the file system again.
+    void resolveFileId();
+    bool hasFileId() const { return d->hasFileId; }
+    QPair<quint64, quint64> fileId() const { return qMakePair(d->device, d->inode); }
+    bool isSameFile(const Location &other) const;
+
     static Location home() { return QDir::homePath() + "/"; } // Add trailing separator to indicate directory
 
 private:
@@ -69,7 +108,7 @@ private:
 
 inline uint qHash(const Location &key, uint seed = 0)
 {
-    return qHash(key.path(), seed);
+    return key.hash() ^ seed;
 }
 
 #endif // LOCATION_H
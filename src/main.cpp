@@ -16,41 +16,80 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "autosave.h"
+#include "directorymodel.h"
 #include "documentmanager.h"
 #include "editorcolors.h"
 #include "eventfilter.h"
+#include "filewatcher.h"
+#include "latencytracer.h"
 #include "mainwindow.h"
 #include "monospacefontmetrics.h"
+#include "recentfiles.h"
 #include "settings.h"
+#include "startupprofiler.h"
 #include "style.h"
 #include "textcodec.h"
 
 #include <QApplication>
 #include <QDebug>
 #include <QFontDatabase>
+#include <QTimer>
 
 int main(int argc, char **argv)
 {
+    StartupProfiler startupProfiler;
+    StartupPhase phase("QApplication");
+
     QApplication application(argc, argv);
 
+    phase.next("Fonts");
+
     application.setWindowIcon(QIcon(":/icons/zero-editor.ico"));
 
     if (QFontDatabase::addApplicationFont(":/fonts/DejaVuSansMono.ttf") < 0) {
         qDebug() << "main: Loading DejaVuSansMono.ttf failed";
     }
 
+    phase.next("Settings::initialize");
     Settings::initialize();
+    phase.next("TextCodec::initialize");
     TextCodec::initialize();
+    phase.next("MonospaceFontMetrics::initialize");
     MonospaceFontMetrics::initialize();
+    phase.next("EditorColors::initialize");
     EditorColors::initialize();
+    phase.next("Style");
     QApplication::setStyle(new Style(QApplication::style()));
     QIcon::setThemeName("zero-editor");
 
+    phase.next("Managers");
+
     EventFilter eventFilter;
     DocumentManager documentManager;
+    RecentFiles recentFiles;
+    DirectoryCache directoryCache;
+    FileWatcher fileWatcher;
+    Autosave autosave;
+    LatencyTracer latencyTracer;
+
+    phase.next("MainWindow");
+
     MainWindow mainWindow;
 
+    phase.next("DocumentManager::restoreSession");
+
+    DocumentManager::restoreSession();
+
+    phase.next("MainWindow::show");
+
     mainWindow.show();
 
+    phase.finish();
+
+    QTimer::singleShot(0, &startupProfiler, &StartupProfiler::finish);
+
+    Autosave::recover();
+
     return application.exec();
 }
@@ -23,14 +23,24 @@
 #include "documentmanager.h"
 #include "editor.h"
 #include "eventfilter.h"
+#include "filedialog.h"
+#include "latencydialog.h"
+#include "monospacefontmetrics.h"
+#include "quickopendialog.h"
+#include "recentfiles.h"
+#include "startupprofiler.h"
 #include "textdocument.h"
 
+#include <QCloseEvent>
 #include <QContextMenuEvent>
 #include <QDebug>
+#include <QDialogButtonBox>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QPlainTextEdit>
 #include <QProcess>
 #include <QToolButton>
+#include <QVBoxLayout>
 #include <QWidgetAction>
 
 MainWindow *MainWindow::s_instance = NULL;
@@ -38,12 +48,18 @@ MainWindow *MainWindow::s_instance = NULL;
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     m_ui(new Ui::MainWindow),
-    m_lastCurrentDocument(NULL)
+    m_lastCurrentDocument(NULL),
+    m_quickOpenDialog(NULL),
+    m_latencyDialog(NULL)
 {
     s_instance = this;
 
+    StartupPhase phase("MainWindow::setupUi");
+
     m_ui->setupUi(this);
 
+    phase.finish();
+
     // File menu
     m_ui->actionSave->setEnabled(false);
     m_ui->actionSave_Tool->setEnabled(m_ui->actionSave->isEnabled());
@@ -99,17 +115,26 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_ui->actionFindAndReplace, &QAction::triggered, this, &MainWindow::showFindAndReplaceWidget);
     connect(m_ui->actionFindInFiles, &QAction::triggered, this, &MainWindow::showFindInFilesWidget);
 
+    // Navigate menu
+    connect(m_ui->actionGoToFile, &QAction::triggered, this, &MainWindow::showQuickOpenDialog);
+    connect(m_ui->actionGoToPreviousFile, &QAction::triggered, this, &MainWindow::goToPreviousFile);
+
     // Options menu
     m_ui->actionEncoding->setEnabled(false);
     m_ui->actionWordWrapping->setEnabled(false);
     m_ui->actionWordWrapping->setChecked(false);
+    m_ui->actionFollow->setEnabled(false);
+    m_ui->actionFollow->setChecked(false);
 
     connect(m_ui->actionEncoding, &QAction::triggered, this, &MainWindow::showEncodingDialog);
     connect(m_ui->actionWordWrapping, &QAction::triggered, this, &MainWindow::setWordWrapping);
+    connect(m_ui->actionFollow, &QAction::triggered, this, &MainWindow::setFollowing);
 
     // Tools menu
     connect(m_ui->actionTerminal, &QAction::triggered, this, &MainWindow::openTerminal);
     connect(m_ui->actionTerminal_Tool, &QAction::triggered, this, &MainWindow::openTerminal);
+    connect(m_ui->actionStartupReport, &QAction::triggered, this, &MainWindow::showStartupReport);
+    connect(m_ui->actionTypingLatency, &QAction::triggered, this, &MainWindow::showLatencyDialog);
     connect(m_ui->actionUnsavedDiff, &QAction::triggered, this, &MainWindow::showUnsavedDiffWidget);
     connect(m_ui->actionUnsavedDiff_Tool, &QAction::triggered, this, &MainWindow::showUnsavedDiffWidget);
     connect(m_ui->actionGitDiff, &QAction::triggered, this, &MainWindow::showGitDiffWidget);
@@ -201,6 +226,15 @@ MainWindow::~MainWindow()
     delete m_ui;
 }
 
+// protected
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    // Save the session while the editors still exist, they know the cursor and scroll positions
+    DocumentManager::saveSession();
+
+    QMainWindow::closeEvent(event);
+}
+
 // private slot
 void MainWindow::newDocument()
 {
@@ -333,6 +367,24 @@ void MainWindow::showFindInFilesWidget()
     m_ui->widgetFindInFiles->prepareForShow();
 }
 
+// private slot
+void MainWindow::showQuickOpenDialog()
+{
+    // Created on first use and kept, so that the project file index survives between uses
+    if (m_quickOpenDialog == NULL) {
+        m_quickOpenDialog = new QuickOpenDialog(this);
+    }
+
+    m_quickOpenDialog->prepareForShow();
+    m_quickOpenDialog->show();
+}
+
+// private slot
+void MainWindow::goToPreviousFile()
+{
+    RecentFiles::goToPreviousFile();
+}
+
 // private slot
 void MainWindow::showEncodingDialog()
 {
@@ -349,6 +401,16 @@ void MainWindow::setWordWrapping(bool enable)
     editor->setWordWrapping(enable);
 }
 
+// private slot
+void MainWindow::setFollowing(bool enable)
+{
+    Editor *editor = DocumentManager::editor(DocumentManager::current());
+
+    Q_ASSERT(editor != NULL);
+
+    editor->setFollowing(enable);
+}
+
 // private slot
 void MainWindow::openTerminal()
 {
@@ -359,6 +421,54 @@ void MainWindow::openTerminal()
     QProcess::startDetached(program, arguments, workingDirectory);
 }
 
+// private slot
+void MainWindow::showStartupReport()
+{
+    QDialog dialog(this);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    QPlainTextEdit *editReport = new QPlainTextEdit(StartupProfiler::report());
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+
+    editReport->setReadOnly(true);
+    editReport->setLineWrapMode(QPlainTextEdit::NoWrap);
+    editReport->setFont(MonospaceFontMetrics::font());
+
+    buttonBox->addButton("Save Trace...", QDialogButtonBox::AcceptRole);
+
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    layout->addWidget(editReport);
+    layout->addWidget(buttonBox);
+
+    dialog.setWindowTitle("Startup Report");
+    dialog.resize(700, 500);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    // The trace is Chrome trace event JSON, it can be opened in chrome://tracing or Perfetto
+    const Location &location = FileDialog::getSaveLocation(this, Location::home().file("startup-trace.json"));
+    QString error;
+
+    if (!location.isEmpty() && !StartupProfiler::writeChromeTrace(location.path(), &error)) {
+        QMessageBox::critical(this, "Save Trace Error", error);
+    }
+}
+
+// private slot
+void MainWindow::showLatencyDialog()
+{
+    if (m_latencyDialog == NULL) {
+        m_latencyDialog = new LatencyDialog(this);
+    }
+
+    m_latencyDialog->show();
+    m_latencyDialog->raise();
+    m_latencyDialog->activateWindow();
+}
+
 // private slot
 void MainWindow::showUnsavedDiffWidget()
 {
@@ -378,9 +488,10 @@ void MainWindow::addEditor(Document *document)
 {
     Editor *editor = DocumentManager::editor(document);
 
-    Q_ASSERT(editor != NULL);
-
-    m_ui->widgetStackedEditors->addWidget(editor->widget());
+    // A restored document gets its editor once it becomes current
+    if (editor != NULL) {
+        m_ui->widgetStackedEditors->addWidget(editor->widget());
+    }
 }
 
 // private slot
@@ -388,9 +499,9 @@ void MainWindow::removeEditor(Document *document)
 {
     Editor *editor = DocumentManager::editor(document);
 
-    Q_ASSERT(editor != NULL);
-
-    m_ui->widgetStackedEditors->removeWidget(editor->widget());
+    if (editor != NULL) {
+        m_ui->widgetStackedEditors->removeWidget(editor->widget());
+    }
 }
 
 // private slot
@@ -408,6 +519,7 @@ void MainWindow::setCurrentDocument(Document *document)
         disconnect(m_lastCurrentDocument, &Document::modificationChanged, m_ui->actionRevert, &QAction::setEnabled);
         disconnect(m_lastCurrentDocument, &Document::modificationChanged, m_ui->actionRevert_Tool, &QAction::setEnabled);
         disconnect(editor, &Editor::actionAvailabilityChanged, this, &MainWindow::updateEditMenuAction);
+        disconnect(editor, &Editor::followingChanged, m_ui->actionFollow, &QAction::setChecked);
 
         m_lastCurrentDocument = NULL;
     }
@@ -450,6 +562,8 @@ void MainWindow::setCurrentDocument(Document *document)
         m_ui->actionEncoding->setEnabled(false);
         m_ui->actionWordWrapping->setEnabled(false);
         m_ui->actionWordWrapping->setChecked(false);
+        m_ui->actionFollow->setEnabled(false);
+        m_ui->actionFollow->setChecked(false);
     } else {
         const Location &location = document->location();
 
@@ -459,6 +573,10 @@ void MainWindow::setCurrentDocument(Document *document)
 
         Q_ASSERT(editor != NULL);
 
+        if (m_ui->widgetStackedEditors->indexOf(editor->widget()) < 0) {
+            m_ui->widgetStackedEditors->addWidget(editor->widget());
+        }
+
         m_ui->widgetStackedEditors->setCurrentWidget(editor->widget());
 
         // File menu
@@ -491,6 +609,8 @@ void MainWindow::setCurrentDocument(Document *document)
         m_ui->actionEncoding->setEnabled(true);
         m_ui->actionWordWrapping->setEnabled(editor->hasFeature(Editor::WordWrapping));
         m_ui->actionWordWrapping->setChecked(editor->isWordWrapping());
+        m_ui->actionFollow->setEnabled(editor->hasFeature(Editor::Following));
+        m_ui->actionFollow->setChecked(editor->isFollowing());
 
         connect(document, &Document::locationChanged, this, &MainWindow::updateWindowTitle);
         connect(document, &Document::locationChanged, this, &MainWindow::updateFileMenuText);
@@ -499,9 +619,13 @@ void MainWindow::setCurrentDocument(Document *document)
         connect(document, &Document::modificationChanged, m_ui->actionRevert, &QAction::setEnabled);
         connect(document, &Document::modificationChanged, m_ui->actionRevert_Tool, &QAction::setEnabled);
         connect(editor, &Editor::actionAvailabilityChanged, this, &MainWindow::updateEditMenuAction);
+        connect(editor, &Editor::followingChanged, m_ui->actionFollow, &QAction::setChecked);
 
         m_lastCurrentDocument = document;
     }
+
+    m_ui->widgetUnsavedDiff->setDocument(document);
+    m_ui->widgetGitDiff->setDocument(document);
 }
 
 // private slot
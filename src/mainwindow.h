@@ -24,7 +24,9 @@
 #include <QMainWindow>
 
 class Document;
+class LatencyDialog;
 class Location;
+class QuickOpenDialog;
 
 namespace Ui {
 class MainWindow;
@@ -41,6 +43,9 @@ public:
 
     static MainWindow *instance() { return s_instance; }
 
+protected:
+    void closeEvent(QCloseEvent *event);
+
 private slots:
     void newDocument();
     void openDocuments();
@@ -61,10 +66,16 @@ private slots:
     void showFindAndReplaceWidget();
     void showFindInFilesWidget();
 
+    void showQuickOpenDialog();
+    void goToPreviousFile();
+
     void showEncodingDialog();
     void setWordWrapping(bool enable);
+    void setFollowing(bool enable);
 
     void openTerminal();
+    void showStartupReport();
+    void showLatencyDialog();
     void showUnsavedDiffWidget();
     void showGitDiffWidget();
 
@@ -84,6 +95,8 @@ private:
 
     Ui::MainWindow *m_ui;
     Document *m_lastCurrentDocument; // owned by DocumentManager
+    QuickOpenDialog *m_quickOpenDialog;
+    LatencyDialog *m_latencyDialog; // created on first use
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,336 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "quickopendialog.h"
+
+#include "document.h"
+#include "documentmanager.h"
+#include "eventfilter.h"
+#include "location.h"
+#include "recentfiles.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+QuickOpenDialog::QuickOpenDialog(QWidget *parent) :
+    QDialog(parent, Qt::Popup),
+    m_editQuery(new QLineEdit(this)),
+    m_treeMatches(new QTreeWidget(this)),
+    m_labelStatus(new QLabel(this)),
+    m_projectIndexTruncated(false),
+    m_indexer(NULL),
+    m_indexGeneration(0)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    layout->setContentsMargins(5, 5, 5, 5);
+    layout->addWidget(m_editQuery);
+    layout->addWidget(m_treeMatches);
+    layout->addWidget(m_labelStatus);
+
+    m_editQuery->installEventFilter(EventFilter::instance());
+    m_editQuery->installEventFilter(this);
+    m_editQuery->setClearButtonEnabled(true);
+    m_editQuery->setPlaceholderText("Go to File");
+
+    m_treeMatches->setColumnCount(2);
+    m_treeMatches->setHeaderHidden(true);
+    m_treeMatches->setRootIsDecorated(false);
+    m_treeMatches->setUniformRowHeights(true);
+    m_treeMatches->setFocusPolicy(Qt::NoFocus);
+    m_treeMatches->setTextElideMode(Qt::ElideLeft);
+    m_treeMatches->header()->setStretchLastSection(true);
+    m_treeMatches->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+
+    resize(700, 400);
+
+    connect(m_editQuery, &QLineEdit::textChanged, this, &QuickOpenDialog::updateMatches);
+    connect(m_treeMatches, &QTreeWidget::itemActivated, this, &QuickOpenDialog::openItem);
+}
+
+QuickOpenDialog::~QuickOpenDialog()
+{
+    if (m_indexer != NULL) {
+        m_indexer->requestInterruption();
+        m_indexer->wait();
+    }
+}
+
+void QuickOpenDialog::prepareForShow()
+{
+    // Open documents and recent files change all the time, but there are only a few of them
+    m_documentIndex.clear();
+    m_documentPaths.clear();
+
+    foreach (Document *document, DocumentManager::documents()) {
+        const Location &location = document->location();
+
+        if (!location.isEmpty()) {
+            m_documentIndex.add(location.path(), FileIndex::OpenSource);
+            m_documentPaths.insert(location.path());
+        }
+    }
+
+    for (const RecentFilesList::Entry *entry = RecentFiles::list(RecentFiles::Opened)->first(); entry != NULL;
+         entry = entry->next) {
+        const QString &path = entry->location.path();
+
+        if (!m_documentPaths.contains(path)) {
+            m_documentIndex.add(path, FileIndex::RecentSource);
+            m_documentPaths.insert(path);
+        }
+    }
+
+    // The project index is only rebuilt if the current document belongs to another project
+    Document *current = DocumentManager::current();
+
+    if (current != NULL && !current->location().isEmpty()) {
+        const QString &rootPath = projectRootPath(current->location());
+
+        if (rootPath != m_projectRootPath) {
+            startIndexing(rootPath);
+        }
+    }
+
+    QWidget *window = parentWidget() != NULL ? parentWidget()->window() : NULL;
+
+    if (window != NULL) {
+        move(window->mapToGlobal(QPoint((window->width() - width()) / 2, 50)));
+    }
+
+    m_editQuery->selectAll();
+    m_editQuery->setFocus();
+
+    updateMatches();
+    updateStatus();
+}
+
+// protected
+bool QuickOpenDialog::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == m_editQuery && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            // Navigate the matches while keeping the focus in the query edit
+            QApplication::sendEvent(m_treeMatches, event);
+
+            return true;
+
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            if (m_treeMatches->currentItem() != NULL) {
+                openItem(m_treeMatches->currentItem());
+            }
+
+            return true;
+
+        default:
+            break;
+        }
+    }
+
+    return QDialog::eventFilter(object, event);
+}
+
+// private slot
+void QuickOpenDialog::updateMatches()
+{
+    m_treeMatches->clear();
+
+    const QString &query = m_editQuery->text();
+    QList<QTreeWidgetItem *> items;
+
+    if (query.trimmed().isEmpty()) {
+        // Without a query show the open documents and then the recent files
+        for (int entry = 0; entry < m_documentIndex.size() && entry < MaximumMatchCount; ++entry) {
+            items.append(createItem(m_documentIndex, entry));
+        }
+    } else {
+        // Project matches that are open or recent files show up among the document matches already. Ask for enough
+        // project matches to fill the list even if all document paths are among them.
+        const QVector<FileIndex::Match> &documentMatches = m_documentIndex.search(query, MaximumMatchCount);
+        const QVector<FileIndex::Match> &projectMatches = m_projectIndex.search(query, MaximumMatchCount
+                                                                                       + m_documentPaths.size());
+        int documentIndex = 0;
+        int projectIndex = 0;
+
+        while (items.size() < MaximumMatchCount) {
+            bool hasDocumentMatch = documentIndex < documentMatches.size();
+            bool hasProjectMatch = projectIndex < projectMatches.size();
+
+            if (!hasDocumentMatch && !hasProjectMatch) {
+                break;
+            }
+
+            if (hasProjectMatch) {
+                const QString &path = m_projectIndex.path(projectMatches.at(projectIndex).entry);
+
+                if (m_documentPaths.contains(path)) {
+                    ++projectIndex;
+                    continue;
+                }
+            }
+
+            if (!hasProjectMatch || (hasDocumentMatch && documentMatches.at(documentIndex).score
+                                                         >= projectMatches.at(projectIndex).score)) {
+                items.append(createItem(m_documentIndex, documentMatches.at(documentIndex++).entry));
+            } else {
+                items.append(createItem(m_projectIndex, projectMatches.at(projectIndex++).entry));
+            }
+        }
+    }
+
+    m_treeMatches->addTopLevelItems(items);
+
+    if (!items.isEmpty()) {
+        m_treeMatches->setCurrentItem(items.first());
+    }
+}
+
+// private slot
+void QuickOpenDialog::openItem(QTreeWidgetItem *item)
+{
+    Q_ASSERT(item != NULL);
+
+    Location location(item->data(0, Qt::UserRole).value<QString>());
+    Document *document = DocumentManager::find(location);
+
+    accept();
+
+    if (document != NULL) {
+        DocumentManager::setCurrent(document);
+
+        return;
+    }
+
+    // Reopen recent files with the type and codec they had, project matches can be recent files too
+    const RecentFilesList::Entry *entry = RecentFiles::list(RecentFiles::Opened)->find(location);
+
+    if (entry != NULL) {
+        RecentFiles::open(entry);
+    } else {
+        DocumentManager::open(location, Document::Text, NULL);
+    }
+}
+
+// private slot
+void QuickOpenDialog::finishIndexing(int generation)
+{
+    if (generation != m_indexGeneration || m_indexer == NULL) {
+        return; // Outdated, a newer indexer replaced this one already
+    }
+
+    m_indexer->wait();
+
+    m_projectIndex = m_indexer->index();
+    m_projectIndexTruncated = m_indexer->isTruncated();
+
+    m_indexer->deleteLater();
+    m_indexer = NULL;
+
+    if (isVisible()) {
+        updateMatches();
+        updateStatus();
+    }
+}
+
+// private static
+QString QuickOpenDialog::projectRootPath(const Location &location)
+{
+    QDir directory(location.directoryPath());
+
+    do {
+        if (QFileInfo(directory.filePath(".git")).isDir()) {
+            return directory.absolutePath();
+        }
+    } while (directory.cdUp());
+
+    return QDir(location.directoryPath()).absolutePath();
+}
+
+// private static
+QTreeWidgetItem *QuickOpenDialog::createItem(const FileIndex &index, int entry)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem;
+    const QString &path = index.path(entry);
+
+    item->setIcon(0, QIcon(":/icons/16x16/file.png"));
+    item->setText(0, index.fileName(entry));
+    item->setText(1, index.directoryPath(entry));
+    item->setToolTip(0, path);
+    item->setToolTip(1, path);
+    item->setData(0, Qt::UserRole, path);
+
+    if (index.source(entry) == FileIndex::ProjectSource) {
+        item->setForeground(0, Qt::darkGray);
+    }
+
+    return item;
+}
+
+// private
+void QuickOpenDialog::startIndexing(const QString &rootPath)
+{
+    if (m_indexer != NULL) {
+        m_indexer->requestInterruption();
+        m_indexer->wait();
+        m_indexer->deleteLater();
+        m_indexer = NULL;
+    }
+
+    m_projectRootPath = rootPath;
+    m_projectIndex.clear();
+    m_projectIndexTruncated = false;
+
+    m_indexer = new FileIndexer(++m_indexGeneration, rootPath, this);
+
+    connect(m_indexer, &FileIndexer::indexFinished, this, &QuickOpenDialog::finishIndexing);
+
+    m_indexer->start(QThread::LowPriority);
+}
+
+// private
+void QuickOpenDialog::updateStatus()
+{
+    if (m_projectRootPath.isEmpty()) {
+        m_labelStatus->setText("No project");
+    } else if (m_indexer != NULL) {
+        m_labelStatus->setText(QString("Indexing %1...").arg(QDir::toNativeSeparators(m_projectRootPath)));
+    } else {
+        QString text = QString("%1 files in %2").arg(m_projectIndex.size())
+                                                .arg(QDir::toNativeSeparators(m_projectRootPath));
+
+        if (m_projectIndexTruncated) {
+            text += " (truncated)";
+        }
+
+        m_labelStatus->setText(text);
+    }
+}
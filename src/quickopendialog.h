@@ -0,0 +1,83 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+#include "fileindex.h"
+
+#include <QDialog>
+#include <QSet>
+
+class QLabel;
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+class Document;
+class Location;
+
+// Popup for jumping to a file by typing a fuzzy part of its path. Matches open documents, recently opened files and
+// all files in the project of the current document. The project is the closest parent directory containing a .git
+// directory, its file index is built in the background and kept until the project changes.
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QuickOpenDialog)
+
+public:
+    enum {
+        MaximumMatchCount = 50
+    };
+
+    explicit QuickOpenDialog(QWidget *parent = NULL);
+    ~QuickOpenDialog();
+
+    void prepareForShow();
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event);
+
+private slots:
+    void updateMatches();
+    void openItem(QTreeWidgetItem *item);
+    void finishIndexing(int generation);
+
+private:
+    static QString projectRootPath(const Location &location);
+    static QTreeWidgetItem *createItem(const FileIndex &index, int entry);
+
+    void startIndexing(const QString &rootPath);
+    void updateStatus();
+
+    QLineEdit *m_editQuery;
+    QTreeWidget *m_treeMatches;
+    QLabel *m_labelStatus;
+
+    FileIndex m_documentIndex; // rebuilt on every show
+    QSet<QString> m_documentPaths;
+
+    FileIndex m_projectIndex;
+    QString m_projectRootPath;
+    bool m_projectIndexTruncated;
+    FileIndexer *m_indexer; // NULL if not indexing
+    int m_indexGeneration;
+};
+
+#endif // QUICKOPENDIALOG_H
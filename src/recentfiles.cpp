@@ -0,0 +1,367 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "recentfiles.h"
+
+#include "documentmanager.h"
+#include "settings.h"
+#include "textcodec.h"
+#include "textdocument.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QTimerEvent>
+
+RecentFilesList::RecentFilesList(int maximumLength) :
+    m_maximumLength(maximumLength),
+    m_first(NULL),
+    m_last(NULL)
+{
+    Q_ASSERT(maximumLength > 0);
+}
+
+RecentFilesList::~RecentFilesList()
+{
+    clear();
+}
+
+void RecentFilesList::touch(const Location &location, Document::Type type, qint64 codecNumber)
+{
+    Entry *entry = m_entries.value(location, NULL);
+
+    if (entry != NULL) {
+        unlink(entry);
+    } else {
+        if (m_entries.size() >= m_maximumLength) {
+            Entry *last = m_last;
+
+            unlink(last);
+            m_entries.remove(last->location);
+
+            delete last;
+        }
+
+        entry = new Entry;
+        entry->location = location;
+
+        m_entries.insert(location, entry);
+    }
+
+    entry->type = type;
+    entry->codecNumber = codecNumber;
+
+    link(entry);
+}
+
+void RecentFilesList::clear()
+{
+    qDeleteAll(m_entries);
+
+    m_entries.clear();
+    m_first = NULL;
+    m_last = NULL;
+}
+
+// private
+void RecentFilesList::link(Entry *entry)
+{
+    entry->previous = NULL;
+    entry->next = m_first;
+
+    if (m_first != NULL) {
+        m_first->previous = entry;
+    } else {
+        m_last = entry;
+    }
+
+    m_first = entry;
+}
+
+// private
+void RecentFilesList::unlink(Entry *entry)
+{
+    if (entry->previous != NULL) {
+        entry->previous->next = entry->next;
+    } else {
+        m_first = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->previous = entry->previous;
+    } else {
+        m_last = entry->previous;
+    }
+
+    entry->previous = NULL;
+    entry->next = NULL;
+}
+
+RecentFiles *RecentFiles::s_instance = NULL;
+
+RecentFiles::RecentFiles(QObject *parent) :
+    QObject(parent),
+    m_loaded(false)
+{
+    s_instance = this;
+
+    for (int list = 0; list < ListCount; ++list) {
+        m_lists[list] = new RecentFilesList(MaximumLength);
+    }
+
+    connect(DocumentManager::instance(), &DocumentManager::opened, this, &RecentFiles::addOpenedDocument);
+    connect(DocumentManager::instance(), &DocumentManager::currentChanged, this, &RecentFiles::addViewedDocument);
+    connect(DocumentManager::instance(), &DocumentManager::aboutToBeClosed, this, &RecentFiles::addClosedDocument);
+}
+
+RecentFiles::~RecentFiles()
+{
+    if (m_saveTimer.isActive()) {
+        save();
+    }
+
+    for (int list = 0; list < ListCount; ++list) {
+        delete m_lists[list];
+    }
+
+    s_instance = NULL;
+}
+
+// static
+const RecentFilesList *RecentFiles::list(List list)
+{
+    if (!s_instance->m_loaded) {
+        s_instance->load();
+    }
+
+    return s_instance->m_lists[list];
+}
+
+// static
+void RecentFiles::open(const RecentFilesList::Entry *entry)
+{
+    Q_ASSERT(entry != NULL);
+
+    Document *document = DocumentManager::find(entry->location);
+
+    if (document != NULL) {
+        DocumentManager::setCurrent(document);
+
+        return;
+    }
+
+    TextCodec *codec = NULL;
+
+    if (entry->type == Document::Text && entry->codecNumber >= 0) {
+        codec = TextCodec::fromNumber(entry->codecNumber);
+    }
+
+    DocumentManager::open(entry->location, entry->type, codec);
+}
+
+// static
+void RecentFiles::goToPreviousFile()
+{
+    const RecentFilesList::Entry *first = list(Viewed)->first();
+
+    if (first != NULL && first->next != NULL) {
+        open(first->next);
+    }
+}
+
+// protected
+void RecentFiles::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_saveTimer.timerId()) {
+        m_saveTimer.stop();
+
+        save();
+    }
+
+    QObject::timerEvent(event);
+}
+
+// private slot
+void RecentFiles::addOpenedDocument(Document *document)
+{
+    connect(document, &Document::locationChanged, this, &RecentFiles::updateLocationOfSender);
+    connect(document, &Document::modificationChanged, this, &RecentFiles::updateModificationOfSender);
+
+    touch(Opened, document);
+}
+
+// private slot
+void RecentFiles::addViewedDocument(Document *document)
+{
+    if (document != NULL) {
+        touch(Viewed, document);
+    }
+}
+
+// private slot
+void RecentFiles::addClosedDocument(Document *document)
+{
+    disconnect(document, &Document::modificationChanged, this, &RecentFiles::updateModificationOfSender);
+    disconnect(document, &Document::locationChanged, this, &RecentFiles::updateLocationOfSender);
+
+    touch(Closed, document);
+}
+
+// private slot
+void RecentFiles::updateLocationOfSender()
+{
+    Document *document = qobject_cast<Document *>(sender());
+
+    Q_ASSERT(document != NULL);
+
+    // A document saved under a new location counts as opened there
+    touch(Opened, document);
+
+    if (document == DocumentManager::current()) {
+        touch(Viewed, document);
+    }
+}
+
+// private slot
+void RecentFiles::updateModificationOfSender(bool modified)
+{
+    Document *document = qobject_cast<Document *>(sender());
+
+    Q_ASSERT(document != NULL);
+
+    if (modified) {
+        touch(Modified, document);
+    }
+}
+
+// private
+void RecentFiles::touch(List list, Document *document)
+{
+    Q_ASSERT(document != NULL);
+
+    const Location &location = document->location();
+
+    if (location.isEmpty()) {
+        return; // Unnamed documents cannot be reopened
+    }
+
+    if (!m_loaded) {
+        load();
+    }
+
+    qint64 codecNumber = -1;
+
+    // A document restored from the session has no codec until it is read, it's detected when reopening then
+    if (document->type() == Document::Text) {
+        TextCodec *codec = static_cast<TextDocument *>(document)->codec();
+
+        codecNumber = codec != NULL ? codec->number() : -1;
+    }
+
+    RecentFilesList *recentFiles = m_lists[list];
+    const RecentFilesList::Entry *first = recentFiles->first();
+
+    // Viewing the current document again is the common case, skip it before telling views about a change
+    if (first != NULL && first->type == document->type() && first->codecNumber == codecNumber
+        && first->location == location) {
+        return;
+    }
+
+    emit aboutToChange(list);
+
+    recentFiles->touch(location, document->type(), codecNumber);
+
+    emit changed(list);
+
+    m_saveTimer.start(1000, this);
+}
+
+// private
+void RecentFiles::load()
+{
+    Q_ASSERT(!m_loaded);
+
+    m_loaded = true;
+
+    // Format: version, then per list its length and its entries from least to most recent. Each entry is a path as
+    // UTF-8, a document type and a codec number.
+    const QByteArray &data = Settings::settings()->value("RecentFiles/Lists").toByteArray();
+
+    if (data.isEmpty()) {
+        return;
+    }
+
+    QDataStream stream(data);
+    quint8 version;
+
+    stream >> version;
+
+    if (version != FormatVersion) {
+        qDebug() << "RecentFiles: Ignoring lists with unknown format version" << version;
+
+        return;
+    }
+
+    for (int list = 0; list < ListCount; ++list) {
+        quint16 length;
+
+        stream >> length;
+
+        for (int i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
+            QByteArray path;
+            quint8 type;
+            qint64 codecNumber;
+
+            stream >> path >> type >> codecNumber;
+
+            if (stream.status() == QDataStream::Ok && !path.isEmpty() && type <= Document::Binary) {
+                m_lists[list]->touch(QString::fromUtf8(path), Document::Type(type), codecNumber);
+            }
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "RecentFiles: Lists are truncated";
+    }
+}
+
+// private
+void RecentFiles::save()
+{
+    if (!m_loaded) {
+        return; // Nothing changed
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    stream << quint8(FormatVersion);
+
+    for (int list = 0; list < ListCount; ++list) {
+        const RecentFilesList *recentFiles = m_lists[list];
+
+        stream << quint16(recentFiles->size());
+
+        // Least recent first, so that loading can touch the entries in order
+        for (const RecentFilesList::Entry *entry = recentFiles->last(); entry != NULL; entry = entry->previous) {
+            stream << entry->location.path().toUtf8() << quint8(entry->type) << entry->codecNumber;
+        }
+    }
+
+    Settings::settings()->setValue("RecentFiles/Lists", data);
+}
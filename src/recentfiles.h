@@ -0,0 +1,131 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef RECENTFILES_H
+#define RECENTFILES_H
+
+#include "document.h"
+#include "location.h"
+
+#include <QBasicTimer>
+#include <QHash>
+#include <QObject>
+
+// Most recently used list of locations with a maximum length. The entries form a doubly linked list from most to least
+// recent, the hash finds the entry of a location. Touching a location moves its entry to the front and evicting drops
+// the entry at the back, both in constant time.
+class RecentFilesList
+{
+    Q_DISABLE_COPY(RecentFilesList)
+
+public:
+    struct Entry {
+        Location location;
+        Document::Type type; // for reopening
+        qint64 codecNumber; // for reopening, -1 if unknown
+        Entry *previous; // more recent entry
+        Entry *next; // less recent entry
+    };
+
+    explicit RecentFilesList(int maximumLength);
+    ~RecentFilesList();
+
+    int size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    const Entry *first() const { return m_first; }
+    const Entry *last() const { return m_last; }
+    const Entry *find(const Location &location) const { return m_entries.value(location, NULL); } // NULL if absent
+
+    void touch(const Location &location, Document::Type type, qint64 codecNumber);
+    void clear();
+
+private:
+    void link(Entry *entry);
+    void unlink(Entry *entry);
+
+    int m_maximumLength;
+    QHash<Location, Entry *> m_entries; // values owned by this
+    Entry *m_first; // most recent entry, NULL if empty
+    Entry *m_last; // least recent entry, NULL if empty
+};
+
+// Keeps the recently opened, viewed, modified and closed files up-to-date with the DocumentManager. The lists are
+// stored as a single binary blob in the settings, which is only read when a list is accessed first and written a
+// moment after the last change.
+class RecentFiles : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(RecentFiles)
+
+public:
+    enum List {
+        Opened,
+        Viewed,
+        Modified,
+        Closed,
+        ListCount
+    };
+
+    enum {
+        MaximumLength = 100
+    };
+
+    explicit RecentFiles(QObject *parent = NULL);
+    ~RecentFiles();
+
+    static RecentFiles *instance() { return s_instance; }
+
+    static const RecentFilesList *list(List list);
+    static void open(const RecentFilesList::Entry *entry);
+
+    // Switches to the second most recently viewed file. Because that makes it the most recently viewed file, using this
+    // repeatedly toggles between the two most recently viewed files.
+    static void goToPreviousFile();
+
+signals:
+    void aboutToChange(RecentFiles::List list);
+    void changed(RecentFiles::List list);
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void addOpenedDocument(Document *document);
+    void addViewedDocument(Document *document);
+    void addClosedDocument(Document *document);
+    void updateLocationOfSender();
+    void updateModificationOfSender(bool modified);
+
+private:
+    enum {
+        FormatVersion = 1
+    };
+
+    void touch(List list, Document *document);
+    void load();
+    void save();
+
+    static RecentFiles *s_instance;
+
+    bool m_loaded;
+    RecentFilesList *m_lists[ListCount];
+    QBasicTimer m_saveTimer;
+};
+
+#endif // RECENTFILES_H
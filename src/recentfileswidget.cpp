@@ -19,8 +19,123 @@
 #include "recentfileswidget.h"
 #include "ui_recentfileswidget.h"
 
+#include "documentmanager.h"
+
+#include <QAbstractListModel>
 #include <QActionGroup>
+#include <QFont>
+#include <QIcon>
 #include <QMenu>
+#include <QTreeView>
+
+// Flat view of one of the RecentFiles lists, most recent first. The list is only loaded when the view asks for it, the
+// entries are then cached in row order until the list changes.
+class RecentFilesModel : public QAbstractListModel
+{
+public:
+    RecentFilesModel(RecentFiles::List list, QObject *parent) :
+        QAbstractListModel(parent),
+        m_list(list),
+        m_icon(":/icons/16x16/file.png"),
+        m_entriesValid(false)
+    {
+        connect(RecentFiles::instance(), &RecentFiles::aboutToChange, this, &RecentFilesModel::beginChange);
+        connect(RecentFiles::instance(), &RecentFiles::changed, this, &RecentFilesModel::endChange);
+        connect(DocumentManager::instance(), &DocumentManager::currentChanged, this, &RecentFilesModel::updateCurrent);
+    }
+
+    const RecentFilesList::Entry *entry(int row) const
+    {
+        updateEntries();
+
+        return m_entries.at(row);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        if (parent.isValid()) {
+            return 0;
+        }
+
+        updateEntries();
+
+        return m_entries.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if (!index.isValid()) {
+            return QVariant();
+        }
+
+        const RecentFilesList::Entry *entry = this->entry(index.row());
+
+        if (role == Qt::DisplayRole) {
+            return entry->location.fileName();
+        } else if (role == Qt::ToolTipRole) {
+            return entry->location.path();
+        } else if (role == Qt::DecorationRole) {
+            return m_icon;
+        } else if (role == Qt::FontRole) {
+            Document *current = DocumentManager::current();
+
+            if (current != NULL && current->location() == entry->location) {
+                QFont font;
+
+                font.setUnderline(true);
+
+                return font;
+            }
+        }
+
+        return QVariant();
+    }
+
+private:
+    void beginChange(RecentFiles::List list)
+    {
+        if (list == m_list) {
+            beginResetModel();
+        }
+    }
+
+    void endChange(RecentFiles::List list)
+    {
+        if (list == m_list) {
+            m_entriesValid = false;
+
+            endResetModel();
+        }
+    }
+
+    void updateCurrent()
+    {
+        if (m_entriesValid && !m_entries.isEmpty()) {
+            emit dataChanged(index(0), index(m_entries.size() - 1));
+        }
+    }
+
+    void updateEntries() const
+    {
+        if (m_entriesValid) {
+            return;
+        }
+
+        m_entries.clear();
+
+        for (const RecentFilesList::Entry *entry = RecentFiles::list(m_list)->first(); entry != NULL;
+             entry = entry->next) {
+            m_entries.append(entry);
+        }
+
+        m_entriesValid = true;
+    }
+
+    RecentFiles::List m_list;
+    QIcon m_icon;
+    mutable QVector<const RecentFilesList::Entry *> m_entries; // owned by RecentFilesList
+    mutable bool m_entriesValid;
+};
 
 RecentFilesWidget::RecentFilesWidget(QWidget *parent) :
     QWidget(parent),
@@ -28,10 +143,10 @@ RecentFilesWidget::RecentFilesWidget(QWidget *parent) :
 {
     m_ui->setupUi(this);
 
-    m_ui->widgetOpenedFiles->setOption(FilesWidget::KeepAfterClose, true);
-    m_ui->widgetViewedFiles->setOption(FilesWidget::KeepAfterClose, true);
-    m_ui->widgetModifiedFiles->setOption(FilesWidget::KeepAfterClose, true);
-    m_ui->widgetClosedFiles->setOption(FilesWidget::KeepAfterClose, true);
+    setupTree(m_ui->treeOpenedFiles, RecentFiles::Opened);
+    setupTree(m_ui->treeViewedFiles, RecentFiles::Viewed);
+    setupTree(m_ui->treeModifiedFiles, RecentFiles::Modified);
+    setupTree(m_ui->treeClosedFiles, RecentFiles::Closed);
 
     QMenu *menuMode = new QMenu;
 
@@ -62,19 +177,6 @@ RecentFilesWidget::RecentFilesWidget(QWidget *parent) :
     connect(m_ui->stackedWidget, &QStackedWidget::currentChanged, this, &RecentFilesWidget::updateModeMenuAndTitle);
 
     showViewedFiles();
-
-    // FIXME: the recently viewed mode always shows the currently viewed document at the top. dbl clicking an item
-    // in the list makes it the currently view document and moves the item to the top of the list. the go to previous
-    // file action makes the second item in the list the currently viewed document and moves it to the top of the list.
-    // this makes the go to previous file action toggle between the two most recently viewed documents.
-    //
-    // the recently opened mode shows files in the order they were opened. closing and reopening a file moves it to the
-    // top of the list
-    //
-    // the recently closed mode shows files in the order they were closed. reopening and closing a file moves it to the
-    // top of the list
-    //
-    // all three list have a maximum length of 100 items
 }
 
 RecentFilesWidget::~RecentFilesWidget()
@@ -85,25 +187,25 @@ RecentFilesWidget::~RecentFilesWidget()
 // private slot
 void RecentFilesWidget::showOpenedFiles()
 {
-    m_ui->stackedWidget->setCurrentWidget(m_ui->widgetOpenedFiles);
+    m_ui->stackedWidget->setCurrentWidget(m_ui->treeOpenedFiles);
 }
 
 // private slot
 void RecentFilesWidget::showViewedFiles()
 {
-    m_ui->stackedWidget->setCurrentWidget(m_ui->widgetViewedFiles);
+    m_ui->stackedWidget->setCurrentWidget(m_ui->treeViewedFiles);
 }
 
 // private slot
 void RecentFilesWidget::showModifiedFiles()
 {
-    m_ui->stackedWidget->setCurrentWidget(m_ui->widgetModifiedFiles);
+    m_ui->stackedWidget->setCurrentWidget(m_ui->treeModifiedFiles);
 }
 
 // private slot
 void RecentFilesWidget::showClosedFiles()
 {
-    m_ui->stackedWidget->setCurrentWidget(m_ui->widgetClosedFiles);
+    m_ui->stackedWidget->setCurrentWidget(m_ui->treeClosedFiles);
 }
 
 // private slot
@@ -111,17 +213,39 @@ void RecentFilesWidget::updateModeMenuAndTitle()
 {
     QWidget *currentWidget = m_ui->stackedWidget->currentWidget();
 
-    if (currentWidget == m_ui->widgetOpenedFiles) {
+    if (currentWidget == m_ui->treeOpenedFiles) {
         m_actionOpened->setChecked(true);
         m_ui->labelTitle->setText(m_actionOpened->text());
-    } else if (currentWidget == m_ui->widgetViewedFiles) {
+    } else if (currentWidget == m_ui->treeViewedFiles) {
         m_actionViewed->setChecked(true);
         m_ui->labelTitle->setText(m_actionViewed->text());
-    } else if (currentWidget == m_ui->widgetModifiedFiles) {
+    } else if (currentWidget == m_ui->treeModifiedFiles) {
         m_actionModified->setChecked(true);
         m_ui->labelTitle->setText(m_actionModified->text());
-    } else if (currentWidget == m_ui->widgetClosedFiles) {
+    } else if (currentWidget == m_ui->treeClosedFiles) {
         m_actionClosed->setChecked(true);
         m_ui->labelTitle->setText(m_actionClosed->text());
     }
 }
+
+// private slot
+void RecentFilesWidget::openIndex(const QModelIndex &index)
+{
+    Q_ASSERT(index.isValid());
+
+    RecentFiles::open(static_cast<const RecentFilesModel *>(index.model())->entry(index.row()));
+}
+
+// private
+void RecentFilesWidget::setupTree(QTreeView *tree, RecentFiles::List list)
+{
+    tree->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    tree->setEditTriggers(QTreeView::NoEditTriggers);
+    tree->setTextElideMode(Qt::ElideLeft);
+    tree->setHeaderHidden(true);
+    tree->setRootIsDecorated(false);
+    tree->setUniformRowHeights(true);
+    tree->setModel(new RecentFilesModel(list, tree));
+
+    connect(tree, &QTreeView::activated, this, &RecentFilesWidget::openIndex);
+}
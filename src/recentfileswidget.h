@@ -19,9 +19,13 @@
 #ifndef RECENTFILESWIDGET_H
 #define RECENTFILESWIDGET_H
 
+#include "recentfiles.h"
+
 #include <QWidget>
 
 class QActionGroup;
+class QModelIndex;
+class QTreeView;
 
 namespace Ui {
 class RecentFilesWidget;
@@ -42,8 +46,11 @@ private slots:
     void showModifiedFiles();
     void showClosedFiles();
     void updateModeMenuAndTitle();
+    void openIndex(const QModelIndex &index);
 
 private:
+    void setupTree(QTreeView *tree, RecentFiles::List list);
+
     Ui::RecentFilesWidget *m_ui;
 
     QActionGroup *m_actionGroup;
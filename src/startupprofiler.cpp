@@ -0,0 +1,209 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "startupprofiler.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+StartupProfiler *StartupProfiler::s_instance = NULL;
+
+StartupProfiler::StartupProfiler(QObject *parent) :
+    QObject(parent),
+    m_depth(0),
+    m_finishTime(-1)
+{
+    s_instance = this;
+
+    m_timer.start();
+}
+
+StartupProfiler::~StartupProfiler()
+{
+    s_instance = NULL;
+}
+
+// static
+int StartupProfiler::begin(const char *name)
+{
+    if (s_instance == NULL || s_instance->m_finishTime >= 0) {
+        return -1;
+    }
+
+    Phase phase;
+
+    phase.name = name;
+    phase.start = s_instance->elapsed();
+    phase.duration = -1;
+    phase.depth = s_instance->m_depth++;
+
+    s_instance->m_phases.append(phase);
+
+    return s_instance->m_phases.length() - 1;
+}
+
+// static
+void StartupProfiler::end(int index)
+{
+    if (s_instance == NULL || index < 0 || index >= s_instance->m_phases.length()) {
+        return;
+    }
+
+    Phase &phase = s_instance->m_phases[index];
+
+    phase.duration = s_instance->elapsed() - phase.start;
+
+    --s_instance->m_depth;
+}
+
+// static
+QString StartupProfiler::report()
+{
+    QString report("    Start  Duration  Phase\n");
+
+    foreach (const Phase &phase, s_instance->m_phases) {
+        QString duration = phase.duration >= 0 ? QString::number(phase.duration / 1000.0, 'f', 1) : QString("-");
+
+        report += QString("%1  %2  %3%4\n").arg(QString::number(phase.start / 1000.0, 'f', 1), 9)
+                                           .arg(duration, 8)
+                                           .arg(QString(phase.depth * 2, ' '), phase.name);
+    }
+
+    if (s_instance->m_finishTime >= 0) {
+        report += QString("\nThe event loop ran %1 ms after startup began.\n")
+                  .arg(QString::number(s_instance->m_finishTime / 1000.0, 'f', 1));
+    }
+
+    report += "\nTimes are in milliseconds since the start of main(), loading the executable and its libraries before "
+              "that isn't included.\n";
+
+    return report;
+}
+
+// static
+QByteArray StartupProfiler::chromeTrace()
+{
+    qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    QJsonObject threadName;
+    QJsonObject threadNameArgs;
+
+    threadNameArgs.insert("name", QString("main"));
+
+    threadName.insert("name", QString("thread_name"));
+    threadName.insert("ph", QString("M"));
+    threadName.insert("pid", (double)pid);
+    threadName.insert("tid", 1);
+    threadName.insert("args", threadNameArgs);
+
+    events.append(threadName);
+
+    foreach (const Phase &phase, s_instance->m_phases) {
+        if (phase.duration < 0) {
+            continue;
+        }
+
+        // Complete events, the viewer nests them by their times
+        QJsonObject event;
+
+        event.insert("name", phase.name);
+        event.insert("cat", QString("startup"));
+        event.insert("ph", QString("X"));
+        event.insert("ts", (double)phase.start);
+        event.insert("dur", (double)phase.duration);
+        event.insert("pid", (double)pid);
+        event.insert("tid", 1);
+
+        events.append(event);
+    }
+
+    if (s_instance->m_finishTime >= 0) {
+        QJsonObject event;
+
+        event.insert("name", QString("Event loop running"));
+        event.insert("cat", QString("startup"));
+        event.insert("ph", QString("i"));
+        event.insert("s", QString("g"));
+        event.insert("ts", (double)s_instance->m_finishTime);
+        event.insert("pid", (double)pid);
+        event.insert("tid", 1);
+
+        events.append(event);
+    }
+
+    QJsonObject trace;
+
+    trace.insert("traceEvents", events);
+    trace.insert("displayTimeUnit", QString("ms"));
+
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+// static
+bool StartupProfiler::writeChromeTrace(const QString &path, QString *error)
+{
+    Q_ASSERT(error != NULL);
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = QString("Could not open \"%1\" for writing: %2").arg(path, file.errorString());
+
+        return false;
+    }
+
+    const QByteArray &data = chromeTrace();
+
+    if (file.write(data) < data.length()) {
+        *error = QString("Short write to \"%1\" occurred.").arg(path);
+
+        return false;
+    }
+
+    return true;
+}
+
+// slot
+void StartupProfiler::finish()
+{
+    // Called once the event loop runs after the main window was shown, that ends the startup
+    if (m_finishTime >= 0) {
+        return;
+    }
+
+    m_finishTime = elapsed();
+
+    QString path = QString::fromLocal8Bit(qgetenv("ZERO_EDITOR_STARTUP_TRACE"));
+
+    foreach (const QString &argument, QCoreApplication::arguments()) {
+        if (argument.startsWith("--startup-trace=")) {
+            path = argument.mid(QString("--startup-trace=").length());
+        }
+    }
+
+    QString error;
+
+    if (!path.isEmpty() && !writeChromeTrace(path, &error)) {
+        qDebug() << "StartupProfiler: Writing trace failed:" << error;
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+
+// Times the phases of the startup until the event loop runs. The phases are shown in the startup report and can be
+// written as Chrome trace event JSON, for chrome://tracing or Perfetto, to the file given by --startup-trace=<path> or
+// the ZERO_EDITOR_STARTUP_TRACE environment variable.
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StartupProfiler)
+
+public:
+    struct Phase {
+        QString name;
+        qint64 start; // microseconds since the profiler was created
+        qint64 duration; // microseconds, -1 while the phase is running
+        int depth; // number of enclosing phases
+    };
+
+    explicit StartupProfiler(QObject *parent = NULL);
+    ~StartupProfiler();
+
+    static StartupProfiler *instance() { return s_instance; }
+
+    // Returns -1 if there is no profiler or the startup is already finished, phases after that aren't recorded
+    static int begin(const char *name);
+    static void end(int index);
+
+    static QList<Phase> phases() { return s_instance->m_phases; }
+    static qint64 finishTime() { return s_instance->m_finishTime; } // microseconds, -1 until finished
+
+    static QString report();
+    static QByteArray chromeTrace();
+    static bool writeChromeTrace(const QString &path, QString *error);
+
+public slots:
+    void finish();
+
+private:
+    qint64 elapsed() const { return m_timer.nsecsElapsed() / 1000; }
+
+    static StartupProfiler *s_instance;
+
+    QElapsedTimer m_timer;
+    QList<Phase> m_phases;
+    int m_depth;
+    qint64 m_finishTime;
+};
+
+// Times a phase of the startup until it's destroyed, finished or followed by the next phase
+class StartupPhase
+{
+    Q_DISABLE_COPY(StartupPhase)
+
+public:
+    explicit StartupPhase(const char *name) : m_index(StartupProfiler::begin(name)) { }
+    ~StartupPhase() { finish(); }
+
+    void next(const char *name)
+    {
+        finish();
+
+        m_index = StartupProfiler::begin(name);
+    }
+
+    void finish()
+    {
+        if (m_index >= 0) {
+            StartupProfiler::end(m_index);
+
+            m_index = -1;
+        }
+    }
+
+private:
+    int m_index;
+};
+
+#endif // STARTUPPROFILER_H
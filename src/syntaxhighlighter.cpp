@@ -18,6 +18,7 @@
 
 #include "syntaxhighlighter.h"
 
+#include "latencytracer.h"
 #include "lexer.h"
 
 #include <QFont>
@@ -29,6 +30,21 @@ SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent) :
 
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
+    LatencyTimer latencyTimer(LatencyTracer::Highlighting);
+    int state = previousBlockState();
+
+    foreach (const QTextLayout::FormatRange &range, formatLine(text, &state)) {
+        setFormat(range.start, range.length, range.format);
+    }
+
+    setCurrentBlockState(state);
+}
+
+// static
+QVector<QTextLayout::FormatRange> SyntaxHighlighter::formatLine(const QString &text, int *state)
+{
+    Q_ASSERT(state != NULL);
+
     QStringList keywords;
 
     keywords << "int";
@@ -49,35 +65,44 @@ void SyntaxHighlighter::highlightBlock(const QString &text)
 
     whitespaceFormat.setForeground(Qt::lightGray);
 
-    setCurrentBlockState(Lexer::InNothing);
-
-    int state = previousBlockState();
-
-    Lexer lexer(text, state >= 0 ? (Lexer::State)state : Lexer::InNothing);
+    Lexer lexer(text, *state >= 0 ? (Lexer::State)*state : Lexer::InNothing);
 
     lexer.setOption(Lexer::WhitespaceToken, true);
     lexer.setOption(Lexer::IdentifierToken, true);
     lexer.setOption(Lexer::CCommentToken, true);
 
+    QVector<QTextLayout::FormatRange> formats;
+    QTextLayout::FormatRange range;
     Token token;
 
     lexer.scan(&token);
 
     while (token.kind != Token::EndOfInput) {
+        range.start = token.offset;
+        range.length = token.length;
+
         if (token.kind == Token::Identifier) {
             const QString &identifier = text.mid(token.offset, token.length);
 
             if (keywords.contains(identifier)) {
-                setFormat(token.offset, token.length, keywordFormat);
+                range.format = keywordFormat;
+
+                formats.append(range);
             }
         } else if (token.kind == Token::CComment) {
-            setFormat(token.offset, token.length, commentFormat);
+            range.format = commentFormat;
+
+            formats.append(range);
         } else if (token.kind == Token::Whitespace) {
-            setFormat(token.offset, token.length, whitespaceFormat);
+            range.format = whitespaceFormat;
+
+            formats.append(range);
         }
 
         lexer.scan(&token);
     }
 
-    setCurrentBlockState(lexer.state());
+    *state = lexer.state();
+
+    return formats;
 }
@@ -20,6 +20,8 @@
 #define SYNTAXHIGHLIGHTER_H
 
 #include <QSyntaxHighlighter>
+#include <QTextLayout>
+#include <QVector>
 
 class SyntaxHighlighter : public QSyntaxHighlighter
 {
@@ -28,6 +30,10 @@ class SyntaxHighlighter : public QSyntaxHighlighter
 public:
     explicit SyntaxHighlighter(QTextDocument *parent);
 
+    // Formats a single line, state is the lexer state at its start and gets updated to the state at its end. Negative
+    // states are treated as Lexer::InNothing.
+    static QVector<QTextLayout::FormatRange> formatLine(const QString &text, int *state);
+
 protected:
     void highlightBlock(const QString &text);
 };
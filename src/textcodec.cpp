@@ -76,6 +76,14 @@ QByteArray TextCodec::encode(const QChar *input, int length, TextCodecState *sta
     return m_codec->fromUnicode(input, length, state != NULL ? &state->m_state : NULL);
 }
 
+bool TextCodec::hasAsciiLineBreaks() const
+{
+    const QChar lineBreaks[] = { '\r', '\n' };
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+
+    return m_codec->fromUnicode(lineBreaks, 2, &state) == "\r\n";
+}
+
 // static
 void TextCodec::initialize()
 {
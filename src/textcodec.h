@@ -33,7 +33,9 @@ class TextCodecState
 public:
     TextCodecState() : m_first(true) { }
 
-    bool hasError() const { return m_state.invalidChars != 0 || m_state.remainingChars != 0; }
+    bool hasError() const { return hasInvalidChars() || hasRemainingChars(); }
+    bool hasInvalidChars() const { return m_state.invalidChars != 0; }
+    bool hasRemainingChars() const { return m_state.remainingChars != 0; } // the input ended in the middle of a char
 
 private:
     bool m_first;
@@ -54,6 +56,10 @@ public:
     QString decode(const char *input, int length, TextCodecState *state = NULL) const;
     QByteArray encode(const QChar *input, int length, TextCodecState *state) const;
 
+    // True if "\r" and "\n" are encoded as single ASCII bytes, then lines can be found without decoding. This is not
+    // the case for UTF-16 and UTF-32.
+    bool hasAsciiLineBreaks() const;
+
     static void initialize();
     static QList<qint64> knownNumbers() { return s_codecs->keys(); }
     static TextCodec *fromNumber(qint64 number) { return s_codecs->value(number, NULL); }
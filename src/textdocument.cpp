@@ -19,6 +19,7 @@
 #include "textdocument.h"
 
 #include "monospacefontmetrics.h"
+#include "settings.h"
 #include "syntaxhighlighter.h"
 #include "textcodec.h"
 
@@ -26,7 +27,27 @@
 #include <QDebug>
 #include <QDir>
 #include <QPlainTextDocumentLayout>
+#include <QTextCursor>
 #include <QTextDocument>
+#include <QTimerEvent>
+
+// Number of blocks QTextDocument::setPlainText creates for the text
+static int blockCountForText(const QString &text)
+{
+    const QChar *characters = text.constData();
+    int length = text.length();
+    int count = 1;
+
+    for (int i = 0; i < length; ++i) {
+        ushort character = characters[i].unicode();
+
+        if (character == '\n' || (character == '\r' && (i + 1 >= length || characters[i + 1] != '\n'))) {
+            ++count;
+        }
+    }
+
+    return count;
+}
 
 TextDocument::TextDocument(TextCodec *codec, QObject *parent) :
     Document(Text, parent),
@@ -35,7 +56,15 @@ TextDocument::TextDocument(TextCodec *codec, QObject *parent) :
     m_syntaxHighlighter(NULL),
     m_codec(codec),
     m_hasDecodingError(false),
-    m_isEncodingModified(false)
+    m_isEncodingModified(false),
+    m_decodingState(NULL),
+    m_endsWithCarriageReturn(false),
+    m_isFollowing(false),
+    m_isTruncated(false),
+    m_mappedFile(NULL),
+    m_mappedData(NULL),
+    m_mappedSize(0),
+    m_lineIndexBuilder(NULL)
 {
     m_internalDocument->setDocumentLayout(new QPlainTextDocumentLayout(m_internalDocument));
 
@@ -62,6 +91,16 @@ TextDocument::~TextDocument()
 
     delete m_syntaxHighlighter;
     delete m_internalDocument;
+    delete m_decodingState;
+
+    if (m_lineIndexBuilder != NULL) {
+        m_lineIndexBuilder->requestInterruption();
+        m_lineIndexBuilder->wait();
+
+        delete m_lineIndexBuilder;
+    }
+
+    delete m_mappedFile; // also unmaps the file
 }
 
 bool TextDocument::load(const QByteArray &data, QString *error)
@@ -77,10 +116,30 @@ bool TextDocument::load(const QByteArray &data, QString *error)
     }
 
     // FIXME: do this in chunks to avoid blocking the UI if the file is big
-    TextCodecState state;
-    const QString &text = m_codec->decode(data.constData(), data.length(), &state);
+    delete m_decodingState;
 
-    m_hasDecodingError = state.hasError();
+    m_decodingState = new TextCodecState;
+
+    // With a maximum line count the QTextDocument drops the lines before the last ones right away. Find them in the
+    // raw data and don't decode them in the first place, that matters when following a huge log file.
+    int maximumLineCount = m_internalDocument->maximumBlockCount();
+    int offset = 0;
+
+    if (maximumLineCount > 0 && m_codec->hasAsciiLineBreaks()) {
+        LineIndex lineIndex;
+
+        lineIndex.reset(data.constData(), data.length());
+        lineIndex.build();
+
+        if (lineIndex.lineCount() > maximumLineCount) {
+            offset = (int)lineIndex.lineStart(lineIndex.lineCount() - maximumLineCount);
+        }
+    }
+
+    const QString &text = m_codec->decode(data.constData() + offset, data.length() - offset, m_decodingState);
+
+    m_hasDecodingError = m_decodingState->hasError();
+    m_endsWithCarriageReturn = text.endsWith('\r');
 
     // FIXME: detect line ending
 
@@ -92,6 +151,8 @@ bool TextDocument::load(const QByteArray &data, QString *error)
 
     connect(m_internalDocument, &QTextDocument::modificationChanged, this, &TextDocument::setContentsModified);
 
+    setTruncated(offset > 0 || (maximumLineCount > 0 && blockCountForText(text) > m_internalDocument->blockCount()));
+
     return true;
 }
 
@@ -101,6 +162,12 @@ bool TextDocument::save(QByteArray *data, QString *error)
     Q_ASSERT(error != NULL);
     Q_ASSERT(m_codec != NULL);
 
+    if (isMapped()) {
+        *error = QString("Can not save \"%1\", the file is too big to be edited.").arg(location().path("unnamed"));
+
+        return false;
+    }
+
     // QTextDocument::toPlainText only outputs "\n" as line ending
     const QString &text = m_internalDocument->toPlainText();
 
@@ -117,9 +184,222 @@ bool TextDocument::save(QByteArray *data, QString *error)
         return false;
     }
 
+    // The saved data is not what was decoded anymore, data appended to it can only be decoded by loading it again
+    delete m_decodingState;
+
+    m_decodingState = NULL;
+
+    return true;
+}
+
+bool TextDocument::append(const QByteArray &data)
+{
+    if (m_decodingState == NULL || m_hasDecodingError || isModified()) {
+        return false;
+    }
+
+    QString text = m_codec->decode(data.constData(), data.length(), m_decodingState);
+
+    // A char split between two appends is kept in the state and decoded with the next data
+    if (m_decodingState->hasInvalidChars()) {
+        delete m_decodingState;
+
+        m_decodingState = NULL;
+
+        return false;
+    }
+
+    // Do the same line ending conversion as QTextDocument::setPlainText, also for a "\r\n" split between two appends
+    if (m_endsWithCarriageReturn && text.startsWith('\n')) {
+        text.remove(0, 1);
+    }
+
+    if (!text.isEmpty()) {
+        m_endsWithCarriageReturn = text.endsWith('\r');
+    }
+
+    text.replace("\r\n", "\n");
+    text.replace('\r', '\n');
+
+    if (text.isEmpty()) {
+        return true;
+    }
+
+    disconnect(m_internalDocument, &QTextDocument::modificationChanged, this, &TextDocument::setContentsModified);
+
+    // The text on disk changed, undoing edits that were made before doesn't make sense anymore. This is also what
+    // loading does.
+    QTextCursor cursor(m_internalDocument);
+
+    int blockCount = m_internalDocument->blockCount() + text.count('\n');
+
+    cursor.movePosition(QTextCursor::End);
+
+    m_internalDocument->setUndoRedoEnabled(false);
+
+    cursor.insertText(text);
+
+    // Lines dropped from the front can't be undone, also an undo stack would grow while following for days
+    m_internalDocument->setUndoRedoEnabled(m_internalDocument->maximumBlockCount() == 0);
+    m_internalDocument->setModified(false);
+
+    connect(m_internalDocument, &QTextDocument::modificationChanged, this, &TextDocument::setContentsModified);
+
+    if (m_internalDocument->blockCount() < blockCount) {
+        setTruncated(true);
+    }
+
+    emit textAppended();
+
+    return true;
+}
+
+bool TextDocument::map(const QString &path, QString *error)
+{
+    Q_ASSERT(error != NULL);
+    Q_ASSERT(m_mappedFile == NULL);
+
+    const char *data;
+    qint64 size;
+    QFile *file = mapFile(path, &data, &size, error);
+
+    if (file == NULL) {
+        return false;
+    }
+
+    if (m_codec == NULL) {
+        m_codec = TextCodec::fromByteOrderMark(QByteArray::fromRawData(data, (int)qMin(size, Q_INT64_C(4))));
+
+        if (m_codec == NULL) {
+            m_codec = TextCodec::fromName("UTF-8");
+        }
+    }
+
+    // The lines are found in the raw bytes, decoding the whole file first would defeat the purpose of mapping it
+    if (!m_codec->hasAsciiLineBreaks()) {
+        *error = QString("Can not show \"%1\" as %2, the file is too big to be decoded as a whole.")
+                 .arg(path, m_codec->name());
+
+        delete file;
+
+        return false;
+    }
+
+    m_mappedFile = file;
+    m_mappedData = data;
+    m_mappedSize = size;
+
+    buildLineIndex();
+
     return true;
 }
 
+bool TextDocument::remap(bool appended, QString *error)
+{
+    Q_ASSERT(error != NULL);
+    Q_ASSERT(isMapped());
+
+    // Map the path again instead of growing the old mapping, the file might have been replaced by another one
+    const char *data;
+    qint64 size;
+    QFile *file = mapFile(m_mappedFile->fileName(), &data, &size, error);
+
+    if (file == NULL) {
+        return false;
+    }
+
+    // An unfinished index is of no use to extend, it's built again for the new mapping
+    if (m_lineIndexBuilder != NULL) {
+        m_lineIndexBuilder->requestInterruption();
+        m_lineIndexBuilder->wait();
+        m_lineIndexBuilder->deleteLater();
+        m_lineIndexBuilder = NULL;
+    }
+
+    appended = appended && m_lineIndex.isBuilt() && size >= m_mappedSize;
+
+    delete m_mappedFile; // also unmaps the file
+
+    m_mappedFile = file;
+    m_mappedData = data;
+    m_mappedSize = size;
+
+    if (appended) {
+        m_lineIndex.extend(m_mappedData, m_mappedSize);
+    } else {
+        buildLineIndex();
+    }
+
+    emit remapped();
+
+    if (appended) {
+        emit textAppended();
+    }
+
+    return true;
+}
+
+QByteArray TextDocument::mappedTail(int length) const
+{
+    Q_ASSERT(isMapped());
+
+    qint64 count = qMin((qint64)length, m_mappedSize);
+
+    return QByteArray(m_mappedData + m_mappedSize - count, (int)count);
+}
+
+QStringList TextDocument::mappedLines(qint64 first, int count)
+{
+    Q_ASSERT(isMapped());
+
+    QStringList lines;
+
+    if (first < 0 || (m_lineIndex.isBuilt() && first >= m_lineIndex.lineCount())) {
+        return lines;
+    }
+
+    // Reading the mapping beyond the end of a file that shrank raises SIGBUS. Show nothing until the file is mapped
+    // again, which can't happen right here while the caller is in the middle of using the line index.
+    qint64 fileSize = LineIndex::fileSize(m_mappedFile->handle());
+
+    if (fileSize >= 0 && fileSize < m_mappedSize) {
+        if (!m_remapTimer.isActive()) {
+            m_remapTimer.start(0, this);
+        }
+
+        return lines;
+    }
+
+    qint64 offset = m_lineIndex.lineStart(first);
+
+    while (lines.size() < count && offset >= 0) {
+        qint64 lineEnd;
+        qint64 nextOffset = m_lineIndex.nextLineStart(offset, &lineEnd);
+        int length = (int)qMin(lineEnd - offset, (qint64)MaximumMappedLineLength);
+        TextCodecState state;
+
+        lines.append(m_codec->decode(m_mappedData + offset, length, &state));
+
+        offset = nextOffset;
+    }
+
+    return lines;
+}
+
+void TextDocument::setFollowing(bool following)
+{
+    if (m_isFollowing != following) {
+        m_isFollowing = following;
+
+        // Never drop lines with unsaved edits in them
+        int maximumLineCount = Settings::settings()->value("TextDocument/FollowMaximumLineCount", 0).toInt();
+
+        setMaximumLineCount(m_isFollowing && !isModified() ? maximumLineCount : 0);
+
+        emit followingChanged(m_isFollowing);
+    }
+}
+
 // FIXME: this needs to be recorded as part of the undo history
 void TextDocument::setCodec(TextCodec *codec)
 {
@@ -132,6 +412,22 @@ void TextDocument::setCodec(TextCodec *codec)
     }
 }
 
+// protected
+void TextDocument::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_remapTimer.timerId()) {
+        m_remapTimer.stop();
+
+        QString error;
+
+        if (isMapped() && !remap(false, &error)) {
+            qDebug() << "TextDocument: Remapping" << m_mappedFile->fileName() << "failed:" << error;
+        }
+    }
+
+    Document::timerEvent(event);
+}
+
 // private slot
 void TextDocument::setContentsModified(bool modified)
 {
@@ -142,6 +438,35 @@ void TextDocument::setContentsModified(bool modified)
     }
 }
 
+// private slot
+void TextDocument::finishLineIndex()
+{
+    // The signal of a builder that remap() threw away might still arrive, the current one isn't done then
+    if (m_lineIndexBuilder == NULL || !m_lineIndexBuilder->index().isBuilt()) {
+        return;
+    }
+
+    m_lineIndex = m_lineIndexBuilder->index();
+
+    m_lineIndexBuilder->deleteLater();
+    m_lineIndexBuilder = NULL;
+
+    emit lineIndexBuilt();
+}
+
+// private
+void TextDocument::buildLineIndex()
+{
+    // Lookups scan from the start of the file until the index is built, that's fast enough for the first lines
+    m_lineIndex.reset(m_mappedData, m_mappedSize);
+
+    m_lineIndexBuilder = new LineIndexBuilder(m_mappedData, m_mappedSize, m_mappedFile->handle());
+
+    connect(m_lineIndexBuilder, &LineIndexBuilder::buildFinished, this, &TextDocument::finishLineIndex);
+
+    m_lineIndexBuilder->start();
+}
+
 // private
 void TextDocument::setEncodingModified(bool modified)
 {
@@ -151,3 +476,74 @@ void TextDocument::setEncodingModified(bool modified)
         setModified(m_isContentsModified || m_isEncodingModified);
     }
 }
+
+// private
+void TextDocument::setMaximumLineCount(int count)
+{
+    count = qMax(count, 0);
+
+    if (m_internalDocument->maximumBlockCount() == count) {
+        return;
+    }
+
+    int blockCount = m_internalDocument->blockCount();
+    bool modified = m_internalDocument->isModified();
+
+    disconnect(m_internalDocument, &QTextDocument::modificationChanged, this, &TextDocument::setContentsModified);
+
+    // This drops lines right away if there are too many. It also disables undo, even for 0 which removes the limit.
+    m_internalDocument->setMaximumBlockCount(count);
+    m_internalDocument->setUndoRedoEnabled(count == 0);
+    m_internalDocument->setModified(modified);
+
+    connect(m_internalDocument, &QTextDocument::modificationChanged, this, &TextDocument::setContentsModified);
+
+    if (m_internalDocument->blockCount() < blockCount) {
+        setTruncated(true);
+    }
+}
+
+// private
+void TextDocument::setTruncated(bool truncated)
+{
+    if (m_isTruncated != truncated) {
+        m_isTruncated = truncated;
+
+        emit truncationChanged(m_isTruncated);
+    }
+}
+
+// private static
+QFile *TextDocument::mapFile(const QString &path, const char **data, qint64 *size, QString *error)
+{
+    QFile *file = new QFile(path);
+
+    if (!file->open(QIODevice::ReadOnly)) {
+        *error = QString("Could not open \"%1\" for reading: %2").arg(path, file->errorString());
+
+        delete file;
+
+        return NULL;
+    }
+
+    *size = file->size();
+
+    // An empty file can't be mapped, a file truncated to nothing still has to be shown
+    if (*size == 0) {
+        *data = "";
+
+        return file;
+    }
+
+    *data = reinterpret_cast<const char *>(file->map(0, *size));
+
+    if (*data == NULL) {
+        *error = QString("Could not map \"%1\" into memory: %2").arg(path, file->errorString());
+
+        delete file;
+
+        return NULL;
+    }
+
+    return file;
+}
@@ -20,11 +20,17 @@
 #define TEXTDOCUMENT_H
 
 #include "document.h"
+#include "lineindex.h"
 
+#include <QBasicTimer>
+#include <QStringList>
+
+class QFile;
 class QTextDocument;
 
 class SyntaxHighlighter;
 class TextCodec;
+class TextCodecState;
 
 class TextDocument : public Document
 {
@@ -32,12 +38,34 @@ class TextDocument : public Document
     Q_DISABLE_COPY(TextDocument)
 
 public:
+    enum {
+        // Bigger files are mapped and shown in a TextViewer, configurable as TextDocument/ViewerThreshold
+        DefaultViewerThreshold = 64 * 1024 * 1024
+    };
+
     explicit TextDocument(TextCodec *codec, QObject *parent = NULL);
     ~TextDocument();
 
     bool load(const QByteArray &data, QString *error);
     bool save(QByteArray *data, QString *error);
 
+    // Appends data that was appended to the loaded file without touching the rest of the text. Returns false if the
+    // data can't be decoded in continuation of the loaded data, then everything has to be loaded again.
+    bool append(const QByteArray &data);
+
+    // Maps the file instead of loading it into the internal document, which stays empty then. The text is read-only and
+    // only decoded line by line when shown. The line index is built in the background, lineIndexBuilt() follows.
+    bool map(const QString &path, QString *error);
+
+    // Maps the file again after it changed on disk. If data was only appended then the built line index is extended
+    // and textAppended() follows, otherwise the line index is built again. remapped() is emitted in both cases.
+    bool remap(bool appended, QString *error);
+    bool isMapped() const { return m_mappedFile != NULL; }
+    qint64 mappedSize() const { return m_mappedSize; }
+    QByteArray mappedTail(int length) const;
+    const LineIndex &lineIndex() const { return m_lineIndex; }
+    QStringList mappedLines(qint64 first, int count); // empty if the file shrank, it's mapped again then
+
     QTextDocument *internalDocument() const { return m_internalDocument; }
 
     void setCodec(TextCodec *codec);
@@ -45,11 +73,37 @@ public:
 
     bool hasDecodingError() const { return m_hasDecodingError; }
 
+    // While following, appended text is scrolled into view and at most FollowMaximumLineCount lines are kept if that
+    // setting is non-zero. Lines that don't fit anymore are dropped from the front, the text is truncated then.
+    bool isFollowing() const { return m_isFollowing; }
+    void setFollowing(bool following);
+    bool isTruncated() const { return m_isTruncated; }
+
+signals:
+    void followingChanged(bool following);
+    void truncationChanged(bool truncated);
+    void textAppended();
+    void lineIndexBuilt();
+    void remapped();
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
 private slots:
     void setContentsModified(bool modified);
+    void finishLineIndex();
 
 private:
+    enum {
+        MaximumMappedLineLength = 64 * 1024 // bytes, longer lines are cut off when shown
+    };
+
+    void buildLineIndex();
     void setEncodingModified(bool modified);
+    void setMaximumLineCount(int count);
+    void setTruncated(bool truncated);
+
+    static QFile *mapFile(const QString &path, const char **data, qint64 *size, QString *error);
 
     QTextDocument *m_internalDocument;
     bool m_isContentsModified;
@@ -58,6 +112,17 @@ private:
     TextCodec *m_codec;
     bool m_hasDecodingError;
     bool m_isEncodingModified;
+    TextCodecState *m_decodingState; // after decoding the loaded and appended data, NULL if that's not the text anymore
+    bool m_endsWithCarriageReturn; // a "\n" at the start of appended data belongs to the last line ending
+    bool m_isFollowing;
+    bool m_isTruncated;
+
+    QFile *m_mappedFile; // NULL if not mapped
+    const char *m_mappedData;
+    qint64 m_mappedSize;
+    LineIndex m_lineIndex;
+    LineIndexBuilder *m_lineIndexBuilder; // NULL if not building
+    QBasicTimer m_remapTimer; // Maps a file that shrank again outside of mappedLines()
 };
 
 #endif // TEXTDOCUMENT_H
@@ -22,6 +22,7 @@
 #include <QClipboard>
 #include <QDebug>
 #include <QMenu>
+#include <QScrollBar>
 
 TextEditor::TextEditor(TextDocument *document, QObject *parent) :
     Editor(parent),
@@ -36,6 +37,7 @@ TextEditor::TextEditor(TextDocument *document, QObject *parent) :
     connect(m_widget.data(), &QPlainTextEdit::selectionChanged, this, &TextEditor::updateSelectionActionsAvailability);
     connect(QApplication::clipboard(), &QClipboard::dataChanged, this, &TextEditor::updatePasteActionAvailability);
     connect(m_document->internalDocument(), &QTextDocument::contentsChanged, this, &TextEditor::updateSelectAllActionAvailability);
+    connect(m_document, &TextDocument::followingChanged, this, &Editor::followingChanged);
 
     m_widget->viewport()->installEventFilter(this);
 }
@@ -83,7 +85,7 @@ bool TextEditor::isActionAvailable(Action action) const
 
 bool TextEditor::hasFeature(Feature feature) const
 {
-    return feature == WordWrapping;
+    return feature == WordWrapping || feature == Following;
 }
 
 bool TextEditor::isWordWrapping() const
@@ -91,6 +93,40 @@ bool TextEditor::isWordWrapping() const
     return m_widget->wordWrapMode() != QTextOption::NoWrap;
 }
 
+bool TextEditor::isFollowing() const
+{
+    return m_document->isFollowing();
+}
+
+qint64 TextEditor::cursorPosition() const
+{
+    return m_widget->textCursor().position();
+}
+
+qint64 TextEditor::firstVisibleLine() const
+{
+    return m_widget->verticalScrollBar()->value();
+}
+
+void TextEditor::restorePosition(qint64 cursorPosition, qint64 firstVisibleLine)
+{
+    // The file might have become shorter since the position was saved
+    if (cursorPosition >= 0) {
+        QTextCursor textCursor = m_widget->textCursor();
+        qint64 maximum = m_document->internalDocument()->characterCount() - 1;
+
+        textCursor.setPosition((int)qMin(cursorPosition, maximum));
+
+        m_widget->setTextCursor(textCursor);
+    }
+
+    if (firstVisibleLine >= 0) {
+        QScrollBar *scrollBar = m_widget->verticalScrollBar();
+
+        scrollBar->setValue((int)qMin(firstVisibleLine, (qint64)scrollBar->maximum()));
+    }
+}
+
 // slot
 void TextEditor::undo()
 {
@@ -169,6 +205,12 @@ void TextEditor::setWordWrapping(bool enable)
     m_widget->setWordWrapMode(enable ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
 }
 
+// slot
+void TextEditor::setFollowing(bool enable)
+{
+    m_document->setFollowing(enable);
+}
+
 // protected
 bool TextEditor::eventFilter(QObject *object, QEvent *event)
 {
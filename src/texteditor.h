@@ -41,6 +41,11 @@ public:
     bool hasFeature(Feature feature) const;
 
     bool isWordWrapping() const;
+    bool isFollowing() const;
+
+    qint64 cursorPosition() const;
+    qint64 firstVisibleLine() const;
+    void restorePosition(qint64 cursorPosition, qint64 firstVisibleLine);
 
 public slots:
     void undo();
@@ -53,6 +58,7 @@ public slots:
     void toggleCase();
 
     void setWordWrapping(bool enable);
+    void setFollowing(bool enable);
 
 protected:
     bool eventFilter(QObject *object, QEvent *event);
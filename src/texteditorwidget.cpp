@@ -21,6 +21,9 @@
 #include "documentmanager.h"
 #include "editorcolors.h"
 #include "encodingdialog.h"
+#include "filewatcher.h"
+#include "gitchangetracker.h"
+#include "latencytracer.h"
 #include "monospacefontmetrics.h"
 #include "textcodec.h"
 #include "textdocument.h"
@@ -87,7 +90,9 @@ class TextEditorInfoArea : public QWidget
 public:
     enum Mode {
         Hidden,
-        DecodingError
+        DecodingError,
+        Following,
+        Truncated
     };
 
     TextEditorInfoArea(TextDocument *document, TextEditorWidget *editor) :
@@ -143,6 +148,24 @@ public:
 
                 show();
 
+                break;
+
+            case Following:
+                m_label->setText(QString("<b>Info:</b> Following the end of \"%1\". Editing is not possible.")
+                                 .arg(m_document->location().fileName()));
+                m_button->setText("Stop Following");
+
+                show();
+
+                break;
+
+            case Truncated:
+                m_label->setText(QString("<b>Info:</b> Only the end of \"%1\" is shown. Editing is not possible.")
+                                 .arg(m_document->location().fileName()));
+                m_button->setText("Reload");
+
+                show();
+
                 break;
             }
         }
@@ -186,6 +209,7 @@ TextEditorWidget::TextEditorWidget(TextDocument *document, QWidget *parent) :
     m_document(document),
     m_extraArea(new TextEditorExtraArea(this)),
     m_extraAreaSelectionAnchorBlockNumber(-1),
+    m_gitChangeTracker(new GitChangeTracker(document, this)),
     m_infoArea(new TextEditorInfoArea(document, this)),
     m_lastCursorBlockNumber(-1),
     m_lastCursorPositionInBlock(-1),
@@ -205,16 +229,15 @@ TextEditorWidget::TextEditorWidget(TextDocument *document, QWidget *parent) :
     connect(this, &QPlainTextEdit::updateRequest, this, &TextEditorWidget::redrawExtraAreaRect);
     connect(this, &QPlainTextEdit::selectionChanged, this, &TextEditorWidget::updateExtraAreaSelectionHighlight);
     connect(this, &QPlainTextEdit::cursorPositionChanged, this, &TextEditorWidget::updateCurrentLineHighlight);
+    connect(m_gitChangeTracker, &GitChangeTracker::markersChanged, this, &TextEditorWidget::redrawExtraArea);
+    connect(m_document, &TextDocument::followingChanged, this, &TextEditorWidget::updateReadOnlyMode);
+    connect(m_document, &TextDocument::truncationChanged, this, &TextEditorWidget::updateReadOnlyMode);
+    connect(m_document, &TextDocument::textAppended, this, &TextEditorWidget::scrollToAppendedText);
+    connect(document(), &QTextDocument::contentsChange, this, &TextEditorWidget::traceContentsChange);
 
     updateViewportMargins();
     updateCurrentLineHighlight();
-
-    if (m_document->hasDecodingError()) {
-        setReadOnly(true);
-        m_infoArea->setMode(TextEditorInfoArea::DecodingError);
-    } else {
-        m_infoArea->hide();
-    }
+    updateReadOnlyMode();
 }
 
 int TextEditorWidget::extraAreaWidth() const
@@ -232,6 +255,7 @@ int TextEditorWidget::extraAreaWidth() const
 
 void TextEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
 {
+    LatencyTimer latencyTimer(LatencyTracer::Painting);
     QPainter painter(m_extraArea);
     int extraAreaWidth = m_extraArea->width();
     int selectionStart = textCursor().selectionStart();
@@ -257,6 +281,23 @@ void TextEditorWidget::extraAreaPaintEvent(QPaintEvent *event)
                 painter.fillRect(lineRect, EditorColors::currentLineHighlightColor());
             }
 
+            // Draw Git change markers into the left margin
+            int markers = m_gitChangeTracker->markers(block.blockNumber());
+
+            if ((markers & GitChangeTracker::AddedMarker) != 0) {
+                painter.fillRect(QRectF(2, top, 3, height), EditorColors::gitAddedColor());
+            } else if ((markers & GitChangeTracker::ModifiedMarker) != 0) {
+                painter.fillRect(QRectF(2, top, 3, height), EditorColors::gitModifiedColor());
+            }
+
+            if ((markers & GitChangeTracker::DeletedAboveMarker) != 0) {
+                painter.fillRect(QRectF(0, top - 1, 6, 2), EditorColors::gitDeletedColor());
+            }
+
+            if ((markers & GitChangeTracker::DeletedBelowMarker) != 0) {
+                painter.fillRect(QRectF(0, bottom - 1, 6, 2), EditorColors::gitDeletedColor());
+            }
+
             // Highlight selected line number
             bool selected = (selectionStart != selectionEnd) &&
                             (selectionStart < block.position() + block.length() && selectionEnd >= block.position());
@@ -400,6 +441,7 @@ void TextEditorWidget::resizeEvent(QResizeEvent *event)
 // protected
 void TextEditorWidget::paintEvent(QPaintEvent *event)
 {
+    LatencyTimer latencyTimer(LatencyTracer::Painting);
     QPainter painter(viewport());
     QPointF offset = contentOffset();
     QTextBlock textCursorBlock = textCursor().block();
@@ -510,6 +552,27 @@ void TextEditorWidget::paintEvent(QPaintEvent *event)
     }
 }
 
+// protected
+void TextEditorWidget::keyPressEvent(QKeyEvent *event)
+{
+    if (!LatencyTracer::isEnabled()) {
+        QPlainTextEdit::keyPressEvent(event);
+
+        return;
+    }
+
+    LatencyTracer::beginKeyPress(LatencyTracer::now());
+
+    int revision = document()->revision();
+    int position = textCursor().position();
+    int anchor = textCursor().anchor();
+
+    QPlainTextEdit::keyPressEvent(event);
+
+    LatencyTracer::endKeyPress(document()->revision() != revision || textCursor().position() != position ||
+                               textCursor().anchor() != anchor);
+}
+
 // protected
 void TextEditorWidget::focusInEvent(QFocusEvent *event)
 {
@@ -576,6 +639,10 @@ void TextEditorWidget::performInfoAreaAction()
 {
     if (m_infoArea->mode() == TextEditorInfoArea::DecodingError && m_document->hasDecodingError()) {
         DocumentManager::showEncodingDialog(m_document);
+    } else if (m_infoArea->mode() == TextEditorInfoArea::Following) {
+        m_document->setFollowing(false);
+    } else if (m_infoArea->mode() == TextEditorInfoArea::Truncated) {
+        FileWatcher::reload(m_document);
     }
 }
 
@@ -590,6 +657,37 @@ void TextEditorWidget::redrawExtraAreaRect(const QRect &rect, int dy)
     }
 }
 
+// private slot
+void TextEditorWidget::redrawExtraArea()
+{
+    m_extraArea->update();
+}
+
+// private slot
+void TextEditorWidget::updateReadOnlyMode()
+{
+    // A truncated document is not the whole file anymore, saving it would lose the rest
+    if (m_document->hasDecodingError()) {
+        m_infoArea->setMode(TextEditorInfoArea::DecodingError);
+    } else if (m_document->isFollowing()) {
+        m_infoArea->setMode(TextEditorInfoArea::Following);
+    } else if (m_document->isTruncated()) {
+        m_infoArea->setMode(TextEditorInfoArea::Truncated);
+    } else {
+        m_infoArea->setMode(TextEditorInfoArea::Hidden);
+    }
+
+    setReadOnly(m_infoArea->mode() != TextEditorInfoArea::Hidden);
+}
+
+// private slot
+void TextEditorWidget::scrollToAppendedText()
+{
+    if (m_document->isFollowing()) {
+        moveCursor(QTextCursor::End);
+    }
+}
+
 // private slot
 void TextEditorWidget::updateExtraAreaSelectionHighlight()
 {
@@ -649,6 +747,15 @@ void TextEditorWidget::updateCurrentLineHighlight()
     m_lastCursorPositionInBlock = positionInBlock;
 }
 
+// private slot
+void TextEditorWidget::traceContentsChange()
+{
+    // The SyntaxHighlighter of a loaded document is connected before this, then its rehighlighting is included
+    if (LatencyTracer::isEnabled()) {
+        LatencyTracer::recordDocumentChange();
+    }
+}
+
 // private
 void TextEditorWidget::redrawLineInBlock(int blockNumber, int positionInBlock)
 {
@@ -22,6 +22,7 @@
 #include <QBasicTimer>
 #include <QPlainTextEdit>
 
+class GitChangeTracker;
 class TextDocument;
 class TextEditorExtraArea;
 class TextEditorInfoArea;
@@ -46,6 +47,7 @@ public:
 protected:
     void resizeEvent(QResizeEvent *event);
     void paintEvent(QPaintEvent *event);
+    void keyPressEvent(QKeyEvent *event);
     void focusInEvent(QFocusEvent *event);
     void focusOutEvent(QFocusEvent *event);
     void timerEvent(QTimerEvent *event);
@@ -56,8 +58,12 @@ public slots:
 
 private slots:
     void redrawExtraAreaRect(const QRect &rect, int dy);
+    void redrawExtraArea();
+    void updateReadOnlyMode();
+    void scrollToAppendedText();
     void updateExtraAreaSelectionHighlight();
     void updateCurrentLineHighlight();
+    void traceContentsChange();
 
 private:
     void redrawLineInBlock(int blockNumber, int positionInBlock);
@@ -69,6 +75,8 @@ private:
     int m_extraAreaSelectionAnchorBlockNumber;
     QBasicTimer m_extraAreaAutoScrollTimer;
 
+    GitChangeTracker *m_gitChangeTracker;
+
     TextEditorInfoArea *m_infoArea;
 
     int m_lastCursorBlockNumber;
@@ -0,0 +1,67 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "textviewer.h"
+
+TextViewer::TextViewer(TextDocument *document, QObject *parent) :
+    Editor(parent),
+    m_document(document),
+    m_widget(new TextViewerWidget(document))
+{
+    Q_ASSERT(document->isMapped());
+
+    connect(m_document, &TextDocument::followingChanged, this, &Editor::followingChanged);
+}
+
+TextViewer::~TextViewer()
+{
+    delete m_widget;
+    delete m_document;
+}
+
+bool TextViewer::hasFeature(Feature feature) const
+{
+    return feature == Following;
+}
+
+bool TextViewer::isFollowing() const
+{
+    return m_document->isFollowing();
+}
+
+qint64 TextViewer::firstVisibleLine() const
+{
+    return m_widget->firstVisibleLine();
+}
+
+// There is no cursor in the viewer
+void TextViewer::restorePosition(qint64 cursorPosition, qint64 firstVisibleLine)
+{
+    Q_UNUSED(cursorPosition)
+
+    if (firstVisibleLine >= 0) {
+        m_widget->restoreFirstVisibleLine(firstVisibleLine);
+    }
+}
+
+// slot
+void TextViewer::setFollowing(bool enable)
+{
+    m_document->setFollowing(enable);
+}
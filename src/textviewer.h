@@ -0,0 +1,57 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TEXTVIEWER_H
+#define TEXTVIEWER_H
+
+#include "editor.h"
+#include "textdocument.h"
+#include "textviewerwidget.h"
+
+#include <QPointer>
+
+// Editor for mapped TextDocuments, they are too big to be edited
+class TextViewer : public Editor
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TextViewer)
+
+public:
+    explicit TextViewer(TextDocument *document, QObject *parent = NULL);
+    ~TextViewer();
+
+    Document *document() const { return m_document; }
+    QWidget *widget() const { return m_widget; }
+
+    bool hasFeature(Feature feature) const;
+
+    bool isFollowing() const;
+
+    qint64 firstVisibleLine() const;
+    void restorePosition(qint64 cursorPosition, qint64 firstVisibleLine);
+
+public slots:
+    void setFollowing(bool enable);
+
+private:
+    QPointer<TextDocument> m_document; // owned by DocumentManager
+    QPointer<TextViewerWidget> m_widget; // owned by its parent widget if any
+};
+
+#endif // TEXTVIEWER_H
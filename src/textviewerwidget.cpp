@@ -0,0 +1,479 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "textviewerwidget.h"
+
+#include "editorcolors.h"
+#include "lexer.h"
+#include "monospacefontmetrics.h"
+#include "syntaxhighlighter.h"
+#include "textdocument.h"
+
+#include <QtMath>
+#include <QApplication>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QWheelEvent>
+
+class TextViewerExtraArea : public QWidget
+{
+public:
+    TextViewerExtraArea(TextViewerWidget *viewer) :
+        QWidget(viewer),
+        m_viewer(viewer)
+    {
+        setFont(MonospaceFontMetrics::font());
+        setPalette(EditorColors::basicPalette());
+        setAutoFillBackground(true);
+    }
+
+    QSize sizeHint() const
+    {
+        return QSize(m_viewer->extraAreaWidth(), 0);
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event)
+    {
+        m_viewer->extraAreaPaintEvent(event);
+    }
+
+    void wheelEvent(QWheelEvent *event)
+    {
+        QCoreApplication::sendEvent(m_viewer->viewport(), event);
+    }
+
+private:
+    TextViewerWidget *m_viewer;
+};
+
+TextViewerWidget::TextViewerWidget(TextDocument *document, QWidget *parent) :
+    QAbstractScrollArea(parent),
+    m_document(document),
+    m_extraArea(new TextViewerExtraArea(this)),
+    m_lineCount(0),
+    m_firstVisibleLine(0),
+    m_restoredFirstVisibleLine(-1),
+    m_settingScrollBarValue(false),
+    m_wheelDelta(0),
+    m_documentMargin(document->internalDocument()->documentMargin()),
+    m_layoutsFirstLine(-1),
+    m_contentWidth(0)
+{
+    Q_ASSERT(m_document->isMapped());
+
+    setFont(MonospaceFontMetrics::font());
+    setPalette(EditorColors::basicPalette());
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+
+    connect(m_document, &TextDocument::lineIndexBuilt, this, &TextViewerWidget::updateLineCount);
+    connect(m_document, &TextDocument::remapped, this, &TextViewerWidget::updateLineCount);
+
+    // While following, the end stays in view. A file that was replaced is followed once its line index is built.
+    connect(m_document, &TextDocument::textAppended, this, &TextViewerWidget::scrollToAppendedText);
+    connect(m_document, &TextDocument::lineIndexBuilt, this, &TextViewerWidget::scrollToAppendedText);
+    connect(m_document, &TextDocument::followingChanged, this, &TextViewerWidget::scrollToAppendedText);
+
+    if (m_document->lineIndex().isBuilt()) {
+        m_lineCount = m_document->lineIndex().lineCount();
+    }
+
+    setViewportMargins(extraAreaWidth(), 0, 0, 0);
+    updateAreaGeometries();
+    updateScrollBarRanges();
+}
+
+TextViewerWidget::~TextViewerWidget()
+{
+    clearLayouts();
+}
+
+int TextViewerWidget::extraAreaWidth() const
+{
+    // Leave room for a few digits while the line count is still unknown
+    qint64 maximum = m_lineCount > 0 ? m_lineCount : 1000;
+    int digits = 1;
+
+    while (maximum >= 10) {
+        maximum /= 10;
+        ++digits;
+    }
+
+    return 8 + MonospaceFontMetrics::charWidth() * digits + 8;
+}
+
+void TextViewerWidget::extraAreaPaintEvent(QPaintEvent *event)
+{
+    QPainter painter(m_extraArea);
+    int extraAreaWidth = m_extraArea->width();
+    int lineHeight = MonospaceFontMetrics::lineHeight();
+    int top = 0;
+
+    layoutVisibleLines();
+
+    // If the first line is visible then offset it by the document margin to mimic the QPlainTextEdit margin behavior.
+    if (m_firstVisibleLine == 0) {
+        top += m_documentMargin;
+    }
+
+    painter.setPen(m_extraArea->palette().color(QPalette::WindowText));
+
+    for (int i = 0; i < m_layouts.size() && top <= event->rect().bottom(); ++i) {
+        if (top + lineHeight >= event->rect().top()) {
+            painter.drawText(QRect(0, top, extraAreaWidth - 8, lineHeight), Qt::AlignRight,
+                             QString::number(m_firstVisibleLine + i + 1));
+        }
+
+        top += lineHeight;
+    }
+}
+
+// protected
+void TextViewerWidget::scrollContentsBy(int dx, int dy)
+{
+    qint64 line = m_firstVisibleLine;
+
+    // A vertical scroll bar change that wasn't triggered by setFirstVisibleLine() comes from the user interacting with
+    // the scroll bar. Map the (potentially scaled) scroll bar value back to a line in that case.
+    if (dy != 0 && !m_settingScrollBarValue) {
+        line = lineForScrollBarValue(verticalScrollBar()->value());
+    }
+
+    if (dx != 0) {
+        viewport()->update();
+    }
+
+    scrollToLine(line);
+}
+
+// protected
+void TextViewerWidget::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    clearLayouts();
+    updateAreaGeometries();
+    updateScrollBarRanges();
+}
+
+// protected
+void TextViewerWidget::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    int lineHeight = MonospaceFontMetrics::lineHeight();
+    int left = m_documentMargin - horizontalScrollBar()->value();
+    int top = 0;
+
+    layoutVisibleLines();
+
+    // If the first line is visible then offset it by the document margin to mimic the QPlainTextEdit margin behavior.
+    if (m_firstVisibleLine == 0) {
+        top += m_documentMargin;
+    }
+
+    painter.setPen(palette().color(QPalette::Text));
+
+    for (int i = 0; i < m_layouts.size() && top <= event->rect().bottom(); ++i) {
+        if (top + lineHeight >= event->rect().top()) {
+            m_layouts.at(i)->draw(&painter, QPointF(left, top));
+        }
+
+        top += lineHeight;
+    }
+}
+
+// protected
+void TextViewerWidget::wheelEvent(QWheelEvent *event)
+{
+    int delta = event->angleDelta().y();
+
+    if (delta == 0) {
+        QAbstractScrollArea::wheelEvent(event);
+
+        return;
+    }
+
+    // Scroll by lines here instead of letting the vertical scroll bar handle the wheel event, because the scroll bar
+    // value might be scaled. See BinaryEditorWidget::wheelEvent.
+    m_wheelDelta += delta;
+
+    int steps = m_wheelDelta / 120;
+
+    m_wheelDelta -= steps * 120;
+
+    setFirstVisibleLine(m_firstVisibleLine - (qint64)steps * QApplication::wheelScrollLines());
+
+    event->accept();
+}
+
+// protected
+void TextViewerWidget::keyPressEvent(QKeyEvent *event)
+{
+    bool ctrlPressed = event->modifiers() & Qt::ControlModifier;
+    int pageStep = qMax(visibleLineCount(), 1);
+
+    switch (event->key()) {
+    case Qt::Key_Up:
+        setFirstVisibleLine(m_firstVisibleLine - 1);
+        break;
+
+    case Qt::Key_Down:
+        setFirstVisibleLine(m_firstVisibleLine + 1);
+        break;
+
+    case Qt::Key_PageUp:
+        setFirstVisibleLine(m_firstVisibleLine - pageStep);
+        break;
+
+    case Qt::Key_PageDown:
+        setFirstVisibleLine(m_firstVisibleLine + pageStep);
+        break;
+
+    case Qt::Key_Left:
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
+        break;
+
+    case Qt::Key_Right:
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+        break;
+
+    case Qt::Key_Home:
+        if (ctrlPressed) {
+            setFirstVisibleLine(0);
+        }
+
+        horizontalScrollBar()->setValue(0);
+
+        break;
+
+    case Qt::Key_End:
+        if (ctrlPressed) {
+            setFirstVisibleLine(maximumFirstVisibleLine());
+        }
+
+        break;
+
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+
+        return;
+    }
+
+    event->accept();
+}
+
+void TextViewerWidget::restoreFirstVisibleLine(qint64 line)
+{
+    if (m_lineCount > 0) {
+        setFirstVisibleLine(line);
+    } else {
+        m_restoredFirstVisibleLine = line;
+    }
+}
+
+// private slot
+void TextViewerWidget::updateLineCount()
+{
+    // After remapping a replaced file the line index is built again, scrolling is disabled until then
+    m_lineCount = m_document->lineIndex().isBuilt() ? m_document->lineIndex().lineCount() : 0;
+
+    clearLayouts();
+    setViewportMargins(extraAreaWidth(), 0, 0, 0);
+    updateAreaGeometries();
+    updateScrollBarRanges();
+
+    if (m_restoredFirstVisibleLine >= 0) {
+        setFirstVisibleLine(m_restoredFirstVisibleLine);
+
+        m_restoredFirstVisibleLine = -1;
+    }
+
+    viewport()->update();
+    m_extraArea->update();
+}
+
+// private slot
+void TextViewerWidget::scrollToAppendedText()
+{
+    if (m_document->isFollowing()) {
+        setFirstVisibleLine(maximumFirstVisibleLine());
+    }
+}
+
+// private
+void TextViewerWidget::updateAreaGeometries()
+{
+    QRect extraAreaRect = contentsRect();
+
+    extraAreaRect.setWidth(extraAreaWidth());
+
+    m_extraArea->setGeometry(extraAreaRect);
+}
+
+// private
+void TextViewerWidget::updateScrollBarRanges()
+{
+    horizontalScrollBar()->setRange(0, m_contentWidth + m_documentMargin * 2 - viewport()->width());
+    horizontalScrollBar()->setSingleStep(MonospaceFontMetrics::charWidth());
+    horizontalScrollBar()->setPageStep(viewport()->width());
+
+    qint64 maximumLine = maximumFirstVisibleLine();
+
+    if (m_firstVisibleLine > maximumLine) {
+        scrollToLine(maximumLine);
+    }
+
+    m_settingScrollBarValue = true;
+
+    verticalScrollBar()->setRange(0, scrollBarValueForLine(maximumLine));
+    verticalScrollBar()->setPageStep(qMax(scrollBarValueForLine(visibleLineCount()), 1));
+    verticalScrollBar()->setValue(scrollBarValueForLine(m_firstVisibleLine));
+
+    m_settingScrollBarValue = false;
+}
+
+// private
+int TextViewerWidget::visibleLineCount() const
+{
+    // Same as BinaryEditorWidget::visibleLineCount, mimics QPlainTextEdit
+    return qMax(viewport()->height() - m_documentMargin * 2 - 1, 0) / MonospaceFontMetrics::lineHeight();
+}
+
+// private
+qint64 TextViewerWidget::maximumFirstVisibleLine() const
+{
+    return qMax(m_lineCount - visibleLineCount(), Q_INT64_C(0));
+}
+
+// private
+int TextViewerWidget::scrollBarValueForLine(qint64 line) const
+{
+    qint64 maximumLine = maximumFirstVisibleLine();
+
+    if (maximumLine <= MaximumScrollBarRange) {
+        return (int)line;
+    }
+
+    // Calculate in double, because line * MaximumScrollBarRange can overflow qint64 for huge documents
+    return (int)qRound64((double)line * MaximumScrollBarRange / maximumLine);
+}
+
+// private
+qint64 TextViewerWidget::lineForScrollBarValue(int value) const
+{
+    qint64 maximumLine = maximumFirstVisibleLine();
+
+    if (maximumLine <= MaximumScrollBarRange) {
+        return value;
+    }
+
+    return qBound(Q_INT64_C(0), qRound64((double)value * maximumLine / MaximumScrollBarRange), maximumLine);
+}
+
+// private
+void TextViewerWidget::setFirstVisibleLine(qint64 line)
+{
+    line = qBound(Q_INT64_C(0), line, maximumFirstVisibleLine());
+
+    if (line == m_firstVisibleLine) {
+        return;
+    }
+
+    // Update the scroll bar without letting scrollContentsBy() map its value back to a line, because that mapping is
+    // lossy if the scroll bar value is scaled.
+    m_settingScrollBarValue = true;
+
+    verticalScrollBar()->setValue(scrollBarValueForLine(line));
+
+    m_settingScrollBarValue = false;
+
+    scrollToLine(line);
+}
+
+// private
+void TextViewerWidget::scrollToLine(qint64 line)
+{
+    if (line == m_firstVisibleLine) {
+        return;
+    }
+
+    // The visible lines are laid out again on the next paint, there is no point in scrolling the old pixels
+    m_firstVisibleLine = line;
+
+    viewport()->update();
+    m_extraArea->update();
+}
+
+// private
+void TextViewerWidget::layoutVisibleLines()
+{
+    if (m_layoutsFirstLine == m_firstVisibleLine) {
+        return;
+    }
+
+    clearLayouts();
+
+    QTextOption option = m_document->internalDocument()->defaultTextOption();
+
+    option.setWrapMode(QTextOption::NoWrap);
+
+    // Lexing everything before the first visible line to get the lexer state there would defeat the purpose of this
+    // viewer. A comment that started above the visible lines is not highlighted as such.
+    int state = Lexer::InNothing;
+    int contentWidth = m_contentWidth;
+
+    foreach (const QString &text, m_document->mappedLines(m_firstVisibleLine, visibleLineCount() + 1)) {
+        QTextLayout *layout = new QTextLayout(text, font());
+
+        layout->setTextOption(option);
+        layout->setFormats(SyntaxHighlighter::formatLine(text, &state));
+        layout->beginLayout();
+
+        QTextLine line = layout->createLine();
+
+        line.setNumColumns(text.length());
+
+        layout->endLayout();
+
+        contentWidth = qMax(contentWidth, qCeil(line.naturalTextWidth()));
+
+        m_layouts.append(layout);
+    }
+
+    m_layoutsFirstLine = m_firstVisibleLine;
+
+    if (m_contentWidth != contentWidth) {
+        m_contentWidth = contentWidth;
+
+        horizontalScrollBar()->setRange(0, m_contentWidth + m_documentMargin * 2 - viewport()->width());
+    }
+}
+
+// private
+void TextViewerWidget::clearLayouts()
+{
+    qDeleteAll(m_layouts);
+
+    m_layouts.clear();
+    m_layoutsFirstLine = -1;
+}
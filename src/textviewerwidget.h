@@ -0,0 +1,92 @@
+//
+// Zero Editor
+// Copyright (C) 2018 Matthias Bolte <matthias.bolte@googlemail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TEXTVIEWERWIDGET_H
+#define TEXTVIEWERWIDGET_H
+
+#include <QAbstractScrollArea>
+#include <QList>
+
+class QTextLayout;
+class TextDocument;
+class TextViewerExtraArea;
+
+// Read-only view of a mapped TextDocument. Only the visible lines are decoded, laid out and highlighted, so showing
+// them costs the same for a file of any size.
+class TextViewerWidget : public QAbstractScrollArea
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TextViewerWidget)
+
+public:
+    TextViewerWidget(TextDocument *document, QWidget *parent = NULL);
+    ~TextViewerWidget();
+
+    int extraAreaWidth() const;
+    void extraAreaPaintEvent(QPaintEvent *event);
+
+    qint64 firstVisibleLine() const { return m_firstVisibleLine; }
+    void restoreFirstVisibleLine(qint64 line);
+
+protected:
+    void scrollContentsBy(int dx, int dy);
+    void resizeEvent(QResizeEvent *event);
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+
+private slots:
+    void updateLineCount();
+    void scrollToAppendedText();
+
+private:
+    enum {
+        // QScrollBar ranges are int. If the document has more lines than this then the vertical scroll bar doesn't
+        // operate in lines anymore, but its value is scaled to map the full range of lines onto this range.
+        MaximumScrollBarRange = 0x3FFFFFFF
+    };
+
+    void updateAreaGeometries();
+    void updateScrollBarRanges();
+    int visibleLineCount() const;
+    qint64 maximumFirstVisibleLine() const;
+    int scrollBarValueForLine(qint64 line) const;
+    qint64 lineForScrollBarValue(int value) const;
+    void setFirstVisibleLine(qint64 line);
+    void scrollToLine(qint64 line);
+    void layoutVisibleLines();
+    void clearLayouts();
+
+    TextDocument *m_document; // owned by TextViewer
+
+    TextViewerExtraArea *m_extraArea;
+
+    qint64 m_lineCount; // 0 until the line index is built, scrolling is disabled until then
+    qint64 m_firstVisibleLine;
+    qint64 m_restoredFirstVisibleLine; // -1 if none, applied once the line index is built
+    bool m_settingScrollBarValue;
+    int m_wheelDelta; // Accumulates partial wheel steps
+    int m_documentMargin;
+
+    QList<QTextLayout *> m_layouts; // of the visible lines
+    qint64 m_layoutsFirstLine; // -1 if the layouts need to be redone
+    int m_contentWidth; // of the widest line laid out so far, the width of the whole text is unknown
+};
+
+#endif // TEXTVIEWERWIDGET_H
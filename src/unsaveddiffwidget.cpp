@@ -19,16 +19,337 @@
 #include "unsaveddiffwidget.h"
 #include "ui_unsaveddiffwidget.h"
 
+#include "diffmodel.h"
+#include "textcodec.h"
+#include "textdocument.h"
+
+#include <QFile>
+#include <QTextDocument>
+#include <QTimerEvent>
+
+UnsavedDiffWorker::UnsavedDiffWorker(int generation, const QSharedPointer<LineInterner> &interner,
+                                     const QVector<int> &newLines, QObject *parent) :
+    QThread(parent),
+    m_generation(generation),
+    m_interner(interner),
+    m_oldCodec(NULL),
+    m_newLines(newLines)
+{
+}
+
+void UnsavedDiffWorker::setOldLines(const QVector<int> &oldLines)
+{
+    m_oldPath.clear();
+    m_oldCodec = NULL;
+    m_oldLines = oldLines;
+}
+
+void UnsavedDiffWorker::setOldFile(const QString &path, TextCodec *codec)
+{
+    Q_ASSERT(!path.isEmpty());
+    Q_ASSERT(codec != NULL);
+
+    m_oldPath = path;
+    m_oldCodec = codec;
+    m_oldLines.clear();
+}
+
+// protected
+void UnsavedDiffWorker::run()
+{
+    if (!m_oldPath.isEmpty()) {
+        QFile file(m_oldPath);
+
+        // A file that cannot be read anymore is diffed as if it was empty
+        if (file.open(QFile::ReadOnly)) {
+            const QByteArray &data = file.readAll();
+            TextCodecState state;
+
+            m_interner->internLines(m_oldCodec->decode(data.constData(), data.length(), &state), &m_oldLines);
+        }
+    }
+
+    if (isInterruptionRequested()) {
+        return;
+    }
+
+    m_hunks = LineDiff::compute(m_oldLines, m_newLines, this);
+
+    if (!isInterruptionRequested()) {
+        emit diffFinished(m_generation);
+    }
+}
+
 UnsavedDiffWidget::UnsavedDiffWidget(QWidget *parent) :
     QWidget(parent),
-    m_ui(new Ui::UnsavedDiffWidget)
+    m_ui(new Ui::UnsavedDiffWidget),
+    m_model(new DiffModel(this)),
+    m_document(NULL),
+    m_hasOldLines(false),
+    m_hasNewLines(false),
+    m_worker(NULL),
+    m_generation(0),
+    m_diffPending(false)
 {
     m_ui->setupUi(this);
 
+    m_ui->listHunks->setModel(m_model);
+    m_ui->listHunks->setUniformItemSizes(true);
+
     connect(m_ui->buttonHide, &QToolButton::clicked, this, &UnsavedDiffWidget::hideClicked);
 }
 
 UnsavedDiffWidget::~UnsavedDiffWidget()
 {
+    stopDiff();
+
     delete m_ui;
 }
+
+void UnsavedDiffWidget::setDocument(Document *document)
+{
+    TextDocument *textDocument = qobject_cast<TextDocument *>(document);
+
+    // A mapped document is too big to be diffed and can't have unsaved changes anyway
+    if (textDocument != NULL && textDocument->isMapped()) {
+        textDocument = NULL;
+    }
+
+    if (textDocument == m_document) {
+        return;
+    }
+
+    if (m_document != NULL) {
+        m_document->internalDocument()->disconnect(this);
+        m_document->disconnect(this);
+    }
+
+    stopDiff();
+    clearLines();
+
+    m_document = textDocument;
+
+    if (m_document != NULL) {
+        connect(m_document->internalDocument(), &QTextDocument::contentsChange, this, &UnsavedDiffWidget::updateLines);
+        connect(m_document, &Document::modificationChanged, this, &UnsavedDiffWidget::scheduleDiff);
+        connect(m_document, &QObject::destroyed, this, &UnsavedDiffWidget::forgetDocument);
+    }
+
+    scheduleDiff();
+}
+
+// protected
+void UnsavedDiffWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    if (m_diffPending && m_worker == NULL) {
+        startDiff();
+    }
+}
+
+// protected
+void UnsavedDiffWidget::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_diffTimer.timerId()) {
+        m_diffTimer.stop();
+
+        // Otherwise the diff is started once the running one is done or once this widget is shown
+        if (m_worker == NULL && isVisible()) {
+            startDiff();
+        } else {
+            m_diffPending = true;
+        }
+    }
+
+    QWidget::timerEvent(event);
+}
+
+// private slot
+void UnsavedDiffWidget::updateLines(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+
+    scheduleDiff();
+
+    if (!m_hasNewLines) {
+        return;
+    }
+
+    // As long as the document is unmodified its lines are the lines on disk
+    if (!m_document->isModified()) {
+        m_oldLines = m_newLines;
+        m_hasOldLines = true;
+    }
+
+    // Replace the IDs of the blocks that were touched by the change, the rest of the lines are still valid
+    if (!BlockLines::update(m_interner.data(), m_document->internalDocument(), position, charsAdded, &m_newLines)) {
+        m_newLines.clear();
+        m_hasNewLines = false; // Out of sync, rebuild all lines for the next diff
+    }
+}
+
+// private slot
+void UnsavedDiffWidget::scheduleDiff()
+{
+    m_diffTimer.start(DiffDelay, this);
+}
+
+// private slot
+void UnsavedDiffWidget::forgetDocument()
+{
+    // The document is being destroyed, its signals are already disconnected
+    m_document = NULL;
+
+    stopDiff();
+    clearLines();
+}
+
+// private slot
+void UnsavedDiffWidget::finishDiff(int generation)
+{
+    if (generation != m_generation || m_worker == NULL) {
+        return;
+    }
+
+    m_worker->wait();
+
+    // Keep the lines read from disk for the next diffs
+    if (!m_hasOldLines) {
+        m_oldLines = m_worker->oldLines();
+        m_hasOldLines = true;
+    }
+
+    m_model->setDiff(m_interner, m_worker->hunks(), m_worker->oldLines(), m_worker->newLines());
+
+    m_worker->deleteLater();
+    m_worker = NULL;
+
+    if (m_diffPending && isVisible()) {
+        startDiff();
+    }
+}
+
+// private
+void UnsavedDiffWidget::clearLines()
+{
+    m_interner = QSharedPointer<LineInterner>(new LineInterner());
+    m_oldLines.clear();
+    m_hasOldLines = false;
+    m_newLines.clear();
+    m_hasNewLines = false;
+
+    m_model->clear();
+}
+
+// private
+void UnsavedDiffWidget::startDiff()
+{
+    Q_ASSERT(m_worker == NULL);
+
+    m_diffPending = false;
+
+    if (m_document == NULL) {
+        m_model->clear();
+
+        return;
+    }
+
+    if (!m_hasNewLines) {
+        QTextDocument *document = m_document->internalDocument();
+
+        m_newLines.clear();
+
+        BlockLines::internBlocks(m_interner.data(), document, 0, document->blockCount(), &m_newLines);
+
+        m_hasNewLines = true;
+    }
+
+    // Every edit interns the lines it touched, typing interns each intermediate state of a line
+    int lineCount = m_newLines.size() + (m_hasOldLines ? m_oldLines.size() : 0);
+
+    if (m_interner->size() > MaximumInternerGrowth * lineCount + MinimumInternerSize) {
+        compactInterner();
+    }
+
+    // Nothing to diff if the document is unmodified
+    if (!m_document->isModified()) {
+        m_oldLines = m_newLines;
+        m_hasOldLines = true;
+
+        m_model->clear();
+
+        return;
+    }
+
+    const Location &location = m_document->location();
+
+    if (!m_hasOldLines && location.isEmpty()) {
+        m_hasOldLines = true; // Never saved, everything is new
+    }
+
+    m_worker = new UnsavedDiffWorker(++m_generation, m_interner, m_newLines, this);
+
+    if (m_hasOldLines) {
+        m_worker->setOldLines(m_oldLines);
+    } else {
+        m_worker->setOldFile(location.path(), m_document->codec());
+    }
+
+    connect(m_worker, &UnsavedDiffWorker::diffFinished, this, &UnsavedDiffWidget::finishDiff);
+
+    m_worker->start(QThread::LowPriority);
+}
+
+// private
+void UnsavedDiffWidget::compactInterner()
+{
+    Q_ASSERT(m_worker == NULL);
+
+    // Intern the lines that are still referenced again in a new interner. The model keeps the old one for as long as it
+    // shows the last diff.
+    QSharedPointer<LineInterner> interner(new LineInterner());
+    QVector<int> ids(m_interner->size(), -1); // old ID to new ID
+
+    for (int i = 0; i < m_newLines.size(); ++i) {
+        int &id = ids[m_newLines.at(i)];
+
+        if (id < 0) {
+            id = interner->intern(m_interner->line(m_newLines.at(i)));
+        }
+
+        m_newLines[i] = id;
+    }
+
+    if (m_hasOldLines) {
+        for (int i = 0; i < m_oldLines.size(); ++i) {
+            int &id = ids[m_oldLines.at(i)];
+
+            if (id < 0) {
+                id = interner->intern(m_interner->line(m_oldLines.at(i)));
+            }
+
+            m_oldLines[i] = id;
+        }
+    } else {
+        m_oldLines.clear();
+    }
+
+    m_interner = interner;
+}
+
+// private
+void UnsavedDiffWidget::stopDiff()
+{
+    m_diffTimer.stop();
+    m_diffPending = false;
+
+    ++m_generation;
+
+    if (m_worker != NULL) {
+        m_worker->requestInterruption();
+        m_worker->wait();
+        m_worker->deleteLater();
+        m_worker = NULL;
+    }
+}
@@ -19,12 +19,60 @@
 #ifndef UNSAVEDDIFFWIDGET_H
 #define UNSAVEDDIFFWIDGET_H
 
+#include "linediff.h"
+
+#include <QBasicTimer>
+#include <QSharedPointer>
+#include <QThread>
 #include <QWidget>
 
+class DiffModel;
+class Document;
+class TextCodec;
+class TextDocument;
+
 namespace Ui {
 class UnsavedDiffWidget;
 }
 
+// Diffs the lines of a document against the lines of its file on disk. If the lines on disk are not known yet, then
+// they are read and decoded first.
+class UnsavedDiffWorker : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(UnsavedDiffWorker)
+
+public:
+    UnsavedDiffWorker(int generation, const QSharedPointer<LineInterner> &interner, const QVector<int> &newLines,
+                      QObject *parent = NULL);
+
+    void setOldLines(const QVector<int> &oldLines);
+    void setOldFile(const QString &path, TextCodec *codec);
+
+    // Only valid after diffFinished() was emitted
+    QVector<int> oldLines() const { return m_oldLines; }
+    QVector<int> newLines() const { return m_newLines; }
+    QVector<LineDiff::Hunk> hunks() const { return m_hunks; }
+
+signals:
+    void diffFinished(int generation);
+
+protected:
+    void run();
+
+private:
+    int m_generation;
+    QSharedPointer<LineInterner> m_interner;
+    QString m_oldPath; // empty if the old lines are given
+    TextCodec *m_oldCodec;
+    QVector<int> m_oldLines;
+    QVector<int> m_newLines;
+    QVector<LineDiff::Hunk> m_hunks;
+};
+
+// Shows the lines of the current text document that differ from its file on disk. The lines of the document are kept
+// as interned line IDs that are updated block by block as the document changes, the diff itself runs on a worker
+// thread while this widget is visible.
 class UnsavedDiffWidget : public QWidget
 {
     Q_OBJECT
@@ -34,11 +82,45 @@ public:
     explicit UnsavedDiffWidget(QWidget *parent = NULL);
     ~UnsavedDiffWidget();
 
+    void setDocument(Document *document);
+
 signals:
     void hideClicked();
 
+protected:
+    void showEvent(QShowEvent *event);
+    void timerEvent(QTimerEvent *event);
+
+private slots:
+    void updateLines(int position, int charsRemoved, int charsAdded);
+    void scheduleDiff();
+    void forgetDocument();
+    void finishDiff(int generation);
+
 private:
+    enum {
+        DiffDelay = 150, // milliseconds
+        MaximumInternerGrowth = 4, // interned lines per referenced line before the interner is compacted
+        MinimumInternerSize = 4096 // lines, smaller interners are never compacted
+    };
+
+    void clearLines();
+    void startDiff();
+    void compactInterner();
+    void stopDiff();
+
     Ui::UnsavedDiffWidget *m_ui;
+    DiffModel *m_model;
+    TextDocument *m_document;
+    QSharedPointer<LineInterner> m_interner;
+    QVector<int> m_oldLines;
+    bool m_hasOldLines; // if not, the old lines are read from disk
+    QVector<int> m_newLines;
+    bool m_hasNewLines;
+    UnsavedDiffWorker *m_worker;
+    int m_generation;
+    bool m_diffPending;
+    QBasicTimer m_diffTimer;
 };
 
 #endif // UNSAVEDDIFFWIDGET_H
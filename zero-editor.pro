@@ -1,65 +1,107 @@
 TEMPLATE     = app
 TARGET       = zero-editor
 QT          += core gui widgets
-SOURCES     += src/binaryeditor.cpp \
+SOURCES     += src/autosave.cpp \
+               src/binaryeditor.cpp \
                src/binaryeditorwidget.cpp \
+               src/binarydecoder.cpp \
                src/binarydocument.cpp \
+               src/binaryinspectorwidget.cpp \
+               src/binarymimedata.cpp \
+               src/binarysearcher.cpp \
                src/bookmarkswidget.cpp \
                src/document.cpp \
+               src/diffmodel.cpp \
+               src/directorymodel.cpp \
                src/documentmanager.cpp \
                src/editor.cpp \
                src/editorcolors.cpp \
                src/encodingdialog.cpp \
                src/eventfilter.cpp \
                src/filedialog.cpp \
+               src/filewatcher.cpp \
+               src/fileindex.cpp \
+               src/filesmodel.cpp \
                src/fileswidget.cpp \
                src/findandreplacewidget.cpp \
                src/findinfileswidget.cpp \
+               src/gitchangetracker.cpp \
                src/gitdiffwidget.cpp \
+               src/gitrepository.cpp \
+               src/latencydialog.cpp \
+               src/latencytracer.cpp \
                src/lexer.cpp \
+               src/linediff.cpp \
+               src/lineindex.cpp \
                src/location.cpp \
                src/main.cpp \
                src/mainwindow.cpp \
                src/monospacefontmetrics.cpp \
                src/openfileswidget.cpp \
+               src/quickopendialog.cpp \
+               src/recentfiles.cpp \
                src/recentfileswidget.cpp \
                src/settings.cpp \
+               src/startupprofiler.cpp \
                src/style.cpp \
                src/syntaxhighlighter.cpp \
                src/textcodec.cpp \
                src/texteditor.cpp \
                src/texteditorwidget.cpp \
                src/textdocument.cpp \
+               src/textviewer.cpp \
+               src/textviewerwidget.cpp \
                src/unsaveddiffwidget.cpp \
                src/utils.cpp
-HEADERS     += src/binaryeditor.h \
+HEADERS     += src/autosave.h \
+               src/binaryeditor.h \
                src/binaryeditorwidget.h \
+               src/binarydecoder.h \
                src/binarydocument.h \
+               src/binaryinspectorwidget.h \
+               src/binarymimedata.h \
+               src/binarysearcher.h \
                src/bookmarkswidget.h \
                src/document.h \
+               src/diffmodel.h \
+               src/directorymodel.h \
                src/documentmanager.h \
                src/editor.h \
                src/editorcolors.h \
                src/encodingdialog.h \
                src/eventfilter.h \
                src/filedialog.h \
+               src/filewatcher.h \
+               src/fileindex.h \
+               src/filesmodel.h \
                src/fileswidget.h \
                src/findandreplacewidget.h \
                src/findinfileswidget.h \
+               src/gitchangetracker.h \
                src/gitdiffwidget.h \
+               src/gitrepository.h \
+               src/latencydialog.h \
+               src/latencytracer.h \
                src/lexer.h \
+               src/linediff.h \
+               src/lineindex.h \
                src/location.h \
                src/mainwindow.h \
                src/monospacefontmetrics.h \
                src/openfileswidget.h \
+               src/quickopendialog.h \
+               src/recentfiles.h \
                src/recentfileswidget.h \
                src/settings.h \
+               src/startupprofiler.h \
                src/style.h \
                src/syntaxhighlighter.h \
                src/textcodec.h \
                src/texteditor.h \
                src/texteditorwidget.h \
                src/textdocument.h \
+               src/textviewer.h \
+               src/textviewerwidget.h \
                src/unsaveddiffwidget.h \
                src/utils.h
 FORMS       += src/bookmarkswidget.ui \